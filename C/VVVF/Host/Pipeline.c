@@ -0,0 +1,235 @@
+#include "Pipeline.h"
+#include "Parameters.h"
+
+#include <math.h>
+#include <string.h>
+
+#define POLL_US (double)1000 // sleep_ms(1) in both loops
+
+typedef enum {
+    GENERATOR_WAKE,     // Check whether the next slot is free
+    GENERATOR_DONE,     // Finished filling a slot
+    PLAYBACK_WAKE,      // Check whether the next slot is ready
+    PLAYBACK_RELEASE    // Slept a buffer period after the play call, release the slot
+} ActorState;
+
+typedef struct {
+    double time;        // Next event
+    ActorState state;
+    int slot;
+} Actor;
+
+typedef struct {
+    const PipelineConfig* config;
+    PipelineResult* result;
+    uint32_t random;
+    double bufferUs;
+
+    bool ready[PIPELINE_MAX_BUFFERS];
+    double readyTime[PIPELINE_MAX_BUFFERS];
+    int readyCount;
+    double lastOccupancyChange;
+
+    bool waitCounted;           // Playback already counted a starvation wait for this slot
+    double firmwareEnd;         // When the last queued sample has been played, < 0 before the first buffer
+    double latencySum;
+} Simulation;
+
+static double Random(Simulation* _Sim) {
+    // xorshift32
+    uint32_t x = _Sim->random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    _Sim->random = x;
+    return (double)x / (double)UINT32_MAX;
+}
+
+// First time at or after _Time that is not inside an LBM burst
+static double AfterBurst(const PipelineConfig* _Config, double _Time) {
+    if (_Config->burstUs <= 0.0f || _Config->burstPeriodUs <= 0.0f) return _Time;
+    double phase = fmod(_Time, (double)_Config->burstPeriodUs);
+    if (phase < (double)_Config->burstUs) return _Time - phase + (double)_Config->burstUs;
+    return _Time;
+}
+
+// When _WorkUs of CPU time started at _Start is done, with LBM bursts taking the CPU in between
+static double RunWork(const PipelineConfig* _Config, double _Start, double _WorkUs) {
+    double time = AfterBurst(_Config, _Start);
+    if (_Config->burstUs <= 0.0f || _Config->burstPeriodUs <= 0.0f) return time + _WorkUs;
+
+    double period = (double)_Config->burstPeriodUs;
+    for (;;) {
+        double nextBurst = (floor(time / period) + 1) * period;
+        if (time + _WorkUs <= nextBurst) return time + _WorkUs;
+        _WorkUs -= nextBurst - time;
+        time = nextBurst + (double)_Config->burstUs;
+    }
+}
+
+// Wake up time of a thread sleeping _SleepUs from _Time
+static double Wake(Simulation* _Sim, double _Time, double _SleepUs) {
+    const PipelineConfig* config = _Sim->config;
+    double tick = (double)config->tickUs;
+    double time = _Time + _SleepUs;
+    if (tick > 0) time = ceil(time / tick) * tick;
+    time += Random(_Sim) * (double)config->jitterUs;
+    return AfterBurst(config, time);
+}
+
+static void SetReady(Simulation* _Sim, double _Time, int _Slot, bool _Ready) {
+    _Sim->result->occupancy[_Sim->readyCount] += _Time - _Sim->lastOccupancyChange;
+    _Sim->lastOccupancyChange = _Time;
+    _Sim->ready[_Slot] = _Ready;
+    _Sim->readyCount += _Ready ? 1 : -1;
+}
+
+// foc_play_audio_samples, at _Time
+static void PlayBuffer(Simulation* _Sim, double _Time, int _Slot) {
+    PipelineResult* result = _Sim->result;
+
+    double start = _Time;
+    if (_Sim->firmwareEnd >= 0) {
+        if (_Sim->firmwareEnd < _Time) {
+            result->underruns++;
+            result->gapUs += _Time - _Sim->firmwareEnd;
+        } else {
+            // Buffers still queued, including the one playing
+            double queued = ceil((_Sim->firmwareEnd - _Time) / _Sim->bufferUs - (double)1e-6f);
+            if (queued >= (double)_Sim->config->firmwareSlots) {
+                result->rejected++;
+                return;
+            }
+            start = _Sim->firmwareEnd;
+        }
+    }
+
+    _Sim->firmwareEnd = start + _Sim->bufferUs;
+    result->buffersPlayed++;
+
+    double latency = start - _Sim->readyTime[_Slot];
+    _Sim->latencySum += latency;
+    if (latency > result->latencyMaxUs) result->latencyMaxUs = latency;
+}
+
+static void StepGenerator(Simulation* _Sim, Actor* _Generator) {
+    const PipelineConfig* config = _Sim->config;
+    double now = _Generator->time;
+
+    switch (_Generator->state) {
+        case GENERATOR_WAKE:
+            if (_Sim->ready[_Generator->slot]) {
+                _Generator->time = Wake(_Sim, now, POLL_US);
+            } else {
+                double work = (double)config->generationOverheadUs +
+                              (double)config->generationUsPerSample * (double)config->bufferLength;
+                _Generator->time = RunWork(config, now, work);
+                _Generator->state = GENERATOR_DONE;
+            }
+            break;
+
+        case GENERATOR_DONE:
+            _Sim->readyTime[_Generator->slot] = now;
+            SetReady(_Sim, now, _Generator->slot, true);
+            _Sim->result->buffersGenerated++;
+            _Generator->slot = (_Generator->slot + 1) % config->numBuffers;
+            _Generator->state = GENERATOR_WAKE;
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void StepPlayback(Simulation* _Sim, Actor* _Playback) {
+    const PipelineConfig* config = _Sim->config;
+    double now = _Playback->time;
+
+    switch (_Playback->state) {
+        case PLAYBACK_WAKE:
+            if (!_Sim->ready[_Playback->slot]) {
+                if (!_Sim->waitCounted && _Sim->result->buffersPlayed + _Sim->result->rejected > 0) {
+                    _Sim->result->starvationWaits++;
+                    _Sim->waitCounted = true;
+                }
+                _Playback->time = Wake(_Sim, now, POLL_US);
+            } else {
+                _Sim->waitCounted = false;
+                PlayBuffer(_Sim, now, _Playback->slot);
+                _Playback->time = Wake(_Sim, RunWork(config, now, (double)config->playCallUs), _Sim->bufferUs);
+                _Playback->state = PLAYBACK_RELEASE;
+            }
+            break;
+
+        case PLAYBACK_RELEASE:
+            SetReady(_Sim, now, _Playback->slot, false);
+            _Playback->slot = (_Playback->slot + 1) % config->numBuffers;
+            _Playback->state = PLAYBACK_WAKE;
+            break;
+
+        default:
+            break;
+    }
+}
+
+void Pipeline_DefaultConfig(PipelineConfig* _Config) {
+    memset(_Config, 0, sizeof(PipelineConfig));
+    _Config->bufferLength = BUFFER_LENGTH;
+    _Config->numBuffers = NUM_BUFFERS;
+    _Config->sampleRate = SAMPLE_RATE;
+    _Config->durationS = 60.0f;
+    _Config->generationOverheadUs = 10.0f;
+    _Config->generationUsPerSample = 0.5f;   // About 85 cycles at 168 MHz, see ext-bench for real numbers
+    _Config->playCallUs = 20.0f;
+    _Config->jitterUs = 200.0f;
+    _Config->tickUs = 100.0f;                // 10 kHz ChibiOS system tick
+    _Config->burstUs = 500.0f;
+    _Config->burstPeriodUs = 20000.0f;       // Lisp/Main.lisp updates every 20 ms
+    _Config->firmwareSlots = 2;
+    _Config->seed = 1;
+}
+
+bool Pipeline_Run(const PipelineConfig* _Config, PipelineResult* _Result) {
+    memset(_Result, 0, sizeof(PipelineResult));
+    if (_Config->bufferLength <= 0 || _Config->numBuffers <= 0 || _Config->numBuffers > PIPELINE_MAX_BUFFERS ||
+        _Config->sampleRate <= 0.0f || _Config->firmwareSlots <= 0 || _Config->durationS <= 0.0f) {
+        return false;
+    }
+
+    Simulation sim;
+    memset(&sim, 0, sizeof(Simulation));
+    sim.config = _Config;
+    sim.result = _Result;
+    sim.random = _Config->seed ? _Config->seed : 1;
+    sim.bufferUs = (double)_Config->bufferLength / (double)_Config->sampleRate * (double)1000000;
+    sim.firmwareEnd = -1;
+
+    // Both threads are spawned together by ext-start-audio-loop
+    Actor generator = { 0.0, GENERATOR_WAKE, 0 };
+    Actor playback = { 0.0, PLAYBACK_WAKE, 0 };
+    double end = (double)_Config->durationS * (double)1000000;
+
+    for (;;) {
+        // The generator goes first on a tie, the same buffer can be made ready and picked up at once
+        bool generatorNext = generator.time <= playback.time;
+        if ((generatorNext ? generator.time : playback.time) >= end) break;
+
+        if (generatorNext) {
+            StepGenerator(&sim, &generator);
+        } else {
+            StepPlayback(&sim, &playback);
+        }
+    }
+
+    // Close the occupancy accounting at the end of the run
+    _Result->occupancy[sim.readyCount] += end - sim.lastOccupancyChange;
+    for (int i = 0; i <= _Config->numBuffers; i++) {
+        _Result->occupancy[i] /= end;
+        _Result->occupancyMean += (double)i * _Result->occupancy[i];
+    }
+
+    if (_Result->buffersPlayed > 0) {
+        _Result->latencyMeanUs = sim.latencySum / (double)_Result->buffersPlayed;
+    }
+    return true;
+}
@@ -0,0 +1,65 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Discrete event model of the sample pipeline in Main.c, on a virtual clock, so buffer
+// sizes can be chosen from data. Unlike the stub in VescStub.c it does not run the plugin,
+// which means BUFFER_LENGTH and NUM_BUFFERS can be any value without rebuilding.
+//
+// Modeled after the code as it is:
+//  - generator_loop: polls the next slot with sleep_ms(1) until playback released it, then
+//    takes generationOverheadUs + generationUsPerSample * bufferLength to fill it
+//  - playback_loop: polls with sleep_ms(1) until the next slot is ready, hands it to the
+//    firmware (foc_play_audio_samples does not block), sleeps one buffer period and only
+//    then releases the slot
+//  - firmware: drains the samples at sampleRate, holding at most firmwareSlots buffers.
+//    A play call while all slots are taken is rejected and its samples are lost.
+//  - scheduling: every wake up is rounded up to the system tick and delayed by a uniform
+//    random jitter of up to jitterUs
+//  - LBM: the Lisp update loop takes the CPU for burstUs every burstPeriodUs. Threads that
+//    wake during a burst wait for its end, generation in progress is paused by it.
+//
+// An underrun here is what can be heard: the firmware running out of samples after the
+// first buffer. Playback waiting for a buffer (what Main.c counts as an underrun) is
+// reported separately as a starvation wait, it only matters if it also causes a gap.
+
+#define PIPELINE_MAX_BUFFERS 16
+
+typedef struct {
+    int bufferLength;             // Samples per buffer, BUFFER_LENGTH
+    int numBuffers;               // NUM_BUFFERS
+    float sampleRate;             // Hz
+    float durationS;              // Simulated time
+    float generationOverheadUs;   // Fixed cost of one GenerateSamples call
+    float generationUsPerSample;
+    float playCallUs;             // Duration of foc_play_audio_samples
+    float jitterUs;               // Largest extra delay on a wake up
+    float tickUs;                 // System tick, sleeps end on a tick
+    float burstUs;                // CPU time taken by one LBM update, 0 for none
+    float burstPeriodUs;          // Time between LBM updates
+    int firmwareSlots;            // Buffers the firmware can hold, including the one playing
+    uint32_t seed;                // Jitter random seed, the same seed gives the same run
+} PipelineConfig;
+
+typedef struct {
+    uint32_t buffersGenerated;
+    uint32_t buffersPlayed;       // Accepted by the firmware
+    uint32_t rejected;            // Play calls the firmware had no room for
+    uint32_t starvationWaits;     // Buffers playback had to wait for, as counted by Main.c
+    uint32_t underruns;           // Times the firmware ran dry
+    double gapUs;                 // Total silence from underruns
+    double latencyMeanUs;         // Buffer ready to first sample audible
+    double latencyMaxUs;
+    double occupancy[PIPELINE_MAX_BUFFERS + 1]; // Fraction of the time with n buffers ready
+    double occupancyMean;
+} PipelineResult;
+
+// Values matching Parameters.h and a typical hardware setup
+void Pipeline_DefaultConfig(PipelineConfig* _Config);
+
+// Returns false for a config that can't be simulated
+bool Pipeline_Run(const PipelineConfig* _Config, PipelineResult* _Result);
+
+#endif // PIPELINE_H
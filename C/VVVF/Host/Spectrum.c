@@ -0,0 +1,186 @@
+#include "Spectrum.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PI_F 3.14159265358979f
+#define EXPECTED_HALF_WIDTH_BINS 4   // Hann main lobe is +-2 bins, leave room for a carrier between bins
+
+// In place iterative radix 2 FFT, _Length must be a power of two
+static void Fft(float* _Real, float* _Imag, int _Length) {
+    // Bit reversal permutation
+    for (int i = 1, j = 0; i < _Length; i++) {
+        int bit = _Length >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            float t = _Real[i]; _Real[i] = _Real[j]; _Real[j] = t;
+            t = _Imag[i]; _Imag[i] = _Imag[j]; _Imag[j] = t;
+        }
+    }
+
+    for (int size = 2; size <= _Length; size <<= 1) {
+        int half = size >> 1;
+        float angle = -2.0f * PI_F / (float)size;
+        for (int k = 0; k < half; k++) {
+            float wr = cosf(angle * (float)k);
+            float wi = sinf(angle * (float)k);
+            for (int i = k; i < _Length; i += size) {
+                int j = i + half;
+                float tr = _Real[j] * wr - _Imag[j] * wi;
+                float ti = _Real[j] * wi + _Imag[j] * wr;
+                _Real[j] = _Real[i] - tr;
+                _Imag[j] = _Imag[i] - ti;
+                _Real[i] += tr;
+                _Imag[i] += ti;
+            }
+        }
+    }
+}
+
+// Peak position in bins, interpolated with a parabola through the log magnitudes around it
+static float InterpolatePeak(const float* _Power, int _Bin, int _LastBin) {
+    if (_Bin <= 0 || _Bin >= _LastBin) return (float)_Bin;
+    float a = logf(_Power[_Bin - 1] + 1e-30f);
+    float b = logf(_Power[_Bin] + 1e-30f);
+    float c = logf(_Power[_Bin + 1] + 1e-30f);
+    float denominator = a - 2.0f * b + c;
+    if (denominator == 0.0f) return (float)_Bin;
+    return (float)_Bin + 0.5f * (a - c) / denominator;
+}
+
+static void MarkExpected(bool* _Expected, int _Bins, float _FrequencyHz, float _BinHz) {
+    int center = (int)lrintf(_FrequencyHz / _BinHz);
+    for (int k = center - EXPECTED_HALF_WIDTH_BINS; k <= center + EXPECTED_HALF_WIDTH_BINS; k++) {
+        if (k >= 0 && k < _Bins) _Expected[k] = true;
+    }
+}
+
+static bool IsNearHarmonic(int _Bin, float _CarrierHz, float _BinHz) {
+    float harmonic = roundf((float)_Bin * _BinHz / _CarrierHz);
+    if (harmonic < 1.0f) return false;
+    return fabsf((float)_Bin - harmonic * _CarrierHz / _BinHz) <= (float)EXPECTED_HALF_WIDTH_BINS;
+}
+
+static float PowerRatioDb(float _Power, float _Reference) {
+    if (_Power <= 0.0f) return -INFINITY;
+    return 10.0f * log10f(_Power / _Reference);
+}
+
+bool Spectrum_Analyze(const float* _Samples, int _Count, float _SampleRate, float _CommandHz, SpectrumReport* _Report) {
+    memset(_Report, 0, sizeof(SpectrumReport));
+    _Report->aliasDb = -INFINITY;
+    if (_Count < SPECTRUM_MIN_LENGTH) return false;
+
+    int length = SPECTRUM_MIN_LENGTH;
+    while (length * 2 <= _Count && length * 2 <= SPECTRUM_MAX_LENGTH) {
+        length *= 2;
+    }
+    int bins = length / 2 + 1;
+
+    float* real = malloc((size_t)length * sizeof(float));
+    float* imag = calloc((size_t)length, sizeof(float));
+    bool* expected = calloc((size_t)bins, sizeof(bool));
+    if (!real || !imag || !expected) {
+        free(real);
+        free(imag);
+        free(expected);
+        return false;
+    }
+
+    for (int i = 0; i < length; i++) {
+        float window = 0.5f - 0.5f * cosf(2.0f * PI_F * (float)i / (float)length);
+        real[i] = _Samples[i] * window;
+    }
+    Fft(real, imag, length);
+
+    // Power spectrum, reusing the real part
+    float* power = real;
+    for (int k = 0; k < bins; k++) {
+        power[k] = real[k] * real[k] + imag[k] * imag[k];
+    }
+
+    _Report->length = length;
+    _Report->binHz = _SampleRate / (float)length;
+    int minBin = (int)ceilf(SPECTRUM_MIN_FREQUENCY_HZ / _Report->binHz);
+
+    float total = 0.0f;
+    int carrierBin = minBin;
+    for (int k = minBin; k < bins; k++) {
+        total += power[k];
+        if (power[k] > power[carrierBin]) carrierBin = k;
+    }
+
+    if (total > 1e-12f) {
+        // A full scale sine peaks at length / 4 with the Hann window's coherent gain of 0.5
+        float fullScale = (float)length / 4.0f;
+        _Report->carrierHz = InterpolatePeak(power, carrierBin, bins - 1) * _Report->binHz;
+        _Report->carrierDb = PowerRatioDb(power[carrierBin], fullScale * fullScale);
+
+        // Carrier harmonics below Nyquist, and the command sidebands around them, are the signal
+        for (int k = 0; k < minBin; k++) {
+            expected[k] = true;
+        }
+        for (int h = 1; (float)h * _Report->carrierHz < _SampleRate / 2.0f; h++) {
+            float harmonic = (float)h * _Report->carrierHz;
+            MarkExpected(expected, bins, harmonic, _Report->binHz);
+            for (int m = 1; _CommandHz > 0.0f && m <= SPECTRUM_COMMAND_SIDEBANDS; m++) {
+                MarkExpected(expected, bins, harmonic - (float)m * _CommandHz, _Report->binHz);
+                MarkExpected(expected, bins, harmonic + (float)m * _CommandHz, _Report->binHz);
+            }
+        }
+
+        float alias = 0.0f;
+        int aliasLastBin = (int)(SPECTRUM_ALIAS_BAND_HZ / _Report->binHz);
+        for (int k = minBin; k <= aliasLastBin && k < bins; k++) {
+            if (!expected[k]) alias += power[k];
+        }
+        _Report->aliasDb = PowerRatioDb(alias, total);
+
+        // Strongest local maxima around the carrier, excluding the carrier and its harmonics
+        int span = (int)(SPECTRUM_SIDEBAND_SPAN_HZ / _Report->binHz);
+        for (int k = carrierBin - span; k <= carrierBin + span; k++) {
+            if (k <= minBin || k >= bins - 1) continue;
+            if (IsNearHarmonic(k, _Report->carrierHz, _Report->binHz)) continue;
+            if (power[k] <= power[k - 1] || power[k] < power[k + 1]) continue;
+
+            float levelDb = PowerRatioDb(power[k], power[carrierBin]);
+            if (levelDb < SPECTRUM_SIDEBAND_FLOOR_DB) continue;
+
+            // Keep the list sorted by level, strongest first
+            int slot = _Report->sidebandCount;
+            while (slot > 0 && _Report->sidebands[slot - 1].levelDb < levelDb) {
+                if (slot < SPECTRUM_MAX_SIDEBANDS) _Report->sidebands[slot] = _Report->sidebands[slot - 1];
+                slot--;
+            }
+            if (slot < SPECTRUM_MAX_SIDEBANDS) {
+                _Report->sidebands[slot].offsetHz = InterpolatePeak(power, k, bins - 1) * _Report->binHz - _Report->carrierHz;
+                _Report->sidebands[slot].levelDb = levelDb;
+                if (_Report->sidebandCount < SPECTRUM_MAX_SIDEBANDS) _Report->sidebandCount++;
+            }
+        }
+
+        if (_CommandHz > 0.0f) {
+            _Report->pulsesPerCycle = _Report->carrierHz / _CommandHz;
+        }
+    }
+
+    free(real);
+    free(imag);
+    free(expected);
+    return true;
+}
+
+bool Spectrum_AnalyzeInt8(const int8_t* _Samples, int _Count, float _SampleRate, float _CommandHz, SpectrumReport* _Report) {
+    float* samples = malloc((size_t)(_Count > 0 ? _Count : 1) * sizeof(float));
+    if (!samples) return false;
+    for (int i = 0; i < _Count; i++) {
+        samples[i] = (float)_Samples[i] / 127.0f;
+    }
+    bool result = Spectrum_Analyze(samples, _Count, _SampleRate, _CommandHz, _Report);
+    free(samples);
+    return result;
+}
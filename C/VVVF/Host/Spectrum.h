@@ -0,0 +1,51 @@
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Spectral checks for rendered generator output. The signal is Hann windowed and
+// transformed at full length (the largest power of two that fits, up to
+// SPECTRUM_MAX_LENGTH samples) with a radix 2 FFT, then reduced to a few numbers:
+//
+//  - carrier:     strongest component, with parabolic interpolation between bins
+//  - sidebands:   strongest other peaks within SPECTRUM_SIDEBAND_SPAN_HZ of the carrier
+//  - alias:       power below SPECTRUM_ALIAS_BAND_HZ that is not at a carrier harmonic
+//                 (or a command sideband of one), relative to the total power. A triangle
+//                 carrier only has odd harmonics, anything else down there was folded
+//                 back from above Nyquist or is noise.
+//  - pulses:      carrier / command frequency, the pulses per cycle a sync mode achieves
+
+#define SPECTRUM_MIN_LENGTH 1024
+#define SPECTRUM_MAX_LENGTH 65536
+#define SPECTRUM_MIN_FREQUENCY_HZ 20.0f    // Anything below is treated as DC
+#define SPECTRUM_ALIAS_BAND_HZ 5000.0f
+#define SPECTRUM_SIDEBAND_SPAN_HZ 2000.0f
+#define SPECTRUM_SIDEBAND_FLOOR_DB -60.0f  // Relative to the carrier
+#define SPECTRUM_MAX_SIDEBANDS 4
+#define SPECTRUM_COMMAND_SIDEBANDS 4       // Command sidebands per harmonic counted as expected
+
+typedef struct {
+    float offsetHz;   // Relative to the carrier
+    float levelDb;    // Relative to the carrier
+} SpectrumSideband;
+
+typedef struct {
+    int length;                 // Samples transformed
+    float binHz;
+    float carrierHz;            // 0 if the signal is silent
+    float carrierDb;            // Relative to a full scale sine
+    SpectrumSideband sidebands[SPECTRUM_MAX_SIDEBANDS];
+    int sidebandCount;
+    float aliasDb;              // Alias power relative to the total power, -INFINITY if there is none
+    float pulsesPerCycle;       // 0 if no command frequency was given
+} SpectrumReport;
+
+// _Samples are normalized to -1.0 to 1.0. _CommandHz is the fundamental the output should be
+// synchronized to, or 0 for asynchronous output. Returns false if there are too few samples.
+bool Spectrum_Analyze(const float* _Samples, int _Count, float _SampleRate, float _CommandHz, SpectrumReport* _Report);
+
+// Same, for raw generator output
+bool Spectrum_AnalyzeInt8(const int8_t* _Samples, int _Count, float _SampleRate, float _CommandHz, SpectrumReport* _Report);
+
+#endif // SPECTRUM_H
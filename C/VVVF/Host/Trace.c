@@ -0,0 +1,139 @@
+#include "Trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void Trace_Init(Trace* _Trace) {
+    memset(_Trace, 0, sizeof(Trace));
+}
+
+void Trace_Free(Trace* _Trace) {
+    free(_Trace->samples);
+    Trace_Init(_Trace);
+}
+
+bool Trace_Append(Trace* _Trace, const TraceSample* _Sample) {
+    if (_Trace->count >= _Trace->capacity) {
+        int capacity = _Trace->capacity ? _Trace->capacity * 2 : 1024;
+        TraceSample* samples = realloc(_Trace->samples, (size_t)capacity * sizeof(TraceSample));
+        if (!samples) return false;
+        _Trace->samples = samples;
+        _Trace->capacity = capacity;
+    }
+    _Trace->samples[_Trace->count++] = *_Sample;
+    return true;
+}
+
+static bool LoadBinary(Trace* _Trace, FILE* _File) {
+    uint32_t header[2];
+    if (fread(header, sizeof(uint32_t), 2, _File) != 2) return false;
+    if (header[0] != TRACE_BINARY_VERSION) {
+        fprintf(stderr, "Unsupported trace version %u\n", header[0]);
+        return false;
+    }
+    for (uint32_t i = 0; i < header[1]; i++) {
+        float values[4];
+        if (fread(values, sizeof(float), 4, _File) != 4) return false;
+        TraceSample sample = { values[0], values[1], values[2], values[3] };
+        if (!Trace_Append(_Trace, &sample)) return false;
+    }
+    return true;
+}
+
+static bool LoadCsv(Trace* _Trace, FILE* _File) {
+    char line[256];
+    while (fgets(line, sizeof(line), _File)) {
+        TraceSample sample;
+        // Header and comment lines don't parse as numbers and are skipped
+        if (sscanf(line, "%f,%f,%f,%f", &sample.time, &sample.rpm, &sample.current, &sample.speedKmh) != 4) {
+            continue;
+        }
+        if (!Trace_Append(_Trace, &sample)) return false;
+    }
+    return true;
+}
+
+bool Trace_Load(Trace* _Trace, const char* _Path) {
+    FILE* file = fopen(_Path, "rb");
+    if (!file) {
+        fprintf(stderr, "Failed to open trace %s\n", _Path);
+        return false;
+    }
+
+    Trace_Init(_Trace);
+
+    char magic[4] = { 0 };
+    bool binary = fread(magic, 1, 4, file) == 4 && memcmp(magic, TRACE_BINARY_MAGIC, 4) == 0;
+    if (!binary) rewind(file);
+
+    bool ok = binary ? LoadBinary(_Trace, file) : LoadCsv(_Trace, file);
+    fclose(file);
+
+    if (!ok || _Trace->count == 0) {
+        fprintf(stderr, "Failed to read trace %s\n", _Path);
+        Trace_Free(_Trace);
+        return false;
+    }
+    return true;
+}
+
+bool Trace_SaveCsv(const Trace* _Trace, const char* _Path) {
+    FILE* file = fopen(_Path, "w");
+    if (!file) return false;
+    fprintf(file, "time_s,rpm,current,speed_kmh\n");
+    for (int i = 0; i < _Trace->count; i++) {
+        const TraceSample* s = &_Trace->samples[i];
+        fprintf(file, "%.4f,%.1f,%.2f,%.3f\n", (double)s->time, (double)s->rpm, (double)s->current, (double)s->speedKmh);
+    }
+    fclose(file);
+    return true;
+}
+
+bool Trace_SaveBinary(const Trace* _Trace, const char* _Path) {
+    FILE* file = fopen(_Path, "wb");
+    if (!file) return false;
+    uint32_t header[2] = { TRACE_BINARY_VERSION, (uint32_t)_Trace->count };
+    fwrite(TRACE_BINARY_MAGIC, 1, 4, file);
+    fwrite(header, sizeof(uint32_t), 2, file);
+    for (int i = 0; i < _Trace->count; i++) {
+        const TraceSample* s = &_Trace->samples[i];
+        float values[4] = { s->time, s->rpm, s->current, s->speedKmh };
+        fwrite(values, sizeof(float), 4, file);
+    }
+    fclose(file);
+    return true;
+}
+
+float Trace_Duration(const Trace* _Trace) {
+    if (_Trace->count == 0) return 0.0f;
+    return _Trace->samples[_Trace->count - 1].time - _Trace->samples[0].time;
+}
+
+TraceSample Trace_SampleAt(Trace* _Trace, float _Time) {
+    TraceSample empty = { _Time, 0.0f, 0.0f, 0.0f };
+    if (_Trace->count == 0) return empty;
+
+    const TraceSample* samples = _Trace->samples;
+    int last = _Trace->count - 1;
+    if (_Time <= samples[0].time) return samples[0];
+    if (_Time >= samples[last].time) return samples[last];
+
+    int i = _Trace->cursor;
+    if (i < 0 || i >= last) i = 0;
+    while (_Time < samples[i].time) i--;
+    while (_Time > samples[i + 1].time) i++;
+    _Trace->cursor = i;
+
+    const TraceSample* a = &samples[i];
+    const TraceSample* b = &samples[i + 1];
+    float span = b->time - a->time;
+    float t = span > 0.0f ? (_Time - a->time) / span : 1.0f;
+
+    TraceSample result;
+    result.time = _Time;
+    result.rpm = a->rpm + (b->rpm - a->rpm) * t;
+    result.current = a->current + (b->current - a->current) * t;
+    result.speedKmh = a->speedKmh + (b->speedKmh - a->speedKmh) * t;
+    return result;
+}
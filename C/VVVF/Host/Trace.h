@@ -0,0 +1,45 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Recorded (or synthesized) ride telemetry, the same values Lisp/Main.lisp feeds the plugin.
+//
+// Traces are loaded from either
+//   CSV:    time_s,rpm,current,speed_kmh (one row per sample, header line optional)
+//   Binary: "VVTR", uint32 version, uint32 count, then count x 4 little endian floats in the same order
+
+#define TRACE_BINARY_MAGIC "VVTR"
+#define TRACE_BINARY_VERSION 1
+
+typedef struct {
+    float time;     // Seconds since the start of the trace
+    float rpm;      // Electrical rpm, as returned by get-rpm
+    float current;  // Motor current in A
+    float speedKmh; // Speed in km/h
+} TraceSample;
+
+typedef struct {
+    TraceSample* samples;
+    int count;
+    int capacity;
+    int cursor;     // Segment of the last Trace_SampleAt lookup
+} Trace;
+
+void Trace_Init(Trace* _Trace);
+void Trace_Free(Trace* _Trace);
+bool Trace_Append(Trace* _Trace, const TraceSample* _Sample);
+
+// Loads CSV or binary, detected from the first bytes of the file
+bool Trace_Load(Trace* _Trace, const char* _Path);
+bool Trace_SaveCsv(const Trace* _Trace, const char* _Path);
+bool Trace_SaveBinary(const Trace* _Trace, const char* _Path);
+
+float Trace_Duration(const Trace* _Trace);
+
+// Linearly interpolated sample at the given time, clamped to the ends of the trace.
+// Lookups are cached, so stepping forward through the trace is O(1) per call.
+TraceSample Trace_SampleAt(Trace* _Trace, float _Time);
+
+#endif // TRACE_H
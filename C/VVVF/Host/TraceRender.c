@@ -0,0 +1,163 @@
+// Offline renderer: drives the real plugin with a recorded ride trace and writes what it
+// would have played to a WAV file, plus a per-buffer parameter log.
+//
+//   vvvf_render [-p profile] [-n poles] [-u update_ms] [-v full_scale_volts] [-l log.csv] trace out.wav
+//
+// The trace is fed to the extensions every update_ms of virtual time, exactly like the Lisp
+// loop does on the VESC, so the control logic, speed range selection and sample generation
+// all run through the same code as on the motor, only many times faster than real time.
+
+#include "VescStub.h"
+#include "Parameters.h"
+#include "Trace.h"
+#include "Wav.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define STATUS_FIELDS 7
+
+typedef struct {
+    WavWriter wav;
+    FILE* log;
+    float fullScaleVolts;
+    uint64_t buffers;
+} RenderState;
+
+static void RenderBuffer(const int8_t* samples, int numSamples, float sampleRate, float voltage, void* arg) {
+    (void)sampleRate;
+    RenderState* render = (RenderState*)arg;
+    uint64_t now = VescStub_GetTimeUs();
+
+    // Keep the WAV aligned with virtual time, the plugin doesn't play anything while disabled
+    uint64_t position = now * SAMPLE_RATE / 1000000u;
+    if (position > render->wav.samplesWritten) {
+        Wav_WriteSilence(&render->wav, (int)(position - render->wav.samplesWritten));
+    }
+
+    // The samples are scaled by the injection voltage on the motor, so do the same here
+    float scale = render->fullScaleVolts > 0.0f ? voltage / render->fullScaleVolts : 0.0f;
+    if (scale > 1.0f) scale = 1.0f;
+    int16_t pcm[1024];
+    for (int offset = 0; offset < numSamples; offset += 1024) {
+        int count = numSamples - offset < 1024 ? numSamples - offset : 1024;
+        for (int i = 0; i < count; i++) {
+            pcm[i] = (int16_t)((float)samples[offset + i] * 256.0f * scale);
+        }
+        Wav_WriteInt16(&render->wav, pcm, count);
+    }
+
+    if (render->log) {
+        float status[STATUS_FIELDS] = { 0 };
+        VescStub_ListToFloats(VescStub_CallExtensionNoArgs("ext-get-status"), status, STATUS_FIELDS);
+        fprintf(render->log, "%.6f,%d,%.4f,%.3f,%d,%d,%d,%.1f,%.4f\n",
+                (double)now / (double)1000000, numSamples, (double)voltage, (double)status[0],
+                (int)status[1], (int)status[2], (int)status[3], (double)status[4], (double)status[5]);
+    }
+
+    render->buffers++;
+}
+
+static void Usage(const char* _Name) {
+    fprintf(stderr, "Usage: %s [-p profile] [-n poles] [-u update_ms] [-v full_scale_volts] [-l log.csv] trace out.wav\n", _Name);
+}
+
+int main(int argc, char** argv) {
+    const char* profile = "0";
+    int poles = 14;
+    int updateMs = 20;
+    float fullScaleVolts = 0.5f;
+    const char* logPath = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:n:u:v:l:h")) != -1) {
+        switch (opt) {
+            case 'p': profile = optarg; break;
+            case 'n': poles = atoi(optarg); break;
+            case 'u': updateMs = atoi(optarg); break;
+            case 'v': fullScaleVolts = (float)atof(optarg); break;
+            case 'l': logPath = optarg; break;
+            default: Usage(argv[0]); return 1;
+        }
+    }
+    if (argc - optind != 2 || updateMs <= 0 || poles <= 0) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    Trace trace;
+    if (!Trace_Load(&trace, argv[optind])) return 1;
+
+    RenderState render = { 0 };
+    render.fullScaleVolts = fullScaleVolts;
+    if (!Wav_Open(&render.wav, argv[optind + 1], SAMPLE_RATE, 16)) {
+        fprintf(stderr, "Failed to open %s\n", argv[optind + 1]);
+        return 1;
+    }
+    if (logPath) {
+        render.log = fopen(logPath, "w");
+        if (!render.log) {
+            fprintf(stderr, "Failed to open %s\n", logPath);
+            return 1;
+        }
+        fprintf(render.log, "time_s,samples,voltage,speed_kmh,range,rotor_state,spwm_type,carrier_hz,amplitude\n");
+    }
+
+    VescStub_Init();
+    VescStub_SetQuiet(true);
+    VescStub_SetAudioSink(RenderBuffer, &render);
+
+    if (!VescStub_LoadPlugin()) {
+        fprintf(stderr, "Plugin init failed\n");
+        return 1;
+    }
+
+    // Profiles can be given by index or by name
+    char* end;
+    long index = strtol(profile, &end, 10);
+    lbm_value profileArg = *end == '\0' ? VESC_IF->lbm_enc_i((lbm_int)index) : VescStub_EncodeString(profile);
+    if (VescStub_IsError(VescStub_CallExtension("ext-set-profile", &profileArg, 1))) {
+        fprintf(stderr, "Unknown profile %s\n", profile);
+        return 1;
+    }
+
+    struct timespec start, stop;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    VescStub_CallExtensionFloat("ext-set-motor-poles", (float)poles);
+    VescStub_CallExtensionNoArgs("ext-start-audio-loop");
+
+    float t0 = trace.samples[0].time;
+    float duration = Trace_Duration(&trace);
+    uint64_t steps = (uint64_t)(duration * 1000.0f) / (uint64_t)updateMs + 1;
+    for (uint64_t i = 0; i < steps; i++) {
+        TraceSample sample = Trace_SampleAt(&trace, t0 + (float)(i * (uint64_t)updateMs) / 1000.0f);
+
+        VescStub_CallExtensionFloat("ext-set-motor-current", sample.current < 0.0f ? -sample.current : sample.current);
+        VescStub_CallExtensionFloat("ext-set-motor-hz", sample.rpm);
+        VescStub_CallExtensionFloat("ext-set-motor-poles", (float)poles);
+        VescStub_CallExtensionFloat("ext-set-speed-kmh", sample.speedKmh);
+
+        VescStub_SleepUs((uint64_t)updateMs * 1000u);
+    }
+
+    VescStub_CallExtensionNoArgs("ext-stop-audio-loop");
+    VescStub_UnloadPlugin();
+
+    clock_gettime(CLOCK_MONOTONIC, &stop);
+    double wall = (double)(stop.tv_sec - start.tv_sec) + (double)(stop.tv_nsec - start.tv_nsec) / (double)1000000000;
+    double simulated = (double)VescStub_GetTimeUs() / (double)1000000;
+
+    Wav_Close(&render.wav);
+    if (render.log) fclose(render.log);
+
+    double speedup = wall > 0 ? simulated / wall : 0;
+
+    printf("Rendered %.2f s of trace (%d samples) in %.3f s (%.0fx real time), %llu buffers played\n",
+           simulated, trace.count, wall, speedup, (unsigned long long)render.buffers);
+
+    Trace_Free(&trace);
+    return 0;
+}
@@ -0,0 +1,174 @@
+// Runs the sample generation microbenchmarks from Source/Benchmark.c on the host and prints
+// them as a table. Save a run as CSV and pass it back in with -b to get per case deltas,
+// e.g. before and after a change to the generator:
+//
+//   vvvf_bench -o before.csv
+//   (change, rebuild)
+//   vvvf_bench -b before.csv
+//
+// Next to the timings, each case's output is rendered and run through Spectrum.h, so that an
+// optimization also shows what it does to the sound: the measured carrier and the alias
+// power below 5 kHz (lower is better, it should not go up when a kernel gets faster).
+//
+// The on target equivalent is (ext-bench), which prints the same timings in cycles.
+
+#include "Benchmark.h"
+#include "Parameters.h"
+#include "Spectrum.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_BASELINE_ROWS 256
+#define QUALITY_BUFFERS 220 // Just over 32768 samples, the full FFT length
+
+typedef struct {
+    float carrierHz;   // Measured, 0 when silent
+    float aliasDb;
+} Quality;
+
+typedef struct {
+    char kernel[16];
+    char variant[16];
+    int carrierHz;
+    float ticksPerBuffer;
+} BaselineRow;
+
+static void PrintUsage(const char* _Name) {
+    fprintf(stderr, "Usage: %s [-o results.csv] [-b baseline.csv]\n", _Name);
+}
+
+// Reads a CSV written with -o, returns the number of rows or -1 if the file can't be opened
+static int LoadBaseline(const char* _Path, BaselineRow* _Rows, int _Max) {
+    FILE* file = fopen(_Path, "r");
+    if (!file) return -1;
+
+    char line[256];
+    int count = 0;
+    while (fgets(line, sizeof(line), file) && count < _Max) {
+        BaselineRow row;
+        if (sscanf(line, "%15[^,],%15[^,],%d,%f", row.kernel, row.variant, &row.carrierHz, &row.ticksPerBuffer) == 4) {
+            _Rows[count++] = row;
+        }
+    }
+
+    fclose(file);
+    return count;
+}
+
+static const BaselineRow* FindBaseline(const BaselineRow* _Rows, int _Count, const BenchmarkResult* _Result) {
+    const char* kernel = Benchmark_GetKernelName(_Result->kernel);
+    const char* variant = Benchmark_GetVariantName(_Result->kernel, _Result->variant);
+    for (int i = 0; i < _Count; i++) {
+        if (_Rows[i].carrierHz == _Result->carrierHz &&
+            strcmp(_Rows[i].kernel, kernel) == 0 && strcmp(_Rows[i].variant, variant) == 0) {
+            return &_Rows[i];
+        }
+    }
+    return NULL;
+}
+
+static Quality MeasureQuality(const BenchmarkResult* _Result) {
+    static int8_t samples[QUALITY_BUFFERS * BUFFER_LENGTH];
+    float commandHz = Benchmark_Render(_Result->kernel, _Result->variant, _Result->carrierHz, samples, QUALITY_BUFFERS);
+    if (_Result->kernel != BENCHMARK_KERNEL_SPWM || _Result->variant != SPWM_TYPE_SYNC) commandHz = 0.0f;
+
+    SpectrumReport report;
+    Spectrum_AnalyzeInt8(samples, QUALITY_BUFFERS * BUFFER_LENGTH, SAMPLE_RATE, commandHz, &report);
+
+    Quality quality = { report.carrierHz, report.aliasDb };
+    return quality;
+}
+
+int main(int argc, char** argv) {
+    const char* outputPath = NULL;
+    const char* baselinePath = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:b:h")) != -1) {
+        switch (opt) {
+            case 'o': outputPath = optarg; break;
+            case 'b': baselinePath = optarg; break;
+            default:
+                PrintUsage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    static BaselineRow baseline[MAX_BASELINE_ROWS];
+    int baselineCount = 0;
+    if (baselinePath) {
+        baselineCount = LoadBaseline(baselinePath, baseline, MAX_BASELINE_ROWS);
+        if (baselineCount < 0) {
+            fprintf(stderr, "Can't open %s\n", baselinePath);
+            return 1;
+        }
+    }
+
+    int maxResults = Benchmark_GetCaseCount();
+    BenchmarkResult* results = malloc((size_t)maxResults * sizeof(BenchmarkResult));
+    if (!results) return 1;
+
+    int count = Benchmark_Run(results, maxResults);
+
+    Quality* quality = malloc((size_t)maxResults * sizeof(Quality));
+    if (!quality) return 1;
+    for (int i = 0; i < count; i++) {
+        quality[i] = MeasureQuality(&results[i]);
+    }
+
+    const char* unit = Benchmark_GetTickUnit();
+
+    printf("%d samples per buffer at %d Hz, %d buffers per run, best of %d, times in %s\n\n",
+           BUFFER_LENGTH, SAMPLE_RATE, BENCHMARK_BUFFERS, BENCHMARK_REPEATS, unit);
+    printf("%-8s %-12s %8s %12s %12s %8s %10s %8s%s\n", "kernel", "variant", "carrier", "per-buffer", "per-sample", "budget",
+           "measured", "alias", baselinePath ? "    delta" : "");
+
+    for (int i = 0; i < count; i++) {
+        const BenchmarkResult* r = &results[i];
+        printf("%-8s %-12s %8d %12u %12.1f %7.2f%%",
+               Benchmark_GetKernelName(r->kernel), Benchmark_GetVariantName(r->kernel, r->variant),
+               r->carrierHz, r->ticksPerBuffer, (double)r->ticksPerSample, (double)r->budgetPercent);
+        if (quality[i].carrierHz > 0.0f) {
+            printf(" %8.1fHz %6.1fdB", (double)quality[i].carrierHz, (double)quality[i].aliasDb);
+        } else {
+            printf(" %10s %8s", "silent", "-");
+        }
+
+        if (baselinePath) {
+            const BaselineRow* row = FindBaseline(baseline, baselineCount, r);
+            if (row && row->ticksPerBuffer > 0.0f) {
+                printf(" %+8.1f%%", (double)(((float)r->ticksPerBuffer / row->ticksPerBuffer - 1.0f) * 100.0f));
+            } else {
+                printf(" %9s", "new");
+            }
+        }
+        printf("\n");
+    }
+
+    if (outputPath) {
+        FILE* file = fopen(outputPath, "w");
+        if (!file) {
+            fprintf(stderr, "Can't open %s\n", outputPath);
+            free(results);
+            free(quality);
+            return 1;
+        }
+
+        fprintf(file, "kernel,variant,carrier_hz,%s_per_buffer,%s_per_sample,budget_percent,measured_carrier_hz,alias_db\n", unit, unit);
+        for (int i = 0; i < count; i++) {
+            const BenchmarkResult* r = &results[i];
+            fprintf(file, "%s,%s,%d,%u,%.2f,%.3f,%.2f,%.2f\n",
+                    Benchmark_GetKernelName(r->kernel), Benchmark_GetVariantName(r->kernel, r->variant),
+                    r->carrierHz, r->ticksPerBuffer, (double)r->ticksPerSample, (double)r->budgetPercent,
+                    (double)quality[i].carrierHz, (double)quality[i].aliasDb);
+        }
+        fclose(file);
+    }
+
+    free(results);
+    free(quality);
+    return 0;
+}
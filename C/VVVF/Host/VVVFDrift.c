@@ -0,0 +1,252 @@
+// Long run precision check of the generator's phase accumulators. Every case runs
+// SPWMGenerator_GenerateSamples for hours of simulated time and follows CommandPhase and
+// CarrierPhase against an exact integer reference, so that we know a mode is still on pitch
+// and in sync at the end of a shift:
+//
+//   vvvf_drift -t 8
+//
+// The reference counts samples and keeps phase as (samples * mHz) mod (SAMPLE_RATE * 1000),
+// which is exact for any run length. After every buffer the accumulator is compared with it,
+// giving per accumulator:
+//   step      frequency error from rounding the per sample increment to float, predicted
+//   accum     frequency error from rounding every addition, the measured rest
+//   total     measured frequency error, the slope of the phase error over the run
+//   max err   largest phase error seen, in degrees
+//   shift     phase error after a shift of -s hours at the measured rate, in cycles
+//   wraps     buffers that ended with the phase outside [0, TWO_PI) or not finite
+// A sync case also gets a slip row: how far the carrier moves against pulses times the
+// command, which is what would turn a sync mode into an async one over time.
+//
+// A case fails (exit code 1) on any wrap failure, it drifts when the total error is above -l.
+//
+// Options:
+//   -t hours      simulated time per case [1]
+//   -s hours      shift length the error is extrapolated to [8]
+//   -l ppm        frequency error above which a case is reported as drifting [500]
+//   -c index      run only this case
+
+#include "SPWMGenerator.h"
+#include "ConfigParser.h"
+#include "Parameters.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define DRIFT_POLES 14
+#define REFERENCE_MODULUS ((int64_t)SAMPLE_RATE * 1000) // One cycle in mHz samples
+
+typedef struct {
+    const char* name;
+    SPWMType type;
+    int32_t commandMilliHz;   // Command frequency, as picked up from command_frequency
+    int32_t carrier;          // Carrier in Hz for SPWM_TYPE_FIXED_ASYNC, pulses for SPWM_TYPE_SYNC
+} DriftCase;
+
+static const DriftCase Cases[] = {
+    { "async 0.5 Hz / 1 kHz", SPWM_TYPE_FIXED_ASYNC, 500, 1000 },
+    { "async 5 Hz / 1 kHz", SPWM_TYPE_FIXED_ASYNC, 5000, 1000 },
+    { "async 50 Hz / 2 kHz", SPWM_TYPE_FIXED_ASYNC, 50000, 2000 },
+    { "async 33.3 Hz / 4.5 kHz", SPWM_TYPE_FIXED_ASYNC, 33300, 4500 },
+    { "async 200 Hz / 12.5 kHz", SPWM_TYPE_FIXED_ASYNC, 200000, 12500 },
+    { "async 100 Hz / 24 kHz", SPWM_TYPE_FIXED_ASYNC, 100000, 24000 },
+    { "async 50 Hz / 30 kHz", SPWM_TYPE_FIXED_ASYNC, 50000, 30000 },   // Increment above TWO_PI
+    { "async 50 Hz / 60 kHz", SPWM_TYPE_FIXED_ASYNC, 50000, 60000 },   // More than two cycles per sample
+    { "async -50 Hz / 2 kHz", SPWM_TYPE_FIXED_ASYNC, -50000, 2000 },   // ext-set-motor-hz takes negative values
+    { "sync 9 pulses 20 Hz", SPWM_TYPE_SYNC, 20000, 9 },
+    { "sync 3 pulses 150 Hz", SPWM_TYPE_SYNC, 150000, 3 },
+    { "sync 15 pulses 7.7 Hz", SPWM_TYPE_SYNC, 7700, 15 },
+};
+#define CASE_COUNT (int)(sizeof(Cases) / sizeof(Cases[0]))
+
+typedef struct {
+    int64_t milliHz;          // Exact frequency of the reference
+    double errorCycles;       // Unwrapped phase error against the reference
+    double lastWrapped;       // Error of the previous buffer, in [-0.5, 0.5)
+    double maxErrorCycles;
+    uint64_t wrapFailures;
+    double firstFailureS;
+} Accumulator;
+
+typedef struct {
+    float stepPpm;
+    float accumPpm;
+    float totalPpm;
+} ErrorBudget;
+
+static double WrapHalf(double _Cycles) {
+    return _Cycles - floor(_Cycles + (double)0.5);
+}
+
+static void Accumulator_Init(Accumulator* _Acc, int64_t _MilliHz) {
+    _Acc->milliHz = _MilliHz;
+    _Acc->errorCycles = 0;
+    _Acc->lastWrapped = 0;
+    _Acc->maxErrorCycles = 0;
+    _Acc->wrapFailures = 0;
+    _Acc->firstFailureS = 0;
+}
+
+// Compares the generator phase after _Samples samples with the exact one
+static void Accumulator_Update(Accumulator* _Acc, float _Phase, uint64_t _Samples) {
+    if (!isfinite(_Phase) || _Phase < 0.0f || _Phase >= TWO_PI) {
+        if (_Acc->wrapFailures++ == 0) _Acc->firstFailureS = (double)_Samples / SAMPLE_RATE;
+    }
+
+    int64_t reference = ((int64_t)_Samples * _Acc->milliHz) % REFERENCE_MODULUS;
+    if (reference < 0) reference += REFERENCE_MODULUS;
+
+    // The generator wraps at the float TWO_PI, so that is its cycle
+    double wrapped = WrapHalf((double)_Phase / (double)TWO_PI - (double)reference / (double)REFERENCE_MODULUS);
+    _Acc->errorCycles += WrapHalf(wrapped - _Acc->lastWrapped);
+    _Acc->lastWrapped = wrapped;
+    if (fabs(_Acc->errorCycles) > _Acc->maxErrorCycles) _Acc->maxErrorCycles = fabs(_Acc->errorCycles);
+}
+
+// Frequency error of the float increment alone, for the frequency the generator was given
+static float PredictStepPpm(float _Frequency, int64_t _MilliHz) {
+    float step = (TWO_PI * _Frequency) / SAMPLE_RATE;
+    double stepCycles = (double)step / (double)TWO_PI;
+    double exactCycles = (double)_MilliHz / (double)REFERENCE_MODULUS;
+    // Only the fraction of a cycle per sample is audible, a whole cycle per sample aliases away
+    double error = WrapHalf(stepCycles - exactCycles);
+    return (float)(error / exactCycles * (double)1000000);
+}
+
+static void FillBudget(const Accumulator* _Acc, float _Frequency, double _Seconds, ErrorBudget* _Budget) {
+    double hz = (double)_Acc->milliHz / (double)1000;
+    _Budget->totalPpm = (float)(_Acc->errorCycles / _Seconds / hz * (double)1000000);
+    _Budget->stepPpm = PredictStepPpm(_Frequency, _Acc->milliHz);
+    _Budget->accumPpm = _Budget->totalPpm - _Budget->stepPpm;
+}
+
+static const char* PrintRow(const char* _Case, const char* _Name, const Accumulator* _Acc, const ErrorBudget* _Budget,
+                            double _ShiftS, float _LimitPpm) {
+    double hz = (double)_Acc->milliHz / (double)1000;
+    double shiftCycles = (double)_Budget->totalPpm / (double)1000000 * hz * _ShiftS;
+    const char* verdict = _Acc->wrapFailures > 0 ? "FAIL" : fabsf(_Budget->totalPpm) > _LimitPpm ? "drift" : "ok";
+
+    printf("%-24s %-8s %10.3f %10.3f %10.3f %10.3f %11.2f %11.2f %8llu  %s", _Case, _Name, hz, (double)_Budget->stepPpm,
+           (double)_Budget->accumPpm, (double)_Budget->totalPpm, _Acc->maxErrorCycles * (double)360, shiftCycles,
+           (unsigned long long)_Acc->wrapFailures, verdict);
+    if (_Acc->wrapFailures > 0) printf(", first after %.3f s", _Acc->firstFailureS);
+    printf("\n");
+    return verdict;
+}
+
+static SpeedRange MakeRange(const DriftCase* _Case) {
+    SPWMConfig config = _Case->type == SPWM_TYPE_SYNC ? AddSPWM_Sync(_Case->carrier) : AddSPWM_AsyncFixed(_Case->carrier);
+
+    SpeedRange range;
+    range.minSpeed = 0.0f;
+    range.maxSpeed = MAX_SPEED_KMH;
+    range.spwm.acceleration = config;
+    range.spwm.coasting = config;
+    range.spwm.deceleration = config;
+    return range;
+}
+
+// Runs one case, returns true if it had no wrap failures
+static bool RunCase(const DriftCase* _Case, double _Seconds, double _ShiftS, float _LimitPpm, int* _Drifting) {
+    SpeedRange range = MakeRange(_Case);
+
+    // Same hand over as the generator thread in Main.c: command_frequency = inverter_hz / motor_poles
+    float inverterHz = (float)_Case->commandMilliHz / 1000.0f * DRIFT_POLES;
+    SPWMGenerator generator;
+    SPWMGenerator_Init(&generator);
+    generator.CommandFrequency = inverterHz / (float)DRIFT_POLES;
+
+    int64_t carrierMilliHz = _Case->type == SPWM_TYPE_SYNC ? (int64_t)_Case->commandMilliHz * _Case->carrier
+                                                           : (int64_t)_Case->carrier * 1000;
+    Accumulator command, carrier;
+    Accumulator_Init(&command, _Case->commandMilliHz);
+    Accumulator_Init(&carrier, carrierMilliHz);
+
+    // Carrier error against pulses times the command error, in carrier cycles
+    double maxSlip = 0;
+
+    int8_t buffer[BUFFER_LENGTH];
+    uint64_t total = (uint64_t)(_Seconds * SAMPLE_RATE);
+    uint64_t samples = 0;
+    while (samples < total) {
+        SPWMGenerator_GenerateSamples(&generator, ROTOR_STATE_ACCELERATING, buffer, BUFFER_LENGTH, &range, inverterHz,
+                                      DRIFT_POLES, 0.0f);
+        samples += BUFFER_LENGTH;
+        Accumulator_Update(&command, generator.CommandPhase, samples);
+        Accumulator_Update(&carrier, generator.CarrierPhase, samples);
+
+        if (_Case->type == SPWM_TYPE_SYNC) {
+            double slip = fabs(carrier.errorCycles - command.errorCycles * _Case->carrier);
+            if (slip > maxSlip) maxSlip = slip;
+        }
+    }
+
+    double seconds = (double)samples / SAMPLE_RATE;
+    ErrorBudget commandBudget, carrierBudget;
+    FillBudget(&command, generator.CommandFrequency, seconds, &commandBudget);
+    FillBudget(&carrier, generator.CarrierFrequency, seconds, &carrierBudget);
+
+    const char* verdicts[2];
+    verdicts[0] = PrintRow(_Case->name, "command", &command, &commandBudget, _ShiftS, _LimitPpm);
+    verdicts[1] = PrintRow("", "carrier", &carrier, &carrierBudget, _ShiftS, _LimitPpm);
+    for (int i = 0; i < 2; i++) {
+        if (verdicts[i][0] == 'd') (*_Drifting)++;
+    }
+
+    if (_Case->type == SPWM_TYPE_SYNC) {
+        double slipRate = (carrier.errorCycles - command.errorCycles * _Case->carrier) / seconds;
+        printf("%-24s %-8s %10s %10s %10s %10s %11.2f %11.2f\n", "", "slip", "", "", "", "", maxSlip * (double)360,
+               slipRate * _ShiftS);
+    }
+
+    return command.wrapFailures == 0 && carrier.wrapFailures == 0;
+}
+
+static void PrintUsage(const char* _Name) {
+    fprintf(stderr, "Usage: %s [-t hours] [-s hours] [-l ppm] [-c index]\n", _Name);
+}
+
+int main(int argc, char** argv) {
+    float hours = 1.0f;
+    float shiftHours = 8.0f;
+    float limitPpm = 500.0f;
+    int only = -1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:s:l:c:h")) != -1) {
+        switch (opt) {
+            case 't': hours = (float)atof(optarg); break;
+            case 's': shiftHours = (float)atof(optarg); break;
+            case 'l': limitPpm = (float)atof(optarg); break;
+            case 'c': only = atoi(optarg); break;
+            default:
+                PrintUsage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (hours <= 0.0f || shiftHours <= 0.0f || only >= CASE_COUNT) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    double seconds = (double)hours * (double)3600;
+    double shiftS = (double)shiftHours * (double)3600;
+    printf("%.2f h per case at %d Hz, errors extrapolated to a %.1f h shift, drift limit %.0f ppm\n\n", (double)hours,
+           SAMPLE_RATE, (double)shiftHours, (double)limitPpm);
+    printf("%-24s %-8s %10s %10s %10s %10s %11s %11s %8s\n", "case", "phase", "hz", "step ppm", "accum ppm",
+           "total ppm", "max err deg", "shift cyc", "wraps");
+
+    int failures = 0;
+    int drifting = 0;
+    for (int i = 0; i < CASE_COUNT; i++) {
+        if (only >= 0 && i != only) continue;
+        if (!RunCase(&Cases[i], seconds, shiftS, limitPpm, &drifting)) failures++;
+        fflush(stdout);
+    }
+
+    printf("\n%d cases with wrap failures, %d accumulators drifting more than %.0f ppm\n", failures, drifting,
+           (double)limitPpm);
+    return failures > 0 ? 1 : 0;
+}
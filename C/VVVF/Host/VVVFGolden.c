@@ -0,0 +1,390 @@
+// Golden output regression check for SPWMGenerator_GenerateSamples.
+//
+//   vvvf_golden [-d corpus_dir] [-s] [-v]   - check the generator against the corpus
+//   vvvf_golden [-d corpus_dir] -u          - render and store a new corpus
+//
+// Every SPWM type over a few carriers, and every speed range of every built in profile in
+// every rotor state, is rendered from a fixed start (generator reset, RSPWM reseeded). Each
+// case is stored in corpus.txt as a hash plus a small fingerprint, and a few cases are also
+// kept as 8 bit WAV snippets that can be listened to and compared sample by sample.
+//
+// Identical output passes outright. Output that differs, e.g. from a fixed point or table
+// based kernel, passes when it is within tolerance of the stored case:
+//  - RMS and the number of zero crossings within 1 %, peak within 2 LSB
+//  - for snippet cases, at most 0.5 % of the samples more than 2 LSB away from the snippet
+//    (edges moving by one sample are fine, anything that sounds different is not)
+// -s turns the tolerance off and requires the exact same output.
+//
+// The corpus is rendered on the host, so an update is needed when the expected output
+// changes on purpose. Say why in the commit.
+
+#include "ConfigParser.h"
+#include "Profiles.h"
+#include "SPWMGenerator.h"
+#include "Parameters.h"
+#include "Wav.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define GOLDEN_BUFFERS 20
+#define GOLDEN_SAMPLES (GOLDEN_BUFFERS * BUFFER_LENGTH)
+#define GOLDEN_POLES 14
+#define GOLDEN_KMH_TO_ERPM 100.0f  // Same rough hub motor factor as vvvf_host
+#define GOLDEN_SNIPPET_CARRIER 2000
+#define MAX_CASES 512
+#define MAX_NAME_LENGTH 64
+
+#define TOLERANCE_LSB 2
+#define TOLERANCE_MISMATCH_FRACTION 0.005f
+#define TOLERANCE_RMS_FRACTION 0.01f
+#define TOLERANCE_CROSSINGS_FRACTION 0.01f
+
+static const int CarrierSweep[] = { 500, GOLDEN_SNIPPET_CARRIER, 8000 };
+#define CARRIER_SWEEP_COUNT (int)(sizeof(CarrierSweep) / sizeof(CarrierSweep[0]))
+
+typedef struct {
+    uint32_t hash;
+    float rms;
+    int crossings;
+    int peak;
+} Fingerprint;
+
+typedef struct {
+    char name[MAX_NAME_LENGTH];
+    Fingerprint fingerprint;
+    bool snippet;             // Also stored as a WAV snippet
+    bool seen;                // Corpus entry matched a rendered case
+} GoldenCase;
+
+typedef struct {
+    const char* dir;
+    bool update;
+    bool strict;
+    bool verbose;
+    GoldenCase corpus[MAX_CASES];
+    int corpusCount;
+    GoldenCase rendered[MAX_CASES];
+    int renderedCount;
+    int exact;
+    int tolerated;
+    int failed;
+} GoldenRun;
+
+static const char* RotorStateName(RotorState _State) {
+    switch (_State) {
+        case ROTOR_STATE_ACCELERATING: return "accel";
+        case ROTOR_STATE_COASTING: return "coast";
+        case ROTOR_STATE_DECELERATING: return "decel";
+    }
+    return "unknown";
+}
+
+static const char* SPWMTypeName(SPWMType _Type) {
+    switch (_Type) {
+        case SPWM_TYPE_NONE: return "none";
+        case SPWM_TYPE_FIXED_ASYNC: return "async-fixed";
+        case SPWM_TYPE_RAMP_ASYNC: return "async-ramp";
+        case SPWM_TYPE_RSPWM: return "rspwm";
+        case SPWM_TYPE_SYNC: return "sync";
+    }
+    return "unknown";
+}
+
+// -- Rendering
+
+static void Render(const SpeedRange* _Range, RotorState _State, float _SpeedKmh, int8_t* _Out) {
+    SPWMGenerator generator;
+    SPWMGenerator_Init(&generator);
+    SPWMGenerator_SeedRandom(&generator, RSPWM_DEFAULT_SEED);
+
+    float commandHz = _SpeedKmh * GOLDEN_KMH_TO_ERPM;
+    generator.CommandFrequency = commandHz / GOLDEN_POLES;
+
+    for (int i = 0; i < GOLDEN_BUFFERS; i++) {
+        SPWMGenerator_GenerateSamples(&generator, _State, _Out + i * BUFFER_LENGTH, BUFFER_LENGTH,
+                                      _Range, commandHz, GOLDEN_POLES, _SpeedKmh);
+    }
+}
+
+static Fingerprint TakeFingerprint(const int8_t* _Samples, int _Count) {
+    Fingerprint fingerprint = { 2166136261u, 0.0f, 0, 0 }; // FNV-1a offset basis
+    float sumSquares = 0.0f;
+    int lastSign = 0;
+
+    for (int i = 0; i < _Count; i++) {
+        fingerprint.hash = (fingerprint.hash ^ (uint8_t)_Samples[i]) * 16777619u;
+
+        int value = _Samples[i];
+        sumSquares += (float)(value * value);
+        if (abs(value) > fingerprint.peak) fingerprint.peak = abs(value);
+
+        int sign = (value > 0) - (value < 0);
+        if (sign != 0) {
+            if (lastSign != 0 && sign != lastSign) fingerprint.crossings++;
+            lastSign = sign;
+        }
+    }
+
+    fingerprint.rms = sqrtf(sumSquares / (float)_Count);
+    return fingerprint;
+}
+
+// -- Corpus files
+
+static void SnippetPath(const GoldenRun* _Run, const char* _Name, char* _Path, size_t _Length) {
+    char file[MAX_NAME_LENGTH];
+    snprintf(file, sizeof(file), "%s", _Name);
+    for (char* c = file; *c; c++) {
+        if (*c == '/') *c = '_';
+    }
+    snprintf(_Path, _Length, "%s/%s.wav", _Run->dir, file);
+}
+
+static bool LoadCorpus(GoldenRun* _Run) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/corpus.txt", _Run->dir);
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Can't open %s, create it with -u\n", path);
+        return false;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), file) && _Run->corpusCount < MAX_CASES) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+
+        GoldenCase entry;
+        memset(&entry, 0, sizeof(entry));
+        int snippet = 0;
+        if (sscanf(line, "%63s %x %f %d %d %d", entry.name, &entry.fingerprint.hash, &entry.fingerprint.rms,
+                   &entry.fingerprint.crossings, &entry.fingerprint.peak, &snippet) == 6) {
+            entry.snippet = snippet != 0;
+            _Run->corpus[_Run->corpusCount++] = entry;
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+static bool SaveCorpus(const GoldenRun* _Run) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/corpus.txt", _Run->dir);
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Can't write %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "# Golden output of SPWMGenerator_GenerateSamples, regenerate with vvvf_golden -u\n");
+    fprintf(file, "# %d samples per case at %d Hz\n", GOLDEN_SAMPLES, SAMPLE_RATE);
+    fprintf(file, "# name fnv1a rms zero-crossings peak snippet\n");
+    for (int i = 0; i < _Run->renderedCount; i++) {
+        const GoldenCase* entry = &_Run->rendered[i];
+        fprintf(file, "%s %08x %.3f %d %d %d\n", entry->name, entry->fingerprint.hash, (double)entry->fingerprint.rms,
+                entry->fingerprint.crossings, entry->fingerprint.peak, entry->snippet ? 1 : 0);
+    }
+
+    fclose(file);
+    return true;
+}
+
+static GoldenCase* FindCorpusCase(GoldenRun* _Run, const char* _Name) {
+    for (int i = 0; i < _Run->corpusCount; i++) {
+        if (strcmp(_Run->corpus[i].name, _Name) == 0) return &_Run->corpus[i];
+    }
+    return NULL;
+}
+
+// -- Checking
+
+static bool WithinFraction(float _Value, float _Reference, float _Fraction) {
+    return fabsf(_Value - _Reference) <= fabsf(_Reference) * _Fraction;
+}
+
+// Returns NULL when the fingerprints match within tolerance, otherwise what didn't
+static const char* CompareFingerprints(const Fingerprint* _Got, const Fingerprint* _Expected) {
+    if (!WithinFraction(_Got->rms, _Expected->rms, TOLERANCE_RMS_FRACTION)) return "rms";
+    if (!WithinFraction((float)_Got->crossings, (float)_Expected->crossings, TOLERANCE_CROSSINGS_FRACTION)) return "zero crossings";
+    if (abs(_Got->peak - _Expected->peak) > TOLERANCE_LSB) return "peak";
+    return NULL;
+}
+
+static const char* CompareSnippet(const GoldenRun* _Run, const char* _Name, const int8_t* _Samples) {
+    static int8_t reference[GOLDEN_SAMPLES];
+    char path[512];
+    SnippetPath(_Run, _Name, path, sizeof(path));
+
+    int count = Wav_ReadInt8(path, reference, GOLDEN_SAMPLES, NULL);
+    if (count != GOLDEN_SAMPLES) return "snippet missing";
+
+    int mismatches = 0;
+    for (int i = 0; i < count; i++) {
+        if (abs(_Samples[i] - reference[i]) > TOLERANCE_LSB) mismatches++;
+    }
+    if ((float)mismatches > TOLERANCE_MISMATCH_FRACTION * (float)count) return "snippet samples";
+    return NULL;
+}
+
+static void AddCase(GoldenRun* _Run, const char* _Name, const SpeedRange* _Range, RotorState _State, float _SpeedKmh, bool _Snippet) {
+    static int8_t samples[GOLDEN_SAMPLES];
+    if (_Run->renderedCount >= MAX_CASES) return;
+
+    Render(_Range, _State, _SpeedKmh, samples);
+
+    GoldenCase* entry = &_Run->rendered[_Run->renderedCount++];
+    snprintf(entry->name, sizeof(entry->name), "%s", _Name);
+    entry->fingerprint = TakeFingerprint(samples, GOLDEN_SAMPLES);
+    entry->snippet = _Snippet;
+
+    if (_Run->update) {
+        if (_Snippet) {
+            char path[512];
+            SnippetPath(_Run, _Name, path, sizeof(path));
+            WavWriter wav;
+            if (Wav_Open(&wav, path, SAMPLE_RATE, 8)) {
+                Wav_WriteInt8(&wav, samples, GOLDEN_SAMPLES);
+                Wav_Close(&wav);
+            } else {
+                fprintf(stderr, "Can't write %s\n", path);
+                _Run->failed++;
+            }
+        }
+        return;
+    }
+
+    GoldenCase* expected = FindCorpusCase(_Run, _Name);
+    const char* failure = NULL;
+    if (!expected) {
+        failure = "not in corpus";
+    } else {
+        expected->seen = true;
+        if (expected->fingerprint.hash == entry->fingerprint.hash) {
+            _Run->exact++;
+            if (_Run->verbose) printf("  exact      %s\n", _Name);
+            return;
+        }
+
+        if (_Run->strict) {
+            failure = "hash";
+        } else {
+            failure = CompareFingerprints(&entry->fingerprint, &expected->fingerprint);
+            if (!failure && expected->snippet) {
+                failure = CompareSnippet(_Run, _Name, samples);
+            }
+        }
+    }
+
+    if (failure) {
+        _Run->failed++;
+        printf("  FAIL       %s (%s)", _Name, failure);
+        if (expected) {
+            printf(" rms %.3f -> %.3f, crossings %d -> %d, peak %d -> %d",
+                   (double)expected->fingerprint.rms, (double)entry->fingerprint.rms,
+                   expected->fingerprint.crossings, entry->fingerprint.crossings,
+                   expected->fingerprint.peak, entry->fingerprint.peak);
+        }
+        printf("\n");
+    } else {
+        _Run->tolerated++;
+        printf("  tolerated  %s\n", _Name);
+    }
+}
+
+// -- Cases
+
+static void AddSPWMCases(GoldenRun* _Run) {
+    for (int type = SPWM_TYPE_NONE; type <= SPWM_TYPE_SYNC; type++) {
+        for (int i = 0; i < CARRIER_SWEEP_COUNT; i++) {
+            int carrier = CarrierSweep[i];
+            SPWMConfig config = AddSPWM_Disabled();
+            switch ((SPWMType)type) {
+                case SPWM_TYPE_NONE: break;
+                case SPWM_TYPE_FIXED_ASYNC: config = AddSPWM_AsyncFixed(carrier); break;
+                case SPWM_TYPE_RAMP_ASYNC: config = AddSPWM_AsyncRamp(carrier / 2, carrier + carrier / 2); break;
+                case SPWM_TYPE_RSPWM: config = AddSPWM_RSPWM(carrier - carrier / 4, carrier + carrier / 4); break;
+                case SPWM_TYPE_SYNC: config = AddSPWM_Sync(7); break;
+            }
+
+            SpeedRange range = { 0.0f, 100.0f, { config, config, config } };
+
+            // Sync derives its carrier from the command frequency, pick the speed that lands on the swept carrier
+            float speed = 50.0f;
+            if (type == SPWM_TYPE_SYNC) {
+                speed = (float)carrier / 7.0f * GOLDEN_POLES / GOLDEN_KMH_TO_ERPM;
+            }
+
+            char name[MAX_NAME_LENGTH];
+            snprintf(name, sizeof(name), "spwm/%s/%d", SPWMTypeName((SPWMType)type), carrier);
+            AddCase(_Run, name, &range, ROTOR_STATE_ACCELERATING, speed,
+                    type != SPWM_TYPE_NONE && carrier == GOLDEN_SNIPPET_CARRIER);
+        }
+    }
+}
+
+static void AddProfileCases(GoldenRun* _Run) {
+    for (int p = 0; p < GetProfileCount(); p++) {
+        const InverterProfile* profile = GetProfile(p);
+        const InverterConfig* config = &profile->config;
+
+        for (int i = 0; i < config->speedRangeCount; i++) {
+            // A few km/h into the range, clear of the zero speed cutoff and the neighbouring ranges
+            float minSpeed = config->speedRanges[i].minSpeed;
+            float maxSpeed = fminf(config->speedRanges[i].maxSpeed, minSpeed + 10.0f);
+            float speed = fmaxf((minSpeed + maxSpeed) * 0.5f, config->zeroSpeedCutoffMargin + 1.0f);
+
+            for (int state = ROTOR_STATE_ACCELERATING; state <= ROTOR_STATE_DECELERATING; state++) {
+                float current = state == ROTOR_STATE_ACCELERATING ? 60.0f : 5.0f;
+                SpeedRange range = GetSpeedRangeAtSpeed(config, speed, current);
+
+                char name[MAX_NAME_LENGTH];
+                snprintf(name, sizeof(name), "profile/%s/%d/%s", profile->name, i, RotorStateName((RotorState)state));
+                AddCase(_Run, name, &range, (RotorState)state, speed, i == 0 && state == ROTOR_STATE_ACCELERATING);
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    static GoldenRun run;
+    run.dir = "Golden";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:usvh")) != -1) {
+        switch (opt) {
+            case 'd': run.dir = optarg; break;
+            case 'u': run.update = true; break;
+            case 's': run.strict = true; break;
+            case 'v': run.verbose = true; break;
+            default:
+                fprintf(stderr, "Usage: %s [-d corpus_dir] [-u] [-s] [-v]\n", argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (!run.update && !LoadCorpus(&run)) return 1;
+
+    AddSPWMCases(&run);
+    AddProfileCases(&run);
+
+    if (run.update) {
+        if (!SaveCorpus(&run) || run.failed) return 1;
+        printf("Wrote %d cases to %s\n", run.renderedCount, run.dir);
+        return 0;
+    }
+
+    for (int i = 0; i < run.corpusCount; i++) {
+        if (!run.corpus[i].seen) {
+            printf("  FAIL       %s (no longer rendered, update the corpus if this is intended)\n", run.corpus[i].name);
+            run.failed++;
+        }
+    }
+
+    printf("%d cases: %d exact, %d within tolerance, %d failed\n",
+           run.renderedCount, run.exact, run.tolerated, run.failed);
+    return run.failed ? 1 : 0;
+}
@@ -0,0 +1,481 @@
+// Host smoke run of the whole plugin: loads it, feeds it a speed ramp every 20 ms and counts the
+// samples that reach foc_play_audio_samples and the telemetry packets sent to VESC Tool. At the
+// end the event log is dumped as app data and summarized per event type.
+//
+//   vvvf_host [seconds] [profile] [update-rate] [snapshot-rate] [motors]
+//
+// With an update rate the ramp goes into the stub's motor state and the plugin polls it itself
+// (ext-set-update-rate), the way Lisp/Main.lisp runs it. A listener thread then takes the
+// events through ext-wait-event and ext-next-event, and they have to match the event log.
+// Without one the ramp is fed through the ext-set-* extensions.
+//
+// With a snapshot rate the output snapshots (ext-set-snapshot-rate) are decoded, encoded again and
+// compared byte for byte, and the delta encoding savings are reported.
+//
+// With 2 motors (ext-set-motor-count) the second one runs the same ramp at MOTOR2_SPEED_SHARE of
+// the speed. Both have to play their own buffers, and at the top of the ramp ext-get-status has to
+// report each motor at its own speed. The second one reaches the zero speed cutoff first, so it
+// plays a few buffers less.
+//
+// The duty cycle of the stub's motors follows the speed, up to TOP_DUTY just below the voltage
+// limit (ext-set-voltage-limit). No buffer may be played louder than the headroom left at the
+// duty the motor ran at, and the sound still has to be played at the top of the ramp.
+//
+// The ramp coasts down into the zero speed cutoff. Every time the audio of a motor starts, and
+// every time it is stopped with foc_stop_audio, it has to be at the silent end of the envelope
+// (Envelope.h) instead of clicking, and when the loop is stopped no motor may be left playing.
+//
+// Before the run the profile editor protocol is checked: the active profile is read, sent back
+// unchanged, has to become the active profile and read back the same. A broken profile has to be
+// rejected.
+
+#include "VescStub.h"
+#include "Parameters.h"
+#include "Telemetry.h"
+#include "EventLog.h"
+#include "Snapshot.h"
+#include "ProfileCodec.h"
+#include "VoltageLimit.h"
+#include "Envelope.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define UPDATE_INTERVAL_US 20000
+#define MOTOR_POLES 14
+#define MAX_RAMP_SPEED_KMH 40.0f
+#define KMH_TO_ERPM 100.0f // Rough factor for a hub motor, only needs to be plausible
+#define MOTOR2_SPEED_SHARE 0.75f
+#define SPEED_SHARE_TOLERANCE 0.05f
+#define INPUT_VOLTAGE 48.0f
+#define COAST_CURRENT 2.0f // Below the 3 A of the zero speed cutoff
+#define CLICK_LIMIT 2 // Largest sample a fade in may start with or a fade out end with
+#define TOP_DUTY 0.895f // Leaves 0.16 V of headroom at the default limit, less than the amplitude at the top
+
+typedef struct {
+    uint64_t calls;
+    uint64_t samples;
+    uint64_t motorSamples[VESC_STUB_MOTORS]; // By the motor the playback thread selected
+    float dutyStep; // Most the duty moves between two updates
+    float lastDuty[VESC_STUB_MOTORS]; // At the previous call for the motor
+    uint64_t overLimit; // Calls louder than the headroom
+    uint64_t topCalls; // Calls with sound close to the top duty
+    bool playing[VESC_STUB_MOTORS]; // Since the first call after foc_stop_audio
+    int8_t lastSample[VESC_STUB_MOTORS];
+    uint64_t fadesIn;
+    uint64_t fadesOut;
+    uint64_t clicks;
+} AudioCounter;
+
+static void CountSamples(const int8_t* samples, int numSamples, float sampleRate, float voltage, void* arg) {
+    (void)samples;
+    (void)sampleRate;
+    AudioCounter* counter = (AudioCounter*)arg;
+    counter->calls++;
+    int motor = VescStub_GetSelectedMotor() - 1;
+    counter->samples += (uint64_t)numSamples;
+    counter->motorSamples[motor] += (uint64_t)numSamples;
+
+    // The plugin measured the duty right before, the ramp may have moved it since. Sound is only
+    // played while the duty rises, so the measurement lies between the previous buffer's and now.
+    float duty = VESC_IF->mc_get_duty_cycle_now();
+    float measured = fminf(duty, counter->lastDuty[motor]);
+    counter->lastDuty[motor] = duty;
+    float headroom = VoltageLimit_Headroom(measured, INPUT_VOLTAGE, VOLTAGE_LIMIT_DEFAULT_MAX_DUTY);
+    if (voltage > headroom + 1e-4f) {
+        counter->overLimit++;
+    }
+    if (duty > TOP_DUTY - 2.0f * counter->dutyStep && voltage > 0.0f) {
+        counter->topCalls++;
+    }
+}
+
+// Audio has to start where the envelope opens, at next to nothing
+static void CheckFadeIn(const int8_t* samples, int numSamples, float sampleRate, float voltage, void* arg) {
+    AudioCounter* counter = (AudioCounter*)arg;
+    int motor = VescStub_GetSelectedMotor() - 1;
+    if (!counter->playing[motor]) {
+        counter->playing[motor] = true;
+        counter->fadesIn++;
+        if (abs(samples[0]) > CLICK_LIMIT) {
+            counter->clicks++;
+        }
+    }
+    counter->lastSample[motor] = samples[numSamples - 1];
+    CountSamples(samples, numSamples, sampleRate, voltage, arg);
+}
+
+// And only be stopped once the envelope has closed
+static void CheckFadeOut(bool reset, void* arg) {
+    (void)reset;
+    AudioCounter* counter = (AudioCounter*)arg;
+    int motor = VescStub_GetSelectedMotor() - 1;
+    if (counter->playing[motor]) {
+        counter->playing[motor] = false;
+        counter->fadesOut++;
+        if (abs(counter->lastSample[motor]) > CLICK_LIMIT) {
+            counter->clicks++;
+        }
+    }
+}
+
+// (max-duty headroom-v limit-v limited-buffers) of the first motor, see ext-get-voltage-limit
+static uint32_t GetLimitedBuffers(void) {
+    return (uint32_t)VESC_IF->lbm_dec_as_u32(VescStub_ListNth(VescStub_CallExtensionNoArgs("ext-get-voltage-limit"), 3));
+}
+
+// Sets one motor value through the ext-set-* extensions, with the motor as the second argument
+static void SetMotorValue(const char* name, float value, int motor) {
+    lbm_value args[2] = { VESC_IF->lbm_enc_float(value), VESC_IF->lbm_enc_i(motor) };
+    VescStub_CallExtension(name, args, 2);
+}
+
+// Speed of the motor from ext-get-status
+static float GetMotorSpeed(int motor) {
+    lbm_value arg = VESC_IF->lbm_enc_i(motor);
+    return VESC_IF->lbm_dec_as_float(VescStub_ListNth(VescStub_CallExtension("ext-get-status", &arg, 1), 0));
+}
+
+typedef struct {
+    lib_thread thread;
+    uint64_t events[EVENT_TYPE_COUNT];
+    uint64_t wakeups;
+    uint64_t errors;
+} EventListener;
+
+// The optional event thread of Lisp/Main.lisp
+static void ListenEvents(void* arg) {
+    EventListener* listener = (EventListener*)arg;
+    while (true) {
+        lbm_value event = VescStub_CallExtensionNoArgs("ext-next-event");
+        if (VescStub_IsError(event)) {
+            listener->errors++;
+            return;
+        }
+
+        float fields[4];
+        if (VescStub_ListToFloats(event, fields, 4) == 4) {
+            int type = (int)fields[0];
+            if (type >= 0 && type < EVENT_TYPE_COUNT) listener->events[type]++;
+            continue;
+        }
+
+        // Queue is empty, nil here means the plugin was stopped
+        lbm_value woken = VescStub_CallExtensionNoArgs("ext-wait-event");
+        if (VescStub_IsError(woken)) listener->errors++;
+        if (woken != VESC_IF->lbm_enc_sym_true) return;
+        listener->wakeups++;
+    }
+}
+
+typedef struct {
+    uint64_t packets;
+    uint64_t invalid;
+    TelemetryStatus last;
+    uint64_t events[EVENT_TYPE_COUNT];
+    uint64_t eventsDropped;
+    uint64_t snapshots;
+    uint64_t snapshotsDelta;
+    uint64_t snapshotBytes;
+    uint64_t snapshotSamples;
+    uint64_t snapshotsInvalid;
+    uint8_t profile[PROFILE_MAX_PACKET_LENGTH]; // Last profile editor reply
+    int profileLength;
+} AppDataCounter;
+
+static void CheckSnapshot(const uint8_t* data, unsigned int length, AppDataCounter* counter) {
+    SnapshotInfo info;
+    int8_t samples[SNAPSHOT_MAX_SAMPLES];
+    uint8_t again[SNAPSHOT_MAX_PACKET_LENGTH];
+    int count = Snapshot_Decode(data, (int)length, &info, samples);
+    if (count != BUFFER_LENGTH ||
+        Snapshot_Encode(&info, samples, count, again) != (int)length || memcmp(again, data, length) != 0) {
+        counter->snapshotsInvalid++;
+        return;
+    }
+    counter->snapshots++;
+    counter->snapshotsDelta += (data[2] & SNAPSHOT_FLAG_DELTA) != 0;
+    counter->snapshotBytes += length - SNAPSHOT_HEADER_LENGTH;
+    counter->snapshotSamples += (uint64_t)count;
+}
+
+static void CountAppData(const uint8_t* data, unsigned int length, void* arg) {
+    AppDataCounter* counter = (AppDataCounter*)arg;
+    TelemetryStatus status;
+    Event event;
+    if (Telemetry_Decode(data, (int)length, &status)) {
+        counter->packets++;
+        counter->last = status;
+    } else if (length >= 1 && data[0] == SNAPSHOT_PACKET_ID) {
+        CheckSnapshot(data, length, counter);
+    } else if (length >= PROFILE_HEADER_LENGTH && length <= PROFILE_MAX_PACKET_LENGTH && data[0] == PROFILE_PACKET_ID) {
+        memcpy(counter->profile, data, length);
+        counter->profileLength = (int)length;
+    } else if (length >= EVENT_LOG_HEADER_LENGTH && data[0] == EVENT_LOG_PACKET_ID) {
+        counter->eventsDropped += (uint64_t)(data[4] | (data[5] << 8) | (data[6] << 16) | ((uint32_t)data[7] << 24));
+        for (int i = 0; EventLog_DecodeEvent(data, (int)length, i, &event); i++) {
+            if (event.type < EVENT_TYPE_COUNT) counter->events[event.type]++;
+        }
+    } else {
+        counter->invalid++;
+    }
+}
+
+// Sends a packet the way the profile editor does and returns the length of the reply, 0 for none
+static int EditorRequest(AppDataCounter* counter, const uint8_t* packet, int length) {
+    counter->profileLength = 0;
+    VescStub_ReceiveAppData(packet, (unsigned int)length);
+    return counter->profileLength;
+}
+
+// GET active, APPLY it unchanged, GET active again, then APPLY one with its speed ranges swapped
+static bool CheckProfileEditor(AppDataCounter* counter, int profile) {
+    uint8_t get[PROFILE_HEADER_LENGTH] = { PROFILE_PACKET_ID, PROFILE_VERSION, PROFILE_CMD_GET, PROFILE_INDEX_ACTIVE };
+    uint8_t sent[PROFILE_MAX_PACKET_LENGTH];
+    int length = EditorRequest(counter, get, PROFILE_HEADER_LENGTH);
+    if (length <= PROFILE_HEADER_LENGTH || counter->profile[2] != PROFILE_CMD_DATA || counter->profile[3] != profile ||
+        ProfileCodec_Validate(counter->profile, length, profile + 1) != PROFILE_OK) {
+        fprintf(stderr, "Profile editor: no valid profile for GET\n");
+        return false;
+    }
+    memcpy(sent, counter->profile, (size_t)length);
+    sent[2] = PROFILE_CMD_APPLY;
+
+    if (EditorRequest(counter, sent, length) != PROFILE_HEADER_LENGTH || counter->profile[3] != PROFILE_OK) {
+        fprintf(stderr, "Profile editor: APPLY failed (%s)\n", ProfileCodec_GetResultName((ProfileResult)counter->profile[3]));
+        return false;
+    }
+
+    int custom = (int)VESC_IF->lbm_dec_as_i32(VescStub_CallExtensionNoArgs("ext-get-profile"));
+    if (EditorRequest(counter, get, PROFILE_HEADER_LENGTH) != length || counter->profile[3] != custom ||
+        memcmp(counter->profile + PROFILE_HEADER_LENGTH, sent + PROFILE_HEADER_LENGTH,
+               (size_t)(length - PROFILE_HEADER_LENGTH)) != 0) {
+        fprintf(stderr, "Profile editor: the applied profile reads back different\n");
+        return false;
+    }
+
+    // Descending ranges, must be refused and leave the profile alone
+    int ranges = sent[PROFILE_HEADER_LENGTH + PROFILE_BODY_LENGTH - 1];
+    ProfileResult expected = ranges > 1 ? PROFILE_ERROR_SPEEDS : PROFILE_ERROR_RANGE_COUNT;
+    if (ranges > 1) {
+        uint8_t* first = sent + PROFILE_HEADER_LENGTH + PROFILE_BODY_LENGTH;
+        uint8_t swap[PROFILE_RANGE_LENGTH];
+        memcpy(swap, first, PROFILE_RANGE_LENGTH);
+        memcpy(first, first + PROFILE_RANGE_LENGTH, PROFILE_RANGE_LENGTH);
+        memcpy(first + PROFILE_RANGE_LENGTH, swap, PROFILE_RANGE_LENGTH);
+    } else {
+        sent[PROFILE_HEADER_LENGTH + PROFILE_BODY_LENGTH - 1] = 0;
+        length = PROFILE_HEADER_LENGTH + PROFILE_BODY_LENGTH;
+    }
+    if (EditorRequest(counter, sent, length) != PROFILE_HEADER_LENGTH || counter->profile[3] != expected ||
+        (int)VESC_IF->lbm_dec_as_i32(VescStub_CallExtensionNoArgs("ext-get-profile")) != custom) {
+        fprintf(stderr, "Profile editor: a broken profile was not rejected\n");
+        return false;
+    }
+
+    printf("Profile editor: %d byte profile applied as profile %d and read back unchanged, broken one rejected (%s)\n",
+           length, custom, ProfileCodec_GetResultName(expected));
+    return true;
+}
+
+int main(int argc, char** argv) {
+    float seconds = argc > 1 ? (float)atof(argv[1]) : 10.0f;
+    int profile = argc > 2 ? atoi(argv[2]) : 0;
+    int update_rate = argc > 3 ? atoi(argv[3]) : 0;
+    int snapshot_rate = argc > 4 ? atoi(argv[4]) : 0;
+    int motors = argc > 5 ? atoi(argv[5]) : 1;
+
+    VescStub_Init();
+    VescStub_SetQuiet(true);
+
+    uint64_t steps = (uint64_t)(seconds * 1e6f) / UPDATE_INTERVAL_US;
+    AudioCounter counter = { 0 };
+    counter.dutyStep = steps > 0 ? 2.0f * TOP_DUTY / (float)steps : TOP_DUTY;
+    VescStub_SetAudioSink(CheckFadeIn, &counter);
+    VescStub_SetAudioStopSink(CheckFadeOut, &counter);
+
+    AppDataCounter telemetry = { 0 };
+    VescStub_SetAppDataSink(CountAppData, &telemetry);
+
+    if (!VescStub_LoadPlugin()) {
+        fprintf(stderr, "Plugin init failed\n");
+        return 1;
+    }
+
+    if (VescStub_IsError(VescStub_CallExtensionFloat("ext-set-profile", (float)profile))) {
+        fprintf(stderr, "Unknown profile %d\n", profile);
+        return 1;
+    }
+
+    if (!CheckProfileEditor(&telemetry, profile)) {
+        return 1;
+    }
+
+    EventListener listener = { 0 };
+    if (update_rate > 0) {
+        if (VescStub_IsError(VescStub_CallExtensionFloat("ext-set-update-rate", (float)update_rate))) {
+            fprintf(stderr, "Invalid update rate %d\n", update_rate);
+            return 1;
+        }
+        listener.thread = VESC_IF->spawn(ListenEvents, 1024, "listener", &listener);
+    }
+
+    if (snapshot_rate > 0 && VescStub_IsError(VescStub_CallExtensionFloat("ext-set-snapshot-rate", (float)snapshot_rate))) {
+        fprintf(stderr, "Invalid snapshot rate %d\n", snapshot_rate);
+        return 1;
+    }
+
+    if (motors != 1 && VescStub_IsError(VescStub_CallExtensionFloat("ext-set-motor-count", (float)motors))) {
+        fprintf(stderr, "Invalid motor count %d\n", motors);
+        return 1;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    VescStub_CallExtensionNoArgs("ext-start-audio-loop");
+
+    float topSpeeds[VESC_STUB_MOTORS] = { 0.0f };
+    for (uint64_t i = 0; i < steps; i++) {
+        // Accelerate up to the max speed over the first half, then coast back down
+        float t = (float)i / (float)steps;
+        float current = t < 0.5f ? 60.0f : COAST_CURRENT;
+
+        for (int m = 1; m <= motors; m++) {
+            float speed = (t < 0.5f ? t * 2.0f : (1.0f - t) * 2.0f) * MAX_RAMP_SPEED_KMH * (m == 1 ? 1.0f : MOTOR2_SPEED_SHARE);
+            // The duty is read by the playback thread either way
+            VescStubMotorState motor = { speed * KMH_TO_ERPM, current, speed / MAX_RAMP_SPEED_KMH * TOP_DUTY, INPUT_VOLTAGE,
+                                         speed / 3.6f, MOTOR_POLES };
+            VescStub_SetMotorStateOf(m, &motor);
+            if (update_rate <= 0) {
+                SetMotorValue("ext-set-motor-current", current, m);
+                SetMotorValue("ext-set-motor-hz", speed * KMH_TO_ERPM, m);
+                SetMotorValue("ext-set-motor-poles", (float)MOTOR_POLES, m);
+                SetMotorValue("ext-set-speed-kmh", speed, m);
+            }
+        }
+
+        VescStub_SleepUs(UPDATE_INTERVAL_US);
+
+        if (i == steps / 2) {
+            for (int m = 1; m <= motors; m++) {
+                topSpeeds[m - 1] = GetMotorSpeed(m);
+            }
+        }
+    }
+
+    // (buffer-period buffers-generated buffers-played underruns generation play-call lead jitter), see ext-get-stats
+    lbm_value stats = VescStub_CallExtensionNoArgs("ext-get-stats");
+    float totals[4];
+    float lead[4];
+    float jitter[4];
+    bool haveStats = VescStub_ListToFloats(stats, totals, 4) == 4 &&
+                     VescStub_ListToFloats(VescStub_ListNth(stats, 6), lead, 4) == 4 &&
+                     VescStub_ListToFloats(VescStub_ListNth(stats, 7), jitter, 4) == 4;
+
+    uint32_t limitedBuffers = GetLimitedBuffers();
+
+    VescStub_CallExtensionNoArgs("ext-stop-audio-loop");
+    VescStub_SleepUs(ENVELOPE_STOP_TIMEOUT_MS * 1000u); // The stop returns right away, the fade out ends in the background
+    VescStub_CallExtensionNoArgs("ext-send-events");
+    VescStub_SleepUs(UPDATE_INTERVAL_US); // Lets the listener catch up with the stop event
+    VescStub_UnloadPlugin();
+    if (listener.thread) VESC_IF->request_terminate(listener.thread);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double wall = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / (double)1000000000;
+    double simulated = (double)VescStub_GetTimeUs() / (double)1000000;
+
+    printf("Simulated %.2f s in %.3f s wall time (%.0fx real time)\n", simulated, wall, simulated / wall);
+    printf("Played %llu samples in %llu calls (%.1f samples/s per motor, expected at most %d)\n",
+           (unsigned long long)counter.samples, (unsigned long long)counter.calls,
+           (double)counter.samples / (double)motors / simulated, SAMPLE_RATE);
+
+    if (haveStats) {
+        // Histograms are (count min max mean ...)
+        printf("Buffers generated %.0f, played %.0f, underruns %.0f, lead min %.0f us, jitter max %.0f us\n",
+               (double)totals[1], (double)totals[2], (double)totals[3], (double)lead[1], (double)jitter[2]);
+    }
+
+    printf("Telemetry: %llu packets (%.1f/s), %llu invalid, last at %.2f km/h range %d carrier %.0f Hz\n",
+           (unsigned long long)telemetry.packets, (double)telemetry.packets / simulated,
+           (unsigned long long)telemetry.invalid, (double)telemetry.last.speedKmh,
+           telemetry.last.rangeIndex, (double)telemetry.last.carrierHz);
+
+    printf("Events:");
+    for (int i = 0; i < EVENT_TYPE_COUNT; i++) {
+        printf(" %s %llu", EventLog_GetTypeName((EventType)i), (unsigned long long)telemetry.events[i]);
+    }
+    printf(", %llu dropped\n", (unsigned long long)telemetry.eventsDropped);
+
+    if (snapshot_rate > 0) {
+        printf("Snapshots: %llu (%.1f/s), %llu delta encoded, %.2f bytes per sample, %llu invalid\n",
+               (unsigned long long)telemetry.snapshots, (double)telemetry.snapshots / simulated,
+               (unsigned long long)telemetry.snapshotsDelta,
+               telemetry.snapshotSamples ? (double)telemetry.snapshotBytes / (double)telemetry.snapshotSamples : (double)0,
+               (unsigned long long)telemetry.snapshotsInvalid);
+    }
+
+    bool listenerOk = true;
+    if (listener.thread) {
+        uint64_t received = 0;
+        for (int i = 0; i < EVENT_TYPE_COUNT; i++) {
+            received += listener.events[i];
+            if (listener.events[i] != telemetry.events[i]) listenerOk = false;
+        }
+        listenerOk = listenerOk && listener.errors == 0;
+        printf("Listener: %llu events in %llu wakeups, %llu errors, %s the event log\n",
+               (unsigned long long)received, (unsigned long long)listener.wakeups,
+               (unsigned long long)listener.errors, listenerOk ? "matches" : "does NOT match");
+    }
+
+    bool limitOk = counter.overLimit == 0 && counter.topCalls > 0 && limitedBuffers > 0;
+    printf("Voltage limit: %u buffers limited, %llu over the headroom, %llu with sound at the top: %s\n",
+           (unsigned)limitedBuffers, (unsigned long long)counter.overLimit, (unsigned long long)counter.topCalls,
+           limitOk ? "ok" : "FAILED");
+
+    bool envelopeOk = counter.fadesIn > 0 && counter.fadesOut == counter.fadesIn && counter.clicks == 0;
+    printf("Envelope: %llu fades in, %llu fades out, %llu clicks: %s\n", (unsigned long long)counter.fadesIn,
+           (unsigned long long)counter.fadesOut, (unsigned long long)counter.clicks, envelopeOk ? "ok" : "FAILED");
+
+    bool motorsOk = true;
+    if (motors > 1) {
+        float share = topSpeeds[0] > 0.0f ? topSpeeds[1] / topSpeeds[0] : 0.0f;
+        motorsOk = counter.motorSamples[0] > 0 && counter.motorSamples[1] > 0 &&
+                   share > MOTOR2_SPEED_SHARE - SPEED_SHARE_TOLERANCE && share < MOTOR2_SPEED_SHARE + SPEED_SHARE_TOLERANCE;
+        printf("Motors: %llu and %llu samples, at the top %.2f and %.2f km/h (%.2f of the first, expected %.2f), %s\n",
+               (unsigned long long)counter.motorSamples[0], (unsigned long long)counter.motorSamples[1],
+               (double)topSpeeds[0], (double)topSpeeds[1], (double)share, (double)MOTOR2_SPEED_SHARE,
+               motorsOk ? "ok" : "FAILED");
+    }
+
+    if (counter.samples == 0) {
+        fprintf(stderr, "No audio was played\n");
+        return 1;
+    }
+    if (!limitOk) {
+        fprintf(stderr, "The audio was not kept within the voltage headroom, or was cut at the top\n");
+        return 1;
+    }
+    if (!envelopeOk) {
+        fprintf(stderr, "The audio clicked when it started or stopped, or was left playing\n");
+        return 1;
+    }
+    if (!motorsOk) {
+        fprintf(stderr, "The motors don't play their own buffers at their own speeds\n");
+        return 1;
+    }
+    if (snapshot_rate > 0 && (telemetry.snapshots == 0 || telemetry.snapshotsInvalid > 0)) {
+        fprintf(stderr, "Snapshots missing or invalid\n");
+        return 1;
+    }
+    if (!listenerOk) {
+        fprintf(stderr, "Listener events don't match the event log\n");
+        return 1;
+    }
+
+    return 0;
+}
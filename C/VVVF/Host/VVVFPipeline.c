@@ -0,0 +1,131 @@
+// Sizes the sample pipeline with the discrete event model in Pipeline.h. Every combination
+// of the given buffer lengths and buffer counts is simulated with the same timing model and
+// seed, one row per combination:
+//
+//   vvvf_pipeline -l 50,100,150,300 -n 2,3,4 -t 120
+//
+// Options (defaults in brackets are from Pipeline_DefaultConfig and Parameters.h):
+//   -l lengths    samples per buffer, comma separated [BUFFER_LENGTH]
+//   -n counts     buffers, comma separated [NUM_BUFFERS]
+//   -t seconds    simulated time per combination
+//   -g us         generation time per sample
+//   -j us         largest scheduling jitter per wake up
+//   -b us         CPU time of one LBM update burst, 0 for none
+//   -p us         time between LBM updates
+//   -f slots      buffers the firmware audio queue holds
+//   -s seed       jitter random seed
+//   -o file.csv   also write the table as CSV
+
+#include "Pipeline.h"
+#include "Parameters.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_CHOICES 16
+
+static void PrintUsage(const char* _Name) {
+    fprintf(stderr, "Usage: %s [-l lengths] [-n counts] [-t seconds] [-g us] [-j us] [-b us] [-p us] [-f slots] [-s seed] [-o file.csv]\n",
+            _Name);
+}
+
+// Parses a comma separated list of positive integers, returns the count or -1 on bad input
+static int ParseList(const char* _Text, int* _Values, int _Max) {
+    int count = 0;
+    const char* cursor = _Text;
+    while (*cursor && count < _Max) {
+        char* end;
+        long value = strtol(cursor, &end, 10);
+        if (end == cursor || value <= 0) return -1;
+        _Values[count++] = (int)value;
+        cursor = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return -1;
+    }
+    return count;
+}
+
+int main(int argc, char** argv) {
+    PipelineConfig config;
+    Pipeline_DefaultConfig(&config);
+
+    int lengths[MAX_CHOICES] = { BUFFER_LENGTH };
+    int counts[MAX_CHOICES] = { NUM_BUFFERS };
+    int lengthCount = 1;
+    int countCount = 1;
+    const char* outputPath = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "l:n:t:g:j:b:p:f:s:o:h")) != -1) {
+        switch (opt) {
+            case 'l': lengthCount = ParseList(optarg, lengths, MAX_CHOICES); break;
+            case 'n': countCount = ParseList(optarg, counts, MAX_CHOICES); break;
+            case 't': config.durationS = (float)atof(optarg); break;
+            case 'g': config.generationUsPerSample = (float)atof(optarg); break;
+            case 'j': config.jitterUs = (float)atof(optarg); break;
+            case 'b': config.burstUs = (float)atof(optarg); break;
+            case 'p': config.burstPeriodUs = (float)atof(optarg); break;
+            case 'f': config.firmwareSlots = atoi(optarg); break;
+            case 's': config.seed = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'o': outputPath = optarg; break;
+            default:
+                PrintUsage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (lengthCount <= 0 || countCount <= 0) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    FILE* csv = NULL;
+    if (outputPath) {
+        csv = fopen(outputPath, "w");
+        if (!csv) {
+            fprintf(stderr, "Can't open %s\n", outputPath);
+            return 1;
+        }
+        fprintf(csv, "buffer_length,num_buffers,buffer_ms,ram_bytes,latency_mean_ms,latency_max_ms,underruns,gap_ms,"
+                     "rejected,starvation_waits,occupancy_mean,empty_percent\n");
+    }
+
+    printf("%.0f s at %.0f Hz, generation %.2f us/sample, jitter %.0f us, LBM burst %.0f us every %.0f us, %d firmware slots\n\n",
+           (double)config.durationS, (double)config.sampleRate, (double)config.generationUsPerSample,
+           (double)config.jitterUs, (double)config.burstUs, (double)config.burstPeriodUs, config.firmwareSlots);
+    printf("%6s %4s %8s %6s %18s %9s %9s %8s %8s %9s %7s\n", "length", "bufs", "period", "RAM", "latency mean/max",
+           "underruns", "gap", "rejected", "starved", "occupancy", "empty");
+
+    for (int l = 0; l < lengthCount; l++) {
+        for (int n = 0; n < countCount; n++) {
+            config.bufferLength = lengths[l];
+            config.numBuffers = counts[n];
+
+            PipelineResult result;
+            if (!Pipeline_Run(&config, &result)) {
+                printf("%6d %4d  can't be simulated, at most %d buffers\n", lengths[l], counts[n], PIPELINE_MAX_BUFFERS);
+                continue;
+            }
+
+            double bufferMs = (double)config.bufferLength / (double)config.sampleRate * (double)1000;
+            int ramBytes = config.bufferLength * config.numBuffers;
+            printf("%6d %4d %6.2fms %6d %7.2f/%7.2fms %9u %7.1fms %8u %8u %9.2f %6.1f%%%s\n",
+                   config.bufferLength, config.numBuffers, bufferMs, ramBytes,
+                   result.latencyMeanUs / (double)1000, result.latencyMaxUs / (double)1000,
+                   result.underruns, result.gapUs / (double)1000, result.rejected, result.starvationWaits,
+                   result.occupancyMean, result.occupancy[0] * (double)100,
+                   config.bufferLength == BUFFER_LENGTH && config.numBuffers == NUM_BUFFERS ? "  <- Parameters.h" : "");
+
+            if (csv) {
+                fprintf(csv, "%d,%d,%.3f,%d,%.3f,%.3f,%u,%.3f,%u,%u,%.3f,%.2f\n",
+                        config.bufferLength, config.numBuffers, bufferMs, ramBytes,
+                        result.latencyMeanUs / (double)1000, result.latencyMaxUs / (double)1000,
+                        result.underruns, result.gapUs / (double)1000, result.rejected, result.starvationWaits,
+                        result.occupancyMean, result.occupancy[0] * (double)100);
+            }
+        }
+    }
+
+    if (csv) fclose(csv);
+    return 0;
+}
@@ -0,0 +1,157 @@
+// Spectral verification of the generator output, see Spectrum.h for what is measured.
+//
+//   vvvf_spectrum                           - every benchmark case, plus the sync pulse checks
+//   vvvf_spectrum -w file.wav [-c command]  - a WAV file, e.g. from vvvf_render. command is the
+//                                             fundamental in Hz, for the pulses per cycle
+//
+// The sync checks render every pulse count from SPWM_SYNC and fail (exit code 1) when the
+// achieved pulses per cycle are off by more than SYNC_PULSE_TOLERANCE.
+
+#include "Benchmark.h"
+#include "ConfigParser.h"
+#include "SPWMGenerator.h"
+#include "Parameters.h"
+#include "Spectrum.h"
+#include "Wav.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define ANALYSIS_BUFFERS 220         // Just over 32768 samples, so the full FFT length is used
+#define ANALYSIS_SAMPLES (ANALYSIS_BUFFERS * BUFFER_LENGTH)
+#define SYNC_POLES 14
+#define SYNC_FUNDAMENTAL_HZ 50.0f
+#define SYNC_PULSE_TOLERANCE 0.05f
+
+static const int SyncPulses[] = { 1, 3, 5, 7, 9, 11, 15 };
+#define SYNC_PULSE_COUNT (int)(sizeof(SyncPulses) / sizeof(SyncPulses[0]))
+
+static void PrintHeader(void) {
+    printf("%-26s %10s %9s %9s  %s\n", "case", "carrier", "level", "alias", "sidebands (offset Hz / dBc)");
+}
+
+static void PrintReport(const char* _Name, const SpectrumReport* _Report) {
+    if (_Report->carrierHz <= 0.0f) {
+        printf("%-26s %10s\n", _Name, "silent");
+        return;
+    }
+
+    printf("%-26s %8.1fHz %7.1fdB %7.1fdB ", _Name, (double)_Report->carrierHz,
+           (double)_Report->carrierDb, (double)_Report->aliasDb);
+    for (int i = 0; i < _Report->sidebandCount; i++) {
+        printf(" %+.0f/%.0f", (double)_Report->sidebands[i].offsetHz, (double)_Report->sidebands[i].levelDb);
+    }
+    if (_Report->pulsesPerCycle > 0.0f) {
+        printf("  pulses/cycle %.2f", (double)_Report->pulsesPerCycle);
+    }
+    printf("\n");
+}
+
+static void AnalyzeBenchmarkCases(int8_t* _Samples) {
+    PrintHeader();
+
+    BenchmarkKernel kernel;
+    int variant;
+    int carrierHz;
+    for (int i = 0; Benchmark_GetCase(i, &kernel, &variant, &carrierHz); i++) {
+        float commandHz = Benchmark_Render(kernel, variant, carrierHz, _Samples, ANALYSIS_BUFFERS);
+
+        // Only sync output is meant to follow the command frequency
+        if (kernel != BENCHMARK_KERNEL_SPWM || variant != SPWM_TYPE_SYNC) commandHz = 0.0f;
+
+        SpectrumReport report;
+        Spectrum_AnalyzeInt8(_Samples, ANALYSIS_SAMPLES, SAMPLE_RATE, commandHz, &report);
+
+        char name[64];
+        snprintf(name, sizeof(name), "%s/%s/%d", Benchmark_GetKernelName(kernel),
+                 Benchmark_GetVariantName(kernel, variant), carrierHz);
+        PrintReport(name, &report);
+    }
+}
+
+// Returns the number of pulse counts that were not achieved
+static int CheckSyncPulses(int8_t* _Samples) {
+    printf("\nSync pulses at a %.0f Hz fundamental\n", (double)SYNC_FUNDAMENTAL_HZ);
+    PrintHeader();
+
+    int failures = 0;
+    for (int i = 0; i < SYNC_PULSE_COUNT; i++) {
+        SPWMConfig config = AddSPWM_Sync(SyncPulses[i]);
+        SpeedRange range = { 0.0f, 100.0f, { config, config, config } };
+        float commandHz = SYNC_FUNDAMENTAL_HZ * SYNC_POLES; // Electrical rpm, as the plugin passes it
+
+        SPWMGenerator generator;
+        SPWMGenerator_Init(&generator);
+        generator.CommandFrequency = SYNC_FUNDAMENTAL_HZ;
+        for (int b = 0; b < ANALYSIS_BUFFERS; b++) {
+            SPWMGenerator_GenerateSamples(&generator, ROTOR_STATE_ACCELERATING, _Samples + b * BUFFER_LENGTH, BUFFER_LENGTH,
+                                          &range, commandHz, SYNC_POLES, 50.0f);
+        }
+
+        SpectrumReport report;
+        Spectrum_AnalyzeInt8(_Samples, ANALYSIS_SAMPLES, SAMPLE_RATE, SYNC_FUNDAMENTAL_HZ, &report);
+
+        char name[64];
+        snprintf(name, sizeof(name), "spwm/sync/%d-pulse", SyncPulses[i]);
+        PrintReport(name, &report);
+
+        if (fabsf(report.pulsesPerCycle - (float)SyncPulses[i]) > SYNC_PULSE_TOLERANCE) {
+            printf("  FAIL: expected %d pulses per cycle\n", SyncPulses[i]);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+static int AnalyzeWav(const char* _Path, float _CommandHz) {
+    float* samples = malloc(SPECTRUM_MAX_LENGTH * sizeof(float));
+    if (!samples) return 1;
+
+    uint32_t sampleRate = 0;
+    int count = Wav_ReadFloat(_Path, samples, SPECTRUM_MAX_LENGTH, &sampleRate);
+    if (count < 0) {
+        fprintf(stderr, "Can't read %s, only mono 8 or 16 bit PCM is supported\n", _Path);
+        free(samples);
+        return 1;
+    }
+
+    SpectrumReport report;
+    if (!Spectrum_Analyze(samples, count, (float)sampleRate, _CommandHz, &report)) {
+        fprintf(stderr, "%s is too short, at least %d samples are needed\n", _Path, SPECTRUM_MIN_LENGTH);
+        free(samples);
+        return 1;
+    }
+
+    printf("%d of %d samples at %u Hz, %.2f Hz per bin\n\n", report.length, count, sampleRate, (double)report.binHz);
+    PrintHeader();
+    PrintReport(_Path, &report);
+
+    free(samples);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const char* wavPath = NULL;
+    float commandHz = 0.0f;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "w:c:h")) != -1) {
+        switch (opt) {
+            case 'w': wavPath = optarg; break;
+            case 'c': commandHz = (float)atof(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-w file.wav [-c command_hz]]\n", argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (wavPath) {
+        return AnalyzeWav(wavPath, commandHz);
+    }
+
+    static int8_t samples[ANALYSIS_SAMPLES];
+    AnalyzeBenchmarkCases(samples);
+    return CheckSyncPulses(samples) ? 1 : 0;
+}
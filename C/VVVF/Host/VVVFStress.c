@@ -0,0 +1,361 @@
+// Concurrency stress test of the plugin, meant to be run under ThreadSanitizer and
+// AddressSanitizer (make stress-tsan / make stress-asan). Several threads call random
+// extensions with random arguments while the generator, playback and telemetry loops run,
+// and one more thread keeps starting and stopping the audio loop:
+//
+//   vvvf_stress -t 30 -n 4
+//
+// On the VESC all extensions are called from the LispBM thread, here they are called from
+// several threads at once, which is a superset of what the firmware can do. The sanitizers
+// do the actual checking, the tool itself only fails when an extension rejects valid
+// arguments or no audio was played at all.
+//
+// Options:
+//   -t seconds    simulated time to run [10]
+//   -n threads    threads calling extensions [4]
+//   -p us         longest pause between two calls of one thread [500]
+//   -c ms         longest time the audio loop runs between a start and a stop, 0 to start
+//                 it once and leave it running [200]
+//   -s seed       random seed, the same seed gives the same call sequence per thread [1]
+//   -b weight     how often ext-bench is called relative to the other extensions, it only
+//                 runs while the audio loop is stopped and takes long in host time [0]
+
+#include "VescStub.h"
+#include "Profiles.h"
+#include "Snapshot.h"
+#include "ProfileCodec.h"
+#include "CarrierSync.h"
+#include "SPWMGenerator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_THREADS 16
+
+typedef enum {
+    CALL_SET_MOTOR_CURRENT,
+    CALL_SET_MOTOR_HZ,
+    CALL_SET_MOTOR_POLES,
+    CALL_SET_SPEED_KMH,
+    CALL_SET_PROFILE,
+    CALL_SET_PROFILE_BY_NAME,
+    CALL_GET_PROFILE,
+    CALL_GET_STATUS,
+    CALL_GET_STATS,
+    CALL_PRINT_STATS,
+    CALL_RESET_STATS,
+    CALL_SET_TELEMETRY_RATE,
+    CALL_PRINT_EVENTS,
+    CALL_SEND_EVENTS,
+    CALL_SET_UPDATE_RATE,
+    CALL_NEXT_EVENT,
+    CALL_SET_SNAPSHOT_RATE,
+    CALL_EDIT_PROFILE,
+    CALL_SET_CARRIER_SYNC,
+    CALL_GET_CARRIER_SYNC,
+    CALL_CARRIER_SYNC_FRAME,
+    CALL_SET_MOTOR_COUNT,
+    CALL_SET_MOTOR2_SPEED,
+    CALL_SET_VOLTAGE_LIMIT,
+    CALL_GET_VOLTAGE_LIMIT,
+    CALL_BENCH,
+    CALL_BAD_ARGUMENTS,
+    CALL_COUNT
+} CallType;
+
+typedef struct {
+    const char* name;
+    int weight;           // Relative frequency
+    bool mayFail;         // Allowed to return an error with the arguments the tool passes
+} CallInfo;
+
+static CallInfo Calls[CALL_COUNT] = {
+    { "ext-set-motor-current", 20, false },
+    { "ext-set-motor-hz", 20, false },
+    { "ext-set-motor-poles", 4, false },
+    { "ext-set-speed-kmh", 20, false },
+    { "ext-set-profile", 3, false },
+    { "ext-set-profile", 1, false },
+    { "ext-get-profile", 4, false },
+    { "ext-get-status", 10, false },
+    { "ext-get-stats", 4, false },
+    { "ext-print-stats", 2, false },
+    { "ext-reset-stats", 1, false },
+    { "ext-set-telemetry-rate", 2, false },
+    { "ext-print-events", 1, false },
+    { "ext-send-events", 2, false },
+    { "ext-set-update-rate", 2, false }, // Makes the generator poll the motor while the others set it
+    { "ext-next-event", 4, false },
+    { "ext-set-snapshot-rate", 2, false },
+    { "profile editor", 2, false }, // Not an extension, a random library profile sent as app data
+    { "ext-set-carrier-sync", 2, false },
+    { "ext-get-carrier-sync", 2, false },
+    { "carrier sync frame", 10, false }, // Not an extension, a random leader frame from the CAN bus
+    { "ext-set-motor-count", 2, true }, // Refused while the audio loop runs
+    { "ext-set-speed-kmh", 10, true },  // Of the second motor, refused while only one is driven
+    { "ext-set-voltage-limit", 2, false },
+    { "ext-get-voltage-limit", 2, false },
+    { "ext-bench", 0, true },      // Weight set from the command line, it takes a lot of host time
+    { "ext-set-motor-hz", 2, true } // Wrong number of arguments, must be rejected cleanly
+};
+
+typedef struct {
+    lib_thread thread;
+    uint32_t random;
+    uint64_t calls[CALL_COUNT];
+    uint64_t errors[CALL_COUNT];
+} Hammer;
+
+typedef struct {
+    lib_thread thread;
+    uint32_t random;
+    int maxRunMs;
+    uint64_t cycles;
+    uint64_t errors;
+} Cycler;
+
+static int MaxPauseUs = 500;
+static int TotalWeight = 0;
+
+static uint32_t Random(uint32_t* _State) {
+    // xorshift32
+    uint32_t x = *_State;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *_State = x;
+    return x;
+}
+
+static float RandomRange(uint32_t* _State, float _Min, float _Max) {
+    return _Min + (_Max - _Min) * (float)(Random(_State) % 10001u) / 10000.0f;
+}
+
+static CallType PickCall(uint32_t* _State) {
+    int pick = (int)(Random(_State) % (uint32_t)TotalWeight);
+    for (int i = 0; i < CALL_COUNT; i++) {
+        if (pick < Calls[i].weight) return (CallType)i;
+        pick -= Calls[i].weight;
+    }
+    return CALL_GET_STATUS;
+}
+
+static lbm_value MakeCall(CallType _Type, uint32_t* _State) {
+    const char* name = Calls[_Type].name;
+    switch (_Type) {
+        case CALL_SET_MOTOR_CURRENT:
+            return VescStub_CallExtensionFloat(name, RandomRange(_State, -60.0f, 120.0f));
+        case CALL_SET_MOTOR_HZ:
+            return VescStub_CallExtensionFloat(name, RandomRange(_State, -200.0f, 2000.0f));
+        case CALL_SET_MOTOR_POLES:
+            // Includes 0, the settings update divides by it
+            return VescStub_CallExtensionFloat(name, (float)(Random(_State) % 30u));
+        case CALL_SET_SPEED_KMH:
+            return VescStub_CallExtensionFloat(name, RandomRange(_State, -10.0f, 120.0f));
+        case CALL_SET_PROFILE:
+            return VescStub_CallExtensionFloat(name, (float)(Random(_State) % (uint32_t)GetProfileCount()));
+        case CALL_SET_PROFILE_BY_NAME: {
+            lbm_value arg = VescStub_EncodeString(GetProfile((int)(Random(_State) % (uint32_t)GetProfileCount()))->name);
+            return VescStub_CallExtension(name, &arg, 1);
+        }
+        case CALL_SET_TELEMETRY_RATE:
+            return VescStub_CallExtensionFloat(name, (float)(Random(_State) % 51u));
+        case CALL_SET_UPDATE_RATE:
+            return VescStub_CallExtensionFloat(name, (float)(Random(_State) % (uint32_t)(SAMPLE_RATE / BUFFER_LENGTH + 1)));
+        case CALL_SET_SNAPSHOT_RATE:
+            return VescStub_CallExtensionFloat(name, (float)(Random(_State) % (SNAPSHOT_MAX_RATE_HZ + 1u)));
+        case CALL_EDIT_PROFILE: {
+            uint8_t packet[PROFILE_MAX_PACKET_LENGTH];
+            int index = (int)(Random(_State) % (uint32_t)GetProfileCount());
+            int length = ProfileCodec_Encode(GetProfile(index), index, index, packet);
+            packet[2] = PROFILE_CMD_APPLY;
+            return VescStub_ReceiveAppData(packet, (unsigned int)length) ? VESC_IF->lbm_enc_sym_true : VESC_IF->lbm_enc_sym_eerror;
+        }
+        case CALL_SET_CARRIER_SYNC: {
+            lbm_value args[2] = { VESC_IF->lbm_enc_i((int32_t)(Random(_State) % 3u)),
+                                  VESC_IF->lbm_enc_i((int32_t)(1u + Random(_State) % CARRIER_SYNC_MAX_RATE_HZ)) };
+            return VescStub_CallExtension(name, args, 2);
+        }
+        case CALL_CARRIER_SYNC_FRAME: {
+            // Only taken while the plugin is a follower, dropped otherwise
+            CarrierSyncFrame frame;
+            frame.sequence = (uint8_t)Random(_State);
+            frame.rangeIndex = (int)(Random(_State) % 20u) - 1; // Includes ranges the profile does not have
+            frame.carrierPhase = RandomRange(_State, 0.0f, TWO_PI);
+            frame.commandPhase = RandomRange(_State, 0.0f, TWO_PI);
+            frame.carrierHz = RandomRange(_State, 0.0f, 12000.0f);
+            uint8_t data[CARRIER_SYNC_FRAME_LENGTH];
+            CarrierSync_Encode(&frame, data);
+            VescStub_ReceiveCan(CARRIER_SYNC_CAN_ID, data, CARRIER_SYNC_FRAME_LENGTH);
+            return VESC_IF->lbm_enc_sym_true;
+        }
+        case CALL_SET_MOTOR_COUNT:
+            return VescStub_CallExtensionFloat(name, (float)(1u + Random(_State) % 2u));
+        case CALL_SET_MOTOR2_SPEED: {
+            lbm_value args[2] = { VESC_IF->lbm_enc_float(RandomRange(_State, -10.0f, 120.0f)), VESC_IF->lbm_enc_i(2) };
+            return VescStub_CallExtension(name, args, 2);
+        }
+        case CALL_SET_VOLTAGE_LIMIT:
+            // Off now and then, otherwise anywhere in the valid range
+            return VescStub_CallExtensionFloat(name, Random(_State) % 4u == 0 ? 0.0f : RandomRange(_State, 0.1f, 1.0f));
+        case CALL_BAD_ARGUMENTS:
+            return VescStub_CallExtensionNoArgs(name);
+        default:
+            return VescStub_CallExtensionNoArgs(name);
+    }
+}
+
+static void HammerLoop(void* _Arg) {
+    Hammer* hammer = (Hammer*)_Arg;
+    while (!VESC_IF->should_terminate()) {
+        CallType type = PickCall(&hammer->random);
+        hammer->calls[type]++;
+        if (VescStub_IsError(MakeCall(type, &hammer->random))) {
+            hammer->errors[type]++;
+        }
+        VESC_IF->sleep_us(1 + Random(&hammer->random) % (uint32_t)MaxPauseUs);
+    }
+}
+
+static void CyclerLoop(void* _Arg) {
+    Cycler* cycler = (Cycler*)_Arg;
+    while (!VESC_IF->should_terminate()) {
+        if (VescStub_IsError(VescStub_CallExtensionNoArgs("ext-start-audio-loop"))) cycler->errors++;
+        VESC_IF->sleep_us(Random(&cycler->random) % ((uint32_t)cycler->maxRunMs * 1000u));
+        if (VescStub_IsError(VescStub_CallExtensionNoArgs("ext-stop-audio-loop"))) cycler->errors++;
+        cycler->cycles++;
+
+        // Sometimes restart right away, the threads of the previous run have only just exited
+        if (Random(&cycler->random) % 4u != 0) {
+            VESC_IF->sleep_us(Random(&cycler->random) % 20000u);
+        }
+    }
+}
+
+static void CountSamples(const int8_t* samples, int numSamples, float sampleRate, float voltage, void* arg) {
+    (void)sampleRate;
+    (void)voltage;
+    // Touch every sample, so ASan catches a buffer that was freed or is too short
+    volatile int sum = 0;
+    for (int i = 0; i < numSamples; i++) sum += samples[i];
+    *(uint64_t*)arg += (uint64_t)numSamples;
+}
+
+static void PrintUsage(const char* _Name) {
+    fprintf(stderr, "Usage: %s [-t seconds] [-n threads] [-p us] [-c ms] [-s seed] [-b weight]\n", _Name);
+}
+
+int main(int argc, char** argv) {
+    float seconds = 10.0f;
+    int threadCount = 4;
+    int maxRunMs = 200;
+    int benchWeight = 0;
+    uint32_t seed = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:n:p:c:s:b:h")) != -1) {
+        switch (opt) {
+            case 't': seconds = (float)atof(optarg); break;
+            case 'n': threadCount = atoi(optarg); break;
+            case 'p': MaxPauseUs = atoi(optarg); break;
+            case 'c': maxRunMs = atoi(optarg); break;
+            case 's': seed = (uint32_t)strtoul(optarg, NULL, 10); break;
+            case 'b': benchWeight = atoi(optarg); break;
+            default:
+                PrintUsage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (seconds <= 0.0f || threadCount < 1 || threadCount > MAX_THREADS || MaxPauseUs < 1 || maxRunMs < 0 || benchWeight < 0) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    Calls[CALL_BENCH].weight = benchWeight;
+    for (int i = 0; i < CALL_COUNT; i++) TotalWeight += Calls[i].weight;
+
+    VescStub_Init();
+    VescStub_SetQuiet(true);
+
+    uint64_t samples = 0;
+    VescStub_SetAudioSink(CountSamples, &samples);
+
+    if (!VescStub_LoadPlugin()) {
+        fprintf(stderr, "Plugin init failed\n");
+        return 1;
+    }
+
+    static Hammer hammers[MAX_THREADS];
+    for (int i = 0; i < threadCount; i++) {
+        hammers[i].random = (seed ? seed : 1) * 2654435761u + (uint32_t)i * 40503u + 1u;
+        hammers[i].thread = VESC_IF->spawn(HammerLoop, 2048, "hammer", &hammers[i]);
+    }
+
+    Cycler cycler = { 0 };
+    cycler.random = (seed ? seed : 1) ^ 0x9E3779B9u;
+    cycler.maxRunMs = maxRunMs;
+    if (maxRunMs > 0) {
+        cycler.thread = VESC_IF->spawn(CyclerLoop, 2048, "cycler", &cycler);
+    } else {
+        VescStub_CallExtensionNoArgs("ext-start-audio-loop");
+    }
+
+    VescStub_SleepUs((uint64_t)((double)seconds * (double)1000000));
+
+    // Stop the callers first, the plugin must not be unloaded under them
+    for (int i = 0; i < threadCount; i++) {
+        VESC_IF->request_terminate(hammers[i].thread);
+    }
+    if (cycler.thread) {
+        VESC_IF->request_terminate(cycler.thread);
+    }
+    VescStub_CallExtensionNoArgs("ext-stop-audio-loop");
+    VescStub_UnloadPlugin();
+
+    printf("%.1f s, %d threads, pauses up to %d us, ", (double)seconds, threadCount, MaxPauseUs);
+    if (maxRunMs > 0) {
+        printf("%llu start/stop cycles\n\n", (unsigned long long)cycler.cycles);
+    } else {
+        printf("no start/stop cycling\n\n");
+    }
+
+    int failures = 0;
+    printf("%-24s %10s %10s\n", "extension", "calls", "errors");
+    for (int type = 0; type < CALL_COUNT; type++) {
+        uint64_t calls = 0;
+        uint64_t errors = 0;
+        for (int i = 0; i < threadCount; i++) {
+            calls += hammers[i].calls[type];
+            errors += hammers[i].errors[type];
+        }
+        if (calls == 0) continue;
+
+        const char* note = "";
+        if (type == CALL_BAD_ARGUMENTS) {
+            note = errors == calls ? "  (no arguments)" : "  (no arguments, accepted!)";
+            if (errors != calls) failures++;
+        } else if (type == CALL_SET_PROFILE_BY_NAME) {
+            note = "  (by name)";
+        } else if (type == CALL_SET_MOTOR2_SPEED) {
+            note = "  (motor 2)";
+        }
+        if (errors > 0 && !Calls[type].mayFail) failures++;
+        printf("%-24s %10llu %10llu%s\n", Calls[type].name, (unsigned long long)calls, (unsigned long long)errors, note);
+    }
+    if (cycler.errors > 0) {
+        printf("%llu start/stop calls failed\n", (unsigned long long)cycler.errors);
+        failures++;
+    }
+
+    printf("\n%llu samples played\n", (unsigned long long)samples);
+    if (samples == 0) failures++;
+
+    if (failures > 0) {
+        printf("FAILED\n");
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,228 @@
+// Host check of the carrier phase sync over CAN, see CarrierSync.h. The plugin runs at a constant
+// speed, first as the leader and then as a follower:
+//
+//   vvvf_sync [-t seconds] [-p profile] [-s speed] [-o offset-hz]
+//
+// Leader: the frames sent with can_transmit_eid are counted and decoded. Their rate has to match
+// the one asked for, and every carrier phase has to be where the previous one predicts, at the
+// carrier frequency of the frame over the virtual time in between.
+//
+// Follower: the tool becomes the leader, a quarter cycle out of phase, and sends its carrier to the
+// plugin a few times per second. The frames claim the plugin's carrier frequency, but the phase
+// actually runs -o Hz faster, the way two VESCs with slightly different crystals would drift
+// apart. The plugin has to pull its carrier in and stay locked over the second half of the run,
+// take the speed range from the frames, and let go once they stop.
+//
+// Exit code 1 when a check fails.
+
+#include "VescStub.h"
+#include "CarrierSync.h"
+#include "SPWMGenerator.h"
+#include "Parameters.h"
+#include "Profiles.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SYNC_RATE_HZ CARRIER_SYNC_DEFAULT_RATE_HZ
+#define SYNC_POLES 14
+#define SYNC_CURRENT 20.0f
+#define KMH_TO_ERPM 100.0f // Same rough factor as vvvf_host
+#define RATE_TOLERANCE 0.1f // Share the leader's frame rate may be off
+#define PREDICTION_LIMIT_DEG 2.0f // Encoding rounds the phase to 0.006 degrees and the carrier to 1/256 Hz
+
+typedef struct {
+    uint64_t frames;
+    uint64_t invalid;
+    uint64_t gaps; // Frames missing from the sequence
+    CarrierSyncFrame last;
+    double lastTime;
+    float maxPredictionDeg; // Largest difference to the phase the previous frame predicts
+} LeaderCounter;
+
+static void CountFrames(uint32_t id, const uint8_t* data, uint8_t length, void* arg) {
+    LeaderCounter* counter = (LeaderCounter*)arg;
+    CarrierSyncFrame frame;
+    if (id != CARRIER_SYNC_CAN_ID || !CarrierSync_Decode(data, length, &frame)) {
+        counter->invalid++;
+        return;
+    }
+
+    double now = (double)VescStub_GetTimeUs() / (double)1000000;
+    if (counter->frames > 0) {
+        counter->gaps += (uint8_t)(frame.sequence - counter->last.sequence - 1);
+        if (frame.carrierHz > 0.0f && frame.carrierHz == counter->last.carrierHz) {
+            float predicted = CarrierSync_Extrapolate(counter->last.carrierPhase, counter->last.carrierHz,
+                                                      (float)(now - counter->lastTime));
+            float error = fabsf(CarrierSync_PhaseError(predicted, frame.carrierPhase)) * 360.0f / TWO_PI;
+            if (error > counter->maxPredictionDeg) {
+                counter->maxPredictionDeg = error;
+            }
+        }
+    }
+    counter->last = frame;
+    counter->lastTime = now;
+    counter->frames++;
+}
+
+static lbm_value CallCarrierSync(int mode) {
+    lbm_value args[2] = { VESC_IF->lbm_enc_i(mode), VESC_IF->lbm_enc_i(SYNC_RATE_HZ) };
+    return VescStub_CallExtension("ext-set-carrier-sync", args, 2);
+}
+
+// (mode frames error-deg locked), see ext-get-carrier-sync
+static void GetSync(float* errorDeg, bool* locked) {
+    lbm_value status = VescStub_CallExtensionNoArgs("ext-get-carrier-sync");
+    *errorDeg = VESC_IF->lbm_dec_as_float(VescStub_ListNth(status, 2));
+    *locked = VescStub_ListNth(status, 3) == VESC_IF->lbm_enc_sym_true;
+}
+
+static int GetRangeIndex(void) {
+    return (int)VESC_IF->lbm_dec_as_i32(VescStub_ListNth(VescStub_CallExtensionNoArgs("ext-get-status"), 1));
+}
+
+static void SendFrame(const CarrierSyncFrame* frame) {
+    uint8_t data[CARRIER_SYNC_FRAME_LENGTH];
+    CarrierSync_Encode(frame, data);
+    VescStub_ReceiveCan(CARRIER_SYNC_CAN_ID, data, CARRIER_SYNC_FRAME_LENGTH);
+}
+
+static bool RunLeader(float seconds, LeaderCounter* counter) {
+    VescStub_SetCanSink(CountFrames, counter);
+    if (VescStub_IsError(CallCarrierSync(SYNC_MODE_LEADER))) {
+        fprintf(stderr, "ext-set-carrier-sync refused leader mode\n");
+        return false;
+    }
+    VescStub_SleepUs((uint64_t)(seconds * 1e6f));
+    VescStub_SetCanSink(NULL, NULL);
+
+    float rate = (float)counter->frames / seconds;
+    bool ok = counter->frames > 0 && counter->invalid == 0 && counter->gaps == 0 &&
+              fabsf(rate - (float)SYNC_RATE_HZ) <= RATE_TOLERANCE * (float)SYNC_RATE_HZ &&
+              counter->maxPredictionDeg <= PREDICTION_LIMIT_DEG;
+    printf("Leader: %llu frames (%.2f/s, asked for %d), %llu invalid, %llu missing, range %d carrier %.2f Hz, "
+           "phase within %.3f deg of the prediction: %s\n",
+           (unsigned long long)counter->frames, (double)rate, SYNC_RATE_HZ, (unsigned long long)counter->invalid,
+           (unsigned long long)counter->gaps, counter->last.rangeIndex, (double)counter->last.carrierHz,
+           (double)counter->maxPredictionDeg, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+static bool RunFollower(float seconds, float speed, int rangeCount, float offsetHz, const CarrierSyncFrame* plugin) {
+    if (VescStub_IsError(CallCarrierSync(SYNC_MODE_FOLLOWER))) {
+        fprintf(stderr, "ext-set-carrier-sync refused follower mode\n");
+        return false;
+    }
+
+    // Same carrier on paper, a little off in fact, and a quarter cycle out of phase
+    CarrierSyncFrame leader = *plugin;
+    float actualHz = plugin->carrierHz + offsetHz;
+    leader.carrierPhase = CarrierSync_Extrapolate(plugin->carrierPhase + TWO_PI / 4.0f, 0.0f, 0.0f);
+
+    uint64_t intervalUs = 1000000 / SYNC_RATE_HZ;
+    int frames = (int)(seconds * (float)SYNC_RATE_HZ);
+    float firstErrorDeg = 0.0f;
+    float maxSettledDeg = 0.0f;
+    bool alwaysLocked = true;
+    for (int i = 0; i < frames; i++) {
+        leader.sequence = (uint8_t)i;
+        SendFrame(&leader);
+        VescStub_SleepUs(intervalUs);
+        leader.carrierPhase = CarrierSync_Extrapolate(leader.carrierPhase, actualHz, (float)intervalUs / 1e6f);
+
+        float errorDeg;
+        bool locked;
+        GetSync(&errorDeg, &locked);
+        if (i == 0) {
+            firstErrorDeg = errorDeg;
+        }
+        if (i >= frames / 2) {
+            maxSettledDeg = fmaxf(maxSettledDeg, fabsf(errorDeg));
+            alwaysLocked = alwaysLocked && locked;
+        }
+    }
+    bool ok = frames > 1 && alwaysLocked;
+    printf("Follower: leader clock %+.2f Hz off, first error %.1f deg, settled within %.2f deg over the last %d frames, %s\n",
+           (double)offsetHz, (double)firstErrorDeg, (double)maxSettledDeg, frames - frames / 2,
+           ok ? "locked" : "NOT locked");
+
+    // The speed range follows the leader's, even where the plugin's own speed points elsewhere. It
+    // is picked up with the next update, as Lisp sends them every 20 ms.
+    bool rangeOk = true;
+    if (rangeCount > 1) {
+        int range = plugin->rangeIndex > 0 ? 0 : 1;
+        leader.rangeIndex = range;
+        SendFrame(&leader);
+        VescStub_SleepUs(intervalUs);
+        VescStub_CallExtensionFloat("ext-set-speed-kmh", speed);
+        rangeOk = GetRangeIndex() == range;
+        printf("Follower: range %d from the leader %s\n", range, rangeOk ? "taken over" : "NOT taken over");
+    }
+
+    // And when the frames stop, the plugin runs free on its own range again
+    VescStub_SleepUs((uint64_t)(CARRIER_SYNC_TIMEOUT_S * 1.5f * 1e6f));
+    VescStub_CallExtensionFloat("ext-set-speed-kmh", speed);
+    float errorDeg;
+    bool locked;
+    GetSync(&errorDeg, &locked);
+    bool releaseOk = !locked && GetRangeIndex() == plugin->rangeIndex;
+    printf("Follower: %s after the frames stopped\n", releaseOk ? "released" : "NOT released");
+
+    return ok && rangeOk && releaseOk;
+}
+
+int main(int argc, char** argv) {
+    float seconds = 10.0f;
+    int profile = 0;
+    float speed = 20.0f;
+    float offsetHz = 0.3f;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:p:s:o:")) != -1) {
+        switch (opt) {
+            case 't': seconds = (float)atof(optarg); break;
+            case 'p': profile = atoi(optarg); break;
+            case 's': speed = (float)atof(optarg); break;
+            case 'o': offsetHz = (float)atof(optarg); break;
+            default:
+                fprintf(stderr, "Usage: vvvf_sync [-t seconds] [-p profile] [-s speed] [-o offset-hz]\n");
+                return 1;
+        }
+    }
+
+    VescStub_Init();
+    VescStub_SetQuiet(true);
+    if (!VescStub_LoadPlugin()) {
+        fprintf(stderr, "Plugin init failed\n");
+        return 1;
+    }
+    if (VescStub_IsError(VescStub_CallExtensionFloat("ext-set-profile", (float)profile))) {
+        fprintf(stderr, "Unknown profile %d\n", profile);
+        return 1;
+    }
+
+    // The plugin averages the motor values, so every average has to be full of the constant speed
+    for (int i = 0; i < RPM_SAMPLE_COUNT || i < NUM_MOTOR_STAT_SAMPLES; i++) {
+        VescStub_CallExtensionFloat("ext-set-motor-current", SYNC_CURRENT);
+        VescStub_CallExtensionFloat("ext-set-motor-hz", speed * KMH_TO_ERPM);
+        VescStub_CallExtensionFloat("ext-set-motor-poles", (float)SYNC_POLES);
+        VescStub_CallExtensionFloat("ext-set-speed-kmh", speed);
+    }
+    VescStub_CallExtensionNoArgs("ext-start-audio-loop");
+
+    LeaderCounter counter = { 0 };
+    bool ok = RunLeader(seconds / 2.0f, &counter);
+    if (counter.frames > 0 && counter.last.carrierHz > 0.0f) {
+        ok = RunFollower(seconds / 2.0f, speed, GetProfile(profile)->config.speedRangeCount, offsetHz, &counter.last) && ok;
+    } else {
+        fprintf(stderr, "No carrier to follow at %.1f km/h, pick a speed with an async or sync range\n", (double)speed);
+        ok = false;
+    }
+
+    VescStub_CallExtensionNoArgs("ext-stop-audio-loop");
+    VescStub_UnloadPlugin();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+// Synthesizes a ride trace with the vehicle model in Vehicle.h, for vvvf_render and the other
+// tools that read traces:
+//
+//   vvvf_vehicle -s chatter -p async-sync -r 50 chatter.csv
+//   vvvf_render -p async-sync chatter.csv chatter.wav
+//
+// Options (defaults in brackets are from Vehicle_DefaultConfig):
+//   -s scenario   built in scenario: ride, chatter, highspeed, stopgo [ride]
+//   -f file       throttle profile to run instead of a scenario, see Vehicle_LoadScenario
+//   -p profile    profile index or name, chatter dithers on its speed range boundaries [0]
+//   -r hz         output samples per second, any rate, 50 is what Lisp/Main.lisp sees [50]
+//   -n poles      motor poles
+//   -w mm         wheel diameter
+//   -g ratio      motor turns per wheel turn
+//   -m kg         vehicle and rider mass
+//   -c amps       motor current at full throttle
+//   -b amps       motor current at full regen brake
+//   -v km/h       top speed of the motor
+//   -x seed       current ripple random seed
+// The trace is written as CSV, or as binary when the file name ends in .bin.
+
+#include "Vehicle.h"
+#include "Profiles.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void PrintUsage(const char* _Name) {
+    fprintf(stderr, "Usage: %s [-s scenario | -f throttle.csv] [-p profile] [-r hz] [-n poles] [-w mm] [-g ratio] [-m kg] "
+                    "[-c amps] [-b amps] [-v km/h] [-x seed] out.csv|out.bin\n", _Name);
+    fprintf(stderr, "Scenarios: %s\n", Vehicle_GetScenarioNames());
+}
+
+int main(int argc, char** argv) {
+    VehicleConfig config;
+    Vehicle_DefaultConfig(&config);
+
+    const char* scenarioName = "ride";
+    const char* throttlePath = NULL;
+    const char* profile = "0";
+    float rateHz = 50.0f;
+    uint32_t seed = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:f:p:r:n:w:g:m:c:b:v:x:h")) != -1) {
+        switch (opt) {
+            case 's': scenarioName = optarg; break;
+            case 'f': throttlePath = optarg; break;
+            case 'p': profile = optarg; break;
+            case 'r': rateHz = (float)atof(optarg); break;
+            case 'n': config.poles = atoi(optarg); break;
+            case 'w': config.wheelDiameterMm = (float)atof(optarg); break;
+            case 'g': config.gearRatio = (float)atof(optarg); break;
+            case 'm': config.massKg = (float)atof(optarg); break;
+            case 'c': config.maxCurrent = (float)atof(optarg); break;
+            case 'b': config.maxRegenCurrent = (float)atof(optarg); break;
+            case 'v': config.maxSpeedKmh = (float)atof(optarg); break;
+            case 'x': seed = (uint32_t)strtoul(optarg, NULL, 10); break;
+            default:
+                PrintUsage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 1) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    const char* outputPath = argv[optind];
+
+    // Profiles can be given by index or by name
+    char* end;
+    long index = strtol(profile, &end, 10);
+    const InverterProfile* inverterProfile = GetProfile(*end == '\0' ? (int)index : FindProfileByName(profile));
+    if (!inverterProfile) {
+        fprintf(stderr, "Unknown profile %s\n", profile);
+        return 1;
+    }
+
+    static VehicleScenario scenario;
+    if (throttlePath) {
+        if (!Vehicle_LoadScenario(&scenario, throttlePath)) return 1;
+        scenarioName = throttlePath;
+    } else if (!Vehicle_BuildScenario(&scenario, scenarioName, &config, &inverterProfile->config)) {
+        fprintf(stderr, "Unknown scenario %s\n", scenarioName);
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    Trace trace;
+    Trace_Init(&trace);
+    if (!Vehicle_Simulate(&config, &scenario, rateHz, seed, &trace)) {
+        fprintf(stderr, "Can't simulate this configuration\n");
+        return 1;
+    }
+
+    size_t length = strlen(outputPath);
+    bool binary = length > 4 && strcmp(outputPath + length - 4, ".bin") == 0;
+    if (!(binary ? Trace_SaveBinary(&trace, outputPath) : Trace_SaveCsv(&trace, outputPath))) {
+        fprintf(stderr, "Failed to write %s\n", outputPath);
+        return 1;
+    }
+
+    float maxSpeed = 0.0f, maxCurrent = 0.0f, minCurrent = 0.0f, maxRpm = 0.0f;
+    for (int i = 0; i < trace.count; i++) {
+        const TraceSample* s = &trace.samples[i];
+        if (s->speedKmh > maxSpeed) maxSpeed = s->speedKmh;
+        if (s->rpm > maxRpm) maxRpm = s->rpm;
+        if (s->current > maxCurrent) maxCurrent = s->current;
+        if (s->current < minCurrent) minCurrent = s->current;
+    }
+    printf("%s: %.1f s, %d samples at %g Hz, %d segments\n", scenarioName, (double)Trace_Duration(&trace), trace.count,
+           (double)rateHz, scenario.count);
+    printf("Top speed %.1f km/h (%.0f erpm), current %.1f A to %.1f A, profile %s\n", (double)maxSpeed, (double)maxRpm,
+           (double)minCurrent, (double)maxCurrent, inverterProfile->name);
+
+    Trace_Free(&trace);
+    return 0;
+}
@@ -0,0 +1,263 @@
+#include "Vehicle.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GRAVITY 9.81f
+#define AIR_DENSITY 1.2f
+#define REGEN_FADE_KMH 3.0f      // Regen current fades out below this speed
+#define BACK_EMF_TAPER 0.1f      // Drive current tapers off over the last 10 % below maxSpeedKmh
+#define HIGHSPEED_FRACTION 0.95f
+#define CHATTER_FLIP_S 0.15f
+
+typedef struct {
+    float speed;                 // m/s, never negative
+    float current;               // Motor current, A
+    float throttle;
+    int chatterFlip;             // Last flip of a SEGMENT_CHATTER, -1 at the start of a segment
+    uint32_t random;
+} VehicleState;
+
+void Vehicle_DefaultConfig(VehicleConfig* _Config) {
+    memset(_Config, 0, sizeof(VehicleConfig));
+    _Config->poles = 14;
+    _Config->wheelDiameterMm = 254.0f;
+    _Config->gearRatio = 1.0f;
+    _Config->massKg = 100.0f;
+    _Config->maxCurrent = 60.0f;
+    _Config->maxRegenCurrent = 40.0f;
+    _Config->torqueConstant = 0.5f;
+    _Config->maxSpeedKmh = 60.0f;
+    _Config->dragArea = 0.6f;
+    _Config->rollingResistance = 0.012f;
+    _Config->currentTimeConstant = 0.05f;
+    _Config->currentNoise = 0.5f;
+}
+
+static float Clamp(float _Value, float _Min, float _Max) {
+    if (_Value < _Min) return _Min;
+    if (_Value > _Max) return _Max;
+    return _Value;
+}
+
+static float Random(VehicleState* _State) {
+    // xorshift32, uniform in -1..1
+    uint32_t x = _State->random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    _State->random = x;
+    return (float)((double)x / (double)UINT32_MAX) * 2.0f - 1.0f;
+}
+
+static bool AddSegment(VehicleScenario* _Scenario, SegmentType _Type, float _Duration, float _Value, float _Band, float _Amount) {
+    if (_Scenario->count >= VEHICLE_MAX_SEGMENTS || _Duration <= 0.0f) return false;
+    VehicleSegment* segment = &_Scenario->segments[_Scenario->count++];
+    segment->type = _Type;
+    segment->duration = _Duration;
+    segment->value = _Value;
+    segment->band = _Band;
+    segment->amount = _Amount;
+    return true;
+}
+
+static void AddThrottle(VehicleScenario* _Scenario, float _RampS, float _HoldS, float _Throttle) {
+    AddSegment(_Scenario, SEGMENT_THROTTLE, _RampS, _Throttle, 0.0f, 0.0f);
+    AddSegment(_Scenario, SEGMENT_THROTTLE, _HoldS, _Throttle, 0.0f, 0.0f);
+}
+
+static void AddHold(VehicleScenario* _Scenario, float _Duration, float _SpeedKmh, float _BandKmh, float _Amount) {
+    AddSegment(_Scenario, SEGMENT_HOLD_SPEED, _Duration, _SpeedKmh, _BandKmh, _Amount);
+}
+
+// Release the throttle, coast for a while and brake to a stop
+static void AddStop(VehicleScenario* _Scenario, float _CoastS, float _Brake) {
+    AddThrottle(_Scenario, 0.5f, _CoastS, 0.0f);
+    AddThrottle(_Scenario, 0.5f, 8.0f, -_Brake);
+    AddThrottle(_Scenario, 0.3f, 2.0f, 0.0f);
+}
+
+bool Vehicle_BuildScenario(VehicleScenario* _Scenario, const char* _Name, const VehicleConfig* _Config,
+                           const InverterConfig* _Profile) {
+    _Scenario->count = 0;
+    float topSpeed = _Config->maxSpeedKmh * HIGHSPEED_FRACTION;
+
+    if (strcmp(_Name, "ride") == 0) {
+        const float cruise[] = { 15.0f, 25.0f, 40.0f };
+        for (int i = 0; i < 3; i++) {
+            AddThrottle(_Scenario, 1.0f + (float)i, 4.0f, 0.4f + 0.3f * (float)i);
+            AddHold(_Scenario, 15.0f, cruise[i] < topSpeed ? cruise[i] : topSpeed, 1.0f, 0.3f);
+            AddStop(_Scenario, 6.0f, 0.3f + 0.2f * (float)i);
+        }
+    } else if (strcmp(_Name, "chatter") == 0) {
+        // Every speed where the profile switches ranges, the first range starts at 0
+        int boundaries = 0;
+        for (int i = 1; i < _Profile->speedRangeCount; i++) {
+            float speed = _Profile->speedRanges[i].minSpeed;
+            if (speed <= 0.0f || speed >= topSpeed) continue;
+            AddSegment(_Scenario, SEGMENT_CHATTER, 15.0f, speed, CHATTER_FLIP_S, 0.5f);
+            boundaries++;
+        }
+        if (boundaries == 0) {
+            AddSegment(_Scenario, SEGMENT_CHATTER, 15.0f, topSpeed * 0.5f, CHATTER_FLIP_S, 0.5f);
+        }
+        AddStop(_Scenario, 3.0f, 0.5f);
+    } else if (strcmp(_Name, "highspeed") == 0) {
+        AddThrottle(_Scenario, 1.0f, 1.0f, 1.0f);
+        AddHold(_Scenario, 120.0f, topSpeed, 0.5f, 1.0f);
+        AddStop(_Scenario, 5.0f, 1.0f);
+    } else if (strcmp(_Name, "stopgo") == 0) {
+        for (int i = 0; i < 12; i++) {
+            AddThrottle(_Scenario, 0.2f, 2.0f + (float)(i % 4), 1.0f);
+            AddThrottle(_Scenario, 0.2f, 0.5f + 0.5f * (float)(i % 3), 0.0f);
+            AddThrottle(_Scenario, 0.2f, 4.0f, -1.0f);
+            AddThrottle(_Scenario, 0.2f, 1.5f, 0.0f);
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* Vehicle_GetScenarioNames(void) {
+    return "ride, chatter, highspeed, stopgo";
+}
+
+bool Vehicle_LoadScenario(VehicleScenario* _Scenario, const char* _Path) {
+    FILE* file = fopen(_Path, "r");
+    if (!file) {
+        fprintf(stderr, "Failed to open throttle profile %s\n", _Path);
+        return false;
+    }
+
+    _Scenario->count = 0;
+    char line[256];
+    int lineNumber = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file)) {
+        lineNumber++;
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+
+        float duration;
+        char kind[16];
+        float speed, band, amount = 0.5f;
+        int fields = sscanf(line, "%f,%15[^,\n\r],%f,%f,%f", &duration, kind, &speed, &band, &amount);
+        if (fields >= 4 && strcmp(kind, "hold") == 0) {
+            ok = AddSegment(_Scenario, SEGMENT_HOLD_SPEED, duration, speed, band, Clamp(amount, 0.0f, 1.0f));
+        } else if (fields >= 4 && strcmp(kind, "chatter") == 0) {
+            ok = band > 0.0f && AddSegment(_Scenario, SEGMENT_CHATTER, duration, speed, band, Clamp(amount, 0.0f, 1.0f));
+        } else if (fields == 2) {
+            char* end;
+            float throttle = strtof(kind, &end);
+            ok = end != kind && AddSegment(_Scenario, SEGMENT_THROTTLE, duration, Clamp(throttle, -1.0f, 1.0f), 0.0f, 0.0f);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            fprintf(stderr, "%s:%d: expected duration,throttle or duration,hold|chatter,speed,band[,amount]\n", _Path, lineNumber);
+        }
+    }
+    fclose(file);
+    return ok && _Scenario->count > 0;
+}
+
+// Throttle the rider gives at _Elapsed seconds into the segment, _Start is the throttle at its start
+static float SegmentThrottle(const VehicleSegment* _Segment, float _Elapsed, float _Start, VehicleState* _State) {
+    if (_Segment->type == SEGMENT_THROTTLE) {
+        return _Start + (_Segment->value - _Start) * Clamp(_Elapsed / _Segment->duration, 0.0f, 1.0f);
+    }
+
+    float speedKmh = _State->speed * 3.6f;
+    if (_Segment->type == SEGMENT_HOLD_SPEED) {
+        if (speedKmh < _Segment->value - _Segment->band) return _Segment->amount;
+        if (speedKmh > _Segment->value + _Segment->band) return -_Segment->amount;
+        return _State->throttle;
+    }
+
+    // Chatter: the rider only reacts every flip time, always towards the target, so the speed
+    // overshoots both ways and keeps crossing it
+    int flip = (int)(_Elapsed / _Segment->band);
+    if (flip == _State->chatterFlip) return _State->throttle;
+    _State->chatterFlip = flip;
+    return speedKmh < _Segment->value ? _Segment->amount : -_Segment->amount;
+}
+
+static void Step(const VehicleConfig* _Config, VehicleState* _State, float _Dt) {
+    float speedKmh = _State->speed * 3.6f;
+
+    float target;
+    if (_State->throttle >= 0.0f) {
+        float taper = Clamp((_Config->maxSpeedKmh - speedKmh) / (_Config->maxSpeedKmh * BACK_EMF_TAPER), 0.0f, 1.0f);
+        target = _State->throttle * _Config->maxCurrent * taper;
+    } else {
+        float fade = Clamp(speedKmh / REGEN_FADE_KMH, 0.0f, 1.0f);
+        target = _State->throttle * _Config->maxRegenCurrent * fade;
+    }
+    float lag = _Config->currentTimeConstant > 0.0f ? Clamp(_Dt / _Config->currentTimeConstant, 0.0f, 1.0f) : 1.0f;
+    _State->current += (target - _State->current) * lag;
+
+    float radius = _Config->wheelDiameterMm / 2000.0f;
+    float drive = _State->current * _Config->torqueConstant * _Config->gearRatio / radius;
+    float drag = 0.5f * AIR_DENSITY * _Config->dragArea * _State->speed * _State->speed;
+    float rolling = _State->speed > 0.0f ? _Config->rollingResistance * _Config->massKg * GRAVITY : 0.0f;
+
+    // Resistance can stop the vehicle but not push it backwards
+    float force = drive - drag - rolling;
+    _State->speed += force / _Config->massKg * _Dt;
+    if (_State->speed < 0.0f) _State->speed = 0.0f;
+}
+
+static TraceSample MakeSample(const VehicleConfig* _Config, VehicleState* _State, double _Time) {
+    TraceSample sample;
+    sample.time = (float)_Time;
+    sample.speedKmh = _State->speed * 3.6f;
+
+    // Electrical rpm as get-rpm reports it: mechanical motor rpm times pole pairs
+    float wheelRpm = sample.speedKmh / wheel_diameter_to_kmh_factor(_Config->wheelDiameterMm);
+    sample.rpm = wheelRpm * _Config->gearRatio * (float)_Config->poles / 2.0f;
+
+    sample.current = _State->current + Random(_State) * _Config->currentNoise;
+    return sample;
+}
+
+bool Vehicle_Simulate(const VehicleConfig* _Config, const VehicleScenario* _Scenario, float _RateHz, uint32_t _Seed,
+                      Trace* _Trace) {
+    if (_RateHz <= 0.0f || _Scenario->count == 0 || _Config->massKg <= 0.0f || _Config->wheelDiameterMm <= 0.0f ||
+        _Config->maxSpeedKmh <= 0.0f || _Config->poles <= 0) {
+        return false;
+    }
+
+    // Whole steps per output sample, so every sample lands exactly on a step at any rate
+    double period = (double)1 / (double)_RateHz;
+    int substeps = (int)ceil(period / (double)VEHICLE_STEP_S);
+    if (substeps < 1) substeps = 1;
+    float dt = (float)(period / (double)substeps);
+
+    VehicleState state = { 0.0f, 0.0f, 0.0f, -1, _Seed ? _Seed : 1 };
+    double time = 0.0;
+    uint64_t output = 0;
+
+    if (!Trace_Append(_Trace, &(TraceSample){ 0.0f, 0.0f, 0.0f, 0.0f })) return false;
+
+    for (int i = 0; i < _Scenario->count; i++) {
+        const VehicleSegment* segment = &_Scenario->segments[i];
+        float start = state.throttle;
+        double segmentStart = time;
+        state.chatterFlip = -1;
+        double end = time + (double)segment->duration;
+
+        while (time < end) {
+            for (int s = 0; s < substeps; s++) {
+                state.throttle = SegmentThrottle(segment, (float)(time - segmentStart), start, &state);
+                Step(_Config, &state, dt);
+                time += (double)dt;
+            }
+            output++;
+            TraceSample sample = MakeSample(_Config, &state, (double)output * period);
+            if (!Trace_Append(_Trace, &sample)) return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,84 @@
+#ifndef VEHICLE_H
+#define VEHICLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ConfigParser.h"
+#include "Trace.h"
+
+// Longitudinal model of an electric vehicle, so the plugin can be benchmarked and tuned on
+// synthetic but plausible load traces instead of recorded rides.
+//
+// The rider is a throttle between -1 and 1: positive drives the motor, negative brakes with regen
+// and 0 coasts. The motor current follows the throttle with a first order lag, tapers to zero
+// towards maxSpeedKmh (back EMF) and regen fades out at walking speed. The resulting wheel force
+// works against rolling resistance and aerodynamic drag. Speed is converted to rpm with
+// wheel_diameter_to_kmh_factor, the gear ratio and the pole count, the same way the VESC reports
+// it, so the traces can be fed to the extensions unchanged.
+
+#define VEHICLE_MAX_SEGMENTS 256
+#define VEHICLE_STEP_S 0.001f   // Integration step, independent of the output rate
+
+typedef struct {
+    int poles;                  // Motor poles, as si-motor-poles, rpm is electrical like get-rpm
+    float wheelDiameterMm;
+    float gearRatio;            // Motor turns per wheel turn, 1 for a hub motor
+    float massKg;               // Vehicle and rider
+    float maxCurrent;           // Motor current at full throttle, A
+    float maxRegenCurrent;      // Motor current at full brake, A, positive
+    float torqueConstant;       // Nm per A at the motor shaft
+    float maxSpeedKmh;          // Speed at which the motor can't push any more current
+    float dragArea;             // Drag coefficient times frontal area, m^2
+    float rollingResistance;    // Rolling resistance coefficient
+    float currentTimeConstant;  // Lag of the current controller behind the throttle, s
+    float currentNoise;         // Peak random ripple added to the reported current, A
+} VehicleConfig;
+
+typedef enum {
+    SEGMENT_THROTTLE,           // Ramp the throttle from its current value to value over the duration
+    SEGMENT_HOLD_SPEED,         // Rider holding value km/h: throttle amount below value - band, brake
+                                // with amount above value + band, unchanged in between
+    SEGMENT_CHATTER             // Rider dithering around value km/h: every band seconds the throttle
+                                // is set to amount below value and to -amount above it
+} SegmentType;
+
+typedef struct {
+    SegmentType type;
+    float duration;             // Seconds
+    float value;                // Throttle, or target speed in km/h
+    float band;                 // Hysteresis in km/h for SEGMENT_HOLD_SPEED, flip time in s for SEGMENT_CHATTER
+    float amount;               // Throttle used by SEGMENT_HOLD_SPEED and SEGMENT_CHATTER, 0 to 1
+} VehicleSegment;
+
+typedef struct {
+    VehicleSegment segments[VEHICLE_MAX_SEGMENTS];
+    int count;
+} VehicleScenario;
+
+// A 10 inch hub motor scooter with a 75 kg rider
+void Vehicle_DefaultConfig(VehicleConfig* _Config);
+
+// Built in scenarios, the speed range boundaries are taken from _Profile:
+//   ride       accelerate, cruise, coast, brake to a stop, a few times at different speeds
+//   chatter    sit on every speed range boundary, switching between drive and regen every 150 ms
+//   highspeed  full throttle up to just below maxSpeedKmh and hold it for two minutes
+//   stopgo     short full throttle bursts and hard regen stops, traffic style
+// Returns false for an unknown name.
+bool Vehicle_BuildScenario(VehicleScenario* _Scenario, const char* _Name, const VehicleConfig* _Config,
+                           const InverterConfig* _Profile);
+const char* Vehicle_GetScenarioNames(void);
+
+// Reads a throttle profile, one segment per line:
+//   duration_s,throttle                           ramp the throttle to the given value
+//   duration_s,hold,speed_kmh,band[,amount]       hold a speed, see SEGMENT_HOLD_SPEED
+//   duration_s,chatter,speed_kmh,flip_s[,amount]  dither around a speed, see SEGMENT_CHATTER
+// Lines starting with # are ignored.
+bool Vehicle_LoadScenario(VehicleScenario* _Scenario, const char* _Path);
+
+// Runs the scenario and appends one sample every 1 / _RateHz seconds to _Trace, which must be
+// initialized. The same seed gives the same current ripple.
+bool Vehicle_Simulate(const VehicleConfig* _Config, const VehicleScenario* _Scenario, float _RateHz, uint32_t _Seed,
+                      Trace* _Trace);
+
+#endif // VEHICLE_H
@@ -0,0 +1,1069 @@
+#include "VescStub.h"
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ThreadSanitizer must only see the synchronization the plugin does itself. The virtual clock
+// funnels every sleep, clock read and stub mutex operation through ClockMutex, which TSan would
+// take as a happens-before edge between almost any two accesses of the plugin, so it never
+// reported a race. The clock's own locking and bookkeeping is hidden from it, and the semaphores
+// and mutexes handed to the plugin are annotated instead, the way the firmware's would order it.
+#if defined(__SANITIZE_THREAD__)
+#include <sanitizer/tsan_interface.h>
+void AnnotateIgnoreSyncBegin(const char* _File, int _Line);
+void AnnotateIgnoreSyncEnd(const char* _File, int _Line);
+void AnnotateIgnoreReadsBegin(const char* _File, int _Line);
+void AnnotateIgnoreReadsEnd(const char* _File, int _Line);
+void AnnotateIgnoreWritesBegin(const char* _File, int _Line);
+void AnnotateIgnoreWritesEnd(const char* _File, int _Line);
+#define TSAN_HIDE_BEGIN() \
+    (AnnotateIgnoreSyncBegin(__FILE__, __LINE__), AnnotateIgnoreReadsBegin(__FILE__, __LINE__), \
+     AnnotateIgnoreWritesBegin(__FILE__, __LINE__))
+#define TSAN_HIDE_END() \
+    (AnnotateIgnoreWritesEnd(__FILE__, __LINE__), AnnotateIgnoreReadsEnd(__FILE__, __LINE__), \
+     AnnotateIgnoreSyncEnd(__FILE__, __LINE__))
+#define TSAN_ACQUIRE(_Addr) __tsan_acquire(_Addr)
+#define TSAN_RELEASE(_Addr) __tsan_release(_Addr)
+#define TSAN_MUTEX_CREATE(_Addr) __tsan_mutex_create(_Addr, 0)
+#define TSAN_MUTEX_PRE_LOCK(_Addr) __tsan_mutex_pre_lock(_Addr, 0)
+#define TSAN_MUTEX_POST_LOCK(_Addr) __tsan_mutex_post_lock(_Addr, 0, 0)
+#define TSAN_MUTEX_PRE_UNLOCK(_Addr) __tsan_mutex_pre_unlock(_Addr, 0)
+#define TSAN_MUTEX_POST_UNLOCK(_Addr) __tsan_mutex_post_unlock(_Addr, 0)
+#else
+#define TSAN_HIDE_BEGIN() ((void)0)
+#define TSAN_HIDE_END() ((void)0)
+#define TSAN_ACQUIRE(_Addr) ((void)(_Addr))
+#define TSAN_RELEASE(_Addr) ((void)(_Addr))
+#define TSAN_MUTEX_CREATE(_Addr) ((void)(_Addr))
+#define TSAN_MUTEX_PRE_LOCK(_Addr) ((void)(_Addr))
+#define TSAN_MUTEX_POST_LOCK(_Addr) ((void)(_Addr))
+#define TSAN_MUTEX_PRE_UNLOCK(_Addr) ((void)(_Addr))
+#define TSAN_MUTEX_POST_UNLOCK(_Addr) ((void)(_Addr))
+#endif
+
+// Provided by the plugin (Main.c) through INIT_FUN
+bool init(lib_info *info);
+
+#define MAX_EXTENSIONS 64
+#define LBM_CELL_COUNT 65536
+#define LBM_FIRST_DYNAMIC_CELL 16
+#define WAIT_FOREVER UINT64_MAX
+
+// Reserved cells for the constant symbols
+#define SYM_NIL 1
+#define SYM_TRUE 2
+#define SYM_TERROR 3
+#define SYM_EERROR 4
+#define SYM_MERROR 5
+
+static vesc_c_if Interface;
+vesc_c_if* VescStub_Interface = &Interface;
+
+static lib_info PluginInfo;
+static void* PluginArg = NULL;
+static bool Quiet = false;
+static VescStubMotorState Motors[VESC_STUB_MOTORS] = {
+    { 0.0f, 0.0f, 0.0f, 48.0f, 0.0f, 14 },
+    { 0.0f, 0.0f, 0.0f, 48.0f, 0.0f, 14 }
+};
+static __thread int SelectedMotor = 1; // Set with mc_select_motor_thread, per thread like in the firmware
+
+static VescStubAudioSink AudioSink = NULL;
+static void* AudioSinkArg = NULL;
+static VescStubAudioStopSink AudioStopSink = NULL;
+static void* AudioStopSinkArg = NULL;
+static VescStubAppDataSink AppDataSink = NULL;
+static void* AppDataSinkArg = NULL;
+static void (*AppDataHandler)(unsigned char* _Data, unsigned int _Length) = NULL;
+static lib_mutex AppDataMutex = NULL; // The firmware calls the handler from one thread only
+static VescStubCanSink CanSink = NULL;
+static void* CanSinkArg = NULL;
+static bool (*CanEidCallback)(uint32_t _Id, uint8_t* _Data, uint8_t _Length) = NULL;
+static lib_mutex CanMutex = NULL; // Frames arrive on one thread in the firmware
+
+
+// -- Virtual clock
+// A thread is "active" while it is running code. Sleeping or blocking removes it from the
+// active count, and when that reaches zero the clock advances to the earliest sleeper.
+
+typedef struct Waiter {
+    uint64_t wakeUs;        // Virtual time to wake up at, WAIT_FOREVER for none
+    bool released;          // Set once the waiter may continue
+    bool signaled;          // Released by a semaphore signal or thread exit rather than timeout
+    struct Waiter* next;    // Next entry in the sleeper list
+    struct Waiter* nextInQueue; // Next entry in a semaphore or join queue
+} Waiter;
+
+typedef struct {
+    pthread_t handle;
+    void (*fun)(void* arg);
+    void* arg;
+    char name[32];
+    bool terminate;         // Set by request_terminate, read by the thread itself
+    bool finished;
+    Waiter* joiners;
+} StubThread;
+
+typedef struct {
+    bool taken;
+    Waiter* waiters;
+} StubSemaphore;
+
+static pthread_mutex_t ClockMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ClockCond = PTHREAD_COND_INITIALIZER;
+static uint64_t NowUs = 0;
+static int ActiveThreads = 0;
+static int BlockedThreads = 0;
+static Waiter* Sleepers = NULL;
+static __thread StubThread* CurrentThread = NULL;
+
+// ClockMutex and everything it guards, hidden from TSan, see the top of the file
+static void Clock_Lock(void) {
+    TSAN_HIDE_BEGIN();
+    pthread_mutex_lock(&ClockMutex);
+}
+
+static void Clock_Unlock(void) {
+    pthread_mutex_unlock(&ClockMutex);
+    TSAN_HIDE_END();
+}
+
+static void Clock_RemoveSleeper(Waiter* _Waiter) {
+    for (Waiter** it = &Sleepers; *it; it = &(*it)->next) {
+        if (*it == _Waiter) {
+            *it = _Waiter->next;
+            return;
+        }
+    }
+}
+
+static void Clock_Release(Waiter* _Waiter, bool _Signaled) {
+    if (_Waiter->released) return;
+    _Waiter->released = true;
+    _Waiter->signaled = _Signaled;
+    Clock_RemoveSleeper(_Waiter);
+    ActiveThreads++;
+    BlockedThreads--;
+    pthread_cond_broadcast(&ClockCond);
+}
+
+static void Clock_AdvanceIfIdle(void) {
+    if (ActiveThreads > 0 || BlockedThreads == 0) return;
+
+    uint64_t next = WAIT_FOREVER;
+    for (Waiter* it = Sleepers; it; it = it->next) {
+        if (it->wakeUs < next) next = it->wakeUs;
+    }
+
+    if (next == WAIT_FOREVER) {
+        fprintf(stderr, "[VescStub] Deadlock: all %d threads are blocked with no timeout at t=%.6f s\n",
+                BlockedThreads, (double)NowUs / (double)1000000);
+        abort();
+    }
+
+    if (next > NowUs) NowUs = next;
+
+    Waiter* it = Sleepers;
+    while (it) {
+        Waiter* next_it = it->next;
+        if (it->wakeUs <= NowUs) Clock_Release(it, false);
+        it = next_it;
+    }
+}
+
+// Blocks the calling thread until the waiter is released. ClockMutex must be held.
+static void Clock_Wait(Waiter* _Waiter) {
+    _Waiter->released = false;
+    _Waiter->signaled = false;
+    if (_Waiter->wakeUs != WAIT_FOREVER) {
+        _Waiter->next = Sleepers;
+        Sleepers = _Waiter;
+    }
+    ActiveThreads--;
+    BlockedThreads++;
+    Clock_AdvanceIfIdle();
+    while (!_Waiter->released) {
+        pthread_cond_wait(&ClockCond, &ClockMutex);
+    }
+}
+
+static void Clock_ThreadExit(void) {
+    ActiveThreads--;
+    Clock_AdvanceIfIdle();
+}
+
+void VescStub_SleepUs(uint64_t _Us) {
+    if (_Us == 0) return;
+    Clock_Lock();
+    Waiter waiter = { 0 };
+    waiter.wakeUs = NowUs + _Us;
+    Clock_Wait(&waiter);
+    Clock_Unlock();
+}
+
+uint64_t VescStub_GetTimeUs(void) {
+    Clock_Lock();
+    uint64_t now = NowUs;
+    Clock_Unlock();
+    return now;
+}
+
+float VescStub_GetTimeSeconds(void) {
+    return (float)((double)VescStub_GetTimeUs() / (double)1000000);
+}
+
+
+// -- OS
+
+static void Stub_SleepMs(uint32_t _Ms) {
+    VescStub_SleepUs((uint64_t)_Ms * 1000u);
+}
+
+static void Stub_SleepUs(uint32_t _Us) {
+    VescStub_SleepUs(_Us);
+}
+
+static void Stub_SleepTicks(systime_t _Ticks) {
+    VescStub_SleepUs((uint64_t)_Ticks * (1000000u / SYSTEM_TICK_RATE_HZ));
+}
+
+static float Stub_SystemTime(void) {
+    return VescStub_GetTimeSeconds();
+}
+
+static systime_t Stub_SystemTimeTicks(void) {
+    return (systime_t)(VescStub_GetTimeUs() / (1000000u / SYSTEM_TICK_RATE_HZ));
+}
+
+static float Stub_TsToAgeS(systime_t _Ts) {
+    systime_t now = Stub_SystemTimeTicks();
+    return (float)(systime_t)(now - _Ts) / (float)SYSTEM_TICK_RATE_HZ;
+}
+
+static uint32_t Stub_TimerTimeNow(void) {
+    return (uint32_t)VescStub_GetTimeUs();
+}
+
+static float Stub_TimerSecondsElapsedSince(uint32_t _Time) {
+    return (float)(uint32_t)(Stub_TimerTimeNow() - _Time) / 1e6f;
+}
+
+static void Stub_TimerSleep(float _Seconds) {
+    VescStub_SleepUs((uint64_t)(_Seconds * 1e6f));
+}
+
+static int Stub_Printf(const char* _Format, ...) {
+    if (Quiet) return 0;
+    va_list args;
+    va_start(args, _Format);
+    int ret = vprintf(_Format, args);
+    va_end(args);
+    return ret;
+}
+
+static void* Stub_Malloc(size_t _Bytes) {
+    return malloc(_Bytes);
+}
+
+static void Stub_Free(void* _Ptr) {
+    free(_Ptr);
+}
+
+static void* Stub_ThreadEntry(void* _Arg) {
+    StubThread* thread = (StubThread*)_Arg;
+    CurrentThread = thread;
+
+    thread->fun(thread->arg);
+
+    Clock_Lock();
+    thread->finished = true;
+    for (Waiter* it = thread->joiners; it; it = it->nextInQueue) {
+        Clock_Release(it, true);
+    }
+    thread->joiners = NULL;
+    Clock_ThreadExit();
+    Clock_Unlock();
+    return NULL;
+}
+
+static lib_thread Stub_Spawn(void (*_Fun)(void* arg), size_t _StackSize, char* _Name, void* _Arg) {
+    (void)_StackSize;
+    StubThread* thread = calloc(1, sizeof(StubThread));
+    if (!thread) return NULL;
+    thread->fun = _Fun;
+    thread->arg = _Arg;
+    snprintf(thread->name, sizeof(thread->name), "%s", _Name ? _Name : "");
+
+    // Count the thread as active before it starts, so the clock can't run ahead of it
+    Clock_Lock();
+    ActiveThreads++;
+    Clock_Unlock();
+
+    if (pthread_create(&thread->handle, NULL, Stub_ThreadEntry, thread) != 0) {
+        Clock_Lock();
+        ActiveThreads--;
+        Clock_Unlock();
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+// Same as ChibiOS: flag the thread for termination and wait for it to exit
+static void Stub_RequestTerminate(lib_thread _Thread) {
+    StubThread* thread = (StubThread*)_Thread;
+    if (!thread) return;
+
+    __atomic_store_n(&thread->terminate, true, __ATOMIC_RELEASE);
+
+    Clock_Lock();
+    if (!thread->finished) {
+        Waiter waiter = { 0 };
+        waiter.wakeUs = WAIT_FOREVER;
+        waiter.nextInQueue = thread->joiners;
+        thread->joiners = &waiter;
+        Clock_Wait(&waiter);
+    }
+    Clock_Unlock();
+
+    pthread_join(thread->handle, NULL);
+    free(thread);
+}
+
+static bool Stub_ShouldTerminate(void) {
+    return CurrentThread && __atomic_load_n(&CurrentThread->terminate, __ATOMIC_ACQUIRE);
+}
+
+static void** Stub_GetArg(uint32_t _ProgAddr) {
+    (void)_ProgAddr;
+    return &PluginArg;
+}
+
+// Binary semaphore, created taken
+static lib_semaphore Stub_SemCreate(void) {
+    StubSemaphore* sem = calloc(1, sizeof(StubSemaphore));
+    if (sem) sem->taken = true;
+    return sem;
+}
+
+static void Sem_RemoveWaiter(StubSemaphore* _Sem, Waiter* _Waiter) {
+    for (Waiter** it = &_Sem->waiters; *it; it = &(*it)->nextInQueue) {
+        if (*it == _Waiter) {
+            *it = _Waiter->nextInQueue;
+            return;
+        }
+    }
+}
+
+static bool Sem_Wait(StubSemaphore* _Sem, uint64_t _TimeoutUs) {
+    Clock_Lock();
+    if (!_Sem->taken) {
+        _Sem->taken = true;
+        Clock_Unlock();
+        return true;
+    }
+    if (_TimeoutUs == 0) {
+        Clock_Unlock();
+        return false;
+    }
+
+    Waiter waiter = { 0 };
+    waiter.wakeUs = _TimeoutUs == WAIT_FOREVER ? WAIT_FOREVER : NowUs + _TimeoutUs;
+
+    // Append so waiters are woken in order
+    Waiter** tail = &_Sem->waiters;
+    while (*tail) tail = &(*tail)->nextInQueue;
+    *tail = &waiter;
+
+    Clock_Wait(&waiter);
+    Sem_RemoveWaiter(_Sem, &waiter);
+    Clock_Unlock();
+    return waiter.signaled;
+}
+
+static void Sem_Signal(StubSemaphore* _Sem) {
+    Clock_Lock();
+    Waiter* first = NULL;
+    for (Waiter* it = _Sem->waiters; it; it = it->nextInQueue) {
+        if (!it->released) {
+            first = it;
+            break;
+        }
+    }
+    if (first) {
+        Clock_Release(first, true);
+    } else {
+        _Sem->taken = false;
+    }
+    Clock_Unlock();
+}
+
+// A signal happens before the wait it ends, as in ChibiOS
+static void Stub_SemWait(lib_semaphore _Sem) {
+    Sem_Wait((StubSemaphore*)_Sem, WAIT_FOREVER);
+    TSAN_ACQUIRE(_Sem);
+}
+
+static bool Stub_SemWaitTo(lib_semaphore _Sem, systime_t _Ticks) {
+    bool taken = Sem_Wait((StubSemaphore*)_Sem, (uint64_t)_Ticks * (1000000u / SYSTEM_TICK_RATE_HZ));
+    if (taken) {
+        TSAN_ACQUIRE(_Sem);
+    }
+    return taken;
+}
+
+static void Stub_SemSignal(lib_semaphore _Sem) {
+    TSAN_RELEASE(_Sem);
+    Sem_Signal((StubSemaphore*)_Sem);
+}
+
+static void Stub_SemReset(lib_semaphore _Sem) {
+    StubSemaphore* sem = (StubSemaphore*)_Sem;
+    Clock_Lock();
+    sem->taken = true;
+    Clock_Unlock();
+}
+
+// Mutexes are binary semaphores created free, so a thread waiting for one counts as blocked for
+// the virtual clock. With a plain pthread mutex the clock would stop while the owner sleeps, and
+// an owner waiting in request_terminate would never see the thread it waits for exit.
+// TSan sees them as the mutexes they are.
+static lib_mutex Stub_MutexCreate(void) {
+    StubSemaphore* mutex = calloc(1, sizeof(StubSemaphore));
+    if (mutex) TSAN_MUTEX_CREATE(mutex);
+    return mutex;
+}
+
+static void Stub_MutexLock(lib_mutex _Mutex) {
+    TSAN_MUTEX_PRE_LOCK(_Mutex);
+    Sem_Wait((StubSemaphore*)_Mutex, WAIT_FOREVER);
+    TSAN_MUTEX_POST_LOCK(_Mutex);
+}
+
+static void Stub_MutexUnlock(lib_mutex _Mutex) {
+    TSAN_MUTEX_PRE_UNLOCK(_Mutex);
+    Sem_Signal((StubSemaphore*)_Mutex);
+    TSAN_MUTEX_POST_UNLOCK(_Mutex);
+}
+
+
+// -- LBM values
+// lbm_value is 32 bits wide, so values are indices into a cell arena rather than pointers.
+// The arena is reused round robin, values only need to live as long as an extension call.
+
+typedef enum {
+    CELL_FREE = 0,
+    CELL_SYMBOL,
+    CELL_INT,
+    CELL_UINT,
+    CELL_FLOAT,
+    CELL_CHAR,
+    CELL_CONS,
+    CELL_ARRAY
+} CellType;
+
+typedef struct {
+    CellType type;
+    union {
+        int32_t i;
+        uint32_t u;
+        float f;
+        struct {
+            lbm_value car;
+            lbm_value cdr;
+        } cons;
+        struct {
+            uint8_t* data;
+            uint32_t size;
+        } array;
+    } v;
+} Cell;
+
+static Cell Cells[LBM_CELL_COUNT];
+static uint32_t NextCell = LBM_FIRST_DYNAMIC_CELL;
+static pthread_mutex_t CellMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static lbm_value Cell_Alloc(CellType _Type, Cell** _Cell) {
+    pthread_mutex_lock(&CellMutex);
+    lbm_value value = NextCell;
+    NextCell++;
+    if (NextCell >= LBM_CELL_COUNT) NextCell = LBM_FIRST_DYNAMIC_CELL;
+    pthread_mutex_unlock(&CellMutex);
+
+    Cell* cell = &Cells[value];
+    if (cell->type == CELL_ARRAY) free(cell->v.array.data);
+    memset(cell, 0, sizeof(Cell));
+    cell->type = _Type;
+    *_Cell = cell;
+    return value;
+}
+
+static Cell* Cell_Get(lbm_value _Value) {
+    if (_Value >= LBM_CELL_COUNT) return NULL;
+    return &Cells[_Value];
+}
+
+static lbm_value Lbm_EncI(lbm_int _X) {
+    Cell* cell;
+    lbm_value value = Cell_Alloc(CELL_INT, &cell);
+    cell->v.i = _X;
+    return value;
+}
+
+static lbm_value Lbm_EncU(lbm_uint _X) {
+    Cell* cell;
+    lbm_value value = Cell_Alloc(CELL_UINT, &cell);
+    cell->v.u = _X;
+    return value;
+}
+
+static lbm_value Lbm_EncChar(uint8_t _X) {
+    Cell* cell;
+    lbm_value value = Cell_Alloc(CELL_CHAR, &cell);
+    cell->v.u = _X;
+    return value;
+}
+
+static lbm_value Lbm_EncFloat(float _F) {
+    Cell* cell;
+    lbm_value value = Cell_Alloc(CELL_FLOAT, &cell);
+    cell->v.f = _F;
+    return value;
+}
+
+static lbm_value Lbm_EncSym(lbm_uint _S) {
+    if (_S >= SYM_NIL && _S <= SYM_MERROR) return _S;
+    Cell* cell;
+    lbm_value value = Cell_Alloc(CELL_SYMBOL, &cell);
+    cell->v.u = _S;
+    return value;
+}
+
+static float Lbm_DecAsFloat(lbm_value _Value) {
+    Cell* cell = Cell_Get(_Value);
+    if (!cell) return 0.0f;
+    switch (cell->type) {
+        case CELL_INT: return (float)cell->v.i;
+        case CELL_UINT: return (float)cell->v.u;
+        case CELL_CHAR: return (float)cell->v.u;
+        case CELL_FLOAT: return cell->v.f;
+        default: return 0.0f;
+    }
+}
+
+static int32_t Lbm_DecAsI32(lbm_value _Value) {
+    Cell* cell = Cell_Get(_Value);
+    if (!cell) return 0;
+    switch (cell->type) {
+        case CELL_INT: return cell->v.i;
+        case CELL_UINT: return (int32_t)cell->v.u;
+        case CELL_CHAR: return (int32_t)cell->v.u;
+        case CELL_FLOAT: return (int32_t)cell->v.f;
+        default: return 0;
+    }
+}
+
+static uint32_t Lbm_DecAsU32(lbm_value _Value) {
+    return (uint32_t)Lbm_DecAsI32(_Value);
+}
+
+static uint8_t Lbm_DecChar(lbm_value _Value) {
+    return (uint8_t)Lbm_DecAsI32(_Value);
+}
+
+static char* Lbm_DecStr(lbm_value _Value) {
+    Cell* cell = Cell_Get(_Value);
+    if (!cell || cell->type != CELL_ARRAY) return NULL;
+    return (char*)cell->v.array.data;
+}
+
+static lbm_uint Lbm_DecSym(lbm_value _Value) {
+    Cell* cell = Cell_Get(_Value);
+    if (!cell || cell->type != CELL_SYMBOL) return 0;
+    return cell->v.u;
+}
+
+static bool Lbm_IsNumber(lbm_value _Value) {
+    Cell* cell = Cell_Get(_Value);
+    if (!cell) return false;
+    return cell->type == CELL_INT || cell->type == CELL_UINT || cell->type == CELL_FLOAT || cell->type == CELL_CHAR;
+}
+
+static bool Lbm_IsByteArray(lbm_value _Value) {
+    Cell* cell = Cell_Get(_Value);
+    return cell && cell->type == CELL_ARRAY;
+}
+
+static bool Lbm_IsCons(lbm_value _Value) {
+    Cell* cell = Cell_Get(_Value);
+    return cell && cell->type == CELL_CONS;
+}
+
+static bool Lbm_IsChar(lbm_value _Value) {
+    Cell* cell = Cell_Get(_Value);
+    return cell && cell->type == CELL_CHAR;
+}
+
+static bool Lbm_IsSymbol(lbm_value _Value) {
+    Cell* cell = Cell_Get(_Value);
+    return cell && cell->type == CELL_SYMBOL;
+}
+
+static bool Lbm_IsSymbolNil(lbm_uint _Value) {
+    return _Value == SYM_NIL;
+}
+
+static bool Lbm_IsSymbolTrue(lbm_uint _Value) {
+    return _Value == SYM_TRUE;
+}
+
+static lbm_value Lbm_Cons(lbm_value _Car, lbm_value _Cdr) {
+    Cell* cell;
+    lbm_value value = Cell_Alloc(CELL_CONS, &cell);
+    cell->v.cons.car = _Car;
+    cell->v.cons.cdr = _Cdr;
+    return value;
+}
+
+static lbm_value Lbm_Car(lbm_value _Value) {
+    Cell* cell = Cell_Get(_Value);
+    if (!cell || cell->type != CELL_CONS) return SYM_NIL;
+    return cell->v.cons.car;
+}
+
+static lbm_value Lbm_Cdr(lbm_value _Value) {
+    Cell* cell = Cell_Get(_Value);
+    if (!cell || cell->type != CELL_CONS) return SYM_NIL;
+    return cell->v.cons.cdr;
+}
+
+static lbm_value Lbm_ListDestructiveReverse(lbm_value _List) {
+    lbm_value prev = SYM_NIL;
+    lbm_value curr = _List;
+    while (Lbm_IsCons(curr)) {
+        Cell* cell = Cell_Get(curr);
+        lbm_value next = cell->v.cons.cdr;
+        cell->v.cons.cdr = prev;
+        prev = curr;
+        curr = next;
+    }
+    return prev;
+}
+
+static bool Lbm_CreateByteArray(lbm_value* _Value, lbm_uint _NumElt) {
+    uint8_t* data = calloc(_NumElt + 1, 1); // Extra byte so that strings are always terminated
+    if (!data) return false;
+    Cell* cell;
+    *_Value = Cell_Alloc(CELL_ARRAY, &cell);
+    cell->v.array.data = data;
+    cell->v.array.size = _NumElt;
+    return true;
+}
+
+lbm_value VescStub_EncodeString(const char* _String) {
+    lbm_value value;
+    size_t length = strlen(_String);
+    if (!Lbm_CreateByteArray(&value, (lbm_uint)length + 1)) return SYM_MERROR;
+    memcpy(Lbm_DecStr(value), _String, length + 1);
+    return value;
+}
+
+int VescStub_ListToFloats(lbm_value _List, float* _Out, int _Max) {
+    int count = 0;
+    while (Lbm_IsCons(_List) && count < _Max) {
+        _Out[count++] = Lbm_DecAsFloat(Lbm_Car(_List));
+        _List = Lbm_Cdr(_List);
+    }
+    return count;
+}
+
+lbm_value VescStub_ListNth(lbm_value _List, int _Index) {
+    for (int i = 0; i < _Index && Lbm_IsCons(_List); i++) {
+        _List = Lbm_Cdr(_List);
+    }
+    return Lbm_IsCons(_List) ? Lbm_Car(_List) : SYM_NIL;
+}
+
+bool VescStub_IsError(lbm_value _Value) {
+    return _Value == SYM_TERROR || _Value == SYM_EERROR || _Value == SYM_MERROR;
+}
+
+
+// -- Extensions
+
+typedef struct {
+    char name[64];
+    extension_fptr fun;
+} Extension;
+
+static Extension Extensions[MAX_EXTENSIONS];
+static int ExtensionCount = 0;
+
+static bool Stub_AddExtension(char* _Name, extension_fptr _Fun) {
+    for (int i = 0; i < ExtensionCount; i++) {
+        if (strcmp(Extensions[i].name, _Name) == 0) {
+            Extensions[i].fun = _Fun;
+            return true;
+        }
+    }
+    if (ExtensionCount >= MAX_EXTENSIONS) return false;
+    snprintf(Extensions[ExtensionCount].name, sizeof(Extensions[ExtensionCount].name), "%s", _Name);
+    Extensions[ExtensionCount].fun = _Fun;
+    ExtensionCount++;
+    return true;
+}
+
+static extension_fptr FindExtension(const char* _Name) {
+    for (int i = 0; i < ExtensionCount; i++) {
+        if (strcmp(Extensions[i].name, _Name) == 0) return Extensions[i].fun;
+    }
+    return NULL;
+}
+
+bool VescStub_HasExtension(const char* _Name) {
+    return FindExtension(_Name) != NULL;
+}
+
+
+// -- Blocked contexts
+// Every thread that calls extensions is its own LBM context. An extension that calls
+// lbm_block_ctx_from_extension only blocks its context once it has returned, the same as in the
+// evaluator, so an unblock that comes in before that fails and has to be retried.
+
+typedef struct BlockedContext {
+    lbm_cid cid;
+    StubSemaphore* sem;
+    lbm_value value;        // Result of the extension call, set by the unblock
+    struct BlockedContext* next;
+} BlockedContext;
+
+static pthread_mutex_t BlockedMutex = PTHREAD_MUTEX_INITIALIZER;
+static BlockedContext* BlockedContexts = NULL;
+static lbm_cid NextCid = 1;
+static __thread lbm_cid CurrentCid = 0;
+static __thread bool BlockRequested = false;
+
+static lbm_cid Stub_GetCurrentCid(void) {
+    if (CurrentCid == 0) {
+        CurrentCid = __atomic_fetch_add(&NextCid, 1, __ATOMIC_RELAXED);
+    }
+    return CurrentCid;
+}
+
+static void Stub_BlockCtxFromExtension(void) {
+    BlockRequested = true;
+}
+
+static bool Stub_UnblockCtxUnboxed(lbm_cid _Cid, lbm_value _Value) {
+    pthread_mutex_lock(&BlockedMutex);
+    BlockedContext* found = NULL;
+    for (BlockedContext** it = &BlockedContexts; *it; it = &(*it)->next) {
+        if ((*it)->cid == _Cid) {
+            found = *it;
+            *it = found->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&BlockedMutex);
+
+    if (!found) return false;
+    found->value = _Value;
+    Stub_SemSignal(found->sem);
+    return true;
+}
+
+lbm_value VescStub_CallExtension(const char* _Name, lbm_value* _Args, lbm_uint _Argn) {
+    extension_fptr fun = FindExtension(_Name);
+    if (!fun) {
+        fprintf(stderr, "[VescStub] Unknown extension %s\n", _Name);
+        return SYM_EERROR;
+    }
+
+    BlockRequested = false;
+    lbm_value result = fun(_Args, _Argn);
+    if (!BlockRequested) return result;
+
+    // Blocked until lbm_unblock_ctx_unboxed, which also provides the result
+    BlockRequested = false;
+    BlockedContext context = { Stub_GetCurrentCid(), Stub_SemCreate(), SYM_NIL, NULL };
+    if (!context.sem) return SYM_MERROR;
+    pthread_mutex_lock(&BlockedMutex);
+    context.next = BlockedContexts;
+    BlockedContexts = &context;
+    pthread_mutex_unlock(&BlockedMutex);
+
+    Stub_SemWait(context.sem);
+    free(context.sem);
+    return context.value;
+}
+
+lbm_value VescStub_CallExtensionFloat(const char* _Name, float _Value) {
+    lbm_value arg = Lbm_EncFloat(_Value);
+    return VescStub_CallExtension(_Name, &arg, 1);
+}
+
+lbm_value VescStub_CallExtensionNoArgs(const char* _Name) {
+    return VescStub_CallExtension(_Name, NULL, 0);
+}
+
+
+// -- Motor control
+
+static const VescStubMotorState* Stub_Motor(void) { return &Motors[SelectedMotor - 1]; }
+
+static float Stub_McGetRpm(void) { return Stub_Motor()->rpm; }
+static float Stub_McGetTotCurrent(void) { return Stub_Motor()->current; }
+static float Stub_McGetDutyCycleNow(void) { return Stub_Motor()->duty; }
+static float Stub_McGetInputVoltageFiltered(void) { return Stub_Motor()->inputVoltage; }
+static float Stub_McGetSpeed(void) { return Stub_Motor()->speed; }
+static float Stub_McGetSamplingFrequencyNow(void) { return 25000.0f; }
+static int Stub_McMotorNow(void) { return SelectedMotor; }
+static int Stub_McGetMotorThread(void) { return SelectedMotor; }
+
+static void Stub_McSelectMotorThread(int _Motor) {
+    if (_Motor >= 1 && _Motor <= VESC_STUB_MOTORS) {
+        SelectedMotor = _Motor;
+    }
+}
+
+static int Stub_GetCfgInt(CFG_PARAM _Param) {
+    if (_Param == CFG_PARAM_si_motor_poles) return Stub_Motor()->poles;
+    return 0;
+}
+
+void VescStub_SetMotorState(const VescStubMotorState* _State) {
+    Motors[0] = *_State;
+}
+
+void VescStub_SetMotorStateOf(int _Motor, const VescStubMotorState* _State) {
+    if (_Motor >= 1 && _Motor <= VESC_STUB_MOTORS) {
+        Motors[_Motor - 1] = *_State;
+    }
+}
+
+int VescStub_GetSelectedMotor(void) {
+    return SelectedMotor;
+}
+
+
+// -- FOC audio
+
+static bool Stub_FocPlayAudioSamples(const int8_t* _Samples, int _NumSamp, float _FSamp, float _Voltage) {
+    if (AudioSink) {
+        AudioSink(_Samples, _NumSamp, _FSamp, _Voltage, AudioSinkArg);
+    }
+    return true;
+}
+
+static void Stub_FocStopAudio(bool _Reset) {
+    if (AudioStopSink) {
+        AudioStopSink(_Reset, AudioStopSinkArg);
+    }
+}
+
+void VescStub_SetAudioSink(VescStubAudioSink _Sink, void* _Arg) {
+    AudioSink = _Sink;
+    AudioSinkArg = _Arg;
+}
+
+void VescStub_SetAudioStopSink(VescStubAudioStopSink _Sink, void* _Arg) {
+    AudioStopSink = _Sink;
+    AudioStopSinkArg = _Arg;
+}
+
+void VescStub_SetQuiet(bool _Quiet) {
+    Quiet = _Quiet;
+}
+
+
+// -- App data
+
+static void Stub_SendAppData(unsigned char* _Data, unsigned int _Length) {
+    if (AppDataSink) {
+        AppDataSink(_Data, _Length, AppDataSinkArg);
+    }
+}
+
+void VescStub_SetAppDataSink(VescStubAppDataSink _Sink, void* _Arg) {
+    AppDataSink = _Sink;
+    AppDataSinkArg = _Arg;
+}
+
+static bool Stub_SetAppDataHandler(void (*_Func)(unsigned char* _Data, unsigned int _Length)) {
+    AppDataHandler = _Func;
+    return true;
+}
+
+bool VescStub_ReceiveAppData(const uint8_t* _Data, unsigned int _Length) {
+    if (!AppDataHandler) {
+        return false;
+    }
+    // The handler gets a copy, like the firmware hands over its receive buffer
+    unsigned char copy[512];
+    if (_Length > sizeof(copy)) {
+        return false;
+    }
+    memcpy(copy, _Data, _Length);
+    Stub_MutexLock(AppDataMutex);
+    AppDataHandler(copy, _Length);
+    Stub_MutexUnlock(AppDataMutex);
+    return true;
+}
+
+
+// -- CAN
+
+static void Stub_CanTransmitEid(uint32_t _Id, const uint8_t* _Data, uint8_t _Length) {
+    if (CanSink) {
+        CanSink(_Id, _Data, _Length, CanSinkArg);
+    }
+}
+
+void VescStub_SetCanSink(VescStubCanSink _Sink, void* _Arg) {
+    CanSink = _Sink;
+    CanSinkArg = _Arg;
+}
+
+// Taken with the frames, so a callback is never called once it was replaced
+static void Stub_CanSetEidCb(bool (*_Func)(uint32_t _Id, uint8_t* _Data, uint8_t _Length)) {
+    Stub_MutexLock(CanMutex);
+    CanEidCallback = _Func;
+    Stub_MutexUnlock(CanMutex);
+}
+
+bool VescStub_ReceiveCan(uint32_t _Id, const uint8_t* _Data, uint8_t _Length) {
+    if (_Length > 8) {
+        return false;
+    }
+    uint8_t copy[8];
+    memcpy(copy, _Data, _Length);
+    Stub_MutexLock(CanMutex);
+    bool handled = CanEidCallback && CanEidCallback(_Id, copy, _Length);
+    Stub_MutexUnlock(CanMutex);
+    return handled;
+}
+
+
+// -- Setup
+
+void VescStub_Init(void) {
+    memset(&Interface, 0, sizeof(Interface));
+    AppDataMutex = Stub_MutexCreate();
+    CanMutex = Stub_MutexCreate();
+
+    for (lbm_uint sym = SYM_NIL; sym <= SYM_MERROR; sym++) {
+        Cells[sym].type = CELL_SYMBOL;
+        Cells[sym].v.u = sym;
+    }
+
+    // LBM
+    Interface.lbm_add_extension = Stub_AddExtension;
+    Interface.lbm_cons = Lbm_Cons;
+    Interface.lbm_car = Lbm_Car;
+    Interface.lbm_cdr = Lbm_Cdr;
+    Interface.lbm_list_destructive_reverse = Lbm_ListDestructiveReverse;
+    Interface.lbm_create_byte_array = Lbm_CreateByteArray;
+    Interface.lbm_enc_i = Lbm_EncI;
+    Interface.lbm_enc_u = Lbm_EncU;
+    Interface.lbm_enc_char = Lbm_EncChar;
+    Interface.lbm_enc_float = Lbm_EncFloat;
+    Interface.lbm_enc_u32 = Lbm_EncU;
+    Interface.lbm_enc_i32 = Lbm_EncI;
+    Interface.lbm_enc_sym = Lbm_EncSym;
+    Interface.lbm_dec_as_float = Lbm_DecAsFloat;
+    Interface.lbm_dec_as_u32 = Lbm_DecAsU32;
+    Interface.lbm_dec_as_i32 = Lbm_DecAsI32;
+    Interface.lbm_dec_char = Lbm_DecChar;
+    Interface.lbm_dec_str = Lbm_DecStr;
+    Interface.lbm_dec_sym = Lbm_DecSym;
+    Interface.lbm_is_byte_array = Lbm_IsByteArray;
+    Interface.lbm_is_cons = Lbm_IsCons;
+    Interface.lbm_is_number = Lbm_IsNumber;
+    Interface.lbm_is_char = Lbm_IsChar;
+    Interface.lbm_is_symbol = Lbm_IsSymbol;
+    Interface.lbm_enc_sym_nil = SYM_NIL;
+    Interface.lbm_enc_sym_true = SYM_TRUE;
+    Interface.lbm_enc_sym_terror = SYM_TERROR;
+    Interface.lbm_enc_sym_eerror = SYM_EERROR;
+    Interface.lbm_enc_sym_merror = SYM_MERROR;
+    Interface.lbm_is_symbol_nil = Lbm_IsSymbolNil;
+    Interface.lbm_is_symbol_true = Lbm_IsSymbolTrue;
+    Interface.lbm_get_current_cid = Stub_GetCurrentCid;
+    Interface.lbm_block_ctx_from_extension = Stub_BlockCtxFromExtension;
+    Interface.lbm_unblock_ctx_unboxed = Stub_UnblockCtxUnboxed;
+
+    // OS
+    Interface.sleep_ms = Stub_SleepMs;
+    Interface.sleep_us = Stub_SleepUs;
+    Interface.system_time = Stub_SystemTime;
+    Interface.ts_to_age_s = Stub_TsToAgeS;
+    Interface.printf = Stub_Printf;
+    Interface.malloc = Stub_Malloc;
+    Interface.free = Stub_Free;
+    Interface.spawn = Stub_Spawn;
+    Interface.request_terminate = Stub_RequestTerminate;
+    Interface.should_terminate = Stub_ShouldTerminate;
+    Interface.get_arg = Stub_GetArg;
+    Interface.mutex_create = Stub_MutexCreate;
+    Interface.mutex_lock = Stub_MutexLock;
+    Interface.mutex_unlock = Stub_MutexUnlock;
+    Interface.timer_time_now = Stub_TimerTimeNow;
+    Interface.timer_seconds_elapsed_since = Stub_TimerSecondsElapsedSince;
+    Interface.timer_sleep = Stub_TimerSleep;
+    Interface.system_time_ticks = Stub_SystemTimeTicks;
+    Interface.sleep_ticks = Stub_SleepTicks;
+    Interface.sem_create = Stub_SemCreate;
+    Interface.sem_wait = Stub_SemWait;
+    Interface.sem_signal = Stub_SemSignal;
+    Interface.sem_wait_to = Stub_SemWaitTo;
+    Interface.sem_reset = Stub_SemReset;
+
+    // Motor control
+    Interface.mc_motor_now = Stub_McMotorNow;
+    Interface.mc_select_motor_thread = Stub_McSelectMotorThread;
+    Interface.mc_get_motor_thread = Stub_McGetMotorThread;
+    Interface.mc_get_rpm = Stub_McGetRpm;
+    Interface.mc_get_tot_current = Stub_McGetTotCurrent;
+    Interface.mc_get_tot_current_filtered = Stub_McGetTotCurrent;
+    Interface.mc_get_duty_cycle_now = Stub_McGetDutyCycleNow;
+    Interface.mc_get_input_voltage_filtered = Stub_McGetInputVoltageFiltered;
+    Interface.mc_get_speed = Stub_McGetSpeed;
+    Interface.mc_get_sampling_frequency_now = Stub_McGetSamplingFrequencyNow;
+    Interface.get_cfg_int = Stub_GetCfgInt;
+
+    // FOC audio
+    Interface.foc_play_audio_samples = Stub_FocPlayAudioSamples;
+    Interface.foc_stop_audio = Stub_FocStopAudio;
+
+    // App data
+    Interface.send_app_data = Stub_SendAppData;
+    Interface.set_app_data_handler = Stub_SetAppDataHandler;
+
+    // CAN
+    Interface.can_transmit_eid = Stub_CanTransmitEid;
+    Interface.can_set_eid_cb = Stub_CanSetEidCb;
+
+    // The calling thread drives the plugin, so it takes part in the virtual clock
+    Clock_Lock();
+    NowUs = 0;
+    ActiveThreads = 1;
+    BlockedThreads = 0;
+    Sleepers = NULL;
+    Clock_Unlock();
+}
+
+bool VescStub_LoadPlugin(void) {
+    memset(&PluginInfo, 0, sizeof(PluginInfo));
+    bool ok = init(&PluginInfo);
+    PluginArg = PluginInfo.arg;
+    return ok;
+}
+
+void VescStub_UnloadPlugin(void) {
+    if (PluginInfo.stop_fun) {
+        PluginInfo.stop_fun(PluginInfo.arg);
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef VESC_STUB_H
+#define VESC_STUB_H
+
+#include "vesc_c_if.h"
+
+// Host (x86-64 Linux) implementation of the VESC_IF function table, used to run the
+// plugin on a workstation. Threads are real pthreads, but all time is virtual: the clock
+// only moves forward once every thread is sleeping or blocked, and then jumps straight to
+// the earliest wake up. A simulated second therefore takes only as long as the code that
+// runs in it, which makes the host build usable for benchmarks and long renders.
+
+#define VESC_STUB_MOTORS 2 // Like a dual motor controller, see mc_select_motor_thread
+
+// Motor values returned by the mc_* and get_cfg_* functions, for the motor the calling thread selected
+typedef struct {
+    float rpm;             // Electrical rpm, as returned by mc_get_rpm
+    float current;         // Motor current in A
+    float duty;            // Duty cycle, -1.0 to 1.0
+    float inputVoltage;    // Input voltage in V
+    float speed;           // Speed in m/s
+    int poles;             // Motor poles
+} VescStubMotorState;
+
+// Called for every foc_play_audio_samples call, from the thread that made it
+typedef void (*VescStubAudioSink)(const int8_t* samples, int numSamples, float sampleRate, float voltage, void* arg);
+
+// Called for every foc_stop_audio call, from the thread that made it
+typedef void (*VescStubAudioStopSink)(bool reset, void* arg);
+
+// Called for every send_app_data call, from the thread that made it
+typedef void (*VescStubAppDataSink)(const uint8_t* data, unsigned int length, void* arg);
+
+// Called for every can_transmit_eid call, from the thread that made it
+typedef void (*VescStubCanSink)(uint32_t id, const uint8_t* data, uint8_t length, void* arg);
+
+// Sets up VESC_IF and registers the calling thread with the virtual clock. Call this first.
+void VescStub_Init(void);
+
+// Calls the plugin's init function / stop function, the same way load-native-lib does
+bool VescStub_LoadPlugin(void);
+void VescStub_UnloadPlugin(void);
+
+// Virtual time since VescStub_Init
+uint64_t VescStub_GetTimeUs(void);
+float VescStub_GetTimeSeconds(void);
+
+// Sleep the calling thread in virtual time, same as VESC_IF->sleep_us
+void VescStub_SleepUs(uint64_t _Us);
+
+// Call an extension registered with lbm_add_extension. Returns the eerror symbol if it does not exist.
+// Each calling thread is an LBM context of its own. When the extension blocks the context, the call
+// returns once it is unblocked, with the value passed to lbm_unblock_ctx_unboxed.
+lbm_value VescStub_CallExtension(const char* _Name, lbm_value* _Args, lbm_uint _Argn);
+lbm_value VescStub_CallExtensionFloat(const char* _Name, float _Value);
+lbm_value VescStub_CallExtensionNoArgs(const char* _Name);
+bool VescStub_HasExtension(const char* _Name);
+
+// LBM value helpers that are not part of VESC_IF
+lbm_value VescStub_EncodeString(const char* _String);
+bool VescStub_IsError(lbm_value _Value);
+int VescStub_ListToFloats(lbm_value _List, float* _Out, int _Max); // Returns the number of elements read
+lbm_value VescStub_ListNth(lbm_value _List, int _Index); // nil if the list is shorter
+
+// Audio output sink, NULL to drop the samples
+void VescStub_SetAudioSink(VescStubAudioSink _Sink, void* _Arg);
+void VescStub_SetAudioStopSink(VescStubAudioStopSink _Sink, void* _Arg);
+
+// App data sink (what VESC Tool would receive), NULL to drop the data
+void VescStub_SetAppDataSink(VescStubAppDataSink _Sink, void* _Arg);
+
+// Passes data to the handler set with set_app_data_handler, as if VESC Tool had sent it. The
+// handler runs on the calling thread, one call at a time like in the firmware. Returns false when no handler is set or the data is
+// longer than a firmware packet.
+bool VescStub_ReceiveAppData(const uint8_t* _Data, unsigned int _Length);
+
+// CAN sink (what the other VESCs on the bus would receive), NULL to drop the frames
+void VescStub_SetCanSink(VescStubCanSink _Sink, void* _Arg);
+
+// Passes an extended frame to the callback set with can_set_eid_cb, as if it came from the bus. The
+// callback runs on the calling thread, one frame at a time like in the firmware. Returns what the
+// callback returns, false when none is set or the frame is longer than 8 bytes.
+bool VescStub_ReceiveCan(uint32_t _Id, const uint8_t* _Data, uint8_t _Length);
+
+// Motor values of motor 1, or of the given motor (1 or 2)
+void VescStub_SetMotorState(const VescStubMotorState* _State);
+void VescStub_SetMotorStateOf(int _Motor, const VescStubMotorState* _State);
+
+// Motor the calling thread selected with mc_select_motor_thread, 1 when it didn't. Tells an audio
+// sink which motor the samples are for.
+int VescStub_GetSelectedMotor(void);
+
+// Suppress the plugin's VESC_IF->printf output
+void VescStub_SetQuiet(bool _Quiet);
+
+#endif // VESC_STUB_H
@@ -0,0 +1,175 @@
+#include "Wav.h"
+
+#include <string.h>
+
+static void WriteU32(FILE* _File, uint32_t _Value) {
+    uint8_t bytes[4] = { (uint8_t)_Value, (uint8_t)(_Value >> 8), (uint8_t)(_Value >> 16), (uint8_t)(_Value >> 24) };
+    fwrite(bytes, 1, 4, _File);
+}
+
+static void WriteU16(FILE* _File, uint16_t _Value) {
+    uint8_t bytes[2] = { (uint8_t)_Value, (uint8_t)(_Value >> 8) };
+    fwrite(bytes, 1, 2, _File);
+}
+
+static void WriteHeader(WavWriter* _Wav) {
+    uint16_t bytesPerSample = _Wav->bitsPerSample / 8;
+    uint32_t dataSize = _Wav->samplesWritten * bytesPerSample;
+
+    fwrite("RIFF", 1, 4, _Wav->file);
+    WriteU32(_Wav->file, 36 + dataSize);
+    fwrite("WAVE", 1, 4, _Wav->file);
+    fwrite("fmt ", 1, 4, _Wav->file);
+    WriteU32(_Wav->file, 16);
+    WriteU16(_Wav->file, 1); // PCM
+    WriteU16(_Wav->file, 1); // Mono
+    WriteU32(_Wav->file, _Wav->sampleRate);
+    WriteU32(_Wav->file, _Wav->sampleRate * bytesPerSample);
+    WriteU16(_Wav->file, bytesPerSample);
+    WriteU16(_Wav->file, _Wav->bitsPerSample);
+    fwrite("data", 1, 4, _Wav->file);
+    WriteU32(_Wav->file, dataSize);
+}
+
+bool Wav_Open(WavWriter* _Wav, const char* _Path, uint32_t _SampleRate, uint16_t _BitsPerSample) {
+    memset(_Wav, 0, sizeof(WavWriter));
+    if (_BitsPerSample != 8 && _BitsPerSample != 16) return false;
+    _Wav->file = fopen(_Path, "wb");
+    if (!_Wav->file) return false;
+    _Wav->sampleRate = _SampleRate;
+    _Wav->bitsPerSample = _BitsPerSample;
+    WriteHeader(_Wav);
+    return true;
+}
+
+void Wav_WriteInt8(WavWriter* _Wav, const int8_t* _Samples, int _Count) {
+    for (int i = 0; i < _Count; i++) {
+        if (_Wav->bitsPerSample == 8) {
+            fputc((uint8_t)(_Samples[i] + 128), _Wav->file);
+        } else {
+            WriteU16(_Wav->file, (uint16_t)(int16_t)(_Samples[i] * 256));
+        }
+    }
+    _Wav->samplesWritten += (uint32_t)_Count;
+}
+
+void Wav_WriteInt16(WavWriter* _Wav, const int16_t* _Samples, int _Count) {
+    for (int i = 0; i < _Count; i++) {
+        if (_Wav->bitsPerSample == 8) {
+            fputc((uint8_t)((_Samples[i] >> 8) + 128), _Wav->file);
+        } else {
+            WriteU16(_Wav->file, (uint16_t)_Samples[i]);
+        }
+    }
+    _Wav->samplesWritten += (uint32_t)_Count;
+}
+
+void Wav_WriteSilence(WavWriter* _Wav, int _Count) {
+    for (int i = 0; i < _Count; i++) {
+        if (_Wav->bitsPerSample == 8) {
+            fputc(128, _Wav->file);
+        } else {
+            WriteU16(_Wav->file, 0);
+        }
+    }
+    _Wav->samplesWritten += (uint32_t)_Count;
+}
+
+void Wav_Close(WavWriter* _Wav) {
+    if (!_Wav->file) return;
+    fseek(_Wav->file, 0, SEEK_SET);
+    WriteHeader(_Wav);
+    fclose(_Wav->file);
+    _Wav->file = NULL;
+}
+
+static uint32_t ReadU32(const uint8_t* _Bytes) {
+    return (uint32_t)_Bytes[0] | ((uint32_t)_Bytes[1] << 8) | ((uint32_t)_Bytes[2] << 16) | ((uint32_t)_Bytes[3] << 24);
+}
+
+static uint16_t ReadU16(const uint8_t* _Bytes) {
+    return (uint16_t)(_Bytes[0] | (_Bytes[1] << 8));
+}
+
+// Opens a mono PCM file and leaves it positioned at the start of the sample data
+static FILE* OpenData(const char* _Path, uint16_t* _BitsPerSample, uint32_t* _SampleRate, uint32_t* _DataSize) {
+    FILE* file = fopen(_Path, "rb");
+    if (!file) return NULL;
+
+    uint8_t riff[12];
+    if (fread(riff, 1, 12, file) != 12 || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        fclose(file);
+        return NULL;
+    }
+
+    // Walk the chunks, fmt has to come before data
+    bool formatOk = false;
+    uint8_t chunk[8];
+    while (fread(chunk, 1, 8, file) == 8) {
+        uint32_t size = ReadU32(chunk + 4);
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            uint8_t format[16];
+            if (size < 16 || fread(format, 1, 16, file) != 16) break;
+            *_BitsPerSample = ReadU16(format + 14);
+            *_SampleRate = ReadU32(format + 4);
+            formatOk = ReadU16(format) == 1 && ReadU16(format + 2) == 1 && (*_BitsPerSample == 8 || *_BitsPerSample == 16);
+            fseek(file, (long)(size - 16 + (size & 1)), SEEK_CUR);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!formatOk) break;
+            *_DataSize = size;
+            return file;
+        } else {
+            fseek(file, (long)(size + (size & 1)), SEEK_CUR);
+        }
+    }
+
+    fclose(file);
+    return NULL;
+}
+
+int Wav_ReadInt8(const char* _Path, int8_t* _Samples, int _Max, uint32_t* _SampleRate) {
+    uint16_t bitsPerSample = 0;
+    uint32_t sampleRate = 0;
+    uint32_t size = 0;
+    FILE* file = OpenData(_Path, &bitsPerSample, &sampleRate, &size);
+    if (!file) return -1;
+    if (bitsPerSample != 8) {
+        fclose(file);
+        return -1;
+    }
+
+    int count = 0;
+    int c;
+    while (count < _Max && (uint32_t)count < size && (c = fgetc(file)) != EOF) {
+        _Samples[count++] = (int8_t)(c - 128);
+    }
+
+    if (_SampleRate) *_SampleRate = sampleRate;
+    fclose(file);
+    return count;
+}
+
+int Wav_ReadFloat(const char* _Path, float* _Samples, int _Max, uint32_t* _SampleRate) {
+    uint16_t bitsPerSample = 0;
+    uint32_t sampleRate = 0;
+    uint32_t size = 0;
+    FILE* file = OpenData(_Path, &bitsPerSample, &sampleRate, &size);
+    if (!file) return -1;
+
+    int bytesPerSample = bitsPerSample / 8;
+    int available = (int)(size / (uint32_t)bytesPerSample);
+    int count = 0;
+    uint8_t bytes[2];
+    while (count < _Max && count < available && fread(bytes, 1, (size_t)bytesPerSample, file) == (size_t)bytesPerSample) {
+        if (bitsPerSample == 8) {
+            _Samples[count++] = (float)((int)bytes[0] - 128) / 128.0f;
+        } else {
+            _Samples[count++] = (float)(int16_t)ReadU16(bytes) / 32768.0f;
+        }
+    }
+
+    if (_SampleRate) *_SampleRate = sampleRate;
+    fclose(file);
+    return count;
+}
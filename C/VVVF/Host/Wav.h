@@ -0,0 +1,31 @@
+#ifndef WAV_H
+#define WAV_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Minimal streaming mono PCM WAV writer. The sizes in the header are patched on close,
+// so files of any length can be written without buffering them in memory.
+
+typedef struct {
+    FILE* file;
+    uint32_t sampleRate;
+    uint16_t bitsPerSample; // 8 (unsigned, as the WAV format requires) or 16
+    uint32_t samplesWritten;
+} WavWriter;
+
+bool Wav_Open(WavWriter* _Wav, const char* _Path, uint32_t _SampleRate, uint16_t _BitsPerSample);
+void Wav_WriteInt8(WavWriter* _Wav, const int8_t* _Samples, int _Count);
+void Wav_WriteInt16(WavWriter* _Wav, const int16_t* _Samples, int _Count);
+void Wav_WriteSilence(WavWriter* _Wav, int _Count);
+void Wav_Close(WavWriter* _Wav);
+
+// Reads up to _Max samples of a mono 8 bit PCM file back as signed samples. Returns the
+// number of samples read, or -1 if the file can't be opened or is in any other format.
+int Wav_ReadInt8(const char* _Path, int8_t* _Samples, int _Max, uint32_t* _SampleRate);
+
+// Same for 8 or 16 bit files, normalized to -1.0 to 1.0
+int Wav_ReadFloat(const char* _Path, float* _Samples, int _Max, uint32_t* _SampleRate);
+
+#endif // WAV_H
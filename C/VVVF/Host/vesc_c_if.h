@@ -0,0 +1,27 @@
+// Host build shim for vesc_c_if.h
+//
+// The Host directory comes first in the include path of the host build, so every
+// #include "vesc_c_if.h" lands here. We pull in the real interface (by relative path, so
+// this works no matter how the header was found) and then point VESC_IF at the stub
+// implementation in VescStub.c instead of the fixed firmware address.
+
+#ifndef VESC_HOST_C_IF_H
+#define VESC_HOST_C_IF_H
+
+#include "../../vesc_c_if.h"
+
+#undef VESC_IF
+#undef HEADER
+#undef INIT_FUN
+#undef INIT_START
+#undef PROG_ADDR
+
+extern vesc_c_if* VescStub_Interface;
+
+#define VESC_IF     VescStub_Interface
+#define HEADER      static volatile int prog_ptr;
+#define INIT_FUN    bool init
+#define INIT_START  (void)prog_ptr;
+#define PROG_ADDR   ((uint32_t)(uintptr_t)&prog_ptr)
+
+#endif // VESC_HOST_C_IF_H
@@ -0,0 +1,260 @@
+#include "Benchmark.h"
+#include "SPWMGenerator.h"
+#include "PulsePattern.h"
+#include "Parameters.h"
+
+#ifdef VESC_HOST_BUILD
+#include <time.h>
+#else
+// Only the core peripherals (DWT, CoreDebug) are used, they are the same on every F4
+#define STM32F405xx
+#include "stm32f4xx.h"
+#endif
+
+#define BENCHMARK_POLES 14          // Only affects the sync carrier, which is derived from it
+#define BENCHMARK_SYNC_PULSES 7
+#define BENCHMARK_MIN_SPEED_KMH 0.0f
+#define BENCHMARK_MAX_SPEED_KMH 100.0f
+#define BENCHMARK_SPEED_KMH 50.0f   // Halfway through the range, so ramps sit at their midpoint
+
+// Carrier frequencies every case is run at
+static const int CarrierSweep[] = { 250, 500, 1000, 2000, 4000, 8000 };
+#define CARRIER_SWEEP_COUNT (int)(sizeof(CarrierSweep) / sizeof(CarrierSweep[0]))
+
+#define SPWM_TYPE_COUNT (SPWM_TYPE_SYNC + 1)
+
+static int8_t bench_buffer[BUFFER_LENGTH];
+
+// -- Tick counter
+#ifdef VESC_HOST_BUILD
+
+#define TICKS_PER_SECOND 1000000000.0f
+
+static void StartCounter(void) {
+}
+
+// Wraps every ~4 s, which is fine since only differences of single runs are used
+static uint32_t ReadCounter(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+
+#else
+
+#define TICKS_PER_SECOND ((float)BENCHMARK_CPU_HZ)
+
+static void StartCounter(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static uint32_t ReadCounter(void) {
+    return DWT->CYCCNT;
+}
+
+#endif
+
+// -- Cases
+static SpeedRange MakeSpeedRange(SPWMType _Type, int _CarrierHz) {
+    SPWMConfig config = AddSPWM_Disabled();
+    switch (_Type) {
+        case SPWM_TYPE_NONE:
+            break;
+        case SPWM_TYPE_FIXED_ASYNC:
+            config = AddSPWM_AsyncFixed(_CarrierHz);
+            break;
+        case SPWM_TYPE_RAMP_ASYNC:
+            // Ends on the swept carrier at the top of the range
+            config = AddSPWM_AsyncRamp(_CarrierHz / 2, _CarrierHz + _CarrierHz / 2);
+            break;
+        case SPWM_TYPE_RSPWM:
+            config = AddSPWM_RSPWM(_CarrierHz - _CarrierHz / 4, _CarrierHz + _CarrierHz / 4);
+            break;
+        case SPWM_TYPE_SYNC:
+            config = AddSPWM_Sync(BENCHMARK_SYNC_PULSES);
+            break;
+    }
+
+    SpeedRange range;
+    range.minSpeed = BENCHMARK_MIN_SPEED_KMH;
+    range.maxSpeed = BENCHMARK_MAX_SPEED_KMH;
+    range.spwm.acceleration = config;
+    range.spwm.coasting = config;
+    range.spwm.deceleration = config;
+    return range;
+}
+
+typedef struct {
+    SPWMGenerator generator;
+    SpeedRange range;
+    float commandHz;          // As passed to SPWMGenerator_GenerateSamples, electrical rpm
+} SPWMCase;
+
+static void SetupSPWMCase(SPWMType _Type, int _CarrierHz, SPWMCase* _Case) {
+    _Case->range = MakeSpeedRange(_Type, _CarrierHz);
+
+    // Command frequency that puts the sync carrier on the swept frequency
+    _Case->commandHz = (float)_CarrierHz * BENCHMARK_POLES / BENCHMARK_SYNC_PULSES;
+
+    SPWMGenerator_Init(&_Case->generator);
+    SPWMGenerator_SeedRandom(&_Case->generator, RSPWM_DEFAULT_SEED);
+    _Case->generator.CommandFrequency = _Case->commandHz / BENCHMARK_POLES;
+}
+
+// _Stride is how far _Out moves per buffer, 0 to keep overwriting the same buffer
+static void GenerateSPWM(SPWMCase* _Case, int8_t* _Out, int _Buffers, int _Stride) {
+    for (int i = 0; i < _Buffers; i++) {
+        SPWMGenerator_GenerateSamples(&_Case->generator, ROTOR_STATE_ACCELERATING, _Out + i * _Stride, BUFFER_LENGTH,
+                                      &_Case->range, _Case->commandHz, BENCHMARK_POLES, BENCHMARK_SPEED_KMH);
+    }
+}
+
+// Same phase handling as the SPWMGenerator_GenerateSamples inner loop, with the pattern swapped out
+static void GeneratePatternLoop(int8_t (*_Pattern)(float, float), int _CarrierHz, int8_t* _Out, int _Buffers, int _Stride) {
+    float phase = 0.0f;
+    float step = SPWMGenerator_PhaseStep((float)_CarrierHz);
+
+    for (int i = 0; i < _Buffers; i++) {
+        int8_t* buffer = _Out + i * _Stride;
+        for (int j = 0; j < BUFFER_LENGTH; j++) {
+            phase = SPWMGenerator_WrapPhase(phase + step);
+            buffer[j] = _Pattern(phase, 0.02f);
+        }
+    }
+}
+
+static void GeneratePattern(PulsePatternType _Pattern, int _CarrierHz, int8_t* _Out, int _Buffers, int _Stride) {
+    switch (_Pattern) {
+        case PULSE_PATTERN_PULSE:
+            GeneratePatternLoop(GeneratePulse, _CarrierHz, _Out, _Buffers, _Stride);
+            break;
+        case PULSE_PATTERN_SAWTOOTH:
+            GeneratePatternLoop(GenerateSawtooth, _CarrierHz, _Out, _Buffers, _Stride);
+            break;
+        case PULSE_PATTERN_SQUARE:
+            GeneratePatternLoop(GenerateSquare, _CarrierHz, _Out, _Buffers, _Stride);
+            break;
+        case PULSE_PATTERN_TRIANGLE:
+        default:
+            GeneratePatternLoop(GenerateTriangle, _CarrierHz, _Out, _Buffers, _Stride);
+            break;
+    }
+}
+
+static uint32_t TimeSPWM(SPWMType _Type, int _CarrierHz) {
+    SPWMCase spwmCase;
+    SetupSPWMCase(_Type, _CarrierHz, &spwmCase);
+
+    uint32_t start = ReadCounter();
+    GenerateSPWM(&spwmCase, bench_buffer, BENCHMARK_BUFFERS, 0);
+    return ReadCounter() - start;
+}
+
+static uint32_t TimePattern(PulsePatternType _Pattern, int _CarrierHz) {
+    uint32_t start = ReadCounter();
+    GeneratePattern(_Pattern, _CarrierHz, bench_buffer, BENCHMARK_BUFFERS, 0);
+    return ReadCounter() - start;
+}
+
+static BenchmarkResult RunCase(BenchmarkKernel _Kernel, int _Variant, int _CarrierHz) {
+    uint32_t best = UINT32_MAX;
+    for (int i = 0; i < BENCHMARK_REPEATS; i++) {
+        uint32_t ticks = _Kernel == BENCHMARK_KERNEL_SPWM ?
+                         TimeSPWM((SPWMType)_Variant, _CarrierHz) :
+                         TimePattern((PulsePatternType)_Variant, _CarrierHz);
+        if (ticks < best) best = ticks;
+    }
+
+    float budgetTicks = TICKS_PER_SECOND * (float)BUFFER_LENGTH / (float)SAMPLE_RATE;
+
+    BenchmarkResult result;
+    result.kernel = _Kernel;
+    result.variant = _Variant;
+    result.carrierHz = _CarrierHz;
+    result.ticksPerBuffer = best / BENCHMARK_BUFFERS;
+    result.ticksPerSample = (float)best / (float)(BENCHMARK_BUFFERS * BUFFER_LENGTH);
+    result.budgetPercent = (float)result.ticksPerBuffer / budgetTicks * 100.0f;
+    return result;
+}
+
+int Benchmark_GetCaseCount(void) {
+    return (SPWM_TYPE_COUNT + PULSE_PATTERN_COUNT) * CARRIER_SWEEP_COUNT;
+}
+
+bool Benchmark_GetCase(int _Index, BenchmarkKernel* _Kernel, int* _Variant, int* _CarrierHz) {
+    if (_Index < 0 || _Index >= Benchmark_GetCaseCount()) return false;
+
+    // All SPWM types first, then all pulse patterns, each over the whole carrier sweep
+    int variant = _Index / CARRIER_SWEEP_COUNT;
+    *_CarrierHz = CarrierSweep[_Index % CARRIER_SWEEP_COUNT];
+    if (variant < SPWM_TYPE_COUNT) {
+        *_Kernel = BENCHMARK_KERNEL_SPWM;
+        *_Variant = variant;
+    } else {
+        *_Kernel = BENCHMARK_KERNEL_PATTERN;
+        *_Variant = variant - SPWM_TYPE_COUNT;
+    }
+    return true;
+}
+
+int Benchmark_Run(BenchmarkResult* _Results, int _Max) {
+    if (!_Results) return 0;
+
+    StartCounter();
+
+    int count = 0;
+    BenchmarkKernel kernel;
+    int variant;
+    int carrierHz;
+    while (count < _Max && Benchmark_GetCase(count, &kernel, &variant, &carrierHz)) {
+        _Results[count] = RunCase(kernel, variant, carrierHz);
+        count++;
+    }
+    return count;
+}
+
+float Benchmark_Render(BenchmarkKernel _Kernel, int _Variant, int _CarrierHz, int8_t* _Out, int _Buffers) {
+    if (_Kernel == BENCHMARK_KERNEL_PATTERN) {
+        GeneratePattern((PulsePatternType)_Variant, _CarrierHz, _Out, _Buffers, BUFFER_LENGTH);
+        return 0.0f;
+    }
+
+    SPWMCase spwmCase;
+    SetupSPWMCase((SPWMType)_Variant, _CarrierHz, &spwmCase);
+    GenerateSPWM(&spwmCase, _Out, _Buffers, BUFFER_LENGTH);
+    return spwmCase.generator.CommandFrequency;
+}
+
+const char* Benchmark_GetTickUnit(void) {
+#ifdef VESC_HOST_BUILD
+    return "ns";
+#else
+    return "cycles";
+#endif
+}
+
+const char* Benchmark_GetKernelName(BenchmarkKernel _Kernel) {
+    return _Kernel == BENCHMARK_KERNEL_SPWM ? "spwm" : "pattern";
+}
+
+const char* Benchmark_GetVariantName(BenchmarkKernel _Kernel, int _Variant) {
+    if (_Kernel == BENCHMARK_KERNEL_SPWM) {
+        switch ((SPWMType)_Variant) {
+            case SPWM_TYPE_NONE: return "none";
+            case SPWM_TYPE_FIXED_ASYNC: return "async-fixed";
+            case SPWM_TYPE_RAMP_ASYNC: return "async-ramp";
+            case SPWM_TYPE_RSPWM: return "rspwm";
+            case SPWM_TYPE_SYNC: return "sync";
+        }
+    } else {
+        switch ((PulsePatternType)_Variant) {
+            case PULSE_PATTERN_PULSE: return "pulse";
+            case PULSE_PATTERN_SAWTOOTH: return "sawtooth";
+            case PULSE_PATTERN_SQUARE: return "square";
+            case PULSE_PATTERN_TRIANGLE: return "triangle";
+            case PULSE_PATTERN_COUNT: break;
+        }
+    }
+    return "unknown";
+}
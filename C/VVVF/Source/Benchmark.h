@@ -0,0 +1,63 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ConfigParser.h"
+
+// Microbenchmarks for the sample generation kernels. Every SPWM type and every pulse
+// pattern is timed over a sweep of carrier frequencies, so that we can see how much of the
+// buffer budget (BUFFER_LENGTH / SAMPLE_RATE, 6 ms by default) each of them takes.
+//
+// On target the timings are DWT cycle counts, on the host build they are nanoseconds from
+// the monotonic clock. Results are always returned in the same order so tables can be
+// compared between commits.
+
+#define BENCHMARK_BUFFERS 20      // Buffers generated per timed run
+#define BENCHMARK_REPEATS 3       // Timed runs per case, the fastest one is reported
+#define BENCHMARK_CPU_HZ 168000000 // STM32F4 core clock, used to convert cycles to budget
+
+typedef enum {
+    BENCHMARK_KERNEL_SPWM,       // SPWMGenerator_GenerateSamples with a given SPWMType
+    BENCHMARK_KERNEL_PATTERN     // The generator's inner loop with a given pulse pattern
+} BenchmarkKernel;
+
+typedef enum {
+    PULSE_PATTERN_PULSE,
+    PULSE_PATTERN_SAWTOOTH,
+    PULSE_PATTERN_SQUARE,
+    PULSE_PATTERN_TRIANGLE,
+    PULSE_PATTERN_COUNT
+} PulsePatternType;
+
+typedef struct {
+    BenchmarkKernel kernel;
+    int variant;              // SPWMType for BENCHMARK_KERNEL_SPWM, PulsePatternType for BENCHMARK_KERNEL_PATTERN
+    int carrierHz;            // Carrier frequency the case was run at
+    uint32_t ticksPerBuffer;  // Fastest run divided by BENCHMARK_BUFFERS
+    float ticksPerSample;
+    float budgetPercent;      // Share of the time one buffer lasts at SAMPLE_RATE
+} BenchmarkResult;
+
+// Runs every case and fills in up to _Max results. Returns the number of results written.
+// Blocks for the whole run, so do not call this while the audio loop is running.
+int Benchmark_Run(BenchmarkResult* _Results, int _Max);
+
+// Kernel, variant and carrier of the case Benchmark_Run puts at _Index. False if out of range.
+bool Benchmark_GetCase(int _Index, BenchmarkKernel* _Kernel, int* _Variant, int* _CarrierHz);
+
+// Renders _Buffers consecutive buffers of the workload a case times into _Out, so that
+// its output can be checked as well. Returns the command (fundamental) frequency in Hz,
+// 0 for the pulse pattern kernel.
+float Benchmark_Render(BenchmarkKernel _Kernel, int _Variant, int _CarrierHz, int8_t* _Out, int _Buffers);
+
+// Number of results Benchmark_Run produces
+int Benchmark_GetCaseCount(void);
+
+// "cycles" on target, "ns" on the host
+const char* Benchmark_GetTickUnit(void);
+
+const char* Benchmark_GetKernelName(BenchmarkKernel _Kernel);
+const char* Benchmark_GetVariantName(BenchmarkKernel _Kernel, int _Variant);
+
+#endif // BENCHMARK_H
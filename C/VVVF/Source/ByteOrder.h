@@ -0,0 +1,27 @@
+#ifndef BYTE_ORDER_H
+#define BYTE_ORDER_H
+
+#include <stdint.h>
+
+// Little endian fields of the app data packets (Telemetry.h, EventLog.h, Snapshot.h and
+// ProfileCodec.h). Written byte by byte, so they work at any alignment and on any host.
+
+static inline void PutU16(uint8_t* _Packet, uint16_t _Value) {
+    _Packet[0] = (uint8_t)(_Value & 0xFF);
+    _Packet[1] = (uint8_t)(_Value >> 8);
+}
+
+static inline void PutU32(uint8_t* _Packet, uint32_t _Value) {
+    PutU16(_Packet, (uint16_t)(_Value & 0xFFFF));
+    PutU16(_Packet + 2, (uint16_t)(_Value >> 16));
+}
+
+static inline uint16_t GetU16(const uint8_t* _Packet) {
+    return (uint16_t)(_Packet[0] | (_Packet[1] << 8));
+}
+
+static inline uint32_t GetU32(const uint8_t* _Packet) {
+    return (uint32_t)GetU16(_Packet) | ((uint32_t)GetU16(_Packet + 2) << 16);
+}
+
+#endif // BYTE_ORDER_H
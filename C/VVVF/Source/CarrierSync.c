@@ -0,0 +1,81 @@
+#include "CarrierSync.h"
+#include "SPWMGenerator.h"
+
+#define PI_F (TWO_PI / 2.0f)
+
+static uint32_t PhaseToFraction(float _Phase, int _Bits) {
+    float cycles = _Phase / TWO_PI;
+    cycles -= (float)(int)cycles;
+    if (cycles < 0.0f) cycles += 1.0f;
+    uint32_t steps = (uint32_t)1 << _Bits;
+    return (uint32_t)(cycles * (float)steps + 0.5f) & (steps - 1);
+}
+
+static float FractionToPhase(uint32_t _Fraction, int _Bits) {
+    return (float)_Fraction / (float)((uint32_t)1 << _Bits) * TWO_PI;
+}
+
+static float Clamp(float _Value, float _Limit) {
+    if (_Value > _Limit) return _Limit;
+    if (_Value < -_Limit) return -_Limit;
+    return _Value;
+}
+
+void CarrierSync_Encode(const CarrierSyncFrame* _Frame, uint8_t* _Data) {
+    int range = _Frame->rangeIndex < -1 ? -1 : _Frame->rangeIndex > INT8_MAX ? INT8_MAX : _Frame->rangeIndex;
+    uint32_t carrier = PhaseToFraction(_Frame->carrierPhase, 16);
+    float hz = _Frame->carrierHz * 256.0f;
+    uint32_t frequency = hz <= 0.0f ? 0 : hz >= 16777215.0f ? 16777215u : (uint32_t)(hz + 0.5f);
+
+    _Data[0] = _Frame->sequence;
+    _Data[1] = (uint8_t)(int8_t)range;
+    _Data[2] = (uint8_t)(carrier & 0xFF);
+    _Data[3] = (uint8_t)(carrier >> 8);
+    _Data[4] = (uint8_t)PhaseToFraction(_Frame->commandPhase, 8);
+    _Data[5] = (uint8_t)(frequency & 0xFF);
+    _Data[6] = (uint8_t)((frequency >> 8) & 0xFF);
+    _Data[7] = (uint8_t)(frequency >> 16);
+}
+
+bool CarrierSync_Decode(const uint8_t* _Data, int _Length, CarrierSyncFrame* _Frame) {
+    if (_Length < CARRIER_SYNC_FRAME_LENGTH) {
+        return false;
+    }
+    _Frame->sequence = _Data[0];
+    _Frame->rangeIndex = (int8_t)_Data[1];
+    _Frame->carrierPhase = FractionToPhase((uint32_t)(_Data[2] | (_Data[3] << 8)), 16);
+    _Frame->commandPhase = FractionToPhase(_Data[4], 8);
+    _Frame->carrierHz = (float)((uint32_t)_Data[5] | ((uint32_t)_Data[6] << 8) | ((uint32_t)_Data[7] << 16)) / 256.0f;
+    return true;
+}
+
+float CarrierSync_Extrapolate(float _Phase, float _Hz, float _Seconds) {
+    // In cycles, so whole cycles can be dropped without fmodf
+    float cycles = _Phase / TWO_PI + _Hz * _Seconds;
+    cycles -= (float)(int)cycles;
+    if (cycles < 0.0f) cycles += 1.0f;
+    float phase = cycles * TWO_PI;
+    return phase < TWO_PI ? phase : 0.0f;
+}
+
+float CarrierSync_PhaseError(float _Reference, float _Own) {
+    float error = _Reference - _Own;
+    if (error >= PI_F) error -= TWO_PI;
+    if (error < -PI_F) error += TWO_PI;
+    return error;
+}
+
+void CarrierSync_ResetLoop(CarrierSyncLoop* _Loop) {
+    _Loop->offsetHz = 0.0f;
+    _Loop->trimHz = 0.0f;
+    _Loop->error = 0.0f;
+}
+
+float CarrierSync_UpdateLoop(CarrierSyncLoop* _Loop, float _Error, float _IntervalS) {
+    // Cycles of error per second of interval, the frequency that would close it in one interval
+    float closingHz = _Error / TWO_PI / (_IntervalS > 0.0f ? _IntervalS : 1.0f);
+    _Loop->error = _Error;
+    _Loop->offsetHz = Clamp(_Loop->offsetHz + CARRIER_SYNC_FREQUENCY_GAIN * closingHz, CARRIER_SYNC_MAX_TRIM_HZ);
+    _Loop->trimHz = Clamp(_Loop->offsetHz + CARRIER_SYNC_PHASE_GAIN * closingHz, CARRIER_SYNC_MAX_TRIM_HZ);
+    return _Loop->trimHz;
+}
@@ -0,0 +1,78 @@
+#ifndef CARRIER_SYNC_H
+#define CARRIER_SYNC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Carrier phase sync between the VESCs of a multi motor vehicle, each running its own copy of
+// the plugin. Free running carriers of slightly different frequencies beat against each other,
+// so one VESC (the leader) broadcasts its carrier and command phases and its active speed range
+// a few times per second, and the others (followers) pull their SPWMGenerator phases towards it.
+//
+// Phases are taken when a buffer is handed to the firmware, at its first sample, where every
+// VESC is in step with its own sample clock. The leader sends them with can_transmit_eid every
+// few buffers. A follower stores the frame with the time it arrived, moves the leader's phases on
+// to the start of its next buffer and compares. The difference of the carrier frequencies is fed
+// forward, and a PI loop turns the phase error into a small frequency trim on top of it, which
+// takes care of the two sample clocks not running at quite the same rate. The loop only updates
+// once per frame, between frames the trims stay put. It pulls in a clock difference of up to about
+// a quarter carrier cycle per frame, far more than two crystals are apart.
+//
+// Frame, extended id CARRIER_SYNC_CAN_ID, all fields little endian:
+//   0  uint8   sequence, wraps
+//   1  int8    active speed range index, -1 when disabled
+//   2  uint16  carrier phase in 1/65536 cycle
+//   4  uint8   command phase in 1/256 cycle
+//   5  uint24  carrier frequency in 1/256 Hz
+
+// Outside the VESC CAN protocol (command 0x5653 is not a VESC command), so other VESCs ignore it
+#define CARRIER_SYNC_CAN_ID 0x00565301u  // 'V' 'S', version 1
+#define CARRIER_SYNC_FRAME_LENGTH 8
+
+#define CARRIER_SYNC_DEFAULT_RATE_HZ 5
+#define CARRIER_SYNC_MAX_RATE_HZ 50
+#define CARRIER_SYNC_TIMEOUT_S 1.0f       // A follower free runs once the last frame is older than this
+#define CARRIER_SYNC_PHASE_GAIN 0.5f      // Share of the phase error removed until the next frame
+#define CARRIER_SYNC_FREQUENCY_GAIN 0.1f  // Share of it that goes into the frequency offset, the integral part
+#define CARRIER_SYNC_MAX_TRIM_HZ 50.0f
+#define CARRIER_SYNC_LOCK_RAD 0.175f      // Locked below 10 degrees of carrier phase error
+
+typedef enum {
+    SYNC_MODE_OFF,
+    SYNC_MODE_LEADER,
+    SYNC_MODE_FOLLOWER
+} SyncMode;
+
+typedef struct {
+    uint8_t sequence;
+    int rangeIndex;
+    float carrierPhase;    // Radians, 0 to TWO_PI
+    float commandPhase;    // Radians, 0 to TWO_PI
+    float carrierHz;
+} CarrierSyncFrame;
+
+// PI loop for one phase
+typedef struct {
+    float offsetHz;        // Integral part, the frequency difference to the leader
+    float trimHz;          // Frequency trim until the next frame
+    float error;           // Last phase error in radians, positive when the leader is ahead
+} CarrierSyncLoop;
+
+// Writes CARRIER_SYNC_FRAME_LENGTH bytes
+void CarrierSync_Encode(const CarrierSyncFrame* _Frame, uint8_t* _Data);
+
+// Returns false if the frame is too short
+bool CarrierSync_Decode(const uint8_t* _Data, int _Length, CarrierSyncFrame* _Frame);
+
+// Phase after _Seconds at _Hz, in [0, TWO_PI)
+float CarrierSync_Extrapolate(float _Phase, float _Hz, float _Seconds);
+
+// _Reference - _Own, wrapped to [-PI, PI)
+float CarrierSync_PhaseError(float _Reference, float _Own);
+
+void CarrierSync_ResetLoop(CarrierSyncLoop* _Loop);
+
+// Feeds one phase error, _IntervalS is the time until the next frame. Returns the new trim.
+float CarrierSync_UpdateLoop(CarrierSyncLoop* _Loop, float _Error, float _IntervalS);
+
+#endif // CARRIER_SYNC_H
@@ -62,169 +62,9 @@ void SetSpeedRangeSpeed(InverterConfig* _Source, int _Index, float minSpeed, flo
     _Source->speedRangeCount += 1;
 }
 
-void InitializeConfiguration(InverterConfig* _Config) {
-    // Setup basic parameters
-    _Config->maxSpeed = MAX_SPEED_KMH; // km/h
-    // _Config->rpmToSpeedRatio = wheel_diameter_to_kmh_factor(WHEEL_DIAMETER_MM);
-    _Config->zeroSpeedCutoffMargin = ZERO_CUTOFF_MARGIN_KMH;
-
-    // Now add ranges
-    SPWMConfig config;
-
-    // Range 0: -1.0 km/h to 5.0 km/h
-    config = AddSPWM_AsyncFixed(4000);
-    SetSPWM_Acceleration(_Config, 0, config);
-    SetSPWM_Coasting(_Config, 0, config);
-    SetSPWM_Deceleration(_Config, 0, config);
-    SetSpeedRangeSpeed(_Config, 0, -1.0f, 31.0f);
-
-
-    // config = AddSPWM_AsyncFixed(4000);
-    // SetSPWM_Acceleration(_Config, 1, config);
-    // SetSPWM_Coasting(_Config, 1, config);
-    // SetSPWM_Deceleration(_Config, 1, config);
-    // SetSpeedRangeSpeed(_Config, 1, -1.0f, 31.0f);
-
-
-    // config = AddSPWM_AsyncFixed(4000);
-    // SetSPWM_Acceleration(_Config, 2, config);
-    // SetSPWM_Coasting(_Config, 2, config);
-    // SetSPWM_Deceleration(_Config, 2, config);
-    // SetSpeedRangeSpeed(_Config, 2, 14.0f, 999.0f);
-    // // Range 0: -1.0 km/h to 5.0 km/h
-    // config = AddSPWM_AsyncRamp(250, 500); // Ramp from 250 Hz to 500 Hz
-    // SetSPWM_Acceleration(_Config, 0, config);
-    // SetSPWM_Coasting(_Config, 0, config);
-    // SetSPWM_Deceleration(_Config, 0, config);
-    // SetSpeedRangeSpeed(_Config, 0, -1.0f, 5.0f);
-
-    // // Range 1: 5.0 km/h to 20.0 km/h
-    // config = AddSPWM_AsyncFixed(500); // Fixed at 500 Hz
-    // SetSPWM_Acceleration(_Config, 1, config);
-    // SetSPWM_Coasting(_Config, 1, config);
-    // SetSPWM_Deceleration(_Config, 1, config);
-    // SetSpeedRangeSpeed(_Config, 1, 5.0f, 20.0f);
-
-    // // Range 2: 20.0 km/h to 21.0 km/h
-    // config = AddSPWM_AsyncRamp(500, 300); // Ramp from 500 Hz to 300 Hz
-    // SetSPWM_Acceleration(_Config, 2, config);
-    // SetSPWM_Coasting(_Config, 2, config);
-    // config = AddSPWM_AsyncFixed(500); // Fixed at 500 Hz for braking
-    // SetSPWM_Deceleration(_Config, 2, config);
-    // SetSpeedRangeSpeed(_Config, 2, 20.0f, 21.0f);
-
-    // // Range 3: 21.0 km/h to 27.0 km/h
-    // config = AddSPWM_Sync(11); // Sync with 11 pulses
-    // SetSPWM_Acceleration(_Config, 3, config);
-    // SetSPWM_Coasting(_Config, 3, config);
-    // SetSPWM_Deceleration(_Config, 3, config);
-    // SetSpeedRangeSpeed(_Config, 3, 21.0f, 27.0f);
-
-    // // Range 4: 27.0 km/h to 40.0 km/h
-    // config = AddSPWM_Sync(7); // Sync with 7 pulses
-    // SetSPWM_Acceleration(_Config, 4, config);
-    // SetSPWM_Coasting(_Config, 4, config);
-    // SetSPWM_Deceleration(_Config, 4, config);
-    // SetSpeedRangeSpeed(_Config, 4, 27.0f, 40.0f);
-
-    // // Range 5: 40.0 km/h to 48.0 km/h
-    // config = AddSPWM_Sync(3); // Sync with 3 pulses, no wide pulse
-    // SetSPWM_Acceleration(_Config, 5, config);
-    // SetSPWM_Coasting(_Config, 5, config);
-    // SetSPWM_Deceleration(_Config, 5, config);
-    // SetSpeedRangeSpeed(_Config, 5, 40.0f, 48.0f);
-
-    // // Range 6: 48.0 km/h to 55.0 km/h
-    // config = AddSPWM_Sync(3); // Sync with 3 pulses, wide pulse enabled
-    // // config.modulationIndex = 1.1f; // Modulation index for W3P mode
-    // SetSPWM_Acceleration(_Config, 6, config);
-    // SetSPWM_Coasting(_Config, 6, config);
-    // SetSPWM_Deceleration(_Config, 6, config);
-    // SetSpeedRangeSpeed(_Config, 6, 48.0f, 55.0f);
-
-    // // Range 7: 55.0 km/h to 150.0 km/h
-    // config = AddSPWM_Sync(1); // Sync with 1 pulse, no wide pulse
-    // SetSPWM_Acceleration(_Config, 7, config);
-    // config = AddSPWM_Sync(3); // Sync with 3 pulses, wide pulse enabled
-    // // config.modulationIndex = 1.15f; // Modulation index for W3P mode
-    // SetSPWM_Coasting(_Config, 7, config);
-    // config = AddSPWM_Sync(1); // Sync with 1 pulse, no wide pulse
-    // SetSPWM_Deceleration(_Config, 7, config);
-    // SetSpeedRangeSpeed(_Config, 7, 55.0f, 150.0f);
-
-    // // Range 0: 0.0 km/h to 4.0 km/h
-    // config = AddSPWM_AsyncFixed(1235);
-    // SetSPWM_Acceleration(_Config, 0, config);
-    // SetSPWM_Coasting(_Config, 0, config);
-    // SetSPWM_Deceleration(_Config, 0, AddSPWM_AsyncFixed(1160));
-    // SetSpeedRangeSpeed(_Config, 0, 0.0f, 10.0f);
-
-    // // Range 1: 4.0 km/h to 8.0 km/h
-    // config = AddSPWM_AsyncFixed(1190);
-    // SetSPWM_Acceleration(_Config, 1, config);
-    // SetSPWM_Coasting(_Config, 1, config);
-    // SetSPWM_Deceleration(_Config, 1, config);
-    // SetSpeedRangeSpeed(_Config, 1, 10.0f, 15.0f);
-
-    // // Range 2: 8.0 km/h to 10.0 km/h
-    // config = AddSPWM_AsyncFixed(1210);
-    // SetSPWM_Acceleration(_Config, 2, config);
-    // SetSPWM_Coasting(_Config, 2, config);
-    // SetSPWM_Deceleration(_Config, 2, config);
-    // SetSpeedRangeSpeed(_Config, 2, 15.0f, 20.0f);
-
-    // // Range 3: 10.0 km/h to 14.0 km/h
-    // config = AddSPWM_AsyncFixed(1235);
-    // SetSPWM_Acceleration(_Config, 3, config);
-    // SetSPWM_Coasting(_Config, 3, config);
-    // SetSPWM_Deceleration(_Config, 3, config);
-    // SetSpeedRangeSpeed(_Config, 3, 20.0f, 23.0f);
-
-    // // Range 4: 14.0 km/h to 16.0 km/h
-    // config = AddSPWM_AsyncFixed(1460);
-    // SetSPWM_Acceleration(_Config, 4, config);
-    // SetSPWM_Coasting(_Config, 4, config);
-    // SetSPWM_Deceleration(_Config, 4, config);
-    // SetSpeedRangeSpeed(_Config, 4, 23.0f, 27.0f);
-
-    // // Range 5: 16.0 km/h to 19.0 km/h
-    // config = AddSPWM_AsyncFixed(1210);
-    // SetSPWM_Acceleration(_Config, 5, config);
-    // SetSPWM_Coasting(_Config, 5, config);
-    // SetSPWM_Deceleration(_Config, 5, config);
-    // SetSpeedRangeSpeed(_Config, 5, 27.0f, 32.0f);
-
-    // // Range 6: 19.0 km/h to 999.0 km/h
-    // config = AddSPWM_AsyncFixed(1230);
-    // SetSPWM_Acceleration(_Config, 6, config);
-    // SetSPWM_Coasting(_Config, 6, config);
-    // SetSPWM_Deceleration(_Config, 6, config);
-    // SetSpeedRangeSpeed(_Config, 6, 32.0f, 999.0f);
-
-}
-
-
-SpeedRange GetSpeedRangeAtSpeed(InverterConfig* _Source, float _Speed, float _MotorCurrent) {
-    SpeedRange defaultRange = {0}; // Default range if no match is found
-    defaultRange.minSpeed = 0;
-    defaultRange.maxSpeed = 99999;
-    defaultRange.spwm.acceleration.type = SPWM_TYPE_NONE;
-    defaultRange.spwm.acceleration.carrierFrequencyStart = 0;
-    defaultRange.spwm.acceleration.carrierFrequencyEnd = 0;
-    defaultRange.spwm.acceleration.numPulses = 0;
-
-    defaultRange.spwm.coasting.type = SPWM_TYPE_NONE;
-    defaultRange.spwm.coasting.carrierFrequencyStart = 0;
-    defaultRange.spwm.coasting.carrierFrequencyEnd = 0;
-    defaultRange.spwm.coasting.numPulses = 0;
-
-    defaultRange.spwm.deceleration.type = SPWM_TYPE_NONE;
-    defaultRange.spwm.deceleration.carrierFrequencyStart = 0;
-    defaultRange.spwm.deceleration.carrierFrequencyEnd = 0;
-    defaultRange.spwm.deceleration.numPulses = 0;
-
+int GetSpeedRangeIndexAtSpeed(const InverterConfig* _Source, float _Speed, float _MotorCurrent) {
     if (_Source == NULL || _Source->speedRangeCount == 0) {
-        return defaultRange; // Return an empty range if the config is invalid
+        return -1; // No range if the config is invalid
     }
 
     // Calculate the speed in km/h using the rpmToSpeedRatio
@@ -235,9 +75,9 @@ SpeedRange GetSpeedRangeAtSpeed(InverterConfig* _Source, float _Speed, float _Mo
         speedKmh = _Source->maxSpeed;
     }
 
-    // If the speed is below the cutoff margin and the current is low, return the default range (disabled)
+    // If the speed is below the cutoff margin and the current is low, there is no range (disabled)
     if (speedKmh < _Source->zeroSpeedCutoffMargin && _MotorCurrent < 3.0f) {
-        return defaultRange;
+        return -1;
     }
 
     // Iterate through the speed ranges to find the appropriate range
@@ -249,12 +89,42 @@ SpeedRange GetSpeedRangeAtSpeed(InverterConfig* _Source, float _Speed, float _Mo
         }
 
         if (speedKmh >= BottomSpeed && speedKmh <= _Source->speedRanges[i].maxSpeed) {
-            return _Source->speedRanges[i]; // Return the matching speed range
+            return i; // Return the matching speed range
         }
     }
 
-    // If no range matches, return the default range
-    return defaultRange;
+    // If no range matches, there is no range
+    return -1;
+}
+
+SpeedRange GetSpeedRangeByIndex(const InverterConfig* _Source, int _Index) {
+    SpeedRange defaultRange = {0}; // Default range if no match is found
+    defaultRange.minSpeed = 0;
+    defaultRange.maxSpeed = 99999;
+    defaultRange.spwm.acceleration.type = SPWM_TYPE_NONE;
+    defaultRange.spwm.acceleration.carrierFrequencyStart = 0;
+    defaultRange.spwm.acceleration.carrierFrequencyEnd = 0;
+    defaultRange.spwm.acceleration.numPulses = 0;
+
+    defaultRange.spwm.coasting.type = SPWM_TYPE_NONE;
+    defaultRange.spwm.coasting.carrierFrequencyStart = 0;
+    defaultRange.spwm.coasting.carrierFrequencyEnd = 0;
+    defaultRange.spwm.coasting.numPulses = 0;
+
+    defaultRange.spwm.deceleration.type = SPWM_TYPE_NONE;
+    defaultRange.spwm.deceleration.carrierFrequencyStart = 0;
+    defaultRange.spwm.deceleration.carrierFrequencyEnd = 0;
+    defaultRange.spwm.deceleration.numPulses = 0;
+
+    if (_Source == NULL || _Index < 0 || _Index >= _Source->speedRangeCount) {
+        return defaultRange; // Disabled range if there is no matching range
+    }
+
+    return _Source->speedRanges[_Index];
+}
+
+SpeedRange GetSpeedRangeAtSpeed(const InverterConfig* _Source, float _Speed, float _MotorCurrent) {
+    return GetSpeedRangeByIndex(_Source, GetSpeedRangeIndexAtSpeed(_Source, _Speed, _MotorCurrent));
 }
 
 
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include "Parameters.h"
+#include "Curve.h"
 
 typedef enum {
     SPWM_TYPE_NONE,          // Output disabled
@@ -31,6 +32,17 @@ typedef struct {
     SPWMBehaviorConfig spwm;   // SPWM configuration for this speed range
 } SpeedRange;
 
+typedef struct {
+    Curve current;           // Motor current (A) to injection voltage (V)
+    Curve speed;             // Speed (km/h) to voltage scale factor, applied on top of the current curve
+} AmplitudeConfig;
+
+typedef struct {
+    AmplitudeConfig acceleration; // Amplitude curves while accelerating
+    AmplitudeConfig coasting;     // Amplitude curves while coasting
+    AmplitudeConfig deceleration; // Amplitude curves while decelerating
+} AmplitudeBehaviorConfig;
+
 // Define the main configuration struct
 typedef struct {
     // float rpmToSpeedRatio;   // Used to convert from the motor's rpm to the speed in km/h
@@ -38,6 +50,7 @@ typedef struct {
     float zeroSpeedCutoffMargin; // How close it should be to 0 kmh before cutting off
     SpeedRange speedRanges[MAX_SPEED_RANGES]; // Array of speed ranges
     int speedRangeCount;     // Number of valid speed ranges
+    AmplitudeBehaviorConfig amplitude; // Amplitude curves for each rotor state
 } InverterConfig;
 
 // Add a new enum to track the state of the rotor
@@ -48,9 +61,13 @@ typedef enum {
 } RotorState;
 
 
-// Function to parse JSON and populate the InverterConfig struct
-void InitializeConfiguration(InverterConfig* _Config);
-SpeedRange GetSpeedRangeAtSpeed(InverterConfig* _Source, float _MotorRPM, float _MotorCurrent);
+// Wheel rpm times this factor is the speed in km/h
+float wheel_diameter_to_kmh_factor(float diameter_mm);
+
+// Selects the speed range for the given speed, the config is only ever read so it can live in flash
+int GetSpeedRangeIndexAtSpeed(const InverterConfig* _Source, float _Speed, float _MotorCurrent); // -1 if disabled
+SpeedRange GetSpeedRangeByIndex(const InverterConfig* _Source, int _Index); // Disabled range for -1
+SpeedRange GetSpeedRangeAtSpeed(const InverterConfig* _Source, float _MotorRPM, float _MotorCurrent);
 void PrintInverterConfig(const InverterConfig* config);
 void PrintSPWMConfig(const SPWMConfig* spwm);
 
@@ -0,0 +1,44 @@
+#include "Curve.h"
+#include <stddef.h>
+
+void Curve_ResetCursor(CurveCursor* _Cursor) {
+    _Cursor->segment = 0;
+}
+
+float Curve_Evaluate(const Curve* _Curve, CurveCursor* _Cursor, float _X) {
+    if (!_Curve || _Curve->pointCount <= 0) return 0.0f;
+
+    const CurvePoint* points = _Curve->points;
+    int lastSegment = _Curve->pointCount - 2;
+
+    // Clamp to the end points
+    if (lastSegment < 0 || _X <= points[0].x) {
+        return points[0].y;
+    }
+    if (_X >= points[lastSegment + 1].x) {
+        return points[lastSegment + 1].y;
+    }
+
+    // The curve may have been swapped for a shorter one since the last call
+    int segment = _Cursor ? _Cursor->segment : 0;
+    if (segment < 0 || segment > lastSegment) {
+        segment = 0;
+    }
+
+    // Walk from the cached segment towards the one containing x
+    while (_X < points[segment].x) {
+        segment--;
+    }
+    while (_X > points[segment + 1].x) {
+        segment++;
+    }
+
+    if (_Cursor) {
+        _Cursor->segment = segment;
+    }
+
+    const CurvePoint* a = &points[segment];
+    const CurvePoint* b = &points[segment + 1];
+    if (b->x == a->x) return b->y; // Avoid division by zero on vertical steps
+    return a->y + (_X - a->x) * (b->y - a->y) / (b->x - a->x);
+}
@@ -0,0 +1,30 @@
+#ifndef CURVE_H
+#define CURVE_H
+
+#define MAX_CURVE_POINTS 8
+
+typedef struct {
+    float x;
+    float y;
+} CurvePoint;
+
+// Piecewise linear curve, points *MUST* be in ascending x order. Outside of the first and
+// last point the curve is clamped to their y values.
+typedef struct {
+    CurvePoint points[MAX_CURVE_POINTS];
+    int pointCount;
+} Curve;
+
+// Remembers which segment the last evaluation landed in. The inputs (current, speed) change
+// slowly between updates, so searching from the cached segment is O(1) amortized.
+typedef struct {
+    int segment;
+} CurveCursor;
+
+// Static initializer for a curve, e.g. CURVE({0.0f, 0.0f}, {10.0f, 1.0f})
+#define CURVE(...) { { __VA_ARGS__ }, (int)(sizeof((CurvePoint[]){ __VA_ARGS__ }) / sizeof(CurvePoint)) }
+
+void Curve_ResetCursor(CurveCursor* _Cursor);
+float Curve_Evaluate(const Curve* _Curve, CurveCursor* _Cursor, float _X);
+
+#endif // CURVE_H
@@ -0,0 +1,72 @@
+#include "Envelope.h"
+
+void Envelope_Init(Envelope* _Envelope, float _SampleRate) {
+    _Envelope->stage = ENVELOPE_IDLE;
+    _Envelope->gain = 0.0f;
+    _Envelope->attackStep = 1.0f / (ENVELOPE_ATTACK_S * _SampleRate);
+    _Envelope->releaseStep = 1.0f / (ENVELOPE_RELEASE_S * _SampleRate);
+}
+
+void Envelope_SetGate(Envelope* _Envelope, bool _Open) {
+    if (_Open) {
+        if (_Envelope->stage == ENVELOPE_IDLE || _Envelope->stage == ENVELOPE_RELEASE) {
+            _Envelope->stage = ENVELOPE_ATTACK;
+        }
+    } else if (_Envelope->stage == ENVELOPE_ATTACK || _Envelope->stage == ENVELOPE_SUSTAIN) {
+        _Envelope->stage = ENVELOPE_RELEASE;
+    }
+}
+
+bool Envelope_IsIdle(const Envelope* _Envelope) {
+    return _Envelope->stage == ENVELOPE_IDLE;
+}
+
+void Envelope_Apply(Envelope* _Envelope, int8_t* _Samples, int _Length) {
+    switch (_Envelope->stage) {
+        case ENVELOPE_SUSTAIN:
+            return;
+
+        case ENVELOPE_IDLE:
+            for (int i = 0; i < _Length; i++) {
+                _Samples[i] = 0;
+            }
+            return;
+
+        case ENVELOPE_ATTACK: {
+            float gain = _Envelope->gain;
+            for (int i = 0; i < _Length; i++) {
+                gain += _Envelope->attackStep;
+                if (gain >= 1.0f) {
+                    // The rest of the buffer is at full amplitude already
+                    _Envelope->gain = 1.0f;
+                    _Envelope->stage = ENVELOPE_SUSTAIN;
+                    return;
+                }
+                _Samples[i] = (int8_t)((float)_Samples[i] * gain);
+            }
+            _Envelope->gain = gain;
+            return;
+        }
+
+        case ENVELOPE_RELEASE: {
+            float gain = _Envelope->gain;
+            int i = 0;
+            for (; i < _Length; i++) {
+                gain -= _Envelope->releaseStep;
+                if (gain <= 0.0f) {
+                    break;
+                }
+                _Samples[i] = (int8_t)((float)_Samples[i] * gain);
+            }
+            if (i < _Length) {
+                for (; i < _Length; i++) {
+                    _Samples[i] = 0;
+                }
+                gain = 0.0f;
+                _Envelope->stage = ENVELOPE_IDLE;
+            }
+            _Envelope->gain = gain;
+            return;
+        }
+    }
+}
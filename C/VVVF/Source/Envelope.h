@@ -0,0 +1,49 @@
+#ifndef ENVELOPE_H
+#define ENVELOPE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Attack/release envelope of a motor's output, applied to every sample the generator writes.
+// Turning the sound on or off from one buffer to the next is a step from full amplitude to
+// nothing, which the motor plays as a click. The envelope is gated open while the active speed
+// range has output and closed when it has none, which includes the zero speed cutoff and the
+// audio loop being stopped. The gain then ramps linearly to 1 over ENVELOPE_ATTACK_S, or to 0 over
+// ENVELOPE_RELEASE_S, one step per sample, and a gate that changes halfway picks the ramp up where
+// the other left it.
+//
+// Once the release has reached 0 the envelope is idle: the generator neither renders nor clears
+// the buffers, and playback stops handing them to the firmware, until the gate opens again. While
+// every motor is idle playback sleeps, and the generator only checks the gates at the motor update
+// rate, or every ENVELOPE_IDLE_CHECK_MS when Lisp sets the motor values.
+
+#define ENVELOPE_ATTACK_S 0.02f // Fade in, short enough not to clip the start of a carrier change
+#define ENVELOPE_RELEASE_S 0.06f // Fade out, a little longer since it ends in silence
+#define ENVELOPE_STOP_TIMEOUT_MS 200 // Longest unloading the library waits for the fade out
+#define ENVELOPE_IDLE_CHECK_MS 20 // Gate checks while idle, the default update rate of Main.lisp
+
+typedef enum {
+    ENVELOPE_IDLE,    // Silent, nothing is generated or played
+    ENVELOPE_ATTACK,  // Gain rising to 1
+    ENVELOPE_SUSTAIN, // Gain 1, the samples are left alone
+    ENVELOPE_RELEASE  // Gain falling to 0
+} EnvelopeStage;
+
+typedef struct {
+    EnvelopeStage stage;
+    float gain;
+    float attackStep;  // Gain per sample
+    float releaseStep; // Likewise
+} Envelope;
+
+void Envelope_Init(Envelope* _Envelope, float _SampleRate);
+
+// Opens or closes the gate, takes effect with the next sample
+void Envelope_SetGate(Envelope* _Envelope, bool _Open);
+
+bool Envelope_IsIdle(const Envelope* _Envelope);
+
+// Scales _Samples in place. A release that ends within the buffer leaves silence after it.
+void Envelope_Apply(Envelope* _Envelope, int8_t* _Samples, int _Length);
+
+#endif // ENVELOPE_H
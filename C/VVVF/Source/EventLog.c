@@ -0,0 +1,122 @@
+#include "EventLog.h"
+#include "ByteOrder.h"
+#include <string.h>
+
+static int8_t ClampInt8(int _Value) {
+    if (_Value < INT8_MIN) return INT8_MIN;
+    if (_Value > INT8_MAX) return INT8_MAX;
+    return (int8_t)_Value;
+}
+
+void EventLog_Init(EventLog* _Log) {
+    memset(_Log->events, 0, sizeof(_Log->events));
+    rb_init(&_Log->ring, _Log->events, sizeof(Event), EVENT_LOG_LENGTH);
+    _Log->dropped = 0;
+    _Log->mutex = VESC_IF->mutex_create();
+}
+
+void EventLog_Free(EventLog* _Log) {
+    VESC_IF->free(_Log->ring.mutex);
+    VESC_IF->free(_Log->mutex);
+    _Log->ring.mutex = NULL;
+    _Log->mutex = NULL;
+}
+
+void EventLog_Add(EventLog* _Log, EventType _Type, int _From, int _To, float _SpeedKmh, uint32_t _Underruns) {
+    Event event;
+    event.timeMs = (uint32_t)(VESC_IF->system_time() * 1000.0f);
+    event.type = (uint8_t)_Type;
+    event.from = ClampInt8(_From);
+    event.to = ClampInt8(_To);
+
+    float speed = _SpeedKmh * 100.0f;
+    if (speed > (float)INT16_MAX) speed = (float)INT16_MAX;
+    if (speed < (float)INT16_MIN) speed = (float)INT16_MIN;
+    event.speed = (int16_t)speed;
+    event.underruns = _Underruns > UINT16_MAX ? UINT16_MAX : (uint16_t)_Underruns;
+
+    // Keep the newest events. A reader popping in between only makes more room, another writer
+    // can't fill it up again while we hold the mutex.
+    VESC_IF->mutex_lock(_Log->mutex);
+    if (!rb_insert(&_Log->ring, &event)) {
+        rb_pop(&_Log->ring, NULL);
+        rb_insert(&_Log->ring, &event);
+        _Log->dropped++;
+    }
+    VESC_IF->mutex_unlock(_Log->mutex);
+}
+
+bool EventLog_Pop(EventLog* _Log, Event* _Event) {
+    return rb_pop(&_Log->ring, _Event);
+}
+
+void EventLog_Clear(EventLog* _Log) {
+    VESC_IF->mutex_lock(_Log->mutex);
+    rb_flush(&_Log->ring);
+    _Log->dropped = 0;
+    VESC_IF->mutex_unlock(_Log->mutex);
+}
+
+uint32_t EventLog_TakeDropped(EventLog* _Log) {
+    VESC_IF->mutex_lock(_Log->mutex);
+    uint32_t dropped = _Log->dropped;
+    _Log->dropped = 0;
+    VESC_IF->mutex_unlock(_Log->mutex);
+    return dropped;
+}
+
+int EventLog_EncodePacket(EventLog* _Log, uint8_t* _Packet) {
+    _Packet[0] = EVENT_LOG_PACKET_ID;
+    _Packet[1] = EVENT_LOG_VERSION;
+    PutU32(_Packet + 4, EventLog_TakeDropped(_Log));
+
+    int count = 0;
+    Event event;
+    while (count < EVENT_LOG_EVENTS_PER_PACKET && EventLog_Pop(_Log, &event)) {
+        uint8_t* out = _Packet + EVENT_LOG_HEADER_LENGTH + count * EVENT_LOG_ENCODED_LENGTH;
+        PutU32(out, event.timeMs);
+        out[4] = event.type;
+        out[5] = (uint8_t)event.from;
+        out[6] = (uint8_t)event.to;
+        out[7] = 0;
+        PutU16(out + 8, (uint16_t)event.speed);
+        PutU16(out + 10, event.underruns);
+        count++;
+    }
+
+    _Packet[2] = (uint8_t)count;
+    _Packet[3] = rb_is_empty(&_Log->ring) ? EVENT_LOG_FLAG_LAST : 0;
+    return EVENT_LOG_HEADER_LENGTH + count * EVENT_LOG_ENCODED_LENGTH;
+}
+
+bool EventLog_DecodeEvent(const uint8_t* _Packet, int _Length, int _Index, Event* _Event) {
+    if (_Length < EVENT_LOG_HEADER_LENGTH || _Packet[0] != EVENT_LOG_PACKET_ID || _Packet[1] != EVENT_LOG_VERSION) {
+        return false;
+    }
+    if (_Index < 0 || _Index >= _Packet[2] || EVENT_LOG_HEADER_LENGTH + (_Index + 1) * EVENT_LOG_ENCODED_LENGTH > _Length) {
+        return false;
+    }
+
+    const uint8_t* in = _Packet + EVENT_LOG_HEADER_LENGTH + _Index * EVENT_LOG_ENCODED_LENGTH;
+    _Event->timeMs = GetU32(in);
+    _Event->type = in[4];
+    _Event->from = (int8_t)in[5];
+    _Event->to = (int8_t)in[6];
+    _Event->speed = (int16_t)GetU16(in + 8);
+    _Event->underruns = GetU16(in + 10);
+    return true;
+}
+
+const char* EventLog_GetTypeName(EventType _Type) {
+    switch (_Type) {
+        case EVENT_START: return "start";
+        case EVENT_STOP: return "stop";
+        case EVENT_SPEED_RANGE: return "speed-range";
+        case EVENT_ROTOR_STATE: return "rotor-state";
+        case EVENT_SPWM_MODE: return "spwm-mode";
+        case EVENT_OUTPUT: return "output";
+        case EVENT_UNDERRUN: return "underrun";
+        case EVENT_PROFILE: return "profile";
+        default: return "unknown";
+    }
+}
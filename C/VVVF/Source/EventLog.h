@@ -0,0 +1,92 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "rb.h"
+
+// Fixed size log of timestamped state changes (speed range, rotor state, SPWM mode, underruns,
+// profile switches, start/stop), for glitches that are over long before a once per second
+// printf comes around. Built on the ring buffer from utils/rb.c over a static array, so adding
+// an event is O(1), never allocates and is safe from any thread. When the log is full the
+// oldest event is dropped.
+//
+// Dumping drains the log, either as text or as app data packets:
+//   0  uint8   EVENT_LOG_PACKET_ID
+//   1  uint8   EVENT_LOG_VERSION
+//   2  uint8   number of events in this packet
+//   3  uint8   flags, bit 0 set on the last packet of a dump
+//   4  uint32  events dropped since the previous dump
+//   8  events, EVENT_LOG_ENCODED_LENGTH bytes each:
+//        0  uint32  time in ms since boot
+//        4  uint8   EventType
+//        5  int8    previous value
+//        6  int8    new value
+//        7  uint8   reserved
+//        8  int16   speed in 0.01 km/h
+//        10 uint16  underruns, saturated
+// All fields are little endian, the same as the telemetry packet.
+
+#define EVENT_LOG_LENGTH 64
+#define EVENT_LOG_PACKET_ID 0x45        // 'E'
+#define EVENT_LOG_VERSION 1
+#define EVENT_LOG_HEADER_LENGTH 8
+#define EVENT_LOG_ENCODED_LENGTH 12
+#define EVENT_LOG_EVENTS_PER_PACKET 16  // Keeps packets well below the VESC packet size limit
+#define EVENT_LOG_PACKET_LENGTH (EVENT_LOG_HEADER_LENGTH + EVENT_LOG_EVENTS_PER_PACKET * EVENT_LOG_ENCODED_LENGTH)
+#define EVENT_LOG_FLAG_LAST 0x01
+
+typedef enum {
+    EVENT_START,          // Audio loop started
+    EVENT_STOP,           // Audio loop stopped
+    EVENT_SPEED_RANGE,    // Active speed range index changed, -1 is disabled
+    EVENT_ROTOR_STATE,    // RotorState changed
+    EVENT_SPWM_MODE,      // SPWMType of the active configuration changed
+    EVENT_OUTPUT,         // Generator output enabled (1) or disabled (0)
+    EVENT_UNDERRUN,       // Playback had to wait for a buffer
+    EVENT_PROFILE,        // Switched to another profile, values are profile indices
+    EVENT_TYPE_COUNT
+} EventType;
+
+typedef struct {
+    uint32_t timeMs;
+    uint8_t type;
+    int8_t from;
+    int8_t to;
+    int16_t speed;        // 0.01 km/h
+    uint16_t underruns;
+} Event;
+
+typedef struct {
+    rb_t ring;
+    Event events[EVENT_LOG_LENGTH];
+    uint32_t dropped;     // Events lost to a full log since the last dump
+    lib_mutex mutex;      // Guards dropped, and making room plus inserting as one step
+} EventLog;
+
+// Creates the mutexes, call once before any other function
+void EventLog_Init(EventLog* _Log);
+// Frees the mutexes, the events themselves live in the struct
+void EventLog_Free(EventLog* _Log);
+
+void EventLog_Add(EventLog* _Log, EventType _Type, int _From, int _To, float _SpeedKmh, uint32_t _Underruns);
+
+// Removes the oldest event, returns false when the log is empty
+bool EventLog_Pop(EventLog* _Log, Event* _Event);
+
+// Drops all events and clears the dropped count
+void EventLog_Clear(EventLog* _Log);
+
+// Takes and clears the dropped count
+uint32_t EventLog_TakeDropped(EventLog* _Log);
+
+// Pops up to EVENT_LOG_EVENTS_PER_PACKET events into one app data packet of at most
+// EVENT_LOG_PACKET_LENGTH bytes. Returns the packet length, the header only when the log is empty.
+int EventLog_EncodePacket(EventLog* _Log, uint8_t* _Packet);
+
+// Reads event _Index from a packet made by EventLog_EncodePacket
+bool EventLog_DecodeEvent(const uint8_t* _Packet, int _Length, int _Index, Event* _Event);
+
+const char* EventLog_GetTypeName(EventType _Type);
+
+#endif // EVENT_LOG_H
@@ -4,6 +4,16 @@
 #include <string.h>
 
 #include "ConfigParser.h"
+#include "Profiles.h"
+#include "Benchmark.h"
+#include "Profiler.h"
+#include "EventLog.h"
+#include "Telemetry.h"
+#include "Snapshot.h"
+#include "ProfileCodec.h"
+#include "CarrierSync.h"
+#include "VoltageLimit.h"
+#include "Envelope.h"
 #include "SPWMGenerator.h"
 #include "Parameters.h"
 
@@ -28,93 +38,190 @@ HEADER
 
 
 // Global variables
-static int8_t *buffers[NUM_BUFFERS];  // Array of pointers to buffers allocated on the heap
-static bool buffer_ready_for_consumption[NUM_BUFFERS];  // Flags to indicate if a buffer is ready for consumption
-static int producer_index = 0;  // Index of the buffer currently being filled by the producer
-static int consumer_index = 0;  // Index of the buffer currently being consumed by the consumer
-static float amplitude = 0.0f;
-static float speed_kmh = 0.0f;
 static float sample_rate = SAMPLE_RATE;
 
-static float current_samples[NUM_MOTOR_STAT_SAMPLES]; // Array of last n current values used to average them
-static int active_current_index = 0; // Index of current sample to be replaced
-static float hz_samples[NUM_MOTOR_STAT_SAMPLES]; // Array of last n hz values used to average them
-static int active_hz_index = 0; // Index of current sample to be replaced
-static float rpm_samples[RPM_SAMPLE_COUNT];
-static int active_rpm_index = 0;
-static float speed_samples[RPM_SAMPLE_COUNT];
-static int active_speed_index = 0;
-
-static float inverter_current = 0.; // Number of phase amps pushed into the motor from the vesc
-static float inverter_hz = 0.; // Current freqency of the inverter in hz
-static int motor_poles = 0; // Number of poles of the motor
-static int inverter_enabled = false; // Enable or disable the inverter doing stuff
-
-static InverterConfig Conf = {0}; // Configuration of the inverter from the json file
-static SpeedRange ActiveSpeedRange = {0}; // Currently active speed range that should be used for motor sound generation
-static SPWMGenerator generator;
-static RotorState rotor_state = ROTOR_STATE_COASTING;
-
-// Motor Sound Config
-static float min_current = INVERTER_CURRENT_RAMP_START; // Amperes - defines linear ramp min current
-static float max_current = INVERTER_CURRENT_RAMP_END; // Amperes - defines linear ramp max current
-static float min_sound_voltage = INVERTER_AMPLITUDE_RAMP_START; // Volts - defines linear ramp min voltage
-static float max_sound_voltage = INVERTER_AMPLITUDE_RAMP_END; // Volts - defines linear ramp max voltage
+static const InverterConfig* Conf = NULL; // Active configuration, points into the const profile library in flash or at custom_profile
+static int active_profile_index = 0; // Index of the active profile, see lookup_profile
+
+// Buffer slots, each holds one buffer per motor, see MotorContext
+static bool buffer_ready_for_consumption[NUM_BUFFERS];  // Flags to indicate if a buffer slot is ready for consumption, for all motors at once
+static int producer_index = 0;  // Index of the buffer slot currently being filled by the producer
+static int consumer_index = 0;  // Index of the buffer slot currently being consumed by the consumer
 
 // SPWM variables
 // static float carrier_phase = 0.0f; // Phase of the current carrier sin wave
 // static float command_phase = 0.0f; // Phase of the current command sin wave
 
 
-// Statistics
+// Statistics. The sample counters belong to the generator and playback threads, print_stats
+// reads them atomically.
 static uint32_t samples_generated = 0;
 static uint32_t last_samples_generated = 0;
 static uint32_t samples_consumed = 0;
 static uint32_t last_samples_comsumed = 0;
 static float last_time = 0.0f;
+static Profiler profiler; // Per buffer timing histograms, see Profiler.h. Guarded by state_mutex.
+static uint32_t buffer_ready_time[NUM_BUFFERS]; // timer_time_now when each buffer slot was marked ready
+static EventLog event_log; // State changes and underruns, dumped with ext-print-events / ext-send-events
+
+// Locking: state_mutex guards the control state (everything the extensions set and
+// update_spwm_settings derives from it). The generator and playback threads only take it to copy
+// what they need for the next buffer, never while generating or sleeping. loop_mutex serializes
+// starting and stopping the audio threads. When both are needed loop_mutex is taken first.
+static lib_mutex state_mutex = NULL;
+static lib_mutex loop_mutex = NULL;
 
 
 // Thread data structure
 typedef struct {
     lib_thread thread;
-    bool running;
+    bool running;       // Only read and written with loop_mutex held, the threads check should_terminate
 } thread_data;
 
 static thread_data generator_thread_data;
 static thread_data playback_thread_data;
-
-
-// Function to map a value from one range to another
-float map_value(float value, float in_min, float in_max, float out_min, float out_max) {
-    // Ensure the input range is not zero to avoid division by zero
-    if (in_min == in_max) {
-        return out_min;  // If input range is zero, return the minimum output value
-    }
-
-    // Clamp the input value to the input range
-    if (value < in_min) {
-        return out_min;  // If value is below in_min, clamp to out_min
-    } else if (value > in_max) {
-        return out_max;  // If value is above in_max, clamp to out_max
-    }
-
-    // Map the value from the input range to the output range
-    float val = out_min + ((value - in_min) / (in_max - in_min)) * (out_max - out_min);
-
-    return val;
-}
+static thread_data telemetry_thread_data;
+static int telemetry_rate_hz = TELEMETRY_DEFAULT_RATE_HZ; // Telemetry packets per second, 0 when off
+
+// Motor state polling, see ext-set-update-rate. Buffers between two polls of the motor by the
+// generator thread, 0 when Lisp supplies the values through the ext-set-* extensions.
+static int update_interval_buffers = 0;
+
+// Output snapshots, see ext-set-snapshot-rate. The generator copies a buffer into snapshot_samples
+// and sets snapshot_ready, the telemetry thread sends it and clears the flag. A buffer that comes
+// due while the previous one is still waiting is skipped, so the generator never waits.
+static int snapshot_interval_buffers = 0; // Buffers between two snapshots, 0 when off
+static int8_t snapshot_samples[BUFFER_LENGTH];
+static SnapshotInfo snapshot_info;
+static bool snapshot_ready = false;
+static uint8_t snapshot_packet[SNAPSHOT_MAX_PACKET_LENGTH]; // Only used by the telemetry thread
+
+// Events for Lisp, see ext-next-event and ext-wait-event. Guarded by state_mutex.
+static Event event_queue[EVENT_QUEUE_LENGTH];
+static int event_queue_start = 0;
+static int event_queue_count = 0;
+static lbm_cid event_waiter = 0;   // Context blocked in ext-wait-event
+static bool event_waiting = false;
+
+// Profile sent by the profile editor, see ProfileCodec.h. It comes after the library, at index
+// GetProfileCount(), and takes its amplitude curves from a library profile. Guarded by state_mutex.
+static InverterProfile custom_profile;
+static bool custom_profile_loaded = false;
+static int custom_base_index = 0;
+static uint8_t profile_reply[PROFILE_MAX_PACKET_LENGTH]; // Only used by the app data handler
+
+// Carrier phase sync with other VESCs over CAN, see CarrierSync.h and ext-set-carrier-sync. The
+// phases are compared when a buffer is handed to the firmware, where every VESC is in step with
+// its sample clock, not when it is generated, which happens up to a few buffers early and with
+// the jitter of a 1 ms poll. The leader sends from the playback thread, the follower measures its
+// error there and the generator turns that into frequency trims.
+//
+// sync_mode and sync_interval_buffers are read atomically, the reference, the measurement and the
+// status are guarded by state_mutex, the loops belong to the generator thread.
+typedef struct {
+    CarrierSyncFrame frame; // Phases before the first sample, carrier and speed range of the buffer
+    float commandHz;
+} BufferPhase;
+
+static int sync_mode = SYNC_MODE_OFF;
+static int sync_interval_buffers = 0; // Buffers between two frames of the leader
+static CarrierSyncFrame sync_reference; // Last frame from the leader
+static uint32_t sync_reference_time = 0; // timer_time_now when it arrived
+static bool sync_reference_valid = false;
+static uint32_t sync_frames = 0; // Frames sent as leader or received as follower
+
+// Everything that belongs to one motor. Dual motor controllers drive two motors from one VESC,
+// and each plays the sound of its own speed: the threads select a motor with
+// mc_select_motor_thread before they poll it or play its samples. The generator and playback
+// threads service all motors in turn, so the motors' buffers of a slot are generated, handed over
+// with one ready flag and played together. The first motor is the one telemetry, snapshots and
+// the carrier sync leader report.
+//
+// The control state is guarded by state_mutex like the globals above. The buffers, the generator
+// and the sync loops belong to the audio threads.
+typedef struct {
+    int number; // Firmware motor number, 1 or 2
+
+    int8_t *buffers[NUM_BUFFERS];  // Array of pointers to buffers allocated on the heap
+    BufferPhase buffer_phases[NUM_BUFFERS]; // Written with the samples, see set_buffer_ready
+    bool buffer_enabled[NUM_BUFFERS]; // Whether the slot is played, likewise. The generator runs
+                                      // ahead, so inverter_enabled may already be a later buffer's.
+    SPWMGenerator generator;
+
+    float amplitude;
+    float speed_kmh;
+    float current_samples[NUM_MOTOR_STAT_SAMPLES]; // Array of last n current values used to average them
+    int active_current_index; // Index of current sample to be replaced
+    float hz_samples[NUM_MOTOR_STAT_SAMPLES]; // Array of last n hz values used to average them
+    int active_hz_index; // Index of current sample to be replaced
+    float rpm_samples[RPM_SAMPLE_COUNT];
+    int active_rpm_index;
+    float speed_samples[RPM_SAMPLE_COUNT];
+    int active_speed_index;
+
+    float inverter_current; // Number of phase amps pushed into the motor from the vesc
+    float inverter_hz; // Current freqency of the inverter in hz
+    int motor_poles; // Number of poles of the motor
+    int inverter_enabled; // Enable or disable the inverter doing stuff
+
+    SpeedRange ActiveSpeedRange; // Currently active speed range that should be used for motor sound generation
+    int active_speed_range_index; // Index of the active speed range in Conf, -1 when disabled
+    RotorState rotor_state;
+    CurveCursor current_curve_cursor; // Cached segments for the active profile's amplitude curves
+    CurveCursor speed_curve_cursor;
+    float command_frequency; // inverter_hz / motor_poles, picked up by the generator
+    float carrier_frequency; // Carrier of the last generated buffer, for status reports
+
+    // Carrier sync of a follower, every motor follows the leader on its own
+    bool sync_reference_new; // Not yet measured against by the playback thread
+    float sync_carrier_error; // Measured by the playback thread, radians
+    float sync_command_error;
+    float sync_carrier_offset; // Leader's carrier frequency minus ours, fed forward
+    uint32_t sync_measure_time;
+    bool sync_measure_new; // Not yet seen by the generator
+    float sync_error; // Carrier phase error the trims were last set from, radians
+    bool sync_locked;
+    CarrierSyncLoop carrier_sync_loop;
+    CarrierSyncLoop command_sync_loop;
+    bool sync_following; // The trims follow a leader
+    uint32_t last_sync_time; // Measurement they were last set from
+
+    // Fades the output in and out, see Envelope.h
+    Envelope envelope; // Belongs to the generator thread
+    bool audio_playing; // The firmware has samples of the motor, set by the playback thread
+
+    // Injection voltage limit, measured by the playback thread before every buffer
+    VoltageLimiter voltage_limiter; // Belongs to the playback thread
+    float voltage_headroom; // Volts the motor control has left
+    float voltage_limit; // Volts the audio may use
+    uint32_t limited_buffers; // Buffers played quieter than the amplitude asked for
+} MotorContext;
+
+static MotorContext motors[MAX_MOTORS];
+static int motor_count = 1; // Motors the audio loop drives, only changed while it is stopped, see ext-set-motor-count
+
+// Stopping with a fade out, see ext-stop-audio-loop. fading_out closes every envelope, the generator
+// ends once they are all idle and sets generator_finished, and playback ends once it has played
+// what the generator left. Playback waits on playback_wake while every motor is idle.
+static bool fading_out = false;
+static bool generator_finished = false;
+static lib_semaphore playback_wake = NULL;
+
+// Injection voltage limit, see VoltageLimit.h and ext-set-voltage-limit. Duty cycle the audio must
+// not push the modulation past, 0 when off. Guarded by state_mutex.
+static float voltage_limit_max_duty = VOLTAGE_LIMIT_DEFAULT_MAX_DUTY;
 
 
 // Function to update the rotor state based on the last n RPM values
-static void update_rotor_state(float current_rpm) {
+static void update_rotor_state(MotorContext* motor, float current_rpm) {
     // Store the current RPM in the samples array
-    rpm_samples[active_rpm_index] = current_rpm;
-    active_rpm_index = (active_rpm_index + 1) % RPM_SAMPLE_COUNT;
+    motor->rpm_samples[motor->active_rpm_index] = current_rpm;
+    motor->active_rpm_index = (motor->active_rpm_index + 1) % RPM_SAMPLE_COUNT;
 
     // Calculate the average RPM over the last n samples
     float total_rpm = 0;
     for (int i = 0; i < RPM_SAMPLE_COUNT; i++) {
-        total_rpm += rpm_samples[i];
+        total_rpm += motor->rpm_samples[i];
     }
     float average_rpm = total_rpm / RPM_SAMPLE_COUNT;
 
@@ -125,139 +232,637 @@ static void update_rotor_state(float current_rpm) {
     }
     // VESC_IF->printf("avg: %.1f, absval: %.1f.\n", average_rpm, abs_rpm_val);
     if (abs_rpm_val <= COASTING_RPM_THRESHOLD) {
-        rotor_state = ROTOR_STATE_COASTING;
+        motor->rotor_state = ROTOR_STATE_COASTING;
     } else if (current_rpm > average_rpm) {
-        rotor_state = ROTOR_STATE_ACCELERATING;
+        motor->rotor_state = ROTOR_STATE_ACCELERATING;
     } else {
-        rotor_state = ROTOR_STATE_DECELERATING;
+        motor->rotor_state = ROTOR_STATE_DECELERATING;
+    }
+}
+
+
+// SPWM configuration of the active speed range for the current rotor state
+static const SPWMConfig* active_spwm_config(const MotorContext* motor) {
+    switch (motor->rotor_state) {
+        case ROTOR_STATE_COASTING:
+            return &motor->ActiveSpeedRange.spwm.coasting;
+        case ROTOR_STATE_DECELERATING:
+            return &motor->ActiveSpeedRange.spwm.deceleration;
+        default:
+            return &motor->ActiveSpeedRange.spwm.acceleration;
+    }
+}
+
+// Motor context for the optional motor argument of an extension at args[index], the first motor
+// when it is left out. NULL when it is not one of the motors the audio loop drives.
+static MotorContext* motor_argument(lbm_value *args, lbm_uint argn, lbm_uint index) {
+    if (argn <= index) {
+        return &motors[0];
+    }
+    if (!VESC_IF->lbm_is_number(args[index])) {
+        return NULL;
+    }
+
+    int number = VESC_IF->lbm_dec_as_i32(args[index]);
+    int count = __atomic_load_n(&motor_count, __ATOMIC_RELAXED);
+    if (number < 1 || number > count) {
+        VESC_IF->printf("Motor must be between 1 and %d.\n", count);
+        return NULL;
+    }
+    return &motors[number - 1];
+}
+
+// Points the mc_* and foc_* calls of the calling thread at the motor. Firmware without
+// mc_select_motor_thread only drives one motor, see ext-set-motor-count.
+static void select_motor(const MotorContext* motor) {
+    if (VESC_IF->mc_select_motor_thread) {
+        VESC_IF->mc_select_motor_thread(motor->number);
     }
 }
 
 
-static void update_spwm_settings() {
+// Wakes the context blocked in ext-wait-event once there is an event for it, call with
+// state_mutex held. Unblocking fails while the context is still on its way into the blocked
+// queue, so the generator and telemetry threads call this again until it succeeds.
+static void wake_event_waiter(void) {
+    if (event_waiting && event_queue_count > 0 &&
+        VESC_IF->lbm_unblock_ctx_unboxed(event_waiter, VESC_IF->lbm_enc_sym_true)) {
+        event_waiting = false;
+    }
+}
+
+// Adds an event with the motor's speed and the underrun count, call with state_mutex held. The
+// events of all motors go into the same log.
+static void log_event(const MotorContext* motor, EventType type, int from, int to) {
+    EventLog_Add(&event_log, type, from, to, motor->speed_kmh, profiler.underruns);
+
+    // Same event for Lisp, the oldest one is dropped when nobody picks them up
+    if (event_queue_count == EVENT_QUEUE_LENGTH) {
+        event_queue_start = (event_queue_start + 1) % EVENT_QUEUE_LENGTH;
+        event_queue_count--;
+    }
+    Event* event = &event_queue[(event_queue_start + event_queue_count) % EVENT_QUEUE_LENGTH];
+    event->type = (uint8_t)type;
+    event->from = (int8_t)from;
+    event->to = (int8_t)to;
+    event->speed = (int16_t)(motor->speed_kmh * 100.0f);
+    event_queue_count++;
+    wake_event_waiter();
+}
+
+// A follower uses the leader's speed range while its frames keep coming, so all motors switch
+// at once even when their speeds differ a little. Call with state_mutex held.
+static bool follows_leader_range(void) {
+    return __atomic_load_n(&sync_mode, __ATOMIC_RELAXED) == SYNC_MODE_FOLLOWER && sync_reference_valid &&
+           sync_reference.rangeIndex < Conf->speedRangeCount &&
+           VESC_IF->timer_seconds_elapsed_since(sync_reference_time) < CARRIER_SYNC_TIMEOUT_S;
+}
+
+// Call with state_mutex held
+static void update_spwm_settings(MotorContext* motor) {
+    int previous_range_index = motor->active_speed_range_index;
+    RotorState previous_rotor_state = motor->rotor_state;
+    SPWMType previous_spwm_type = active_spwm_config(motor)->type;
+
     // Calculate current speed
     // float CurrentSpeed_KMH = (inverter_hz / (float)motor_poles) * Conf.rpmToSpeedRatio;
 
     // Update the rotor state based on the current RPM
-    update_rotor_state(inverter_hz / (float)motor_poles);
-
-    // Define amplitude based on current, speed
-    amplitude = map_value(inverter_current, min_current, max_current, min_sound_voltage, max_sound_voltage);
-    float AmplitudeScaleFactor = map_value(
-        speed_kmh, 
-        INVERTER_AMPLITUDE_SPEED_RAMP_START_KMH,
-        INVERTER_AMPLITUDE_SPEED_RAMP_END_KMH,
-        INVERTER_AMPLITUDE_SPEED_SCALAR_START,
-        INVERTER_AMPLITUDE_SPEED_SCALAR_END
-    );
-    amplitude += INVERTER_AMPLITUDE_BASE;
-    // VESC_IF->printf("Amplitude Scale Value: %.1f.\n", AmplitudeScaleFactor);
-    amplitude = amplitude * AmplitudeScaleFactor;
+    update_rotor_state(motor, motor->inverter_hz / (float)motor->motor_poles);
 
-    // Get the active speed range
-    ActiveSpeedRange = GetSpeedRangeAtSpeed(&Conf, speed_kmh, inverter_current);
-
-    // Select the appropriate SPWM configuration based on the rotor state
-    SPWMConfig* spwm_config = NULL;
-    switch (rotor_state) {
+    // Define amplitude based on current, speed using the curves for the current rotor state
+    const AmplitudeConfig* amplitude_config = &Conf->amplitude.acceleration;
+    switch (motor->rotor_state) {
         case ROTOR_STATE_ACCELERATING:
-            spwm_config = &ActiveSpeedRange.spwm.acceleration;
+            amplitude_config = &Conf->amplitude.acceleration;
             break;
         case ROTOR_STATE_COASTING:
-            spwm_config = &ActiveSpeedRange.spwm.coasting;
+            amplitude_config = &Conf->amplitude.coasting;
             break;
         case ROTOR_STATE_DECELERATING:
-            spwm_config = &ActiveSpeedRange.spwm.deceleration;
+            amplitude_config = &Conf->amplitude.deceleration;
             break;
     }
+    motor->amplitude = Curve_Evaluate(&amplitude_config->current, &motor->current_curve_cursor, motor->inverter_current);
+    float AmplitudeScaleFactor = Curve_Evaluate(&amplitude_config->speed, &motor->speed_curve_cursor, motor->speed_kmh);
+    // VESC_IF->printf("Amplitude Scale Value: %.1f.\n", AmplitudeScaleFactor);
+    motor->amplitude = motor->amplitude * AmplitudeScaleFactor;
 
-    // Update the generator with the selected SPWM configuration
-    if (spwm_config) {
-        generator.CarrierFrequency = spwm_config->carrierFrequencyStart;
-        generator.CommandFrequency = (inverter_hz / (float)motor_poles);
-        generator.ModulationIndex = 1.0f; // Adjust as needed
+    // Get the active speed range
+    motor->active_speed_range_index = GetSpeedRangeIndexAtSpeed(Conf, motor->speed_kmh, motor->inverter_current);
+    if (follows_leader_range()) {
+        motor->active_speed_range_index = sync_reference.rangeIndex;
+    }
+    motor->ActiveSpeedRange = GetSpeedRangeByIndex(Conf, motor->active_speed_range_index);
+
+    // Select the appropriate SPWM configuration based on the rotor state
+    const SPWMConfig* spwm_config = active_spwm_config(motor);
+
+    // The generator picks these up before its next buffer, it owns the generator struct
+    motor->carrier_frequency = spwm_config->carrierFrequencyStart;
+    motor->command_frequency = (motor->inverter_hz / (float)motor->motor_poles);
+
+    if (motor->active_speed_range_index != previous_range_index) {
+        log_event(motor, EVENT_SPEED_RANGE, previous_range_index, motor->active_speed_range_index);
+    }
+    if (motor->rotor_state != previous_rotor_state) {
+        log_event(motor, EVENT_ROTOR_STATE, previous_rotor_state, motor->rotor_state);
+    }
+    if (spwm_config->type != previous_spwm_type) {
+        log_event(motor, EVENT_SPWM_MODE, previous_spwm_type, spwm_config->type);
     }
 }
 
 
-// Generator loop function
+// Adds a value to a moving average over the last NUM_MOTOR_STAT_SAMPLES values and returns the average
+static float add_motor_sample(float* samples, int* index, float value) {
+	// Update array of samples with new value, update current value pointer
+	samples[*index] = value;
+	*index = (*index + 1) % NUM_MOTOR_STAT_SAMPLES;
+
+	// Now calculate average over the array
+	float total = 0;
+	for (unsigned int i = 0; i < NUM_MOTOR_STAT_SAMPLES; i++) {
+		total += samples[i];
+	}
+	return total / NUM_MOTOR_STAT_SAMPLES;
+}
+
+// Reads the motor state and updates the settings once, what Lisp/Main.lisp used to do with four
+// extension calls every 20 ms. Called from the generator thread, see ext-set-update-rate.
+static void poll_motor_state(MotorContext* motor) {
+	select_motor(motor);
+	float current = VESC_IF->mc_get_tot_current();
+	if (current < 0) {
+		current = -current;
+	}
+	float rpm = VESC_IF->mc_get_rpm();
+	float speed = VESC_IF->mc_get_speed() * 3.6f; // m/s to km/h
+	int poles = VESC_IF->get_cfg_int(CFG_PARAM_si_motor_poles);
+
+	VESC_IF->mutex_lock(state_mutex);
+	motor->inverter_current = add_motor_sample(motor->current_samples, &motor->active_current_index, current);
+	motor->inverter_hz = add_motor_sample(motor->hz_samples, &motor->active_hz_index, rpm);
+	motor->speed_kmh = add_motor_sample(motor->speed_samples, &motor->active_speed_index, speed);
+	motor->motor_poles = poles;
+	update_spwm_settings(motor);
+	VESC_IF->mutex_unlock(state_mutex);
+}
+
+
+// The ready flags hand a buffer from one thread to the other. Release and acquire make sure the
+// samples are written before the flag is seen set, and read before it is seen cleared.
+static bool buffer_is_ready(int index) {
+    return __atomic_load_n(&buffer_ready_for_consumption[index], __ATOMIC_ACQUIRE);
+}
+
+static void set_buffer_ready(int index, bool ready) {
+    __atomic_store_n(&buffer_ready_for_consumption[index], ready, __ATOMIC_RELEASE);
+}
+
+// Carrier sync for the buffer that is about to be played, from the playback thread. The leader
+// sends the phases of its first motor every sync_interval_buffers buffers, the follower measures
+// each motor against a new frame of the leader, moved on by the time since it arrived.
+static void sync_buffer_played(MotorContext* motor, int mode, const BufferPhase* played, bool enabled,
+                               const CarrierSyncFrame* reference, uint32_t reference_time) {
+    static int buffers_since_sync = 0;
+    static uint8_t sequence = 0;
+
+    if (mode == SYNC_MODE_LEADER && motor == &motors[0]) {
+        if (++buffers_since_sync < __atomic_load_n(&sync_interval_buffers, __ATOMIC_RELAXED)) {
+            return;
+        }
+        buffers_since_sync = 0;
+
+        CarrierSyncFrame frame = played->frame;
+        frame.sequence = sequence++;
+        if (!enabled) {
+            frame.rangeIndex = -1;
+            frame.carrierHz = 0.0f;
+        }
+        uint8_t data[CARRIER_SYNC_FRAME_LENGTH];
+        CarrierSync_Encode(&frame, data);
+        VESC_IF->can_transmit_eid(CARRIER_SYNC_CAN_ID, data, CARRIER_SYNC_FRAME_LENGTH);
+
+        VESC_IF->mutex_lock(state_mutex);
+        sync_frames++;
+        VESC_IF->mutex_unlock(state_mutex);
+    } else if (mode == SYNC_MODE_FOLLOWER && reference && enabled) {
+        float age = VESC_IF->timer_seconds_elapsed_since(reference_time);
+        float carrier = CarrierSync_Extrapolate(reference->carrierPhase, reference->carrierHz, age);
+        float command = CarrierSync_Extrapolate(reference->commandPhase, played->commandHz, age);
+
+        VESC_IF->mutex_lock(state_mutex);
+        motor->sync_carrier_error = CarrierSync_PhaseError(carrier, played->frame.carrierPhase);
+        motor->sync_command_error = CarrierSync_PhaseError(command, played->frame.commandPhase);
+        motor->sync_carrier_offset = reference->carrierHz - played->frame.carrierHz;
+        motor->sync_measure_time = VESC_IF->timer_time_now();
+        motor->sync_measure_new = true;
+        VESC_IF->mutex_unlock(state_mutex);
+    }
+}
+
+static void release_sync(MotorContext* motor) {
+    CarrierSync_ResetLoop(&motor->carrier_sync_loop);
+    CarrierSync_ResetLoop(&motor->command_sync_loop);
+    motor->generator.CarrierFrequencyTrim = 0.0f;
+    motor->generator.CommandFrequencyTrim = 0.0f;
+    motor->sync_following = false;
+}
+
+// Fills the motor's buffer in slot index, from the generator thread. Returns whether the output
+// is enabled, adds the generation time to generation_us and sets voltage to the amplitude.
+static int generate_buffer(MotorContext* motor, int index, int mode, float* generation_us, float* voltage) {
+    SPWMGenerator* generator = &motor->generator;
+
+    // Copy the control state for this buffer, the extensions can change it while we generate
+    VESC_IF->mutex_lock(state_mutex);
+    SpeedRange speed_range = motor->ActiveSpeedRange;
+    RotorState state = motor->rotor_state;
+    float hz = motor->inverter_hz;
+    int poles = motor->motor_poles;
+    float speed = motor->speed_kmh;
+    int range_index = motor->active_speed_range_index;
+    generator->CommandFrequency = motor->command_frequency;
+    SPWMType spwm_type = active_spwm_config(motor)->type;
+    bool measure_new = motor->sync_measure_new;
+    float carrier_error = motor->sync_carrier_error;
+    float command_error = motor->sync_command_error;
+    float carrier_offset = motor->sync_carrier_offset;
+    uint32_t measure_time = motor->sync_measure_time;
+    motor->sync_measure_new = false;
+    VESC_IF->mutex_unlock(state_mutex);
+
+    // Follow the leader's phase. The random carrier has none worth following, and the trims
+    // are dropped when the frames stop, so the carrier runs free again.
+    bool followable = mode == SYNC_MODE_FOLLOWER && spwm_type != SPWM_TYPE_NONE && spwm_type != SPWM_TYPE_RSPWM;
+    if (followable && measure_new) {
+        // Spread the correction over the time until the next measurement, as long as the last one took
+        float interval = 1.0f / (float)CARRIER_SYNC_DEFAULT_RATE_HZ;
+        if (motor->sync_following) {
+            interval = VESC_IF->timer_seconds_elapsed_since(motor->last_sync_time) -
+                       VESC_IF->timer_seconds_elapsed_since(measure_time);
+            if (interval < 1.0f / (float)CARRIER_SYNC_MAX_RATE_HZ) {
+                interval = 1.0f / (float)CARRIER_SYNC_MAX_RATE_HZ;
+            }
+        }
+        generator->CarrierFrequencyTrim = carrier_offset + CarrierSync_UpdateLoop(&motor->carrier_sync_loop, carrier_error, interval);
+        generator->CommandFrequencyTrim = CarrierSync_UpdateLoop(&motor->command_sync_loop, command_error, interval);
+        motor->last_sync_time = measure_time;
+        motor->sync_following = true;
+    } else if (motor->sync_following && (!followable ||
+               VESC_IF->timer_seconds_elapsed_since(motor->last_sync_time) >= CARRIER_SYNC_TIMEOUT_S)) {
+        release_sync(motor);
+    }
+    bool following = motor->sync_following;
+
+    // Generate SPWM samples through the envelope. Once it has faded out there is nothing to generate,
+    // and the buffer is not played.
+    BufferPhase* phase = &motor->buffer_phases[index];
+    phase->frame.carrierPhase = generator->CarrierPhase;
+    phase->frame.commandPhase = generator->CommandPhase;
+    bool output = SPWMGenerator_IsOutputEnabled(&speed_range);
+    Envelope_SetGate(&motor->envelope, output && !__atomic_load_n(&fading_out, __ATOMIC_RELAXED));
+    int enabled = !Envelope_IsIdle(&motor->envelope);
+    motor->buffer_enabled[index] = enabled;
+    if (enabled) {
+        uint32_t generation_start = VESC_IF->timer_time_now();
+        if (output) {
+            SPWMGenerator_GenerateSamples(generator, state, motor->buffers[index], BUFFER_LENGTH, &speed_range, hz, poles, speed);
+        } else {
+            // The range has no output any more, fade out what played last
+            SPWMGenerator_ContinueSamples(generator, motor->buffers[index], BUFFER_LENGTH);
+        }
+        Envelope_Apply(&motor->envelope, motor->buffers[index], BUFFER_LENGTH);
+        *generation_us += VESC_IF->timer_seconds_elapsed_since(generation_start) * 1000000.0f;
+    }
+    phase->frame.carrierHz = generator->CarrierFrequency;
+    phase->frame.rangeIndex = range_index;
+    phase->commandHz = generator->CommandFrequency;
+
+    VESC_IF->mutex_lock(state_mutex);
+    if (mode == SYNC_MODE_FOLLOWER) {
+        motor->sync_error = following ? carrier_error : 0.0f;
+        motor->sync_locked = following && carrier_error < CARRIER_SYNC_LOCK_RAD && carrier_error > -CARRIER_SYNC_LOCK_RAD;
+    }
+    int was_enabled = motor->inverter_enabled;
+    motor->inverter_enabled = enabled;
+    if (enabled) {
+        motor->carrier_frequency = generator->CarrierFrequency;
+    }
+    if ((enabled != 0) != (was_enabled != 0)) {
+        log_event(motor, EVENT_OUTPUT, was_enabled != 0, enabled != 0);
+    }
+    wake_event_waiter();
+    *voltage = motor->amplitude;
+    VESC_IF->mutex_unlock(state_mutex);
+
+    return enabled;
+}
+
+// Generator loop function, fills the buffer slots of all motors
 static void generator_loop(void *arg) {
     (void)arg;
 
-    SPWMGenerator_Init(&generator);
+    int count = __atomic_load_n(&motor_count, __ATOMIC_RELAXED);
+    for (int i = 0; i < count; i++) {
+        SPWMGenerator_Init(&motors[i].generator);
+        Envelope_Init(&motors[i].envelope, sample_rate);
+        release_sync(&motors[i]);
+    }
+    int buffers_since_update = 0;
+    int buffers_since_snapshot = 0;
+    bool idling = false; // The last buffer handed to playback left every motor idle
 
-    while (generator_thread_data.running) {
+    while (!VESC_IF->should_terminate()) {
         // Wait until the current buffer is ready to be written to
-        while (buffer_ready_for_consumption[producer_index] && generator_thread_data.running) {
+        while (buffer_is_ready(producer_index) && !VESC_IF->should_terminate()) {
             VESC_IF->sleep_ms(1);
         }
 
-        if (!generator_thread_data.running) break;
+        if (VESC_IF->should_terminate()) break;
+
+        // Poll the motors when the library owns the update cadence
+        int update_interval = __atomic_load_n(&update_interval_buffers, __ATOMIC_RELAXED);
+        if (update_interval > 0 && ++buffers_since_update >= update_interval) {
+            buffers_since_update = 0;
+            for (int i = 0; i < count; i++) {
+                poll_motor_state(&motors[i]);
+            }
+        }
+
+        int mode = __atomic_load_n(&sync_mode, __ATOMIC_RELAXED);
+        float generation_us = 0.0f;
+        float voltage = 0.0f;
+        int enabled = 0;
+        bool idle = true;
+        for (int i = count - 1; i >= 0; i--) { // Ends on the first motor, whose buffer the snapshots show
+            enabled = generate_buffer(&motors[i], producer_index, mode, &generation_us, &voltage);
+            idle = idle && !enabled;
+        }
 
-        // Generate SPWM samples
-        inverter_enabled = SPWMGenerator_GenerateSamples(&generator, rotor_state, buffers[producer_index], BUFFER_LENGTH, &ActiveSpeedRange, inverter_hz, motor_poles, speed_kmh);
+        // Playback is parked after the first idle buffer and nothing has to be generated until a
+        // gate opens, so check the gates at the motor update rate instead of every buffer
+        bool stopping = __atomic_load_n(&fading_out, __ATOMIC_RELAXED);
+        if (idle && idling && !stopping) {
+            int idle_ms = ENVELOPE_IDLE_CHECK_MS;
+            if (update_interval > 0) {
+                idle_ms = (int)((float)(update_interval * BUFFER_LENGTH) / sample_rate * 1000.0f);
+                buffers_since_update = update_interval; // Poll again after the sleep
+            }
+            VESC_IF->sleep_ms(idle_ms > 0 ? idle_ms : 1);
+            continue;
+        }
 
-        // Mark the buffer as ready for consumption
-        buffer_ready_for_consumption[producer_index] = true;
+        VESC_IF->mutex_lock(state_mutex);
+        Profiler_AddGeneration(&profiler, generation_us);
+        VESC_IF->mutex_unlock(state_mutex);
+
+        // Hand a copy of the first motor's buffer to the telemetry thread, unless it still has the previous one
+        int snapshot_interval = __atomic_load_n(&snapshot_interval_buffers, __ATOMIC_RELAXED);
+        if (snapshot_interval > 0 && ++buffers_since_snapshot >= snapshot_interval &&
+            !__atomic_load_n(&snapshot_ready, __ATOMIC_ACQUIRE)) {
+            buffers_since_snapshot = 0;
+            if (enabled) {
+                memcpy(snapshot_samples, motors[0].buffers[producer_index], BUFFER_LENGTH);
+            } else {
+                memset(snapshot_samples, 0, BUFFER_LENGTH); // Idle buffers are not written
+            }
+            snapshot_info.sequence = (uint16_t)(samples_generated / BUFFER_LENGTH);
+            snapshot_info.sampleRate = sample_rate;
+            snapshot_info.carrierHz = enabled ? motors[0].generator.CarrierFrequency : 0.0f;
+            snapshot_info.amplitude = voltage;
+            snapshot_info.enabled = enabled != 0;
+            __atomic_store_n(&snapshot_ready, true, __ATOMIC_RELEASE);
+        }
+
+        // Mark the buffer as ready for consumption, and wake playback if it is parked
+        buffer_ready_time[producer_index] = VESC_IF->timer_time_now();
+        set_buffer_ready(producer_index, true);
+        if (idling) {
+            VESC_IF->sem_signal(playback_wake);
+        }
+        idling = idle;
 
         // Update statistics
-        samples_generated += BUFFER_LENGTH;
+        __atomic_store_n(&samples_generated, samples_generated + BUFFER_LENGTH, __ATOMIC_RELAXED);
 
-        // Move to the next buffer
-        producer_index = (producer_index + 1) % NUM_BUFFERS;
+        // Move to the next buffer, playback reads the index for the underrun events
+        __atomic_store_n(&producer_index, (producer_index + 1) % NUM_BUFFERS, __ATOMIC_RELAXED);
+
+        // The fade out has ended, playback ends after this buffer
+        if (idle && stopping) break;
     }
 
+    __atomic_store_n(&generator_finished, true, __ATOMIC_RELEASE);
+    VESC_IF->sem_signal(playback_wake);
     VESC_IF->printf("Generator loop thread terminated.\n");
 }
 
-// Playback loop function
+// Ends the audio of the selected motor in the firmware
+static void stop_motor_audio(MotorContext* motor) {
+    if (VESC_IF->foc_stop_audio) {
+        VESC_IF->foc_stop_audio(true);
+    }
+    __atomic_store_n(&motor->audio_playing, false, __ATOMIC_RELAXED);
+}
+
+// Playback loop function, plays the buffer slots of all motors
 static void playback_loop(void *arg) {
     (void)arg;
 
-    while (playback_thread_data.running) {
-        // Wait until the current buffer is ready for consumption
-        while (!buffer_ready_for_consumption[consumer_index] && playback_thread_data.running) {
-            VESC_IF->sleep_ms(1);  // Sleep briefly to avoid busy-waiting
+    int count = __atomic_load_n(&motor_count, __ATOMIC_RELAXED);
+    uint32_t last_consume_time = 0;
+    float buffer_period = (float)BUFFER_LENGTH / sample_rate;
+    for (int i = 0; i < count; i++) {
+        VoltageLimit_Reset(&motors[i].voltage_limiter);
+    }
+    bool parked = false; // The last buffer left every motor idle, see generator_loop
+
+    while (!VESC_IF->should_terminate()) {
+        // Every buffer playback has to wait for once it is running is an underrun
+        if (!buffer_is_ready(consumer_index) && !parked && !__atomic_load_n(&generator_finished, __ATOMIC_ACQUIRE)) {
+            VESC_IF->mutex_lock(state_mutex);
+            if (profiler.buffersPlayed > 0) {
+                Profiler_AddUnderrun(&profiler);
+                log_event(&motors[0], EVENT_UNDERRUN, consumer_index, __atomic_load_n(&producer_index, __ATOMIC_RELAXED));
+            }
+            VESC_IF->mutex_unlock(state_mutex);
+        }
 
-            // If we're not just booting up, the buffer should be full. If it isn't log errors.
-            if (VESC_IF->system_time() > 1) {
-                VESC_IF->printf("[ERROR] Playback Thread Starved For Sample Buffers!\n");
+        if (parked) {
+            // Nothing to play until a gate opens, the generator signals the buffer after that
+            while (!buffer_is_ready(consumer_index) && !__atomic_load_n(&generator_finished, __ATOMIC_ACQUIRE)) {
+                VESC_IF->sem_wait(playback_wake);
+            }
+        } else {
+            // Wait until the current buffer is ready for consumption
+            while (!buffer_is_ready(consumer_index) && !__atomic_load_n(&generator_finished, __ATOMIC_ACQUIRE) &&
+                   !VESC_IF->should_terminate()) {
+                VESC_IF->sleep_ms(1);  // Sleep briefly to avoid busy-waiting
+
+                // If we're not just booting up, the buffer should be full. If it isn't log errors.
+                if (VESC_IF->system_time() > 1) {
+                    VESC_IF->printf("[ERROR] Playback Thread Starved For Sample Buffers!\n");
+                }
             }
         }
 
-        if (!playback_thread_data.running) {
+        // Ends once the generator has finished and everything it left is played
+        if (VESC_IF->should_terminate() || !buffer_is_ready(consumer_index)) {
             break;
         }
 
-        // Play the samples from the current buffer
-        if (inverter_enabled) {
-            VESC_IF->foc_play_audio_samples(buffers[consumer_index], BUFFER_LENGTH, sample_rate, amplitude);
+        // Lead is how far ahead of playback the generator is, the interval between pickups shows the jitter
+        float lead_us = VESC_IF->timer_seconds_elapsed_since(buffer_ready_time[consumer_index]) * 1000000.0f;
+        float interval_us = VESC_IF->timer_seconds_elapsed_since(last_consume_time) * 1000000.0f;
+        uint32_t consume_time = VESC_IF->timer_time_now();
+        last_consume_time = consume_time;
+        VESC_IF->mutex_lock(state_mutex);
+        Profiler_AddConsumed(&profiler, lead_us, profiler.buffersPlayed > 0 && !parked ? interval_us : -1.0f);
+        VESC_IF->mutex_unlock(state_mutex);
+        parked = true;
+
+        for (int i = 0; i < count; i++) {
+            MotorContext* motor = &motors[i];
+
+            // The motor control's share of the voltage right before the buffer goes out
+            select_motor(motor);
+            float duty = VESC_IF->mc_get_duty_cycle_now();
+            float input_voltage = VESC_IF->mc_get_input_voltage_filtered();
+
+            bool enabled = motor->buffer_enabled[consumer_index];
+            VESC_IF->mutex_lock(state_mutex);
+            float voltage = motor->amplitude;
+            if (voltage_limit_max_duty > 0.0f) {
+                motor->voltage_headroom = VoltageLimit_Headroom(duty, input_voltage, voltage_limit_max_duty);
+                motor->voltage_limit = VoltageLimit_Update(&motor->voltage_limiter, motor->voltage_headroom, buffer_period);
+                if (voltage > motor->voltage_limit) {
+                    voltage = motor->voltage_limit;
+                    motor->limited_buffers += enabled ? 1 : 0;
+                }
+            }
+            int mode = __atomic_load_n(&sync_mode, __ATOMIC_RELAXED);
+            bool sync_new = motor->sync_reference_new;
+            CarrierSyncFrame reference = sync_reference;
+            uint32_t reference_time = sync_reference_time;
+            motor->sync_reference_new = false;
+            VESC_IF->mutex_unlock(state_mutex);
+
+            if (mode != SYNC_MODE_OFF) {
+                sync_buffer_played(motor, mode, &motor->buffer_phases[consumer_index], enabled,
+                                   sync_new ? &reference : NULL, reference_time);
+            }
+
+            // Play the samples from the current buffer
+            parked = parked && !enabled;
+            if (enabled) {
+                uint32_t play_time = VESC_IF->timer_time_now();
+                VESC_IF->foc_play_audio_samples(motor->buffers[consumer_index], BUFFER_LENGTH, sample_rate, voltage);
+                float play_us = VESC_IF->timer_seconds_elapsed_since(play_time) * 1000000.0f;
+                VESC_IF->mutex_lock(state_mutex);
+                Profiler_AddPlayCall(&profiler, play_us);
+                VESC_IF->mutex_unlock(state_mutex);
+                __atomic_store_n(&motor->audio_playing, true, __ATOMIC_RELAXED);
+            } else if (motor->audio_playing) {
+                // The envelope has faded out, the firmware can let go of the audio
+                stop_motor_audio(motor);
+            }
         }
-        samples_consumed += BUFFER_LENGTH;
+        __atomic_store_n(&samples_consumed, samples_consumed + BUFFER_LENGTH, __ATOMIC_RELAXED);
 
         // TEMPORARY FIX!!!!!
         // -- THIS SHOULD NOT BE NEEDED -- THE PLAY AUDIO SAMPLES CODE SHOULD BLOCK BUT IT DOESNT!
-        float sleep_time = (float)BUFFER_LENGTH / sample_rate * 1000.0f * 1000.0f;
+        float sleep_time = buffer_period * 1000.0f * 1000.0f;
         VESC_IF->sleep_us((uint32_t)sleep_time);
 
         // Mark the buffer as consumed
-        buffer_ready_for_consumption[consumer_index] = false;
+        set_buffer_ready(consumer_index, false);
 
         // Move to the next buffer in a circular manner
         consumer_index = (consumer_index + 1) % NUM_BUFFERS;
     }
 
+    // Cut off when the loop was stopped without a fade out
+    for (int i = 0; i < count; i++) {
+        if (motors[i].audio_playing) {
+            select_motor(&motors[i]);
+            stop_motor_audio(&motors[i]);
+        }
+    }
+
     VESC_IF->printf("Playback loop thread terminated.\n");
 }
 
+// Telemetry loop function, pushes the status packet to VESC Tool, see Telemetry.h
+static void telemetry_loop(void *arg) {
+    (void)arg;
+
+    uint8_t packet[TELEMETRY_PACKET_LENGTH];
+    uint32_t last_wakeup = VESC_IF->timer_time_now();
+    float status_due_s = 1.0f; // Time since the last status packet was due, the first one goes out right away
+
+    while (!VESC_IF->should_terminate()) {
+        // The status of the first motor
+        const MotorContext* motor = &motors[0];
+        TelemetryStatus status;
+        VESC_IF->mutex_lock(state_mutex);
+        int rate_hz = telemetry_rate_hz;
+        status.speedKmh = motor->speed_kmh;
+        status.rangeIndex = motor->active_speed_range_index;
+        status.rotorState = motor->rotor_state;
+        status.spwmType = active_spwm_config(motor)->type;
+        status.enabled = motor->inverter_enabled;
+        status.carrierHz = motor->carrier_frequency;
+        status.amplitude = motor->amplitude;
+        status.underruns = profiler.underruns;
+        wake_event_waiter();
+        VESC_IF->mutex_unlock(state_mutex);
+
+        // Wake up often enough for both the status packets and the snapshots
+        int period_ms = rate_hz > 0 ? 1000 / rate_hz : 100;
+        int snapshot_interval = __atomic_load_n(&snapshot_interval_buffers, __ATOMIC_RELAXED);
+        if (snapshot_interval > 0) {
+            int snapshot_period_ms = (int)((float)(snapshot_interval * BUFFER_LENGTH) / sample_rate * 1000.0f);
+            if (snapshot_period_ms < period_ms) {
+                period_ms = snapshot_period_ms > 0 ? snapshot_period_ms : 1;
+            }
+        }
+
+        // Keeps the average status rate exact when the wake ups are set by the snapshots
+        status_due_s += VESC_IF->timer_seconds_elapsed_since(last_wakeup);
+        last_wakeup = VESC_IF->timer_time_now();
+        float status_period_s = rate_hz > 0 ? 1.0f / (float)rate_hz : 0.0f;
+        if (rate_hz > 0 && status_due_s >= status_period_s * 0.99f) {
+            status_due_s -= status_period_s;
+            if (status_due_s > status_period_s) {
+                status_due_s = 0.0f;
+            }
+            Telemetry_Encode(&status, packet);
+            VESC_IF->send_app_data(packet, TELEMETRY_PACKET_LENGTH);
+        }
+
+        if (__atomic_load_n(&snapshot_ready, __ATOMIC_ACQUIRE)) {
+            int length = Snapshot_Encode(&snapshot_info, snapshot_samples, BUFFER_LENGTH, snapshot_packet);
+            __atomic_store_n(&snapshot_ready, false, __ATOMIC_RELEASE);
+            VESC_IF->send_app_data(snapshot_packet, length);
+        }
+
+        VESC_IF->sleep_ms(period_ms);
+    }
+}
+
+// Call with state_mutex held
 static void print_stats(void) {
     float current_time = VESC_IF->system_time();
     if (current_time - last_time >= 1.0f) {
         // Calculate samples generated and consumed per second
-        uint32_t samples_per_second = samples_generated - last_samples_generated;
-        uint32_t samples_consumed_per_second = samples_consumed - last_samples_comsumed;
-        last_samples_generated = samples_generated;
-        last_samples_comsumed = samples_consumed;
+        uint32_t generated = __atomic_load_n(&samples_generated, __ATOMIC_RELAXED);
+        uint32_t consumed = __atomic_load_n(&samples_consumed, __ATOMIC_RELAXED);
+        uint32_t samples_per_second = generated - last_samples_generated;
+        uint32_t samples_consumed_per_second = consumed - last_samples_comsumed;
+        last_samples_generated = generated;
+        last_samples_comsumed = consumed;
         last_time = current_time;
 
         // Calculate actual sample rates
@@ -274,193 +879,279 @@ static void print_stats(void) {
         VESC_IF->printf("(Generated samples/s: %.1f) (Consumed samples/s: %.1f)\n",
                         (double)actual_sample_rate, (double)sample_consume_rate);
 
-        // Calculate the current speed in km/h
-        // float current_speed_kmh = inverter_hz / (float)motor_poles * Conf.rpmToSpeedRatio;
-
-        // Print the current speed and active speed range
-        VESC_IF->printf("Current Speed: %.1f km/h\n", (double)speed_kmh);
-        VESC_IF->printf("Active Speed Range: %f km/h to %f km/h\n",
-                        (double)ActiveSpeedRange.minSpeed, (double)ActiveSpeedRange.maxSpeed);
-
-        // Print the rotor state
-        const char* rotor_state_str = "Unknown";
-        switch (rotor_state) {
-            case ROTOR_STATE_ACCELERATING:
-                rotor_state_str = "Accelerating";
-                break;
-            case ROTOR_STATE_COASTING:
-                rotor_state_str = "Coasting";
-                break;
-            case ROTOR_STATE_DECELERATING:
-                rotor_state_str = "Decelerating";
-                break;
-        }
-        VESC_IF->printf("Rotor State: %s\n", rotor_state_str);
-
-        // Print SPWM mode and carrier frequency
-        const char* spwm_mode_str = "Unknown";
-        SPWMConfig ActiveSPWM = ActiveSpeedRange.spwm.acceleration;
-        switch (rotor_state) {
-            case ROTOR_STATE_ACCELERATING:
-                ActiveSPWM = ActiveSpeedRange.spwm.acceleration;
-                break;
-            case ROTOR_STATE_COASTING:
-                ActiveSPWM = ActiveSpeedRange.spwm.coasting;
-                break;
-            case ROTOR_STATE_DECELERATING:
-                ActiveSPWM = ActiveSpeedRange.spwm.deceleration;
-                break;
+        int count = __atomic_load_n(&motor_count, __ATOMIC_RELAXED);
+        for (int i = 0; i < count; i++) {
+            const MotorContext* motor = &motors[i];
+            if (count > 1) {
+                VESC_IF->printf("Motor %d:\n", motor->number);
+            }
+
+            // Calculate the current speed in km/h
+            // float current_speed_kmh = inverter_hz / (float)motor_poles * Conf.rpmToSpeedRatio;
+
+            // Print the current speed and active speed range
+            VESC_IF->printf("Current Speed: %.1f km/h\n", (double)motor->speed_kmh);
+            VESC_IF->printf("Active Speed Range: %f km/h to %f km/h\n",
+                            (double)motor->ActiveSpeedRange.minSpeed, (double)motor->ActiveSpeedRange.maxSpeed);
+
+            // Print the rotor state
+            const char* rotor_state_str = "Unknown";
+            switch (motor->rotor_state) {
+                case ROTOR_STATE_ACCELERATING:
+                    rotor_state_str = "Accelerating";
+                    break;
+                case ROTOR_STATE_COASTING:
+                    rotor_state_str = "Coasting";
+                    break;
+                case ROTOR_STATE_DECELERATING:
+                    rotor_state_str = "Decelerating";
+                    break;
+            }
+            VESC_IF->printf("Rotor State: %s\n", rotor_state_str);
+
+            // Print SPWM mode and carrier frequency
+            const char* spwm_mode_str = "Unknown";
+            switch (active_spwm_config(motor)->type) {
+                case SPWM_TYPE_FIXED_ASYNC:
+                    spwm_mode_str = "Fixed Async";
+                    break;
+                case SPWM_TYPE_RAMP_ASYNC:
+                    spwm_mode_str = "Ramp Async";
+                    break;
+                case SPWM_TYPE_RSPWM:
+                    spwm_mode_str = "Random SPWM";
+                    break;
+                case SPWM_TYPE_SYNC:
+                    spwm_mode_str = "Synchronous";
+                    break;
+                case SPWM_TYPE_NONE:
+                    spwm_mode_str = "Disabled";
+                    break;
+            }
+            VESC_IF->printf("SPWM Mode: %s, Carrier Frequency: %.1fHz, Amplitude %.3fV\n",
+                            spwm_mode_str, (double)motor->carrier_frequency, (double)motor->amplitude);
         }
-        switch (ActiveSPWM.type) {
-            case SPWM_TYPE_FIXED_ASYNC:
-                spwm_mode_str = "Fixed Async";
-                break;
-            case SPWM_TYPE_RAMP_ASYNC:
-                spwm_mode_str = "Ramp Async";
-                break;
-            case SPWM_TYPE_RSPWM:
-                spwm_mode_str = "Random SPWM";
-                break;
-            case SPWM_TYPE_SYNC:
-                spwm_mode_str = "Synchronous";
-                break;
-            case SPWM_TYPE_NONE:
-                spwm_mode_str = "Disabled";
-                break;
+
+        // Real time budget, see ext-get-stats for the full histograms
+        VESC_IF->printf("Generation: %.0fus avg, %.0fus max of %.0fus. Lead: %.0fus min. Jitter: %.0fus max. Underruns: %u\n",
+                        (double)Histogram_Mean(&profiler.generation), (double)profiler.generation.max,
+                        (double)profiler.bufferPeriod, (double)profiler.lead.min, (double)profiler.jitter.max,
+                        (unsigned int)profiler.underruns);
+    }
+}
+
+// (count min max mean bin-width (bins ...)), times in microseconds
+static lbm_value encode_histogram(const Histogram* histogram) {
+    lbm_value bins = VESC_IF->lbm_enc_sym_nil;
+    for (int i = PROFILER_HISTOGRAM_BINS - 1; i >= 0; i--) {
+        bins = VESC_IF->lbm_cons(VESC_IF->lbm_enc_u32(histogram->bins[i]), bins);
+    }
+
+    lbm_value result = VESC_IF->lbm_cons(bins, VESC_IF->lbm_enc_sym_nil);
+    result = VESC_IF->lbm_cons(VESC_IF->lbm_enc_float(histogram->binWidth), result);
+    result = VESC_IF->lbm_cons(VESC_IF->lbm_enc_float(Histogram_Mean(histogram)), result);
+    result = VESC_IF->lbm_cons(VESC_IF->lbm_enc_float(histogram->max), result);
+    result = VESC_IF->lbm_cons(VESC_IF->lbm_enc_float(histogram->min), result);
+    result = VESC_IF->lbm_cons(VESC_IF->lbm_enc_u32(histogram->count), result);
+    return result;
+}
+
+
+// Frees the sample buffers of all motors, the audio threads must not be running
+static void free_buffers(void) {
+    for (int m = 0; m < MAX_MOTORS; m++) {
+        for (int i = 0; i < NUM_BUFFERS; i++) {
+            if (motors[m].buffers[i] != NULL) {
+                VESC_IF->free(motors[m].buffers[i]);
+                motors[m].buffers[i] = NULL;
+            }
         }
-        VESC_IF->printf("SPWM Mode: %s, Carrier Frequency: %.1fHz, Amplitude %.3fV\n",
-                        spwm_mode_str, (double)generator.CarrierFrequency, (double)amplitude);
     }
 }
 
+// Stops the generator and playback threads and frees the buffers, call with loop_mutex held.
+// request_terminate only returns once the thread has exited, so nothing uses the buffers anymore.
+// The generator goes first, a parked playback thread only wakes up when it has finished.
+// Returns false if they were not running.
+static bool stop_audio_threads(void) {
+    if (!generator_thread_data.running || !playback_thread_data.running) {
+        return false;
+    }
+
+    generator_thread_data.running = false;
+    playback_thread_data.running = false;
+
+    VESC_IF->request_terminate(generator_thread_data.thread);
+    VESC_IF->request_terminate(playback_thread_data.thread);
+
+    free_buffers();
+    return true;
+}
+
+// Joins the threads of an audio loop ext-stop-audio-loop is fading out, they end by themselves once
+// it is silent. A fade out that is still going is cut short. Call with loop_mutex held.
+static void reap_audio_threads(void) {
+    if (__atomic_load_n(&fading_out, __ATOMIC_RELAXED)) {
+        stop_audio_threads();
+    }
+}
 
 // Extension function to start the audio loop
 static lbm_value ext_start_audio_loop(lbm_value *args, lbm_uint argn) {
     (void)args;
     (void)argn;
 
+    VESC_IF->mutex_lock(loop_mutex);
+    reap_audio_threads();
     if (!generator_thread_data.running && !playback_thread_data.running) {
-        // Allocate buffers on the heap
-        for (int i = 0; i < NUM_BUFFERS; i++) {
-            buffers[i] = (int8_t *)VESC_IF->malloc(BUFFER_LENGTH * sizeof(int8_t));
-            if (buffers[i] == NULL) {
-                VESC_IF->printf("Failed to allocate buffer %d\n", i);
-                return VESC_IF->lbm_enc_sym_eerror;
+        // Allocate buffers on the heap, a set for every motor
+        for (int m = 0; m < motor_count; m++) {
+            for (int i = 0; i < NUM_BUFFERS; i++) {
+                motors[m].buffers[i] = (int8_t *)VESC_IF->malloc(BUFFER_LENGTH * sizeof(int8_t));
+                if (motors[m].buffers[i] == NULL) {
+                    VESC_IF->printf("Failed to allocate buffer %d of motor %d\n", i, motors[m].number);
+                    free_buffers();
+                    VESC_IF->mutex_unlock(loop_mutex);
+                    return VESC_IF->lbm_enc_sym_merror;
+                }
             }
+        }
+        for (int i = 0; i < NUM_BUFFERS; i++) {
             buffer_ready_for_consumption[i] = false;  // Initialize all buffers as not ready for consumption
         }
 
+        // Fresh statistics for every run
+        VESC_IF->mutex_lock(state_mutex);
+        Profiler_Init(&profiler, (float)BUFFER_LENGTH / sample_rate * 1000000.0f);
+        VESC_IF->mutex_unlock(state_mutex);
+
         generator_thread_data.running = true;
         playback_thread_data.running = true;
+        __atomic_store_n(&fading_out, false, __ATOMIC_RELAXED);
+        __atomic_store_n(&generator_finished, false, __ATOMIC_RELAXED);
+        VESC_IF->sem_reset(playback_wake);
 
         generator_thread_data.thread = VESC_IF->spawn(generator_loop, 1024, "generator_loop", NULL);
         playback_thread_data.thread = VESC_IF->spawn(playback_loop, 1024, "playback_loop", NULL);
 
+        VESC_IF->mutex_lock(state_mutex);
+        log_event(&motors[0], EVENT_START, 0, 0);
+        VESC_IF->mutex_unlock(state_mutex);
         VESC_IF->printf("Generator and playback threads started.\n");
     } else {
         VESC_IF->printf("Generator and playback threads are already running.\n");
     }
+    VESC_IF->mutex_unlock(loop_mutex);
 
     return VESC_IF->lbm_enc_sym_true;
 }
 
+// Whether the firmware still has audio of any motor
+static bool audio_playing(void) {
+    int count = __atomic_load_n(&motor_count, __ATOMIC_RELAXED);
+    for (int i = 0; i < count; i++) {
+        if (__atomic_load_n(&motors[i].audio_playing, __ATOMIC_RELAXED)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Fades the sound out before the threads are stopped when the library is unloaded, instead of
+// cutting it, see Envelope.h. Called with loop_mutex held.
+static void fade_out_audio(void) {
+    if (!generator_thread_data.running || !playback_thread_data.running) {
+        return;
+    }
+    __atomic_store_n(&fading_out, true, __ATOMIC_RELAXED);
+    for (int waited_ms = 0; waited_ms < ENVELOPE_STOP_TIMEOUT_MS && audio_playing(); waited_ms++) {
+        VESC_IF->sleep_ms(1);
+    }
+}
+
 // Extension function to stop the audio loop
 static lbm_value ext_stop_audio_loop(lbm_value *args, lbm_uint argn) {
     (void)args;
     (void)argn;
 
-    if (generator_thread_data.running && playback_thread_data.running) {
-        generator_thread_data.running = false;
-        playback_thread_data.running = false;
-
-        VESC_IF->request_terminate(generator_thread_data.thread);
-        VESC_IF->request_terminate(playback_thread_data.thread);
-
-        // Free the allocated buffers
-        for (int i = 0; i < NUM_BUFFERS; i++) {
-            if (buffers[i] != NULL) {
-                VESC_IF->free(buffers[i]);
-                buffers[i] = NULL;
-            }
-        }
-
+    VESC_IF->mutex_lock(loop_mutex);
+    if (!generator_thread_data.running || !playback_thread_data.running) {
+        VESC_IF->printf("Generator and playback threads are not running.\n");
+    } else if (__atomic_load_n(&fading_out, __ATOMIC_RELAXED)) {
+        // Stopped twice, cut what is left of the fade out
+        stop_audio_threads();
         VESC_IF->printf("Generator and playback threads stopped.\n");
     } else {
-        VESC_IF->printf("Generator and playback threads are not running.\n");
+        __atomic_store_n(&fading_out, true, __ATOMIC_RELAXED);
+        VESC_IF->mutex_lock(state_mutex);
+        log_event(&motors[0], EVENT_STOP, 0, 0);
+        VESC_IF->mutex_unlock(state_mutex);
+        VESC_IF->printf("Fading out, the generator and playback threads end once it is silent.\n");
     }
+    VESC_IF->mutex_unlock(loop_mutex);
 
     return VESC_IF->lbm_enc_sym_true;
 }
 
 
+// The motor values below take the motor as an optional second argument, 1 when left out, see
+// ext-set-motor-count
 static lbm_value ext_set_motor_current(lbm_value *args, lbm_uint argn) {
-    if (argn != 1 || !VESC_IF->lbm_is_number(args[0])) {
+    if (argn < 1 || argn > 2 || !VESC_IF->lbm_is_number(args[0])) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+    MotorContext* motor = motor_argument(args, argn, 1);
+    if (!motor) {
         return VESC_IF->lbm_enc_sym_eerror;
     }
 
 	float new_current = VESC_IF->lbm_dec_as_float(args[0]);
 
-	// Update array of samples with new value, update current value pointer
-	current_samples[active_current_index] = new_current;
-	active_current_index = (active_current_index + 1) % NUM_MOTOR_STAT_SAMPLES;
-
-	// Now calculate average over the array, and use that as the actual amplitude
-	float total = 0;
-	for (unsigned int i = 0; i < NUM_MOTOR_STAT_SAMPLES; i++) {
-		total += current_samples[i];
-	}
-	inverter_current = total / NUM_MOTOR_STAT_SAMPLES;
-
-	update_spwm_settings();
+	VESC_IF->mutex_lock(state_mutex);
+	motor->inverter_current = add_motor_sample(motor->current_samples, &motor->active_current_index, new_current);
+	update_spwm_settings(motor);
+	VESC_IF->mutex_unlock(state_mutex);
 
     return VESC_IF->lbm_enc_sym_true;
 }
 
 static lbm_value ext_set_motor_hz(lbm_value *args, lbm_uint argn) {
-    if (argn != 1 || !VESC_IF->lbm_is_number(args[0])) {
+    if (argn < 1 || argn > 2 || !VESC_IF->lbm_is_number(args[0])) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+    MotorContext* motor = motor_argument(args, argn, 1);
+    if (!motor) {
         return VESC_IF->lbm_enc_sym_eerror;
     }
 
 	float new_freq = VESC_IF->lbm_dec_as_float(args[0]);
 
-	// Update array of samples with new value, update current value pointer
-	hz_samples[active_hz_index] = new_freq;
-	active_hz_index = (active_hz_index + 1) % NUM_MOTOR_STAT_SAMPLES;
-
-	// Now calculate average over the array, and use that as the actual amplitude
-	float total = 0;
-	for (unsigned int i = 0; i < NUM_MOTOR_STAT_SAMPLES; i++) {
-		total += hz_samples[i];
-	}
-	inverter_hz = total / NUM_MOTOR_STAT_SAMPLES;
-
-	update_spwm_settings();
-
+	VESC_IF->mutex_lock(state_mutex);
+	motor->inverter_hz = add_motor_sample(motor->hz_samples, &motor->active_hz_index, new_freq);
+	update_spwm_settings(motor);
+	VESC_IF->mutex_unlock(state_mutex);
 
     return VESC_IF->lbm_enc_sym_true;
 }
 
 
 static lbm_value ext_set_speed_kmh(lbm_value *args, lbm_uint argn) {
-    if (argn != 1 || !VESC_IF->lbm_is_number(args[0])) {
+    if (argn < 1 || argn > 2 || !VESC_IF->lbm_is_number(args[0])) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+    MotorContext* motor = motor_argument(args, argn, 1);
+    if (!motor) {
         return VESC_IF->lbm_enc_sym_eerror;
     }
 
 	float current_speed_kmh = VESC_IF->lbm_dec_as_float(args[0]);
 
-	// Update array of samples with new value, update current value pointer
-	speed_samples[active_speed_index] = current_speed_kmh;
-	active_speed_index = (active_speed_index + 1) % NUM_MOTOR_STAT_SAMPLES;
-
-	// Now calculate average over the array, and use that as the actual amplitude
-	float total = 0;
-	for (unsigned int i = 0; i < NUM_MOTOR_STAT_SAMPLES; i++) {
-		total += speed_samples[i];
-	}
-	speed_kmh = total / NUM_MOTOR_STAT_SAMPLES;
+	VESC_IF->mutex_lock(state_mutex);
+	motor->speed_kmh = add_motor_sample(motor->speed_samples, &motor->active_speed_index, current_speed_kmh);
     // VESC_IF->printf("Speed = %.1f\n", speed_kmh);
 
-	update_spwm_settings();
+	update_spwm_settings(motor);
+	VESC_IF->mutex_unlock(state_mutex);
 
     return VESC_IF->lbm_enc_sym_true;
 }
@@ -468,70 +1159,770 @@ static lbm_value ext_set_speed_kmh(lbm_value *args, lbm_uint argn) {
 
 
 static lbm_value ext_set_motor_poles(lbm_value *args, lbm_uint argn) {
+    if (argn < 1 || argn > 2 || !VESC_IF->lbm_is_number(args[0])) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+    MotorContext* motor = motor_argument(args, argn, 1);
+    if (!motor) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    int poles = VESC_IF->lbm_dec_as_i32(args[0]);
+
+    VESC_IF->mutex_lock(state_mutex);
+    motor->motor_poles = poles;
+	update_spwm_settings(motor);
+    VESC_IF->mutex_unlock(state_mutex);
+
+    return VESC_IF->lbm_enc_sym_true;
+}
+
+// Whether selecting motor 2 takes effect. Single motor hardware ignores the selection and stays
+// on motor 1. The selection of the calling thread is restored afterwards.
+static bool has_second_motor(void) {
+    int previous = VESC_IF->mc_get_motor_thread ? VESC_IF->mc_get_motor_thread() : 0;
+    VESC_IF->mc_select_motor_thread(2);
+    bool selected = VESC_IF->mc_motor_now() == 2;
+    VESC_IF->mc_select_motor_thread(previous);
+    return selected;
+}
+
+// Sets how many motors the audio loop drives: 1 (the default) or 2 on a dual motor controller,
+// where each motor gets its own buffers and plays the sound of its own speed. The ext-set-motor-*
+// values and ext-get-status take the motor as an optional last argument. Only while the audio
+// loop is stopped.
+static lbm_value ext_set_motor_count(lbm_value *args, lbm_uint argn) {
+    if (argn != 1 || !VESC_IF->lbm_is_number(args[0])) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    int count = VESC_IF->lbm_dec_as_i32(args[0]);
+    if (count < 1 || count > MAX_MOTORS) {
+        VESC_IF->printf("Motor count must be between 1 and %d.\n", MAX_MOTORS);
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+    if (count > 1 && (!VESC_IF->mc_select_motor_thread || !VESC_IF->mc_motor_now)) {
+        VESC_IF->printf("This firmware can't select the motor of a thread.\n");
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+    if (count > 1 && !has_second_motor()) {
+        VESC_IF->printf("This controller has no second motor.\n");
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    VESC_IF->mutex_lock(loop_mutex);
+    reap_audio_threads();
+    if (generator_thread_data.running || playback_thread_data.running) {
+        VESC_IF->mutex_unlock(loop_mutex);
+        VESC_IF->printf("Stop the audio loop before changing the motor count.\n");
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+    __atomic_store_n(&motor_count, count, __ATOMIC_RELAXED);
+    VESC_IF->mutex_unlock(loop_mutex);
+
+    return VESC_IF->lbm_enc_sym_true;
+}
+
+// Limits the injection voltage to what the motor control has left below max-duty, so the audio
+// never pushes the modulation into saturation, see VoltageLimit.h. 0 turns the limit off, the
+// default is 0.9. Takes effect with the next buffer.
+static lbm_value ext_set_voltage_limit(lbm_value *args, lbm_uint argn) {
     if (argn != 1 || !VESC_IF->lbm_is_number(args[0])) {
         return VESC_IF->lbm_enc_sym_eerror;
     }
 
-    motor_poles = VESC_IF->lbm_dec_as_float(args[0]);
+    float max_duty = VESC_IF->lbm_dec_as_float(args[0]);
+    if (max_duty != 0.0f && (max_duty < 0.1f || max_duty > 1.0f)) {
+        VESC_IF->printf("Voltage limit duty must be 0 (off) or between 0.1 and 1.0.\n");
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
 
-	update_spwm_settings();
+    VESC_IF->mutex_lock(state_mutex);
+    voltage_limit_max_duty = max_duty;
+    VESC_IF->mutex_unlock(state_mutex);
 
     return VESC_IF->lbm_enc_sym_true;
 }
 
+// Returns (max-duty headroom-v limit-v limited-buffers) of the first motor, or of the one given as
+// the optional argument. headroom-v is what the motor control had left before the last buffer,
+// limit-v what the audio could use, limited-buffers counts the buffers played quieter than the
+// amplitude curves asked for since the plugin was loaded.
+static lbm_value ext_get_voltage_limit(lbm_value *args, lbm_uint argn) {
+    if (argn > 1) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+    const MotorContext* motor = motor_argument(args, argn, 0);
+    if (!motor) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    VESC_IF->mutex_lock(state_mutex);
+    float max_duty = voltage_limit_max_duty;
+    float headroom = motor->voltage_headroom;
+    float limit = motor->voltage_limit;
+    uint32_t limited = motor->limited_buffers;
+    VESC_IF->mutex_unlock(state_mutex);
+
+    // Built back to front
+    lbm_value result = VESC_IF->lbm_enc_sym_nil;
+    result = VESC_IF->lbm_cons(VESC_IF->lbm_enc_u32(limited), result);
+    result = VESC_IF->lbm_cons(VESC_IF->lbm_enc_float(limit), result);
+    result = VESC_IF->lbm_cons(VESC_IF->lbm_enc_float(headroom), result);
+    result = VESC_IF->lbm_cons(VESC_IF->lbm_enc_float(max_duty), result);
+
+    return result;
+}
+
+// Profile at the given index: the library, then the editor's profile once one was applied.
+// NULL if there is none. Call with state_mutex held.
+static const InverterProfile* lookup_profile(int index) {
+    if (index == GetProfileCount() && custom_profile_loaded) {
+        return &custom_profile;
+    }
+    return GetProfile(index);
+}
+
+// Call with state_mutex held
+static void activate_profile(const InverterProfile* profile, int index) {
+    log_event(&motors[0], EVENT_PROFILE, active_profile_index, index);
+    Conf = &profile->config;
+    active_profile_index = index;
+    for (int i = 0; i < MAX_MOTORS; i++) {
+        Curve_ResetCursor(&motors[i].current_curve_cursor);
+        Curve_ResetCursor(&motors[i].speed_curve_cursor);
+    }
+    for (int i = 0; i < __atomic_load_n(&motor_count, __ATOMIC_RELAXED); i++) {
+        update_spwm_settings(&motors[i]);
+    }
+}
+
+// Switch to a profile from the library, takes either the profile index or its name. The profile
+// sent by the profile editor comes right after the library, by index or by the name it was sent with.
+static lbm_value ext_set_profile(lbm_value *args, lbm_uint argn) {
+    if (argn != 1) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    const char* name = NULL;
+    int index = -1;
+    if (VESC_IF->lbm_is_number(args[0])) {
+        index = VESC_IF->lbm_dec_as_i32(args[0]);
+    } else {
+        name = VESC_IF->lbm_dec_str(args[0]);
+        index = FindProfileByName(name);
+    }
+
+    // Switching is a single pointer write, the generator picks it up on the next settings update
+    VESC_IF->mutex_lock(state_mutex);
+    if (index < 0 && name && custom_profile_loaded && strncmp(custom_profile.name, name, PROFILE_NAME_LENGTH) == 0) {
+        index = GetProfileCount();
+    }
+    const InverterProfile* profile = lookup_profile(index);
+    if (profile) {
+        activate_profile(profile, index);
+    }
+    VESC_IF->mutex_unlock(state_mutex);
+
+    if (!profile) {
+        VESC_IF->printf("Unknown profile, %d profiles available.\n", GetProfileCount() + (custom_profile_loaded ? 1 : 0));
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    VESC_IF->printf("Switched to profile %d (%s).\n", index, profile->name);
+
+    return VESC_IF->lbm_enc_sym_true;
+}
+
+static lbm_value ext_get_profile(lbm_value *args, lbm_uint argn) {
+    (void)args;
+    if (argn != 0) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    VESC_IF->mutex_lock(state_mutex);
+    int index = active_profile_index;
+    VESC_IF->mutex_unlock(state_mutex);
+
+    return VESC_IF->lbm_enc_i(index);
+}
+
+// Returns the generator state as a list: (speed-kmh range-index rotor-state spwm-type carrier-hz amplitude enabled)
+// Of the first motor, or the one given as the optional argument, see ext-set-motor-count.
+static lbm_value ext_get_status(lbm_value *args, lbm_uint argn) {
+    if (argn > 1) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+    const MotorContext* motor = motor_argument(args, argn, 0);
+    if (!motor) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    // Same fields as the telemetry packet, copied in one go so they are consistent
+    TelemetryStatus copy;
+    VESC_IF->mutex_lock(state_mutex);
+    copy.speedKmh = motor->speed_kmh;
+    copy.rangeIndex = motor->active_speed_range_index;
+    copy.rotorState = motor->rotor_state;
+    copy.spwmType = active_spwm_config(motor)->type;
+    copy.enabled = motor->inverter_enabled;
+    copy.carrierHz = motor->carrier_frequency;
+    copy.amplitude = motor->amplitude;
+    VESC_IF->mutex_unlock(state_mutex);
+
+    // Built back to front
+    lbm_value status = VESC_IF->lbm_enc_sym_nil;
+    status = VESC_IF->lbm_cons(VESC_IF->lbm_enc_i(copy.enabled ? 1 : 0), status);
+    status = VESC_IF->lbm_cons(VESC_IF->lbm_enc_float(copy.amplitude), status);
+    status = VESC_IF->lbm_cons(VESC_IF->lbm_enc_float(copy.carrierHz), status);
+    status = VESC_IF->lbm_cons(VESC_IF->lbm_enc_i(copy.spwmType), status);
+    status = VESC_IF->lbm_cons(VESC_IF->lbm_enc_i(copy.rotorState), status);
+    status = VESC_IF->lbm_cons(VESC_IF->lbm_enc_i(copy.rangeIndex), status);
+    status = VESC_IF->lbm_cons(VESC_IF->lbm_enc_float(copy.speedKmh), status);
+
+    return status;
+}
+
+// Times every SPWM type and pulse pattern, prints a table and returns a list with one entry per case:
+// ((kernel variant carrier-hz ticks-per-buffer ticks-per-sample budget-percent) ...)
+// Ticks are CPU cycles. Kernel is 0 for SPWM types and 1 for pulse patterns, see Benchmark.h.
+static lbm_value ext_bench(lbm_value *args, lbm_uint argn) {
+    (void)args;
+    if (argn != 0) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    // The generator thread would skew the timings. Holding loop_mutex keeps it from being started
+    // while the benchmark runs.
+    VESC_IF->mutex_lock(loop_mutex);
+    reap_audio_threads();
+    if (generator_thread_data.running || playback_thread_data.running) {
+        VESC_IF->mutex_unlock(loop_mutex);
+        VESC_IF->printf("Stop the audio loop before running the benchmark.\n");
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    int max_results = Benchmark_GetCaseCount();
+    BenchmarkResult* results = (BenchmarkResult *)VESC_IF->malloc(max_results * sizeof(BenchmarkResult));
+    if (results == NULL) {
+        VESC_IF->mutex_unlock(loop_mutex);
+        return VESC_IF->lbm_enc_sym_merror;
+    }
+
+    int count = Benchmark_Run(results, max_results);
+    VESC_IF->mutex_unlock(loop_mutex);
+
+    VESC_IF->printf("%-8s %-12s %8s %12s %12s %8s\n", "kernel", "variant", "carrier", "per-buffer", "per-sample", "budget");
+    lbm_value table = VESC_IF->lbm_enc_sym_nil;
+    for (int i = count - 1; i >= 0; i--) {
+        const BenchmarkResult* r = &results[i];
+
+        lbm_value row = VESC_IF->lbm_enc_sym_nil;
+        row = VESC_IF->lbm_cons(VESC_IF->lbm_enc_float(r->budgetPercent), row);
+        row = VESC_IF->lbm_cons(VESC_IF->lbm_enc_float(r->ticksPerSample), row);
+        row = VESC_IF->lbm_cons(VESC_IF->lbm_enc_u32(r->ticksPerBuffer), row);
+        row = VESC_IF->lbm_cons(VESC_IF->lbm_enc_i(r->carrierHz), row);
+        row = VESC_IF->lbm_cons(VESC_IF->lbm_enc_i(r->variant), row);
+        row = VESC_IF->lbm_cons(VESC_IF->lbm_enc_i(r->kernel), row);
+        table = VESC_IF->lbm_cons(row, table);
+    }
+
+    for (int i = 0; i < count; i++) {
+        const BenchmarkResult* r = &results[i];
+        VESC_IF->printf("%-8s %-12s %8d %12u %12.1f %7.2f%%\n",
+                        Benchmark_GetKernelName(r->kernel), Benchmark_GetVariantName(r->kernel, r->variant),
+                        r->carrierHz, (unsigned int)r->ticksPerBuffer, (double)r->ticksPerSample, (double)r->budgetPercent);
+    }
+
+    VESC_IF->free(results);
+
+    return table;
+}
+
+// Returns the real time budget statistics as a list:
+// (buffer-period-us buffers-generated buffers-played underruns generation play-call lead jitter)
+// where each of the last four is a histogram: (count min max mean bin-width (bins ...)), see Profiler.h
 static lbm_value ext_get_stats(lbm_value *args, lbm_uint argn) {
     (void)args;
     if (argn != 0) {
         return VESC_IF->lbm_enc_sym_eerror;
     }
 
+    // Copy, so the lists are not built with state_mutex held
+    VESC_IF->mutex_lock(state_mutex);
+    Profiler copy = profiler;
+    VESC_IF->mutex_unlock(state_mutex);
+
+    // Built back to front
+    lbm_value stats = VESC_IF->lbm_enc_sym_nil;
+    stats = VESC_IF->lbm_cons(encode_histogram(&copy.jitter), stats);
+    stats = VESC_IF->lbm_cons(encode_histogram(&copy.lead), stats);
+    stats = VESC_IF->lbm_cons(encode_histogram(&copy.playCall), stats);
+    stats = VESC_IF->lbm_cons(encode_histogram(&copy.generation), stats);
+    stats = VESC_IF->lbm_cons(VESC_IF->lbm_enc_u32(copy.underruns), stats);
+    stats = VESC_IF->lbm_cons(VESC_IF->lbm_enc_u32(copy.buffersPlayed), stats);
+    stats = VESC_IF->lbm_cons(VESC_IF->lbm_enc_u32(copy.buffersGenerated), stats);
+    stats = VESC_IF->lbm_cons(VESC_IF->lbm_enc_float(copy.bufferPeriod), stats);
+
+    return stats;
+}
+
+// Prints the statistics as text, at most once per second
+static lbm_value ext_print_stats(lbm_value *args, lbm_uint argn) {
+    (void)args;
+    if (argn != 0) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    VESC_IF->mutex_lock(state_mutex);
     print_stats();
+    VESC_IF->mutex_unlock(state_mutex);
+
+    return VESC_IF->lbm_enc_sym_true;
+}
+
+static lbm_value ext_reset_stats(lbm_value *args, lbm_uint argn) {
+    (void)args;
+    if (argn != 0) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    VESC_IF->mutex_lock(state_mutex);
+    Profiler_Init(&profiler, (float)BUFFER_LENGTH / sample_rate * 1000000.0f);
+    VESC_IF->mutex_unlock(state_mutex);
+
+    return VESC_IF->lbm_enc_sym_true;
+}
+
+// Sets how many telemetry packets are sent per second, 0 turns telemetry off
+static lbm_value ext_set_telemetry_rate(lbm_value *args, lbm_uint argn) {
+    if (argn != 1 || !VESC_IF->lbm_is_number(args[0])) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    int rate_hz = VESC_IF->lbm_dec_as_i32(args[0]);
+    if (rate_hz < 0 || rate_hz > TELEMETRY_MAX_RATE_HZ) {
+        VESC_IF->printf("Telemetry rate must be between 0 and %d Hz.\n", TELEMETRY_MAX_RATE_HZ);
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    VESC_IF->mutex_lock(state_mutex);
+    telemetry_rate_hz = rate_hz;
+    VESC_IF->mutex_unlock(state_mutex);
+
+    return VESC_IF->lbm_enc_sym_true;
+}
+
+// Sets how many times per second the generator thread reads current, rpm, speed and poles from
+// the motor itself, so Lisp only has to start the loop. 0 (the default) leaves it to the
+// ext-set-* extensions. Polling runs with the audio loop, at most once per buffer.
+static lbm_value ext_set_update_rate(lbm_value *args, lbm_uint argn) {
+    if (argn != 1 || !VESC_IF->lbm_is_number(args[0])) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    int max_rate_hz = (int)(sample_rate / BUFFER_LENGTH);
+    int rate_hz = VESC_IF->lbm_dec_as_i32(args[0]);
+    if (rate_hz < 0 || rate_hz > max_rate_hz) {
+        VESC_IF->printf("Update rate must be between 0 and %d Hz.\n", max_rate_hz);
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    int interval = 0;
+    if (rate_hz > 0) {
+        interval = (int)(sample_rate / BUFFER_LENGTH / (float)rate_hz + 0.5f);
+        if (interval < 1) {
+            interval = 1;
+        }
+    }
+    __atomic_store_n(&update_interval_buffers, interval, __ATOMIC_RELAXED);
+
+    return VESC_IF->lbm_enc_sym_true;
+}
+
+// Sets how many output snapshots are sent per second for the dashboard scope and spectrogram, 0
+// (the default) turns them off. Snapshots are whole buffers, taken one every N while the audio
+// loop runs, see Snapshot.h.
+static lbm_value ext_set_snapshot_rate(lbm_value *args, lbm_uint argn) {
+    if (argn != 1 || !VESC_IF->lbm_is_number(args[0])) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    int rate_hz = VESC_IF->lbm_dec_as_i32(args[0]);
+    if (rate_hz < 0 || rate_hz > SNAPSHOT_MAX_RATE_HZ) {
+        VESC_IF->printf("Snapshot rate must be between 0 and %d Hz.\n", SNAPSHOT_MAX_RATE_HZ);
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
 
+    // Rounded up, so there are never more snapshots than asked for
+    int interval = 0;
+    if (rate_hz > 0) {
+        float buffers = sample_rate / BUFFER_LENGTH / (float)rate_hz;
+        interval = (int)buffers;
+        if ((float)interval < buffers) {
+            interval++;
+        }
+    }
+    __atomic_store_n(&snapshot_interval_buffers, interval, __ATOMIC_RELAXED);
 
     return VESC_IF->lbm_enc_sym_true;
 }
 
+// Frames from the carrier sync leader, from the CAN thread. Other extended frames are left to
+// the firmware.
+static bool can_frame_received(uint32_t id, uint8_t *data, uint8_t len) {
+    CarrierSyncFrame frame;
+    if (id != CARRIER_SYNC_CAN_ID || !CarrierSync_Decode(data, len, &frame)) {
+        return false;
+    }
+
+    VESC_IF->mutex_lock(state_mutex);
+    sync_reference = frame;
+    sync_reference_time = VESC_IF->timer_time_now();
+    sync_reference_valid = true;
+    for (int i = 0; i < MAX_MOTORS; i++) {
+        motors[i].sync_reference_new = true;
+    }
+    sync_frames++;
+    VESC_IF->mutex_unlock(state_mutex);
+
+    return true;
+}
+
+// Carrier phase sync with the other VESCs on the CAN bus, see CarrierSync.h. mode 0 turns it
+// off, 1 makes this VESC the leader, which sends its phases rate-hz times per second (5 when
+// left out), and 2 a follower, which pulls its carrier to the leader's and uses its speed range.
+// There should be one leader per bus.
+static lbm_value ext_set_carrier_sync(lbm_value *args, lbm_uint argn) {
+    if (argn < 1 || argn > 2 || !VESC_IF->lbm_is_number(args[0]) || (argn == 2 && !VESC_IF->lbm_is_number(args[1]))) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    int mode = VESC_IF->lbm_dec_as_i32(args[0]);
+    int rate_hz = argn == 2 ? VESC_IF->lbm_dec_as_i32(args[1]) : CARRIER_SYNC_DEFAULT_RATE_HZ;
+    if (mode < SYNC_MODE_OFF || mode > SYNC_MODE_FOLLOWER) {
+        VESC_IF->printf("Carrier sync mode must be 0 (off), 1 (leader) or 2 (follower).\n");
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+    if (rate_hz < 1 || rate_hz > CARRIER_SYNC_MAX_RATE_HZ) {
+        VESC_IF->printf("Carrier sync rate must be between 1 and %d Hz.\n", CARRIER_SYNC_MAX_RATE_HZ);
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    int interval = (int)(sample_rate / BUFFER_LENGTH / (float)rate_hz + 0.5f);
+    if (interval < 1) {
+        interval = 1;
+    }
+
+    VESC_IF->mutex_lock(state_mutex);
+    sync_reference_valid = false;
+    sync_frames = 0;
+    for (int i = 0; i < MAX_MOTORS; i++) {
+        motors[i].sync_reference_new = false;
+        motors[i].sync_measure_new = false;
+        motors[i].sync_error = 0.0f;
+        motors[i].sync_locked = false;
+    }
+    __atomic_store_n(&sync_interval_buffers, interval, __ATOMIC_RELAXED);
+    __atomic_store_n(&sync_mode, mode, __ATOMIC_RELAXED);
+    VESC_IF->mutex_unlock(state_mutex);
+
+    VESC_IF->can_set_eid_cb(mode == SYNC_MODE_FOLLOWER ? can_frame_received : NULL);
+
+    return VESC_IF->lbm_enc_sym_true;
+}
+
+// Returns (mode frames error-deg locked), frames counts the frames sent by a leader or received
+// by a follower since the mode was set, error-deg is the follower's last carrier phase error. The
+// error is that of the first motor, or of the one given as the optional argument.
+static lbm_value ext_get_carrier_sync(lbm_value *args, lbm_uint argn) {
+    if (argn > 1) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+    const MotorContext* motor = motor_argument(args, argn, 0);
+    if (!motor) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    VESC_IF->mutex_lock(state_mutex);
+    int mode = __atomic_load_n(&sync_mode, __ATOMIC_RELAXED);
+    uint32_t frames = sync_frames;
+    float error_deg = motor->sync_error * 360.0f / TWO_PI;
+    bool locked = motor->sync_locked;
+    VESC_IF->mutex_unlock(state_mutex);
+
+    // Built back to front
+    lbm_value result = VESC_IF->lbm_enc_sym_nil;
+    result = VESC_IF->lbm_cons(locked ? VESC_IF->lbm_enc_sym_true : VESC_IF->lbm_enc_sym_nil, result);
+    result = VESC_IF->lbm_cons(VESC_IF->lbm_enc_float(error_deg), result);
+    result = VESC_IF->lbm_cons(VESC_IF->lbm_enc_i((int)frames), result);
+    result = VESC_IF->lbm_cons(VESC_IF->lbm_enc_i(mode), result);
+
+    return result;
+}
+
+// Takes the oldest event from the queue for Lisp as (type from to speed-kmh), nil when there is
+// none. type is an EventType, from and to are the same values as in the event log.
+static lbm_value ext_next_event(lbm_value *args, lbm_uint argn) {
+    (void)args;
+    if (argn != 0) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    VESC_IF->mutex_lock(state_mutex);
+    if (event_queue_count == 0) {
+        VESC_IF->mutex_unlock(state_mutex);
+        return VESC_IF->lbm_enc_sym_nil;
+    }
+    Event event = event_queue[event_queue_start];
+    event_queue_start = (event_queue_start + 1) % EVENT_QUEUE_LENGTH;
+    event_queue_count--;
+    VESC_IF->mutex_unlock(state_mutex);
+
+    // Built back to front
+    lbm_value result = VESC_IF->lbm_enc_sym_nil;
+    result = VESC_IF->lbm_cons(VESC_IF->lbm_enc_float((float)event.speed / 100.0f), result);
+    result = VESC_IF->lbm_cons(VESC_IF->lbm_enc_i(event.to), result);
+    result = VESC_IF->lbm_cons(VESC_IF->lbm_enc_i(event.from), result);
+    result = VESC_IF->lbm_cons(VESC_IF->lbm_enc_i(event.type), result);
+
+    return result;
+}
+
+// Blocks the calling context until ext-next-event has something, returns t right away if it
+// already has. Only one context can wait at a time. Returns nil when the library is stopped.
+static lbm_value ext_wait_event(lbm_value *args, lbm_uint argn) {
+    (void)args;
+    if (argn != 0 || !VESC_IF->lbm_unblock_ctx_unboxed) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    VESC_IF->mutex_lock(state_mutex);
+    if (event_queue_count > 0) {
+        VESC_IF->mutex_unlock(state_mutex);
+        return VESC_IF->lbm_enc_sym_true;
+    }
+    if (event_waiting) {
+        VESC_IF->mutex_unlock(state_mutex);
+        VESC_IF->printf("Another context is already waiting for events.\n");
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+    event_waiter = VESC_IF->lbm_get_current_cid();
+    event_waiting = true;
+    VESC_IF->lbm_block_ctx_from_extension();
+    VESC_IF->mutex_unlock(state_mutex);
+
+    // The context gets the value passed to lbm_unblock_ctx_unboxed instead of this one
+    return VESC_IF->lbm_enc_sym_true;
+}
+
+// Drains the event log and prints it, oldest first
+static lbm_value ext_print_events(lbm_value *args, lbm_uint argn) {
+    (void)args;
+    if (argn != 0) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    uint32_t dropped = EventLog_TakeDropped(&event_log);
+    if (dropped > 0) {
+        VESC_IF->printf("%u older events were dropped.\n", (unsigned int)dropped);
+    }
+
+    Event event;
+    int count = 0;
+    while (EventLog_Pop(&event_log, &event)) {
+        VESC_IF->printf("%10.3fs %-12s %4d -> %-4d %6.2f km/h, %u underruns\n",
+                        (double)((float)event.timeMs / 1000.0f), EventLog_GetTypeName((EventType)event.type),
+                        event.from, event.to, (double)((float)event.speed / 100.0f), (unsigned int)event.underruns);
+        count++;
+    }
+
+    return VESC_IF->lbm_enc_i(count);
+}
+
+// Drains the event log as app data packets, see EventLog.h for the format. There is always at
+// least one packet, with the last flag set, so the receiver knows the dump is complete.
+static lbm_value ext_send_events(lbm_value *args, lbm_uint argn) {
+    (void)args;
+    if (argn != 0) {
+        return VESC_IF->lbm_enc_sym_eerror;
+    }
+
+    uint8_t packet[EVENT_LOG_PACKET_LENGTH];
+    int count = 0;
+    do {
+        int length = EventLog_EncodePacket(&event_log, packet);
+        VESC_IF->send_app_data(packet, length);
+        count += packet[2];
+    } while (!(packet[3] & EVENT_LOG_FLAG_LAST));
+
+    return VESC_IF->lbm_enc_i(count);
+}
+
+
+// Profile editor packets from VESC Tool, see ProfileCodec.h. GET is answered with the profile,
+// APPLY is checked, copied into custom_profile and switched to right away, then answered with
+// the result. Packets that are not for the editor are ignored.
+static void app_data_received(unsigned char *data, unsigned int len) {
+    if (len < PROFILE_HEADER_LENGTH || data[0] != PROFILE_PACKET_ID) {
+        return;
+    }
+
+    int length = 0;
+    if (data[1] != PROFILE_VERSION) {
+        length = ProfileCodec_EncodeResult(PROFILE_ERROR_FORMAT, profile_reply);
+    } else if (data[2] == PROFILE_CMD_GET) {
+        VESC_IF->mutex_lock(state_mutex);
+        int index = data[3] == PROFILE_INDEX_ACTIVE ? active_profile_index : data[3];
+        const InverterProfile* profile = lookup_profile(index);
+        if (profile) {
+            int base = profile == &custom_profile ? custom_base_index : index;
+            length = ProfileCodec_Encode(profile, index, base, profile_reply);
+        }
+        VESC_IF->mutex_unlock(state_mutex);
+
+        if (!profile) {
+            length = ProfileCodec_EncodeResult(PROFILE_ERROR_INDEX, profile_reply);
+        }
+    } else if (data[2] == PROFILE_CMD_APPLY) {
+        // Checked before touching anything, a bad packet leaves the active profile alone
+        ProfileResult result = ProfileCodec_Validate(data, (int)len, GetProfileCount());
+        if (result == PROFILE_OK) {
+            VESC_IF->mutex_lock(state_mutex);
+            custom_base_index = ProfileCodec_Decode(data, &custom_profile);
+            custom_profile.config.amplitude = GetProfile(custom_base_index)->config.amplitude;
+            custom_profile_loaded = true;
+            activate_profile(&custom_profile, GetProfileCount());
+            VESC_IF->mutex_unlock(state_mutex);
+        }
+
+        VESC_IF->printf("Profile from the editor: %s.\n", ProfileCodec_GetResultName(result));
+        length = ProfileCodec_EncodeResult(result, profile_reply);
+    } else {
+        return;
+    }
+
+    VESC_IF->send_app_data(profile_reply, (unsigned int)length);
+}
 
 // Called when the code is stopped
 static void stop(void *arg) {
     (void)arg;
 
-    if (generator_thread_data.running && playback_thread_data.running) {
-        generator_thread_data.running = false;
-        playback_thread_data.running = false;
+    VESC_IF->set_app_data_handler(NULL);
+    if (__atomic_load_n(&sync_mode, __ATOMIC_RELAXED) == SYNC_MODE_FOLLOWER) {
+        VESC_IF->can_set_eid_cb(NULL);
+    }
 
-        VESC_IF->request_terminate(generator_thread_data.thread);
-        VESC_IF->request_terminate(playback_thread_data.thread);
+    VESC_IF->mutex_lock(loop_mutex);
+    fade_out_audio();
+    if (stop_audio_threads()) {
+        VESC_IF->printf("Generator and playback threads terminated in stop function.\n");
+    }
+    VESC_IF->mutex_unlock(loop_mutex);
 
-        // Free the allocated buffers
-        for (int i = 0; i < NUM_BUFFERS; i++) {
-            if (buffers[i] != NULL) {
-                VESC_IF->free(buffers[i]);
-                buffers[i] = NULL;
-            }
+    if (telemetry_thread_data.running) {
+        telemetry_thread_data.running = false;
+        VESC_IF->request_terminate(telemetry_thread_data.thread);
+    }
+
+    // Don't leave a context waiting for events that will never come. It can still be on its way
+    // into the blocked queue, so give it a few tries.
+    for (int tries = 0; tries < 10; tries++) {
+        VESC_IF->mutex_lock(state_mutex);
+        if (event_waiting && VESC_IF->lbm_unblock_ctx_unboxed(event_waiter, VESC_IF->lbm_enc_sym_nil)) {
+            event_waiting = false;
         }
+        bool waiting = event_waiting;
+        VESC_IF->mutex_unlock(state_mutex);
 
-        VESC_IF->printf("Generator and playback threads terminated in stop function.\n");
+        if (!waiting) {
+            break;
+        }
+        VESC_IF->sleep_ms(1);
     }
+
+    EventLog_Free(&event_log);
+    VESC_IF->free(state_mutex);
+    VESC_IF->free(loop_mutex);
+    VESC_IF->free(playback_wake);
+    state_mutex = NULL;
+    loop_mutex = NULL;
+    playback_wake = NULL;
 }
 
 INIT_FUN(lib_info *info) {
     INIT_START
 
-    // Load the config
-    InitializeConfiguration(&Conf);
-    PrintInverterConfig(&Conf);
+    // Start with the first profile in the library
+    active_profile_index = 0;
+    Conf = &GetProfile(active_profile_index)->config;
+    PrintInverterConfig(Conf);
 
+    state_mutex = VESC_IF->mutex_create();
+    loop_mutex = VESC_IF->mutex_create();
+    playback_wake = VESC_IF->sem_create();
     generator_thread_data.running = false;
     playback_thread_data.running = false;
+    fading_out = false;
+    generator_finished = false;
+    Profiler_Init(&profiler, (float)BUFFER_LENGTH / sample_rate * 1000000.0f);
+    EventLog_Init(&event_log);
+    update_interval_buffers = 0;
+    snapshot_interval_buffers = 0;
+    snapshot_ready = false;
+    event_queue_start = 0;
+    event_queue_count = 0;
+    event_waiting = false;
+    custom_profile_loaded = false;
+    custom_base_index = 0;
+    sync_mode = SYNC_MODE_OFF;
+    sync_interval_buffers = 0;
+    sync_reference_valid = false;
+    sync_frames = 0;
+
+    // Every motor starts out still, with the generator's defaults
+    memset(motors, 0, sizeof(motors));
+    for (int i = 0; i < MAX_MOTORS; i++) {
+        motors[i].number = i + 1;
+        motors[i].active_speed_range_index = -1;
+        motors[i].rotor_state = ROTOR_STATE_COASTING;
+        SPWMGenerator_Init(&motors[i].generator);
+    }
+    motor_count = 1;
+    voltage_limit_max_duty = VOLTAGE_LIMIT_DEFAULT_MAX_DUTY;
+
+    // Telemetry runs independently of the audio loop, so the dashboard keeps updating while it is stopped
+    telemetry_rate_hz = TELEMETRY_DEFAULT_RATE_HZ;
+    telemetry_thread_data.running = true;
+    telemetry_thread_data.thread = VESC_IF->spawn(telemetry_loop, 1024, "telemetry_loop", NULL);
 
     VESC_IF->lbm_add_extension("ext-start-audio-loop", ext_start_audio_loop);
     VESC_IF->lbm_add_extension("ext-stop-audio-loop", ext_stop_audio_loop);
     VESC_IF->lbm_add_extension("ext-get-stats", ext_get_stats);
+    VESC_IF->lbm_add_extension("ext-print-stats", ext_print_stats);
+    VESC_IF->lbm_add_extension("ext-reset-stats", ext_reset_stats);
+    VESC_IF->lbm_add_extension("ext-get-status", ext_get_status);
     VESC_IF->lbm_add_extension("ext-set-motor-current", ext_set_motor_current);
     VESC_IF->lbm_add_extension("ext-set-motor-hz", ext_set_motor_hz);
     VESC_IF->lbm_add_extension("ext-set-motor-poles", ext_set_motor_poles);
     VESC_IF->lbm_add_extension("ext-set-speed-kmh", ext_set_speed_kmh);
+    VESC_IF->lbm_add_extension("ext-set-profile", ext_set_profile);
+    VESC_IF->lbm_add_extension("ext-get-profile", ext_get_profile);
+    VESC_IF->lbm_add_extension("ext-bench", ext_bench);
+    VESC_IF->lbm_add_extension("ext-set-telemetry-rate", ext_set_telemetry_rate);
+    VESC_IF->lbm_add_extension("ext-print-events", ext_print_events);
+    VESC_IF->lbm_add_extension("ext-send-events", ext_send_events);
+    VESC_IF->lbm_add_extension("ext-set-update-rate", ext_set_update_rate);
+    VESC_IF->lbm_add_extension("ext-set-snapshot-rate", ext_set_snapshot_rate);
+    VESC_IF->lbm_add_extension("ext-next-event", ext_next_event);
+    VESC_IF->lbm_add_extension("ext-wait-event", ext_wait_event);
+    VESC_IF->lbm_add_extension("ext-set-carrier-sync", ext_set_carrier_sync);
+    VESC_IF->lbm_add_extension("ext-get-carrier-sync", ext_get_carrier_sync);
+    VESC_IF->lbm_add_extension("ext-set-motor-count", ext_set_motor_count);
+    VESC_IF->lbm_add_extension("ext-set-voltage-limit", ext_set_voltage_limit);
+    VESC_IF->lbm_add_extension("ext-get-voltage-limit", ext_get_voltage_limit);
+    VESC_IF->set_app_data_handler(app_data_received);
 
 
 
@@ -6,22 +6,12 @@
 
 #define ZERO_CUTOFF_MARGIN_KMH 1 // Speed which the inverter turns off when slowing down
 
-#define INVERTER_CURRENT_RAMP_START 5.0
-#define INVERTER_CURRENT_RAMP_END 120.0
-
-#define INVERTER_AMPLITUDE_BASE 0.0
-#define INVERTER_AMPLITUDE_RAMP_START 0.00
-#define INVERTER_AMPLITUDE_RAMP_END 0.5
-
-#define INVERTER_AMPLITUDE_SPEED_RAMP_START_KMH 28.0
-#define INVERTER_AMPLITUDE_SPEED_RAMP_END_KMH 31.0
-#define INVERTER_AMPLITUDE_SPEED_SCALAR_START 1.0
-#define INVERTER_AMPLITUDE_SPEED_SCALAR_END 0.0
-
 #define COASTING_RPM_THRESHOLD 0.1 // RPM threshold to consider the rotor as coasting
 #define RPM_SAMPLE_COUNT 5        // Number of RPM samples to consider for state determination
 
 #define BUFFER_LENGTH 150
 #define SAMPLE_RATE_WARNING_THRESHOLD 1.2f
 #define NUM_BUFFERS 3
-#define NUM_MOTOR_STAT_SAMPLES 5
\ No newline at end of file
+#define NUM_MOTOR_STAT_SAMPLES 5
+#define MAX_MOTORS 2 // Motors one VESC can drive, dual motor controllers have two, see ext-set-motor-count
+#define EVENT_QUEUE_LENGTH 8 // Events kept for ext-next-event until Lisp picks them up
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include "ProfileCodec.h"
+#include "ByteOrder.h"
+
+#define PROFILE_SPWM_LENGTH 6
+
+static int16_t SpeedToI16(float _Speed) {
+    float value = _Speed * 100.0f;
+    if (value <= (float)INT16_MIN) return INT16_MIN;
+    if (value >= (float)INT16_MAX) return INT16_MAX;
+    return (int16_t)(value + (value < 0.0f ? -0.5f : 0.5f));
+}
+
+static uint16_t CarrierToU16(int _Carrier) {
+    if (_Carrier <= 0) return 0;
+    if (_Carrier >= UINT16_MAX) return UINT16_MAX;
+    return (uint16_t)_Carrier;
+}
+
+static float GetSpeed(const uint8_t* _Packet) {
+    return (float)(int16_t)GetU16(_Packet) / 100.0f;
+}
+
+static void EncodeSPWM(const SPWMConfig* _Config, uint8_t* _Packet) {
+    _Packet[0] = (uint8_t)_Config->type;
+    _Packet[1] = (uint8_t)(_Config->numPulses < 0 ? 0 : _Config->numPulses > 255 ? 255 : _Config->numPulses);
+    PutU16(_Packet + 2, CarrierToU16(_Config->carrierFrequencyStart));
+    PutU16(_Packet + 4, CarrierToU16(_Config->carrierFrequencyEnd));
+}
+
+static bool ValidSPWM(const uint8_t* _Packet) {
+    int carrierMax = SAMPLE_RATE / 2;
+    switch ((SPWMType)_Packet[0]) {
+        case SPWM_TYPE_NONE:
+            return true;
+        case SPWM_TYPE_SYNC:
+            return _Packet[1] > 0;
+        case SPWM_TYPE_FIXED_ASYNC:
+            return GetU16(_Packet + 2) > 0 && GetU16(_Packet + 2) <= carrierMax;
+        case SPWM_TYPE_RAMP_ASYNC:
+        case SPWM_TYPE_RSPWM:
+            return GetU16(_Packet + 2) > 0 && GetU16(_Packet + 2) <= carrierMax &&
+                   GetU16(_Packet + 4) > 0 && GetU16(_Packet + 4) <= carrierMax;
+    }
+    return false;
+}
+
+static void DecodeSPWM(const uint8_t* _Packet, SPWMConfig* _Config) {
+    _Config->type = (SPWMType)_Packet[0];
+    _Config->numPulses = _Packet[1];
+    _Config->carrierFrequencyStart = GetU16(_Packet + 2);
+    // A fixed carrier only has a start, keep the end the same like SPWM_ASYNC_FIXED does
+    _Config->carrierFrequencyEnd = _Config->type == SPWM_TYPE_FIXED_ASYNC ? _Config->carrierFrequencyStart : GetU16(_Packet + 4);
+}
+
+int ProfileCodec_Encode(const InverterProfile* _Profile, int _Index, int _BaseIndex, uint8_t* _Packet) {
+    const InverterConfig* config = &_Profile->config;
+    int count = config->speedRangeCount;
+    if (count < 0) count = 0;
+    if (count > MAX_SPEED_RANGES) count = MAX_SPEED_RANGES;
+
+    _Packet[0] = PROFILE_PACKET_ID;
+    _Packet[1] = PROFILE_VERSION;
+    _Packet[2] = PROFILE_CMD_DATA;
+    _Packet[3] = (uint8_t)_Index;
+
+    uint8_t* body = _Packet + PROFILE_HEADER_LENGTH;
+    for (int i = 0; i < PROFILE_NAME_LENGTH; i++) {
+        body[i] = 0;
+    }
+    for (int i = 0; i < PROFILE_NAME_LENGTH - 1 && _Profile->name[i]; i++) {
+        body[i] = (uint8_t)_Profile->name[i];
+    }
+    PutU16(body + PROFILE_NAME_LENGTH, (uint16_t)SpeedToI16(config->maxSpeed));
+    PutU16(body + PROFILE_NAME_LENGTH + 2, (uint16_t)SpeedToI16(config->zeroSpeedCutoffMargin));
+    body[PROFILE_NAME_LENGTH + 4] = (uint8_t)_BaseIndex;
+    body[PROFILE_NAME_LENGTH + 5] = (uint8_t)count;
+
+    uint8_t* range = body + PROFILE_BODY_LENGTH;
+    for (int i = 0; i < count; i++) {
+        const SpeedRange* source = &config->speedRanges[i];
+        PutU16(range, (uint16_t)SpeedToI16(source->minSpeed));
+        PutU16(range + 2, (uint16_t)SpeedToI16(source->maxSpeed));
+        EncodeSPWM(&source->spwm.acceleration, range + 4);
+        EncodeSPWM(&source->spwm.coasting, range + 4 + PROFILE_SPWM_LENGTH);
+        EncodeSPWM(&source->spwm.deceleration, range + 4 + 2 * PROFILE_SPWM_LENGTH);
+        range += PROFILE_RANGE_LENGTH;
+    }
+
+    return PROFILE_HEADER_LENGTH + PROFILE_BODY_LENGTH + count * PROFILE_RANGE_LENGTH;
+}
+
+int ProfileCodec_EncodeResult(ProfileResult _Result, uint8_t* _Packet) {
+    _Packet[0] = PROFILE_PACKET_ID;
+    _Packet[1] = PROFILE_VERSION;
+    _Packet[2] = PROFILE_CMD_RESULT;
+    _Packet[3] = (uint8_t)_Result;
+    return PROFILE_HEADER_LENGTH;
+}
+
+ProfileResult ProfileCodec_Validate(const uint8_t* _Packet, int _Length, int _BaseCount) {
+    if (_Length < PROFILE_HEADER_LENGTH + PROFILE_BODY_LENGTH || _Packet[0] != PROFILE_PACKET_ID ||
+        _Packet[1] != PROFILE_VERSION) {
+        return PROFILE_ERROR_FORMAT;
+    }
+
+    const uint8_t* body = _Packet + PROFILE_HEADER_LENGTH;
+    if (body[PROFILE_NAME_LENGTH + 4] >= _BaseCount) {
+        return PROFILE_ERROR_INDEX;
+    }
+
+    int count = body[PROFILE_NAME_LENGTH + 5];
+    if (count == 0 || count > MAX_SPEED_RANGES) {
+        return PROFILE_ERROR_RANGE_COUNT;
+    }
+    if (_Length != PROFILE_HEADER_LENGTH + PROFILE_BODY_LENGTH + count * PROFILE_RANGE_LENGTH) {
+        return PROFILE_ERROR_FORMAT;
+    }
+
+    const uint8_t* range = body + PROFILE_BODY_LENGTH;
+    float previousMin = 0.0f;
+    for (int i = 0; i < count; i++) {
+        float minSpeed = GetSpeed(range);
+        float maxSpeed = GetSpeed(range + 2);
+        if (maxSpeed <= minSpeed || (i > 0 && minSpeed < previousMin)) {
+            return PROFILE_ERROR_SPEEDS;
+        }
+        previousMin = minSpeed;
+
+        for (int state = 0; state < 3; state++) {
+            if (!ValidSPWM(range + 4 + state * PROFILE_SPWM_LENGTH)) {
+                return PROFILE_ERROR_SPWM;
+            }
+        }
+        range += PROFILE_RANGE_LENGTH;
+    }
+
+    return PROFILE_OK;
+}
+
+int ProfileCodec_Decode(const uint8_t* _Packet, InverterProfile* _Profile) {
+    const uint8_t* body = _Packet + PROFILE_HEADER_LENGTH;
+    InverterConfig* config = &_Profile->config;
+
+    for (int i = 0; i < PROFILE_NAME_LENGTH; i++) {
+        _Profile->name[i] = (char)body[i];
+    }
+    _Profile->name[PROFILE_NAME_LENGTH - 1] = '\0';
+    config->maxSpeed = GetSpeed(body + PROFILE_NAME_LENGTH);
+    config->zeroSpeedCutoffMargin = GetSpeed(body + PROFILE_NAME_LENGTH + 2);
+    config->speedRangeCount = body[PROFILE_NAME_LENGTH + 5];
+
+    const uint8_t* range = body + PROFILE_BODY_LENGTH;
+    for (int i = 0; i < config->speedRangeCount; i++) {
+        SpeedRange* target = &config->speedRanges[i];
+        target->minSpeed = GetSpeed(range);
+        target->maxSpeed = GetSpeed(range + 2);
+        DecodeSPWM(range + 4, &target->spwm.acceleration);
+        DecodeSPWM(range + 4 + PROFILE_SPWM_LENGTH, &target->spwm.coasting);
+        DecodeSPWM(range + 4 + 2 * PROFILE_SPWM_LENGTH, &target->spwm.deceleration);
+        range += PROFILE_RANGE_LENGTH;
+    }
+
+    return body[PROFILE_NAME_LENGTH + 4];
+}
+
+// A switch instead of a table of names, native libs are not relocated so a table of string
+// pointers would hold link-time addresses on the VESC, see InverterProfile in Profiles.h
+const char* ProfileCodec_GetResultName(ProfileResult _Result) {
+    switch (_Result) {
+        case PROFILE_OK: return "ok";
+        case PROFILE_ERROR_FORMAT: return "format";
+        case PROFILE_ERROR_INDEX: return "index";
+        case PROFILE_ERROR_RANGE_COUNT: return "range-count";
+        case PROFILE_ERROR_SPEEDS: return "speeds";
+        case PROFILE_ERROR_SPWM: return "spwm";
+        default: return "unknown";
+    }
+}
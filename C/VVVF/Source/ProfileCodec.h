@@ -0,0 +1,79 @@
+#ifndef PROFILE_CODEC_H
+#define PROFILE_CODEC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "Profiles.h"
+
+// Compact binary profile format, exchanged with the profile editor (Display/ProfileEditor.qml)
+// as app data. The editor asks for a profile, edits its speed ranges and sends it back, and the
+// plugin switches to it right away from a RAM slot after the built in profiles. No rebuild and
+// no Lisp involved.
+//
+// Every packet starts with:
+//   0  uint8   PROFILE_PACKET_ID
+//   1  uint8   PROFILE_VERSION
+//   2  uint8   command, PROFILE_CMD_*
+//   3  uint8   GET: index of the profile to send, PROFILE_INDEX_ACTIVE for the active one
+//              DATA: index of the profile that is sent
+//              APPLY: unused, the profile always goes into the RAM slot
+//              RESULT: ProfileResult
+//
+// DATA and APPLY continue with the profile:
+//   4  char[PROFILE_NAME_LENGTH]  name, NUL padded
+//   20 int16   max speed in 0.01 km/h
+//   22 int16   zero speed cutoff margin in 0.01 km/h
+//   24 uint8   base profile, the amplitude curves are taken from it
+//   25 uint8   number of speed ranges, up to MAX_SPEED_RANGES
+//   26 speed ranges, PROFILE_RANGE_LENGTH bytes each:
+//        0  int16   min speed in 0.01 km/h
+//        2  int16   max speed in 0.01 km/h
+//        4  acceleration, coasting and deceleration SPWM settings, 6 bytes each:
+//             0  uint8   SPWMType
+//             1  uint8   pulses, for SPWM_TYPE_SYNC
+//             2  uint16  carrier start in Hz
+//             4  uint16  carrier end in Hz
+// All fields are little endian, the same as the telemetry packet.
+//
+// The plugin answers GET with DATA, and APPLY with RESULT.
+
+#define PROFILE_PACKET_ID 0x50          // 'P'
+#define PROFILE_VERSION 1
+#define PROFILE_HEADER_LENGTH 4
+#define PROFILE_BODY_LENGTH (PROFILE_NAME_LENGTH + 6)
+#define PROFILE_RANGE_LENGTH 22
+#define PROFILE_MAX_PACKET_LENGTH (PROFILE_HEADER_LENGTH + PROFILE_BODY_LENGTH + MAX_SPEED_RANGES * PROFILE_RANGE_LENGTH)
+#define PROFILE_INDEX_ACTIVE 0xFF
+
+#define PROFILE_CMD_GET 0
+#define PROFILE_CMD_DATA 1
+#define PROFILE_CMD_APPLY 2
+#define PROFILE_CMD_RESULT 3
+
+typedef enum {
+    PROFILE_OK,
+    PROFILE_ERROR_FORMAT,       // Not a profile packet, wrong version or wrong length
+    PROFILE_ERROR_INDEX,        // No such profile
+    PROFILE_ERROR_RANGE_COUNT,  // No speed ranges, or more than MAX_SPEED_RANGES
+    PROFILE_ERROR_SPEEDS,       // A range ends before it starts, or the ranges are not ascending
+    PROFILE_ERROR_SPWM,         // Unknown SPWM type, a carrier outside 1 Hz to half the sample rate, or no pulses
+    PROFILE_RESULT_COUNT
+} ProfileResult;
+
+// Writes a DATA packet for _Profile and returns its length. _BaseIndex is the profile the
+// amplitude curves come from.
+int ProfileCodec_Encode(const InverterProfile* _Profile, int _Index, int _BaseIndex, uint8_t* _Packet);
+
+// Writes a RESULT packet and returns its length
+int ProfileCodec_EncodeResult(ProfileResult _Result, uint8_t* _Packet);
+
+// Checks an APPLY or DATA packet. _BaseCount is the number of valid base profiles.
+ProfileResult ProfileCodec_Validate(const uint8_t* _Packet, int _Length, int _BaseCount);
+
+// Reads the name, speeds and speed ranges of a packet that passed ProfileCodec_Validate into
+// _Profile, the amplitude curves are left alone. Returns the base profile index.
+int ProfileCodec_Decode(const uint8_t* _Packet, InverterProfile* _Profile);
+
+const char* ProfileCodec_GetResultName(ProfileResult _Result);
+
+#endif // PROFILE_CODEC_H
@@ -0,0 +1,59 @@
+#include "Profiler.h"
+#include "Parameters.h"
+#include <string.h>
+
+void Histogram_Init(Histogram* _Histogram, float _BinWidth) {
+    memset(_Histogram, 0, sizeof(Histogram));
+    _Histogram->binWidth = _BinWidth > 0.0f ? _BinWidth : 1.0f;
+}
+
+void Histogram_Add(Histogram* _Histogram, float _Value) {
+    int bin = (int)(_Value / _Histogram->binWidth);
+    if (bin < 0) bin = 0;
+    if (bin >= PROFILER_HISTOGRAM_BINS) bin = PROFILER_HISTOGRAM_BINS - 1;
+    _Histogram->bins[bin]++;
+
+    if (_Histogram->count == 0 || _Value < _Histogram->min) _Histogram->min = _Value;
+    if (_Histogram->count == 0 || _Value > _Histogram->max) _Histogram->max = _Value;
+    _Histogram->sum += _Value;
+    _Histogram->count++;
+}
+
+float Histogram_Mean(const Histogram* _Histogram) {
+    if (_Histogram->count == 0) return 0.0f;
+    return _Histogram->sum / (float)_Histogram->count;
+}
+
+void Profiler_Init(Profiler* _Profiler, float _BufferPeriodUs) {
+    memset(_Profiler, 0, sizeof(Profiler));
+    _Profiler->bufferPeriod = _BufferPeriodUs;
+
+    // Generation and the play call cover half the buffer period, anything in the last bin is a warning sign.
+    // Lead covers the whole queue, jitter a quarter period.
+    Histogram_Init(&_Profiler->generation, _BufferPeriodUs / (2 * PROFILER_HISTOGRAM_BINS));
+    Histogram_Init(&_Profiler->playCall, _BufferPeriodUs / (2 * PROFILER_HISTOGRAM_BINS));
+    Histogram_Init(&_Profiler->lead, _BufferPeriodUs * NUM_BUFFERS / PROFILER_HISTOGRAM_BINS);
+    Histogram_Init(&_Profiler->jitter, _BufferPeriodUs / (4 * PROFILER_HISTOGRAM_BINS));
+}
+
+void Profiler_AddGeneration(Profiler* _Profiler, float _Us) {
+    Histogram_Add(&_Profiler->generation, _Us);
+    _Profiler->buffersGenerated++;
+}
+
+void Profiler_AddPlayCall(Profiler* _Profiler, float _Us) {
+    Histogram_Add(&_Profiler->playCall, _Us);
+}
+
+void Profiler_AddConsumed(Profiler* _Profiler, float _LeadUs, float _IntervalUs) {
+    Histogram_Add(&_Profiler->lead, _LeadUs);
+    if (_IntervalUs >= 0.0f) {
+        float jitter = _IntervalUs - _Profiler->bufferPeriod;
+        Histogram_Add(&_Profiler->jitter, jitter < 0.0f ? -jitter : jitter);
+    }
+    _Profiler->buffersPlayed++;
+}
+
+void Profiler_AddUnderrun(Profiler* _Profiler) {
+    _Profiler->underruns++;
+}
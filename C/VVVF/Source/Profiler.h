@@ -0,0 +1,49 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+
+// Real time budget instrumentation for the generator and playback threads. Every buffer adds
+// one value to each histogram, so we can see how close we are to the deadline long before a
+// buffer actually arrives late. All times are in microseconds.
+//
+// The generator thread only writes the generation histogram and the playback thread only the
+// others. Nothing here locks: the plugin holds state_mutex around every update, read and reset,
+// since ext-reset-stats clears the histograms while both threads are adding to them.
+
+#define PROFILER_HISTOGRAM_BINS 16
+
+typedef struct {
+    uint32_t bins[PROFILER_HISTOGRAM_BINS]; // The last bin also counts everything above the range
+    float binWidth;
+    uint32_t count;
+    float min;
+    float max;
+    float sum;
+} Histogram;
+
+typedef struct {
+    Histogram generation;      // Time to generate one buffer
+    Histogram playCall;        // Duration of the foc_play_audio_samples call
+    Histogram lead;            // How long a buffer was ready before playback picked it up
+    Histogram jitter;          // Difference between the playback interval and the buffer period
+    uint32_t underruns;        // Buffers playback had to wait for after it started
+    uint32_t buffersGenerated;
+    uint32_t buffersPlayed;
+    float bufferPeriod;        // Time one buffer lasts at the sample rate
+} Profiler;
+
+void Histogram_Init(Histogram* _Histogram, float _BinWidth);
+void Histogram_Add(Histogram* _Histogram, float _Value);
+float Histogram_Mean(const Histogram* _Histogram);
+
+// Clears all histograms, with bin widths scaled to the buffer period
+void Profiler_Init(Profiler* _Profiler, float _BufferPeriodUs);
+
+void Profiler_AddGeneration(Profiler* _Profiler, float _Us);
+void Profiler_AddPlayCall(Profiler* _Profiler, float _Us);
+// _IntervalUs is the time since the previous buffer was picked up, negative for the first one
+void Profiler_AddConsumed(Profiler* _Profiler, float _LeadUs, float _IntervalUs);
+void Profiler_AddUnderrun(Profiler* _Profiler);
+
+#endif // PROFILER_H
@@ -0,0 +1,95 @@
+#include "Profiles.h"
+#include <string.h>
+
+// Built in profile library. Everything here is const so it stays in flash, the active
+// profile is selected by pointer at runtime so switching does not copy anything into RAM.
+// NOTE: THE SPEED RANGE VALUES *MUST* BE IN ASCENDING ORDER (Low index = closer to 0 speed, higher = higher speed)
+static const InverterProfile Profiles[] = {
+    {
+        .name = "fixed-4000",
+        .config = {
+            .maxSpeed = MAX_SPEED_KMH,
+            .zeroSpeedCutoffMargin = ZERO_CUTOFF_MARGIN_KMH,
+            .speedRanges = {
+                SPEED_RANGE_ALL(-1.0f, 999.0f, SPWM_ASYNC_FIXED(4000)),
+            },
+            .speedRangeCount = 1,
+            .amplitude = AMPLITUDE_ALL(AMPLITUDE_DEFAULT),
+        },
+    },
+    {
+        // Ramping async carrier at low speed, then 11/7/3/1 pulse synchronous modes
+        .name = "async-sync",
+        .config = {
+            .maxSpeed = MAX_SPEED_KMH,
+            .zeroSpeedCutoffMargin = ZERO_CUTOFF_MARGIN_KMH,
+            .speedRanges = {
+                SPEED_RANGE_ALL(-1.0f, 5.0f, SPWM_ASYNC_RAMP(250, 500)),
+                SPEED_RANGE_ALL(5.0f, 20.0f, SPWM_ASYNC_FIXED(500)),
+                SPEED_RANGE(20.0f, 21.0f, SPWM_ASYNC_RAMP(500, 300), SPWM_ASYNC_RAMP(500, 300), SPWM_ASYNC_FIXED(500)),
+                SPEED_RANGE_ALL(21.0f, 27.0f, SPWM_SYNC(11)),
+                SPEED_RANGE_ALL(27.0f, 40.0f, SPWM_SYNC(7)),
+                SPEED_RANGE_ALL(40.0f, 48.0f, SPWM_SYNC(3)), // No wide pulse
+                SPEED_RANGE_ALL(48.0f, 55.0f, SPWM_SYNC(3)), // Wide pulse
+                SPEED_RANGE(55.0f, 150.0f, SPWM_SYNC(1), SPWM_SYNC(3), SPWM_SYNC(1)),
+            },
+            .speedRangeCount = 8,
+            .amplitude = AMPLITUDE_ALL(AMPLITUDE_DEFAULT),
+        },
+    },
+    {
+        // Async carrier only, ramping up through the low speed ranges
+        .name = "async-ramp",
+        .config = {
+            .maxSpeed = MAX_SPEED_KMH,
+            .zeroSpeedCutoffMargin = ZERO_CUTOFF_MARGIN_KMH,
+            .speedRanges = {
+                SPEED_RANGE_ALL(-1.0f, 5.0f, SPWM_ASYNC_RAMP(250, 500)),
+                SPEED_RANGE_ALL(5.0f, 20.0f, SPWM_ASYNC_FIXED(500)),
+                SPEED_RANGE(20.0f, 999.0f, SPWM_ASYNC_RAMP(500, 300), SPWM_ASYNC_RAMP(500, 300), SPWM_ASYNC_FIXED(500)),
+            },
+            .speedRangeCount = 3,
+            .amplitude = AMPLITUDE_ALL(AMPLITUDE_DEFAULT),
+        },
+    },
+    {
+        // Fixed async carrier stepping between 1160 Hz and 1460 Hz
+        .name = "stepping",
+        .config = {
+            .maxSpeed = MAX_SPEED_KMH,
+            .zeroSpeedCutoffMargin = ZERO_CUTOFF_MARGIN_KMH,
+            .speedRanges = {
+                SPEED_RANGE(0.0f, 10.0f, SPWM_ASYNC_FIXED(1235), SPWM_ASYNC_FIXED(1235), SPWM_ASYNC_FIXED(1160)),
+                SPEED_RANGE_ALL(10.0f, 15.0f, SPWM_ASYNC_FIXED(1190)),
+                SPEED_RANGE_ALL(15.0f, 20.0f, SPWM_ASYNC_FIXED(1210)),
+                SPEED_RANGE_ALL(20.0f, 23.0f, SPWM_ASYNC_FIXED(1235)),
+                SPEED_RANGE_ALL(23.0f, 27.0f, SPWM_ASYNC_FIXED(1460)),
+                SPEED_RANGE_ALL(27.0f, 32.0f, SPWM_ASYNC_FIXED(1210)),
+                SPEED_RANGE_ALL(32.0f, 999.0f, SPWM_ASYNC_FIXED(1230)),
+            },
+            .speedRangeCount = 7,
+            .amplitude = AMPLITUDE_ALL(AMPLITUDE_DEFAULT),
+        },
+    },
+};
+
+#define PROFILE_COUNT (int)(sizeof(Profiles) / sizeof(Profiles[0]))
+
+int GetProfileCount(void) {
+    return PROFILE_COUNT;
+}
+
+const InverterProfile* GetProfile(int _Index) {
+    if (_Index < 0 || _Index >= PROFILE_COUNT) return NULL;
+    return &Profiles[_Index];
+}
+
+int FindProfileByName(const char* _Name) {
+    if (!_Name) return -1;
+    for (int i = 0; i < PROFILE_COUNT; i++) {
+        if (strncmp(Profiles[i].name, _Name, PROFILE_NAME_LENGTH) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
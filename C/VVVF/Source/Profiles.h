@@ -0,0 +1,49 @@
+#ifndef PROFILES_H
+#define PROFILES_H
+
+#include "ConfigParser.h"
+
+#define PROFILE_NAME_LENGTH 16
+
+// Static initializer versions of the AddSPWM_* helpers, so that profiles can be built as const tables in flash
+#define SPWM_ASYNC_FIXED(_Carrier) { SPWM_TYPE_FIXED_ASYNC, (_Carrier), (_Carrier), 0 }
+#define SPWM_ASYNC_RAMP(_Start, _End) { SPWM_TYPE_RAMP_ASYNC, (_Start), (_End), 0 }
+#define SPWM_RSPWM(_Min, _Max) { SPWM_TYPE_RSPWM, (_Min), (_Max), 0 }
+#define SPWM_SYNC(_NumPulses) { SPWM_TYPE_SYNC, 0, 0, (_NumPulses) }
+#define SPWM_DISABLED() { SPWM_TYPE_NONE, 0, 0, 0 }
+
+// Speed range with separate acceleration, coasting and deceleration settings
+#define SPEED_RANGE(_Min, _Max, _Accel, _Coast, _Decel) { (_Min), (_Max), { _Accel, _Coast, _Decel } }
+// Speed range using the same setting for every rotor state
+#define SPEED_RANGE_ALL(_Min, _Max, _Config) { (_Min), (_Max), { _Config, _Config, _Config } }
+
+// Amplitude curves for one rotor state, see Curve.h for CURVE()
+#define AMPLITUDE(_Current, _Speed) { _Current, _Speed }
+// Amplitude with separate acceleration, coasting and deceleration curves
+#define AMPLITUDE_STATES(_Accel, _Coast, _Decel) { _Accel, _Coast, _Decel }
+// Amplitude using the same curves for every rotor state
+#define AMPLITUDE_ALL(_Amplitude) { _Amplitude, _Amplitude, _Amplitude }
+
+// Default amplitude: ramp from 0 V at 5 A to 0.5 V at 120 A at every speed. Near top speed the
+// voltage limiter takes it down to what the motor control leaves, see VoltageLimit.h
+#define AMPLITUDE_CURRENT_DEFAULT CURVE({ 5.0f, 0.0f }, { 120.0f, 0.5f })
+#define AMPLITUDE_SPEED_DEFAULT CURVE({ 0.0f, 1.0f })
+#define AMPLITUDE_DEFAULT AMPLITUDE(AMPLITUDE_CURRENT_DEFAULT, AMPLITUDE_SPEED_DEFAULT)
+
+// A named inverter configuration. The name is stored inline (not as a pointer) because
+// native libs are not relocated when loaded, so pointers in initialized data would be invalid.
+typedef struct {
+    char name[PROFILE_NAME_LENGTH];
+    InverterConfig config;
+} InverterProfile;
+
+// Number of profiles in the built in library
+int GetProfileCount(void);
+
+// Returns the profile at the given index, or NULL if out of range
+const InverterProfile* GetProfile(int _Index);
+
+// Returns the index of the profile with the given name, or -1 if there is none
+int FindProfileByName(const char* _Name);
+
+#endif // PROFILES_H
@@ -39,29 +39,31 @@ static const uint16_t random_lookup_table[256] = {
     144, 78, 199, 65, 122, 87, 33, 210, 99, 45, 177, 66, 88, 150, 44
 };
 
-// Index to track the current position in the lookup table
-static uint16_t lookup_index = 0;
-
-// LFSR state for additional randomness
-static uint16_t lfsr = 0xACE1u; // Example seed
+// Restart the random sequence, so that RSPWM output can be reproduced
+void SPWMGenerator_SeedRandom(SPWMGenerator* generator, uint16_t seed) {
+    generator->RandomIndex = 0;
+    generator->RandomState = seed ? seed : RSPWM_DEFAULT_SEED; // An all zero LFSR never leaves zero
+}
 
 // Get the next random number from the lookup table and LFSR
-uint16_t get_enhanced_random() {
+static uint16_t get_enhanced_random(SPWMGenerator* generator) {
     // Get a value from the lookup table
-    uint16_t lookup_value = random_lookup_table[lookup_index];
-    lookup_index = (lookup_index + 1) % 256; // Wrap around after 256 values
+    uint16_t lookup_value = random_lookup_table[generator->RandomIndex];
+    generator->RandomIndex = (generator->RandomIndex + 1) % 256; // Wrap around after 256 values
 
     // Update the LFSR for additional randomness
+    uint16_t lfsr = generator->RandomState;
     uint16_t bit = ((lfsr >> 0) ^ (lfsr >> 2) ^ (lfsr >> 3) ^ (lfsr >> 5)) & 1;
     lfsr = (lfsr >> 1) | (bit << 15);
+    generator->RandomState = lfsr;
 
     // Combine the lookup value and LFSR output
     return (lookup_value ^ lfsr); // XOR for mixing
 }
 
 // Generate a random number between min and max (inclusive)
-int random_range(int min, int max) {
-    uint16_t rand_val = get_enhanced_random();
+static int random_range(SPWMGenerator* generator, int min, int max) {
+    uint16_t rand_val = get_enhanced_random(generator);
     int range = max - min + 1;
     return min + (rand_val % range);
 }
@@ -74,6 +76,9 @@ void SPWMGenerator_Init(SPWMGenerator* generator) {
     generator->CommandFrequency = 100.0f;    // Default command frequency
     generator->ModulationIndex = 1.0f;     // Default modulation index
     generator->Amplitude = 0.0f;           // Default amplitude
+    generator->CarrierFrequencyTrim = 0.0f;
+    generator->CommandFrequencyTrim = 0.0f;
+    SPWMGenerator_SeedRandom(generator, RSPWM_DEFAULT_SEED);
 }
 
 
@@ -96,7 +101,7 @@ int SPWMGenerator_GenerateSamples(SPWMGenerator* generator, RotorState _RotorSta
     if (!generator || !buffer || !speedRange) return false;
 
     // Firstly check if disabled, if so, set audio to none
-    if (speedRange->spwm.acceleration.type == SPWM_TYPE_NONE) {
+    if (!SPWMGenerator_IsOutputEnabled(speedRange)) {
         for (int i = 0; i < bufferLength; i++) {
             buffer[i] = 0;
         }
@@ -129,19 +134,30 @@ int SPWMGenerator_GenerateSamples(SPWMGenerator* generator, RotorState _RotorSta
         } else if (spwm_config->type == SPWM_TYPE_SYNC) {
             generator->CarrierFrequency = (CommandHZ / (float)NumPoles) * spwm_config->numPulses;
         } else if (spwm_config->type == SPWM_TYPE_RSPWM) {
-            generator->CarrierFrequency = random_range(spwm_config->carrierFrequencyStart, spwm_config->carrierFrequencyEnd);
+            generator->CarrierFrequency = random_range(generator, spwm_config->carrierFrequencyStart, spwm_config->carrierFrequencyEnd);
         }
     }
 
+    SPWMGenerator_ContinueSamples(generator, buffer, bufferLength);
+    return true;
+}
+
+// Whether the speed range has any output, a range without one is the off state
+bool SPWMGenerator_IsOutputEnabled(const SpeedRange* speedRange) {
+    return speedRange->spwm.acceleration.type != SPWM_TYPE_NONE;
+}
+
+// Carries on with the carrier and command frequencies of the last buffer, e.g. to fade them out
+// once the speed range has no output any more
+void SPWMGenerator_ContinueSamples(SPWMGenerator* generator, int8_t* buffer, int bufferLength) {
+    float commandStep = SPWMGenerator_PhaseStep(generator->CommandFrequency + generator->CommandFrequencyTrim);
+    float carrierStep = SPWMGenerator_PhaseStep(generator->CarrierFrequency + generator->CarrierFrequencyTrim);
+
     // Generate SPWM samples
     for (int i = 0; i < bufferLength; i++) {
-        // Update phases
-        generator->CommandPhase += (TWO_PI * generator->CommandFrequency) / SAMPLE_RATE;
-        generator->CarrierPhase += (TWO_PI * generator->CarrierFrequency) / SAMPLE_RATE;
-
-        // Wrap phases
-        if (generator->CommandPhase >= TWO_PI) generator->CommandPhase -= TWO_PI;
-        if (generator->CarrierPhase >= TWO_PI) generator->CarrierPhase -= TWO_PI;
+        // Update phases, a single wrap is enough since the steps are below one cycle
+        generator->CommandPhase = SPWMGenerator_WrapPhase(generator->CommandPhase + commandStep);
+        generator->CarrierPhase = SPWMGenerator_WrapPhase(generator->CarrierPhase + carrierStep);
 
         // Generate command and carrier signals
         // int8_t carrier = SPWMGenerator_GenerateSawtooth(generator->CarrierPhase);
@@ -151,12 +167,31 @@ int SPWMGenerator_GenerateSamples(SPWMGenerator* generator, RotorState _RotorSta
         // int8_t output = CommandCarrierLogic(command, carrier);
         buffer[i] = carrier;
     }
-
-    return true;
 }
 
 
 
+// Phase increment per sample. Frequencies of a whole sample rate or more (a sync carrier at
+// high speed) alias anyway, dropping the whole cycles keeps the step within one cycle so
+// that SPWMGenerator_WrapPhase only ever has to wrap once.
+float SPWMGenerator_PhaseStep(float frequency) {
+    float step = (TWO_PI * frequency) / SAMPLE_RATE;
+    if (step >= TWO_PI || step <= -TWO_PI) {
+        step -= TWO_PI * (float)(int)(step / TWO_PI);
+    }
+    return step;
+}
+
+// Brings a phase that moved by at most one step back into [0, TWO_PI), in either direction
+float SPWMGenerator_WrapPhase(float phase) {
+    if (phase >= TWO_PI) return phase - TWO_PI;
+    if (phase < 0.0f) {
+        phase += TWO_PI;
+        return phase < TWO_PI ? phase : 0.0f; // A tiny negative phase rounds up to TWO_PI itself
+    }
+    return phase;
+}
+
 // Map a value from one range to another
 float SPWMGenerator_MapValue(float value, float inMin, float inMax, float outMin, float outMax) {
     if (inMin == inMax) return outMin; // Avoid division by zero
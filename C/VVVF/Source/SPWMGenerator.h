@@ -1,6 +1,7 @@
 #ifndef SPWM_GENERATOR_H
 #define SPWM_GENERATOR_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "ConfigParser.h" // For SpeedRange and other dependencies
 #include "Parameters.h"
@@ -10,6 +11,7 @@
 #define INT8_SCALE 127
 #define TWO_PI 6.28318530718f
 #define SAWTOOTH_MAX 127 // Maximum value for the sawtooth (int8 range: 0-127)
+#define RSPWM_DEFAULT_SEED 0xACE1u // Initial LFSR state of the RSPWM random carrier
 
 // Sine lookup table
 extern const int8_t SineLookupTable[SINE_TABLE_SIZE];
@@ -22,11 +24,20 @@ typedef struct {
     float CommandFrequency;   // Current command frequency
     float ModulationIndex;    // Modulation index for SPWM
     float Amplitude;          // Output amplitude scaling
+    float CarrierFrequencyTrim; // Added to the carrier frequency, set by the carrier sync of a follower
+    float CommandFrequencyTrim; // Added to the command frequency, likewise
+    uint16_t RandomIndex;     // Position in the RSPWM random lookup table
+    uint16_t RandomState;     // RSPWM LFSR state, every generator has its own random sequence
 } SPWMGenerator;
 
 // Function Prototypes
 void SPWMGenerator_Init(SPWMGenerator* generator);
+void SPWMGenerator_SeedRandom(SPWMGenerator* generator, uint16_t seed);
 int SPWMGenerator_GenerateSamples(SPWMGenerator* generator, RotorState _RotorState, int8_t* buffer, int bufferLength, const SpeedRange* speedRange, float CommandHZ, int NumPoles, float Speed_kmh);
+bool SPWMGenerator_IsOutputEnabled(const SpeedRange* speedRange);
+void SPWMGenerator_ContinueSamples(SPWMGenerator* generator, int8_t* buffer, int bufferLength);
+float SPWMGenerator_PhaseStep(float frequency);
+float SPWMGenerator_WrapPhase(float phase);
 float SPWMGenerator_MapValue(float value, float inMin, float inMax, float outMin, float outMax);
 int8_t SPWMGenerator_GenerateSin(float phase);
 int8_t SPWMGenerator_GenerateSawtooth(float phase);
@@ -0,0 +1,123 @@
+#include "Snapshot.h"
+#include "ByteOrder.h"
+
+static uint16_t Clamp16(float _Value) {
+    if (_Value <= 0.0f) return 0;
+    if (_Value >= 65535.0f) return 65535;
+    return (uint16_t)(_Value + 0.5f);
+}
+
+// Nibble writer for the delta encoding, returns false once _Max bytes are used
+static bool PutNibble(uint8_t* _Data, int* _Nibbles, int _Max, uint8_t _Value) {
+    int byte = *_Nibbles / 2;
+    if (byte >= _Max) return false;
+    if (*_Nibbles % 2 == 0) {
+        _Data[byte] = (uint8_t)(_Value << 4);
+    } else {
+        _Data[byte] |= _Value & 0x0F;
+    }
+    (*_Nibbles)++;
+    return true;
+}
+
+static uint8_t GetNibble(const uint8_t* _Data, int _Nibble) {
+    return (_Nibble % 2 == 0) ? (uint8_t)(_Data[_Nibble / 2] >> 4) : (uint8_t)(_Data[_Nibble / 2] & 0x0F);
+}
+
+// Linear prediction from the two previous samples, a triangle carrier only misses it at its peaks
+static int Predict(const int8_t* _Samples, int _Index) {
+    if (_Index < 2) return _Samples[_Index - 1];
+    return 2 * _Samples[_Index - 1] - _Samples[_Index - 2];
+}
+
+// Returns the number of bytes used, or -1 if delta encoding would not be shorter than _Count bytes
+static int EncodeDelta(const int8_t* _Samples, int _Count, uint8_t* _Data) {
+    if (_Count == 0) return -1;
+    _Data[0] = (uint8_t)_Samples[0];
+    int nibbles = 2;
+    for (int i = 1; i < _Count; i++) {
+        int delta = _Samples[i] - Predict(_Samples, i);
+        bool ok;
+        if (delta >= -7 && delta <= 7) {
+            ok = PutNibble(_Data, &nibbles, _Count - 1, (uint8_t)(delta & 0x0F));
+        } else {
+            uint8_t sample = (uint8_t)_Samples[i];
+            ok = PutNibble(_Data, &nibbles, _Count - 1, SNAPSHOT_ESCAPE) &&
+                 PutNibble(_Data, &nibbles, _Count - 1, sample >> 4) &&
+                 PutNibble(_Data, &nibbles, _Count - 1, sample & 0x0F);
+        }
+        if (!ok) return -1;
+    }
+    return (nibbles + 1) / 2;
+}
+
+int Snapshot_Encode(const SnapshotInfo* _Info, const int8_t* _Samples, int _Count, uint8_t* _Packet) {
+    if (_Count > SNAPSHOT_MAX_SAMPLES) _Count = SNAPSHOT_MAX_SAMPLES;
+    if (_Count < 0) _Count = 0;
+
+    uint8_t* data = _Packet + SNAPSHOT_HEADER_LENGTH;
+    int length = EncodeDelta(_Samples, _Count, data);
+    uint8_t flags = _Info->enabled ? SNAPSHOT_FLAG_ENABLED : 0;
+    if (length >= 0) {
+        flags |= SNAPSHOT_FLAG_DELTA;
+    } else {
+        for (int i = 0; i < _Count; i++) {
+            data[i] = (uint8_t)_Samples[i];
+        }
+        length = _Count;
+    }
+
+    _Packet[0] = SNAPSHOT_PACKET_ID;
+    _Packet[1] = SNAPSHOT_VERSION;
+    _Packet[2] = flags;
+    _Packet[3] = (uint8_t)_Count;
+    PutU16(_Packet + 4, _Info->sequence);
+    PutU16(_Packet + 6, Clamp16(_Info->sampleRate));
+    PutU16(_Packet + 8, Clamp16(_Info->carrierHz));
+    PutU16(_Packet + 10, Clamp16(_Info->amplitude * 1000.0f));
+    return SNAPSHOT_HEADER_LENGTH + length;
+}
+
+int Snapshot_Decode(const uint8_t* _Packet, int _Length, SnapshotInfo* _Info, int8_t* _Samples) {
+    if (_Length < SNAPSHOT_HEADER_LENGTH || _Packet[0] != SNAPSHOT_PACKET_ID || _Packet[1] != SNAPSHOT_VERSION) {
+        return -1;
+    }
+
+    uint8_t flags = _Packet[2];
+    int count = _Packet[3];
+    _Info->sequence = GetU16(_Packet + 4);
+    _Info->sampleRate = (float)GetU16(_Packet + 6);
+    _Info->carrierHz = (float)GetU16(_Packet + 8);
+    _Info->amplitude = (float)GetU16(_Packet + 10) / 1000.0f;
+    _Info->enabled = (flags & SNAPSHOT_FLAG_ENABLED) != 0;
+
+    const uint8_t* data = _Packet + SNAPSHOT_HEADER_LENGTH;
+    int available = _Length - SNAPSHOT_HEADER_LENGTH;
+
+    if (!(flags & SNAPSHOT_FLAG_DELTA)) {
+        if (available < count) return -1;
+        for (int i = 0; i < count; i++) {
+            _Samples[i] = (int8_t)data[i];
+        }
+        return count;
+    }
+
+    if (count == 0) return 0;
+    if (available < 1) return -1;
+    _Samples[0] = (int8_t)data[0];
+    int nibble = 2;
+    for (int i = 1; i < count; i++) {
+        if (nibble / 2 >= available) return -1;
+        uint8_t value = GetNibble(data, nibble++);
+        if (value == SNAPSHOT_ESCAPE) {
+            if ((nibble + 1) / 2 >= available) return -1;
+            uint8_t high = GetNibble(data, nibble++);
+            uint8_t low = GetNibble(data, nibble++);
+            _Samples[i] = (int8_t)(uint8_t)((high << 4) | low);
+        } else {
+            int delta = value >= 8 ? (int)value - 16 : (int)value;
+            _Samples[i] = (int8_t)(Predict(_Samples, i) + delta);
+        }
+    }
+    return count;
+}
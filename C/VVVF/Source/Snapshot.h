@@ -0,0 +1,57 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Copy of one generated sample buffer, pushed to VESC Tool with send_app_data so the dashboard
+// (Display/CombinedMain.qml) can draw a scope trace and a spectrogram of the actual output.
+// The generator only copies the buffer (one every N, see ext-set-snapshot-rate), the telemetry
+// thread encodes and sends it.
+//
+// Layout, all fields little endian:
+//   0  uint8   SNAPSHOT_PACKET_ID
+//   1  uint8   SNAPSHOT_VERSION
+//   2  uint8   flags, SNAPSHOT_FLAG_*
+//   3  uint8   number of samples
+//   4  uint16  sequence, the number of the buffer since the audio loop was started, wraps
+//   6  uint16  sample rate in Hz
+//   8  uint16  carrier frequency in Hz
+//   10 uint16  amplitude in mV
+//   12 samples
+//
+// Samples are int8, either raw or delta encoded (SNAPSHOT_FLAG_DELTA). Delta encoding stores the
+// first sample as a byte, then one nibble per sample, high nibble first: the difference to the
+// prediction from -7 to 7, or SNAPSHOT_ESCAPE followed by two nibbles with the sample itself. The
+// prediction is 2 * s[i - 1] - s[i - 2], and s[0] for the second sample, so the straight flanks of
+// the triangle carrier cost half a byte per sample and only its peaks are escaped. The last byte
+// is padded with a 0 nibble. The encoder falls back to raw samples when those are shorter, so a
+// packet is never longer than SNAPSHOT_MAX_PACKET_LENGTH.
+
+#define SNAPSHOT_PACKET_ID 0x57        // 'W'
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_HEADER_LENGTH 12
+#define SNAPSHOT_MAX_SAMPLES 255
+#define SNAPSHOT_MAX_PACKET_LENGTH (SNAPSHOT_HEADER_LENGTH + SNAPSHOT_MAX_SAMPLES)
+#define SNAPSHOT_FLAG_DELTA 0x01
+#define SNAPSHOT_FLAG_ENABLED 0x02      // Inverter output was enabled for this buffer
+#define SNAPSHOT_ESCAPE 0x8
+
+#define SNAPSHOT_MAX_RATE_HZ 20
+
+typedef struct {
+    uint16_t sequence;
+    float sampleRate;
+    float carrierHz;
+    float amplitude;
+    bool enabled;
+} SnapshotInfo;
+
+// Writes the packet and returns its length. At most SNAPSHOT_MAX_SAMPLES samples are encoded.
+int Snapshot_Encode(const SnapshotInfo* _Info, const int8_t* _Samples, int _Count, uint8_t* _Packet);
+
+// Returns the number of samples written to _Samples, which must hold SNAPSHOT_MAX_SAMPLES, or -1
+// if the packet is not one of ours, has a different version or is truncated
+int Snapshot_Decode(const uint8_t* _Packet, int _Length, SnapshotInfo* _Info, int8_t* _Samples);
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,37 @@
+#include "Telemetry.h"
+#include "ByteOrder.h"
+
+static int32_t Clamp(float _Value, int32_t _Min, int32_t _Max) {
+    if (_Value <= (float)_Min) return _Min;
+    if (_Value >= (float)_Max) return _Max;
+    return (int32_t)(_Value + (_Value < 0.0f ? -0.5f : 0.5f));
+}
+
+void Telemetry_Encode(const TelemetryStatus* _Status, uint8_t* _Packet) {
+    _Packet[0] = TELEMETRY_PACKET_ID;
+    _Packet[1] = TELEMETRY_VERSION;
+    PutU16(_Packet + 2, (uint16_t)(int16_t)Clamp(_Status->speedKmh * 100.0f, INT16_MIN, INT16_MAX));
+    _Packet[4] = (uint8_t)(int8_t)Clamp((float)_Status->rangeIndex, INT8_MIN, INT8_MAX);
+    _Packet[5] = (uint8_t)_Status->rotorState;
+    _Packet[6] = (uint8_t)_Status->spwmType;
+    _Packet[7] = _Status->enabled ? TELEMETRY_FLAG_ENABLED : 0;
+    PutU16(_Packet + 8, (uint16_t)Clamp(_Status->carrierHz, 0, UINT16_MAX));
+    PutU16(_Packet + 10, (uint16_t)Clamp(_Status->amplitude * 1000.0f, 0, UINT16_MAX));
+    PutU32(_Packet + 12, _Status->underruns);
+}
+
+bool Telemetry_Decode(const uint8_t* _Packet, int _Length, TelemetryStatus* _Status) {
+    if (_Length < TELEMETRY_PACKET_LENGTH || _Packet[0] != TELEMETRY_PACKET_ID || _Packet[1] != TELEMETRY_VERSION) {
+        return false;
+    }
+
+    _Status->speedKmh = (float)(int16_t)GetU16(_Packet + 2) / 100.0f;
+    _Status->rangeIndex = (int8_t)_Packet[4];
+    _Status->rotorState = (RotorState)_Packet[5];
+    _Status->spwmType = (SPWMType)_Packet[6];
+    _Status->enabled = (_Packet[7] & TELEMETRY_FLAG_ENABLED) != 0;
+    _Status->carrierHz = (float)GetU16(_Packet + 8);
+    _Status->amplitude = (float)GetU16(_Packet + 10) / 1000.0f;
+    _Status->underruns = (uint32_t)GetU16(_Packet + 12) | ((uint32_t)GetU16(_Packet + 14) << 16);
+    return true;
+}
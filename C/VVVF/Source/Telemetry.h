@@ -0,0 +1,48 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ConfigParser.h"
+
+// Compact binary status packet, pushed to VESC Tool with send_app_data at a fixed rate so that
+// the dashboard (Display/CombinedMain.qml) does not have to poll or parse printf output.
+//
+// Layout, all fields little endian:
+//   0  uint8   TELEMETRY_PACKET_ID
+//   1  uint8   TELEMETRY_VERSION
+//   2  int16   speed in 0.01 km/h
+//   4  int8    active speed range index, -1 when disabled
+//   5  uint8   rotor state (RotorState)
+//   6  uint8   SPWM type (SPWMType)
+//   7  uint8   flags, bit 0 set while the inverter output is enabled
+//   8  uint16  carrier frequency in Hz
+//   10 uint16  amplitude in mV
+//   12 uint32  underruns since the audio loop was started
+
+#define TELEMETRY_PACKET_ID 0x56       // 'V', tells our packets apart from other app data
+#define TELEMETRY_VERSION 1
+#define TELEMETRY_PACKET_LENGTH 16
+#define TELEMETRY_FLAG_ENABLED 0x01
+
+#define TELEMETRY_DEFAULT_RATE_HZ 10
+#define TELEMETRY_MAX_RATE_HZ 50
+
+typedef struct {
+    float speedKmh;
+    int rangeIndex;
+    RotorState rotorState;
+    SPWMType spwmType;
+    bool enabled;
+    float carrierHz;
+    float amplitude;
+    uint32_t underruns;
+} TelemetryStatus;
+
+// Writes TELEMETRY_PACKET_LENGTH bytes, values outside the field ranges are clamped
+void Telemetry_Encode(const TelemetryStatus* _Status, uint8_t* _Packet);
+
+// Returns false if the packet is not one of ours or has a different version
+bool Telemetry_Decode(const uint8_t* _Packet, int _Length, TelemetryStatus* _Status);
+
+#endif // TELEMETRY_H
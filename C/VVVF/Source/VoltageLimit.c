@@ -0,0 +1,29 @@
+#include "VoltageLimit.h"
+
+float VoltageLimit_Headroom(float _Duty, float _InputVoltage, float _MaxDuty) {
+    float duty = _Duty < 0.0f ? -_Duty : _Duty;
+    if (duty >= _MaxDuty || _InputVoltage <= 0.0f) {
+        return 0.0f;
+    }
+    return (_MaxDuty - duty) * _InputVoltage * VOLTAGE_LIMIT_PHASE_PER_DUTY;
+}
+
+void VoltageLimit_Reset(VoltageLimiter* _Limiter) {
+    _Limiter->limit = 0.0f;
+    _Limiter->valid = false;
+}
+
+float VoltageLimit_Update(VoltageLimiter* _Limiter, float _Headroom, float _IntervalS) {
+    if (!_Limiter->valid || _Headroom <= _Limiter->limit) {
+        // Less headroom has to be respected right away
+        _Limiter->limit = _Headroom;
+        _Limiter->valid = true;
+    } else {
+        float share = _IntervalS / VOLTAGE_LIMIT_RELEASE_S;
+        if (share > 1.0f) {
+            share = 1.0f;
+        }
+        _Limiter->limit += (_Headroom - _Limiter->limit) * share;
+    }
+    return _Limiter->limit;
+}
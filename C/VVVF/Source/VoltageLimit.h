@@ -0,0 +1,35 @@
+#ifndef VOLTAGE_LIMIT_H
+#define VOLTAGE_LIMIT_H
+
+#include <stdbool.h>
+
+// Caps the injection voltage to the headroom the motor control has left. FOC turns the d and q
+// voltages into a duty cycle, and once that reaches the firmware's maximum the modulation
+// saturates: the current controllers lose their authority and the motor runs rough. The audio is
+// added on top of the control voltage, so it must never take more than what is left between the
+// duty the motor runs at and the ceiling.
+//
+// The headroom is measured before every buffer is played, from mc_get_duty_cycle_now and
+// mc_get_input_voltage_filtered. The limit follows it down at once and back up over
+// VOLTAGE_LIMIT_RELEASE_S, so the sound comes back smoothly when the motor backs off, instead of
+// jumping with every wobble of the duty cycle. This replaces fading the sound out at a fixed speed:
+// it only gets quieter where the motor really runs out of voltage.
+
+#define VOLTAGE_LIMIT_DEFAULT_MAX_DUTY 0.9f // Below the firmware's usual l_max_duty of 0.95, as a margin
+#define VOLTAGE_LIMIT_PHASE_PER_DUTY (2.0f / 3.0f) // Phase voltage amplitude per unit of duty and volt of input in FOC
+#define VOLTAGE_LIMIT_RELEASE_S 0.2f // Time constant of the limit rising back to the headroom
+
+typedef struct {
+    float limit;     // Volts, what the audio may use
+    bool valid;      // False until the first headroom was fed
+} VoltageLimiter;
+
+// Volts left for the audio at _Duty (-1 to 1) and _InputVoltage, 0 when the duty is at or above _MaxDuty
+float VoltageLimit_Headroom(float _Duty, float _InputVoltage, float _MaxDuty);
+
+void VoltageLimit_Reset(VoltageLimiter* _Limiter);
+
+// Feeds the headroom before a buffer, _IntervalS after the previous one. Returns the new limit.
+float VoltageLimit_Update(VoltageLimiter* _Limiter, float _Headroom, float _IntervalS);
+
+#endif // VOLTAGE_LIMIT_H
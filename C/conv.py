@@ -1,32 +1,212 @@
-import sys,getopt,binascii
-
-filename = ""
-name = "test"
-
-opts,args = getopt.getopt(sys.argv[1:],'f:n:')
-for o,a in opts:
-	if o == '-f':
-		filename = a
-	if o == '-n':
-		name = a
-
-with open(filename, "rb") as f:
-	hexdata = f.read().hex()
-	tokens = [hexdata[i:i+2] for i in range(0, len(hexdata), 2)]
-	res = "(def " + name + " [\n"
-	cnt = 0
-	for c in tokens:
-		res += "0x" + c
-		cnt = cnt + 1
-		if cnt == 20:
-			cnt = 0
-			res += "\n"
-		else:
-			res += " "
-	
-	if res[-1] == '\n':
-		res += "])\n"
-	else:
-		res += "\n])\n"
-	print(res)
-
+import sys,getopt,binascii
+
+# Turns a native lib binary into a LispBM byte array for load-native-lib.
+#
+#   -f file   binary to convert
+#   -n name   name of the array
+#   -m mode   hex:  0x.. literals, the original format (default)
+#             dec:  decimal literals, about a third less text
+#             lz:   LZ compressed decimal literals plus a small Lisp unpacker, so the
+#                   script defines the same array after unpacking it at load time
+#   -t        lz only, print how long the unpacking took on the VESC
+#   -r        print the size of every mode to stderr, with the upload time at -b bytes/s
+#   -b rate   link rate for -r, bytes per second (default 2000, a slow BLE link)
+#
+# lz format, a sequence of tokens:
+#   c < 128   literal run, the next c + 1 bytes are copied to the output
+#   c >= 128  match, copy c - 125 bytes (3 to 130) from offset back in the output, where
+#             offset is the next two bytes, big endian, 1 to 65535
+# The unpacker copies a match byte by byte, so a match may overlap its own output.
+
+LZ_MIN_MATCH = 3
+LZ_MAX_MATCH = 130
+LZ_MAX_LITERALS = 128
+LZ_MAX_OFFSET = 65535
+LZ_MAX_CHAIN = 256
+
+LZ_UNPACKER = """(defun unpack-native-lib (packed size) {
+	(var out (bufcreate size))
+	(var in 0)
+	(var pos 0)
+	(loopwhile (< pos size) {
+		(var c (bufget-u8 packed in))
+		(setq in (+ in 1))
+		(if (< c 128)
+			{
+				(looprange i 0 (+ c 1) (bufset-u8 out (+ pos i) (bufget-u8 packed (+ in i))))
+				(setq in (+ in c 1))
+				(setq pos (+ pos c 1))
+			}
+			{
+				(var from (- pos (+ (* (bufget-u8 packed in) 256) (bufget-u8 packed (+ in 1)))))
+				(var run (- c 125))
+				(looprange i 0 run (bufset-u8 out (+ pos i) (bufget-u8 out (+ from i))))
+				(setq in (+ in 2))
+				(setq pos (+ pos run))
+			}
+		)
+	})
+	out
+})
+"""
+
+def format_array(name, data, fmt):
+	res = "(def " + name + " [\n"
+	cnt = 0
+	for c in data:
+		res += fmt(c)
+		cnt = cnt + 1
+		if cnt == 20:
+			cnt = 0
+			res += "\n"
+		else:
+			res += " "
+
+	if res[-1] == '\n':
+		res += "])\n"
+	else:
+		res += "\n])\n"
+	return res
+
+def format_hex(name, data):
+	return format_array(name, data, lambda c: "0x%02x" % c)
+
+def format_dec(name, data):
+	return format_array(name, data, lambda c: str(c))
+
+# Greedy LZ77 with hash chains over 3 byte prefixes, the binaries are small enough for
+# the whole file to be the window
+def lz_compress(data):
+	out = bytearray()
+	literals = bytearray()
+	chains = {}
+
+	def flush_literals():
+		while literals:
+			run = literals[:LZ_MAX_LITERALS]
+			out.append(len(run) - 1)
+			out.extend(run)
+			del literals[:LZ_MAX_LITERALS]
+
+	def insert(pos):
+		if pos + LZ_MIN_MATCH <= len(data):
+			chains.setdefault(bytes(data[pos:pos + LZ_MIN_MATCH]), []).append(pos)
+
+	pos = 0
+	while pos < len(data):
+		best_len = 0
+		best_from = 0
+		candidates = chains.get(bytes(data[pos:pos + LZ_MIN_MATCH]), [])
+		for start in reversed(candidates[-LZ_MAX_CHAIN:]):
+			if pos - start > LZ_MAX_OFFSET:
+				break
+			length = 0
+			while length < LZ_MAX_MATCH and pos + length < len(data) and data[start + length] == data[pos + length]:
+				length += 1
+			if length > best_len:
+				best_len = length
+				best_from = start
+				if length == LZ_MAX_MATCH:
+					break
+
+		if best_len >= LZ_MIN_MATCH:
+			flush_literals()
+			offset = pos - best_from
+			out.append(128 + best_len - LZ_MIN_MATCH)
+			out.append(offset >> 8)
+			out.append(offset & 0xff)
+			for i in range(best_len):
+				insert(pos + i)
+			pos += best_len
+		else:
+			literals.append(data[pos])
+			insert(pos)
+			pos += 1
+
+	flush_literals()
+	return bytes(out)
+
+# Same steps as unpack-native-lib, to check every packed binary before it is written out
+def lz_decompress(packed, size):
+	out = bytearray(size)
+	inp = 0
+	pos = 0
+	while pos < size:
+		c = packed[inp]
+		inp += 1
+		if c < 128:
+			out[pos:pos + c + 1] = packed[inp:inp + c + 1]
+			inp += c + 1
+			pos += c + 1
+		else:
+			start = pos - ((packed[inp] << 8) | packed[inp + 1])
+			for i in range(c - 125):
+				out[pos + i] = out[start + i]
+			inp += 2
+			pos += c - 125
+	return bytes(out)
+
+def format_lz(name, data, timed):
+	packed = lz_compress(data)
+	if lz_decompress(packed, len(data)) != data:
+		sys.exit("conv.py: lz round trip failed")
+
+	res = ";; " + name + " packed with conv.py -m lz, " + str(len(data)) + " bytes in " + str(len(packed)) + "\n"
+	if timed:
+		res += "(def " + name + "-unpack-start (systime))\n"
+	res += format_dec(name + "-packed", packed)
+	res += LZ_UNPACKER
+	res += "(def " + name + " (unpack-native-lib " + name + "-packed " + str(len(data)) + "))\n"
+	res += "(undefine '" + name + "-packed)\n"
+	if timed:
+		res += "(print (str-merge \"" + name + " unpacked in \" (str-from-n (secs-since " + name + "-unpack-start)) \" s\"))\n"
+	return res
+
+def report(name, data, rate):
+	rows = [
+		("binary", len(data)),
+		("hex", len(format_hex(name, data))),
+		("dec", len(format_dec(name, data))),
+		("lz", len(format_lz(name, data, False))),
+	]
+	sys.stderr.write("%-8s %8s %8s %10s\n" % ("mode", "bytes", "ratio", "upload"))
+	for mode, size in rows:
+		sys.stderr.write("%-8s %8d %7.2fx %9.1fs\n" % (mode, size, size / len(data), size / rate))
+
+filename = ""
+name = "test"
+mode = "hex"
+timed = False
+show_report = False
+rate = 2000.0
+
+opts,args = getopt.getopt(sys.argv[1:],'f:n:m:trb:')
+for o,a in opts:
+	if o == '-f':
+		filename = a
+	if o == '-n':
+		name = a
+	if o == '-m':
+		mode = a
+	if o == '-t':
+		timed = True
+	if o == '-r':
+		show_report = True
+	if o == '-b':
+		rate = float(a)
+
+if mode not in ("hex", "dec", "lz"):
+	sys.exit("conv.py: unknown mode " + mode + ", use hex, dec or lz")
+
+with open(filename, "rb") as f:
+	data = f.read()
+
+if show_report:
+	report(name, data, rate)
+
+if mode == "hex":
+	print(format_hex(name, data))
+elif mode == "dec":
+	print(format_dec(name, data))
+else:
+	print(format_lz(name, data, timed))
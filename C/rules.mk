@@ -31,6 +31,11 @@ ifeq ($(USE_OPT),)
 	USE_OPT =
 endif
 
+# Extra conv.py options, e.g. CONV_OPT="-m lz -r" for a compressed array, see conv.py
+ifeq ($(CONV_OPT),)
+	CONV_OPT =
+endif
+
 CFLAGS = -fpic -Os -Wall -Wextra -Wundef -std=gnu99 -I$(VESC_C_LIB_PATH)
 CFLAGS += -I$(STLIB_PATH)/CMSIS/include -I$(STLIB_PATH)/CMSIS/ST -I$(UTILS_PATH)/
 CFLAGS += -fomit-frame-pointer -falign-functions=16 -mthumb
@@ -51,7 +56,7 @@ LDFLAGS = -nostartfiles -static -mfloat-abi=hard -mfpu=fpv4-sp-d16 -mcpu=cortex-
 LDFLAGS += -lm -Wl,--gc-sections,--undefined=init
 LDFLAGS += -T $(VESC_C_LIB_PATH)/link.ld
 
-.PHONY: default all clean FORCE
+.PHONY: default all clean size size-update FORCE
 
 default: $(TARGET)
 all: default
@@ -65,7 +70,17 @@ $(TARGET): $(OBJECTS) FORCE
 	$(LD) $(OBJECTS) $(LDFLAGS) -o $@.elf
 	$(OBJDUMP) -D $@.elf > $@.list
 	$(OBJCOPY) -O binary $@.elf $@.bin --gap-fill 0x00
-	$(PYTHON) $(VESC_C_LIB_PATH)/conv.py -f $@.bin -n $@ > $@.lisp
+ifneq ($(SIZE_BUDGET),)
+	$(PYTHON) $(VESC_C_LIB_PATH)/size.py -q -e $@.elf -b $(SIZE_BUDGET) -s "$(filter %.c,$(SOURCES))"
+endif
+	$(PYTHON) $(VESC_C_LIB_PATH)/conv.py -f $@.bin -n $@ $(CONV_OPT) > $@.lisp
+
+# Flash/RAM report per section, function, object and thread stack, see size.py
+size: $(TARGET)
+	$(PYTHON) $(VESC_C_LIB_PATH)/size.py -e $(TARGET).elf $(if $(SIZE_BUDGET),-b $(SIZE_BUDGET)) -s "$(filter %.c,$(SOURCES))"
+
+size-update: $(TARGET)
+	$(PYTHON) $(VESC_C_LIB_PATH)/size.py -q -e $(TARGET).elf -b $(SIZE_BUDGET) -u -s "$(filter %.c,$(SOURCES))"
 
 clean:
 	rm -f $(OBJECTS) $(TARGET).elf $(TARGET).list $(TARGET).lisp $(TARGET).bin
\ No newline at end of file
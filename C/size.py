@@ -0,0 +1,268 @@
+import sys,getopt,re,struct
+
+# Flash/RAM footprint of a native lib, from its ELF and sources, checked against a budget.
+#
+#   -e file   ELF to analyze, e.g. vvvf.elf
+#   -s files  sources to scan for VESC_IF->spawn stack sizes, space separated
+#   -b file   budget file, exit code 1 when a budget is exceeded
+#   -u        rewrite the budget file from this build, with -m percent headroom
+#   -m pct    headroom for -u (default 10)
+#   -n rows   rows per table, 0 for all (default 15)
+#   -q        only print the budget check
+#
+# A native lib is loaded into RAM as one image, from the program pointer to the end of the
+# last section, with .data and .bss in the middle of it (see link.ld). So every byte here is
+# RAM on the VESC, for as long as the lib is loaded. The thread stacks are allocated on top
+# of that when the threads are spawned.
+#
+# Budget file, one budget per line, # starts a comment:
+#   image 40960          whole loaded image
+#   code 32768           functions
+#   const 8192           read only objects, e.g. lookup tables and profiles
+#   data 256             initialized variables
+#   bss 4096             zero initialized variables
+#   stacks 3072          thread stacks from VESC_IF->spawn
+#   function 4096        largest single function
+#   object 2048          largest single object
+#   symbol Conf 1024     one symbol
+
+SHT_SYMTAB = 2
+SHT_NOBITS = 8
+SHF_WRITE = 0x1
+SHF_ALLOC = 0x2
+STT_OBJECT = 1
+STT_FUNC = 2
+
+BUDGET_ORDER = ["image", "code", "const", "data", "bss", "stacks", "function", "object"]
+
+class Section:
+	pass
+
+class Symbol:
+	pass
+
+def read_elf(path):
+	with open(path, "rb") as f:
+		elf = f.read()
+
+	if elf[:4] != b"\x7fELF":
+		sys.exit("size.py: " + path + " is not an ELF file")
+	is64 = elf[4] == 2
+	end = "<" if elf[5] == 1 else ">"
+
+	if is64:
+		shoff, = struct.unpack_from(end + "Q", elf, 0x28)
+		shentsize, shnum, shstrndx = struct.unpack_from(end + "HHH", elf, 0x3a)
+	else:
+		shoff, = struct.unpack_from(end + "I", elf, 0x20)
+		shentsize, shnum, shstrndx = struct.unpack_from(end + "HHH", elf, 0x2e)
+
+	sections = []
+	for i in range(shnum):
+		s = Section()
+		if is64:
+			(s.name_offset, s.type, s.flags, s.addr, s.offset, s.size, s.link, s.info, s.align,
+			 s.entsize) = struct.unpack_from(end + "IIQQQQIIQQ", elf, shoff + i * shentsize)
+		else:
+			(s.name_offset, s.type, s.flags, s.addr, s.offset, s.size, s.link, s.info, s.align,
+			 s.entsize) = struct.unpack_from(end + "IIIIIIIIII", elf, shoff + i * shentsize)
+		sections.append(s)
+
+	def string(table, offset):
+		start = table.offset + offset
+		return elf[start:elf.index(b"\0", start)].decode("ascii", "replace")
+
+	for s in sections:
+		s.name = string(sections[shstrndx], s.name_offset)
+
+	symbols = []
+	seen = set()
+	for table in sections:
+		if table.type != SHT_SYMTAB:
+			continue
+		for i in range(table.size // table.entsize):
+			offset = table.offset + i * table.entsize
+			sym = Symbol()
+			if is64:
+				name, info, other, shndx, value, size = struct.unpack_from(end + "IBBHQQ", elf, offset)
+			else:
+				name, value, size, info, other, shndx = struct.unpack_from(end + "IIIBBH", elf, offset)
+			kind = info & 0xf
+			if size == 0 or kind not in (STT_OBJECT, STT_FUNC) or shndx == 0 or shndx >= len(sections):
+				continue
+			sym.name = string(sections[table.link], name)
+			sym.kind = kind
+			sym.size = size
+			sym.addr = value & ~1 if kind == STT_FUNC else value # Thumb functions have bit 0 set
+			sym.section = sections[shndx]
+			if (sym.name, sym.addr) in seen:
+				continue
+			seen.add((sym.name, sym.addr))
+			symbols.append(sym)
+
+	return sections, symbols
+
+def classify(sym):
+	if sym.kind == STT_FUNC:
+		return "code"
+	if sym.section.type == SHT_NOBITS:
+		return "bss"
+	if sym.section.flags & SHF_WRITE:
+		return "data"
+	return "const"
+
+def file_exists(path):
+	try:
+		open(path).close()
+		return True
+	except OSError:
+		return False
+
+# Simple integer #defines, enough to resolve a stack size given as a macro
+def read_defines(paths):
+	defines = {}
+	for path in paths:
+		with open(path) as f:
+			for m in re.finditer(r"^\s*#define\s+(\w+)\s+\(?(\d+)\)?", f.read(), re.M):
+				defines[m.group(1)] = int(m.group(2))
+	return defines
+
+def scan_stacks(paths):
+	headers = []
+	for path in paths:
+		headers += [re.sub(r"\.c$", ".h", path), path]
+	defines = read_defines([p for p in headers if file_exists(p)])
+
+	stacks = []
+	for path in paths:
+		with open(path) as f:
+			text = f.read()
+		for m in re.finditer(r"spawn\(\s*(\w+)\s*,\s*([^,]+?)\s*,\s*\"([^\"]*)\"", text):
+			size = m.group(2)
+			value = int(size) if size.isdigit() else defines.get(size)
+			if value is None:
+				sys.exit("size.py: can't resolve the stack size " + size + " of " + m.group(1) + " in " + path)
+			line = text.count("\n", 0, m.start()) + 1
+			stacks.append((m.group(3), m.group(1), value, path + ":" + str(line)))
+	return stacks
+
+def read_budget(path):
+	budget = {}
+	symbols = {}
+	with open(path) as f:
+		for number, line in enumerate(f, 1):
+			words = line.split("#")[0].split()
+			if not words:
+				continue
+			if words[0] == "symbol" and len(words) == 3:
+				symbols[words[1]] = int(words[2])
+			elif words[0] in BUDGET_ORDER and len(words) == 2:
+				budget[words[0]] = int(words[1])
+			else:
+				sys.exit("size.py: " + path + ":" + str(number) + ": can't parse " + line.strip())
+	return budget, symbols
+
+def write_budget(path, usage, symbol_sizes, headroom):
+	def allow(value):
+		return value + (value * headroom + 99) // 100
+
+	lines = ["# Size budgets in bytes, checked on every build, see C/size.py",
+			 "# Regenerate with make size-update, after an intended size change"]
+	for key in BUDGET_ORDER:
+		lines.append("%-10s %d" % (key, allow(usage[key])))
+	for name, size in symbol_sizes:
+		lines.append("symbol %s %d" % (name, allow(size)))
+	with open(path, "w") as f:
+		f.write("\n".join(lines) + "\n")
+
+def print_table(title, rows, limit):
+	print(title)
+	shown = rows if limit == 0 else rows[:limit]
+	for row in shown:
+		print("  %8d  %-40s %s" % row)
+	if len(shown) < len(rows):
+		print("  %8d  %d more" % (sum(r[0] for r in rows[len(shown):]), len(rows) - len(shown)))
+	print("")
+
+elf_path = ""
+sources = []
+budget_path = ""
+update = False
+headroom = 10
+limit = 15
+quiet = False
+
+opts,args = getopt.getopt(sys.argv[1:],'e:s:b:um:n:q')
+for o,a in opts:
+	if o == '-e':
+		elf_path = a
+	if o == '-s':
+		sources = a.split()
+	if o == '-b':
+		budget_path = a
+	if o == '-u':
+		update = True
+	if o == '-m':
+		headroom = int(a)
+	if o == '-n':
+		limit = int(a)
+	if o == '-q':
+		quiet = True
+
+if not elf_path or (update and not budget_path):
+	sys.exit("Usage: size.py -e file.elf [-s sources] [-b budget] [-u] [-m pct] [-n rows] [-q]")
+
+sections, symbols = read_elf(elf_path)
+stacks = scan_stacks(sources)
+
+loaded = [s for s in sections if s.flags & SHF_ALLOC and s.size > 0]
+usage = { "image": max([s.addr + s.size for s in loaded] + [0]) }
+for key in ["code", "const", "data", "bss"]:
+	usage[key] = sum(sym.size for sym in symbols if classify(sym) == key)
+usage["stacks"] = sum(stack[2] for stack in stacks)
+usage["function"] = max([sym.size for sym in symbols if sym.kind == STT_FUNC] + [0])
+usage["object"] = max([sym.size for sym in symbols if sym.kind == STT_OBJECT] + [0])
+by_name = {}
+for sym in symbols:
+	by_name[sym.name] = by_name.get(sym.name, 0) + sym.size
+
+if not quiet:
+	print("%s: %d byte image, %d bytes of thread stacks, %d bytes of RAM while running\n" %
+		  (elf_path, usage["image"], usage["stacks"], usage["image"] + usage["stacks"]))
+	print("Sections")
+	for s in sorted(loaded, key=lambda s: s.addr):
+		print("  %8d  %-40s 0x%05x%s" % (s.size, s.name, s.addr, " (zero filled)" if s.type == SHT_NOBITS else ""))
+	print("")
+
+	for key, title in [("code", "Functions"), ("const", "Read only objects"), ("data", ".data"), ("bss", ".bss")]:
+		rows = sorted([(sym.size, sym.name, "0x%05x" % sym.addr) for sym in symbols if classify(sym) == key], reverse=True)
+		print_table(title + " (%d bytes)" % usage[key], rows, limit)
+
+	print_table("Thread stacks (%d bytes)" % usage["stacks"],
+				[(stack[2], stack[0] + " (" + stack[1] + ")", stack[3]) for stack in stacks], 0)
+
+if not budget_path:
+	sys.exit(0)
+
+if update:
+	# Keep the symbols that already have a budget
+	_, symbol_budget = read_budget(budget_path) if file_exists(budget_path) else ({}, {})
+	write_budget(budget_path, usage, [(name, by_name.get(name, 0)) for name in symbol_budget], headroom)
+	print("Wrote " + budget_path + " with " + str(headroom) + " % headroom")
+	sys.exit(0)
+
+budget, symbol_budget = read_budget(budget_path)
+checks = [(key, usage[key], budget[key]) for key in BUDGET_ORDER if key in budget]
+checks += [("symbol " + name + ("" if name in by_name else " (not found)"), by_name.get(name, 0), allowed)
+		   for name, allowed in symbol_budget.items()]
+
+failures = 0
+print("Size budget (" + budget_path + ")")
+for name, used, allowed in checks:
+	over = used > allowed
+	failures += over
+	print("  %-28s %8d of %8d %5.1f%%%s" % (name, used, allowed, 100.0 * used / allowed if allowed else 0.0,
+											"  OVER BUDGET" if over else ""))
+if failures:
+	print(str(failures) + " budgets exceeded, shrink the change or raise the budget in " + budget_path)
+	sys.exit(1)
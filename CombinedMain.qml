@@ -1,7 +1,6 @@
 import QtQuick 2.7
 import QtQuick.Controls 2.0
 import QtQuick.Layouts 1.3
-import QtQuick.Extras 1.4
 import Vedder.vesc.utility 1.0
 import Vedder.vesc.commands 1.0
 import Vedder.vesc.configparams 1.0
@@ -11,219 +10,218 @@ Item {
     id: rootItem
     anchors.fill: parent
 
+    // Vertical bar gauge, the same as Display/GaugeBar.qml. VESC Tool loads this file on its own, so
+    // it can't import the Display directory and keeps a copy. See there for how it is drawn.
     Component {
-    id: gaugeBarComponent
-    Item {
-        id: root
-        property string title: "Title"
-        property real value: 0
-        property real minValue: -100
-        property real maxValue: 100
-        property string unit: "unit"
-        property color valueColor: "white"
-        property color unitColor: "#ff6700"
-        property color negativeColor: "#6a7aff"
-        property int titleFontSize: 20
-        property int valueFontSize: 28
-        property int unitFontSize: 14
-        property bool bold: true
-        property real tickmarkStepSize: 20.0
-        property int minorTickmarkCount: 4
-        property int gaugeWidth: 150
-        property int barWidth: 40
-        property int bottomMargin: 15
-        property int topMargin: 10
-        property int leftMargin: 10
-        property real totalWidth: arrowCanvas.width + gaugeBackground.width + root.leftMargin + 20
-
-        // Calculate zero position (center of gauge)
-        property real zeroPosition: (0 - minValue) / (maxValue - minValue) * gaugeBackground.height
-
-        ColumnLayout {
-            anchors.fill: parent
-            spacing: 0
-
-            // Title
-            Text {
-                text: root.title
-                color: "white"
-                font.pixelSize: root.titleFontSize
-                font.bold: root.bold
-                elide: Text.ElideRight
-                horizontalAlignment: Text.AlignHCenter
-                Layout.fillWidth: true
-                Layout.preferredHeight: 30
-                Layout.topMargin: root.topMargin
+        id: gaugeBarComponent
+        Item {
+            id: root
+            property string title: "Title"
+            property real value: 0
+            property real minValue: 0
+            property real maxValue: 100
+            property string unit: "unit"
+            property color valueColor: "white"
+            property color unitColor: "#ff6700"
+            property color negativeColor: "#6a7aff"
+            property int titleFontSize: 20
+            property int valueFontSize: 28
+            property int unitFontSize: 14
+            property bool bold: true
+            property real tickmarkStepSize: 20.0 // Changed to real for floating-point values
+            property int minorTickmarkCount: 4
+            property int gaugeWidth: 150 // Unused, the width follows from barWidth
+            property int barWidth: 40 // Width of the vertical bar
+            property int bottomMargin: 15 // Default bottom margin set to 15
+            property int topMargin: 10 // Margin at the top of the gauge
+            property int leftMargin: 0 // Space left of the arrow
+            property real repaintThreshold: 0.004 // Fraction of the range the value has to move before the bar is repainted
+
+            property int arrowSize: 20
+            property int labelWidth: 36
+            property real totalWidth: leftMargin + arrowSize + barWidth + 20 + labelWidth // Arrow + bar + label spacing
+
+            property real drawnValue: minValue // Value the bar was last painted at
+
+            function span() {
+                return maxValue > minValue ? maxValue - minValue : 1
             }
 
-            // Gauge
-            Item {
-                Layout.fillWidth: true
-                Layout.fillHeight: true
-                Layout.preferredWidth: root.totalWidth
-                Layout.topMargin: root.topMargin
-                Layout.alignment: Qt.AlignHCenter
+            function clampValue(v) {
+                return Math.max(minValue, Math.min(maxValue, v))
+            }
 
-                // Background of the gauge
-                Rectangle {
-                    id: gaugeBackground
-                    width: root.barWidth
-                    height: parent.height - root.bottomMargin - root.topMargin
-                    anchors.left: arrowCanvas.right
-                    anchors.bottom: parent.bottom
-                    anchors.bottomMargin: root.bottomMargin
-                    color: "transparent"
-                    border.color: "white"
-                    border.width: 1
-
-                    // Vertical bar representing the gauge value
-Rectangle {
-    id: valueBar
-    width: parent.width
-    color: root.value >= 0 ? root.valueColor : root.negativeColor
-    radius: 3
-
-    // Calculate the position of zero in the gauge
-    property real zeroPosition: gaugeBackground.height - (0 - root.minValue) / (root.maxValue - root.minValue) * gaugeBackground.height
-
-    // Calculate bar height based on absolute value
-    property real barHeight: Math.abs(root.value) / (root.maxValue - root.minValue) * gaugeBackground.height
-
-    // Position and size based on value sign
-    y: {
-        if (root.value >= 0) {
-            // For positive values: from zeroPosition - barHeight to zeroPosition
-            return zeroPosition - barHeight;
-        } else {
-            // For negative values: from zeroPosition to zeroPosition + barHeight
-            return zeroPosition;
-        }
-    }
-    height: barHeight
-}
+            // Repaint everything after a change of the layout or the range
+            function repaintAll() {
+                drawnValue = clampValue(value)
+                scaleCanvas.requestPaint()
+                barCanvas.requestPaint()
+            }
+
+            Component.onCompleted: repaintAll()
+
+            onValueChanged: {
+                var v = clampValue(value)
+                if (Math.abs(v - drawnValue) >= repaintThreshold * span()) {
+                    drawnValue = v
+                    barCanvas.requestPaint()
                 }
+            }
+            onMinValueChanged: repaintAll()
+            onMaxValueChanged: repaintAll()
+            onTickmarkStepSizeChanged: scaleCanvas.requestPaint()
+            onMinorTickmarkCountChanged: scaleCanvas.requestPaint()
+            onBarWidthChanged: repaintAll()
+            onValueColorChanged: barCanvas.requestPaint()
+            onNegativeColorChanged: barCanvas.requestPaint()
 
-                // Tick marks (positioned to the right of the bar)
-                Repeater {
-                    model: Math.floor((root.maxValue - root.minValue) / root.tickmarkStepSize) + 1
-
-                    Rectangle {
-                        width: 10
-                        height: 1
-                        color: "white"
-                        anchors.bottom: gaugeBackground.bottom
-                        anchors.bottomMargin: (index * root.tickmarkStepSize / (root.maxValue - root.minValue)) * gaugeBackground.height
-                        anchors.left: gaugeBackground.right
-                        anchors.leftMargin: 5
-                    }
+            ColumnLayout {
+                anchors.fill: parent
+                spacing: 0
+
+                // Title
+                Text {
+                    text: root.title
+                    color: "white"
+                    font.pixelSize: root.titleFontSize
+                    font.bold: root.bold
+                    elide: Text.ElideRight
+                    horizontalAlignment: Text.AlignHCenter
+                    Layout.fillWidth: true
+                    Layout.preferredHeight: 30
+                    Layout.topMargin: root.topMargin // Apply top margin to the title
                 }
 
-                // Minor tick marks (positioned to the right of the bar)
-                Repeater {
-                    model: Math.floor((root.maxValue - root.minValue) / (root.tickmarkStepSize / root.minorTickmarkCount)) + 1
-
-                    Rectangle {
-                        width: 5
-                        height: 1
-                        color: "white"
-                        anchors.bottom: gaugeBackground.bottom
-                        anchors.bottomMargin: (index * (root.tickmarkStepSize / root.minorTickmarkCount) / (root.maxValue - root.minValue)) * gaugeBackground.height
-                        anchors.left: gaugeBackground.right
-                        anchors.leftMargin: 5
+                // Gauge, both canvases share its coordinates
+                Item {
+                    id: gaugeArea
+                    Layout.fillWidth: true
+                    Layout.fillHeight: true
+                    Layout.maximumWidth: root.totalWidth
+                    Layout.preferredWidth: root.totalWidth
+                    Layout.alignment: Qt.AlignHCenter // Center the gauge horizontally
+
+                    property real barX: root.leftMargin + root.arrowSize
+                    property real barTop: root.topMargin
+                    property real barHeight: Math.max(1, height - root.topMargin - root.bottomMargin)
+
+                    function yAt(v) {
+                        return barTop + barHeight * (1 - (v - root.minValue) / root.span())
                     }
-                }
 
-                // Labels (positioned to the right of the bar)
-                Repeater {
-                    model: Math.floor((root.maxValue - root.minValue) / root.tickmarkStepSize) + 1
+                    onWidthChanged: root.repaintAll()
+                    onHeightChanged: root.repaintAll()
+
+                    // Frame, tick marks and labels, right of the bar
+                    Canvas {
+                        id: scaleCanvas
+                        anchors.fill: parent
+
+                        onPaint: {
+                            var ctx = getContext("2d")
+                            ctx.reset()
+                            var x = gaugeArea.barX
+                            ctx.strokeStyle = "white"
+                            ctx.lineWidth = 1
+                            ctx.strokeRect(Math.round(x) + 0.5, Math.round(gaugeArea.barTop) + 0.5,
+                                           root.barWidth - 1, Math.round(gaugeArea.barHeight) - 1)
+
+                            if (root.tickmarkStepSize <= 0) {
+                                return
+                            }
+                            ctx.fillStyle = "white"
+                            var right = x + root.barWidth + 5 // Space between bar and tick marks
+                            var minorStep = root.tickmarkStepSize / Math.max(1, root.minorTickmarkCount)
+                            var minorCount = Math.floor(root.span() / minorStep + 1e-6)
+                            for (var i = 0; i <= minorCount; i++) {
+                                ctx.fillRect(right, Math.round(gaugeArea.yAt(root.minValue + i * minorStep)), 5, 1)
+                            }
 
-                    Text {
-                        text: {
-                            var value = root.minValue + index * root.tickmarkStepSize;
-                            if (value % 1 !== 0) {
-                                return value.toFixed(1);
-                            } else {
-                                return value.toFixed(0);
+                            ctx.font = "12px sans-serif"
+                            ctx.textBaseline = "middle"
+                            var majorCount = Math.floor(root.span() / root.tickmarkStepSize + 1e-6)
+                            for (var j = 0; j <= majorCount; j++) {
+                                var tick = root.minValue + j * root.tickmarkStepSize
+                                var y = Math.round(gaugeArea.yAt(tick))
+                                ctx.fillRect(right, y, 10, 1)
+                                // Show decimals only if the value requires it
+                                ctx.fillText(Math.abs(tick % 1) > 1e-6 ? tick.toFixed(1) : tick.toFixed(0), x + root.barWidth + 20, y)
                             }
                         }
-                        color: "white"
-                        font.pixelSize: 12
-                        anchors.bottom: gaugeBackground.bottom
-                        anchors.bottomMargin: (index * root.tickmarkStepSize / (root.maxValue - root.minValue)) * gaugeBackground.height - height/2
-                        anchors.left: gaugeBackground.right
-                        anchors.leftMargin: 20
-                    }
-                }
-
-                // Triangular arrow pointing to the value
-                Canvas {
-                    id: arrowCanvas
-                    width: 20
-                    height: 20
-                    anchors.left: parent.left
-                    anchors.leftMargin: leftMargin
-                    anchors.bottom: gaugeBackground.bottom
-                    anchors.bottomMargin: {
-                        var pos = (root.value - root.minValue) / (root.maxValue - root.minValue) * gaugeBackground.height;
-                        return Math.max(0, Math.min(gaugeBackground.height - height, pos - height/2));
                     }
 
-                    onPaint: {
-                        var ctx = getContext("2d");
-                        ctx.reset();
-                        ctx.beginPath();
-                        ctx.moveTo(width, height / 2);
-                        ctx.lineTo(0, 0);
-                        ctx.lineTo(0, height);
-                        ctx.closePath();
-                        ctx.fillStyle = root.valueColor;
-                        ctx.fill();
+                    // Bar from 0 (or the end of the range closest to it) to the value, and the arrow pointing at it
+                    Canvas {
+                        id: barCanvas
+                        anchors.fill: parent
+
+                        onPaint: {
+                            var ctx = getContext("2d")
+                            ctx.reset()
+                            var x = gaugeArea.barX
+                            var base = root.minValue > 0 ? root.minValue : (root.maxValue < 0 ? root.maxValue : 0)
+                            var yBase = gaugeArea.yAt(base)
+                            var yValue = gaugeArea.yAt(root.drawnValue)
+
+                            ctx.fillStyle = root.drawnValue >= base ? root.valueColor : root.negativeColor
+                            ctx.fillRect(x + 1, Math.min(yBase, yValue), root.barWidth - 2, Math.abs(yBase - yValue))
+
+                            ctx.beginPath()
+                            ctx.moveTo(x, yValue) // Tip touches the bar
+                            ctx.lineTo(x - root.arrowSize, yValue - root.arrowSize / 2)
+                            ctx.lineTo(x - root.arrowSize, yValue + root.arrowSize / 2)
+                            ctx.closePath()
+                            ctx.fillStyle = root.valueColor // Use the same color as the bar
+                            ctx.fill()
+                        }
                     }
                 }
-            }
 
-            // Grey horizontal line
-            Rectangle {
-                Layout.fillWidth: true
-                Layout.preferredHeight: 2
-                color: "grey"
-            }
+                // Grey horizontal line
+                Rectangle {
+                    Layout.fillWidth: true
+                    Layout.preferredHeight: 2
+                    color: "grey"
+                }
 
-            // Decimal value and unit label
-            ColumnLayout {
-                Layout.fillWidth: true
-                Layout.preferredHeight: 60
-                spacing: 5
-                Layout.alignment: Qt.AlignHCenter
+                // Decimal value and unit label
+                ColumnLayout {
+                    Layout.fillWidth: true
+                    Layout.preferredHeight: 60
+                    spacing: 5
+                    Layout.alignment: Qt.AlignHCenter // Center the content
 
-                Text {
-                    text: {
-                        var formattedValue = root.value.toFixed(1);
-                        if (root.value < 0) {
-                            formattedValue = "-" + Math.abs(root.value).toFixed(1).padStart(4, '0');
-                        } else {
-                            formattedValue = formattedValue.padStart(5, '0');
+                    Text {
+                        text: {
+                            var formattedValue = root.value.toFixed(1);
+                            if (root.value < 0) {
+                                // Add a negative sign to the left of the value
+                                formattedValue = "-" + Math.abs(root.value).toFixed(1).padStart(4, '0'); // Ensure 4 digits after the negative sign
+                            } else {
+                                formattedValue = formattedValue.padStart(5, '0'); // 000.0 format
+                            }
+                            return formattedValue;
                         }
-                        return formattedValue;
+                        color: root.valueColor
+                        font.family: "Monospace"
+                        font.pixelSize: root.valueFontSize
+                        font.bold: root.bold
+                        horizontalAlignment: Text.AlignHCenter
+                        Layout.alignment: Qt.AlignHCenter
                     }
-                    color: root.valueColor
-                    font.family: "Monospace"
-                    font.pixelSize: root.valueFontSize
-                    font.bold: root.bold
-                    horizontalAlignment: Text.AlignHCenter
-                }
 
-                Text {
-                    text: root.unit
-                    color: root.unitColor
-                    font.pixelSize: root.unitFontSize
-                    font.bold: root.bold
-                    horizontalAlignment: Text.AlignHCenter
+                    Text {
+                        text: root.unit
+                        color: root.unitColor
+                        font.pixelSize: root.unitFontSize
+                        font.bold: root.bold
+                        horizontalAlignment: Text.AlignHCenter
+                        Layout.alignment: Qt.AlignHCenter
+                    }
                 }
             }
         }
     }
-}
 
     // Define the TitledDecimalDisplay component
     Component {
@@ -354,6 +352,7 @@ Rectangle {
                         item.minorTickmarkCount = 4
                         item.gaugeWidth = 150
                         item.barWidth = 25
+                        item.leftMargin = 10
                         item.minValue = 0
                         item.maxValue = 100
                     }
@@ -381,6 +380,7 @@ Rectangle {
                         item.minorTickmarkCount = 4
                         item.gaugeWidth = 150
                         item.barWidth = 25
+                        item.leftMargin = 10
                         item.minValue = -100
                         item.maxValue = 300
                         item.value = -50
@@ -409,6 +409,7 @@ Rectangle {
                         item.minorTickmarkCount = 4
                         item.gaugeWidth = 150
                         item.barWidth = 25
+                        item.leftMargin = 10
                         item.minValue = -4
                         item.maxValue = 16
                     }
@@ -436,6 +437,7 @@ Rectangle {
                         item.minorTickmarkCount = 4
                         item.gaugeWidth = 150
                         item.barWidth = 25
+                        item.leftMargin = 10
                         item.minValue = 0
                         item.maxValue = 100
                     }
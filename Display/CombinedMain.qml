@@ -1,7 +1,6 @@
 import QtQuick 2.7
 import QtQuick.Controls 2.0
 import QtQuick.Layouts 1.3
-import QtQuick.Extras 1.4
 import Vedder.vesc.utility 1.0
 import Vedder.vesc.commands 1.0
 import Vedder.vesc.configparams 1.0
@@ -17,6 +16,22 @@ Item {
     // Configurable color for units
     property color unitColor: "#ff6700" // Neon indigo
 
+    // Set while the VVVF plugin is sending telemetry packets, see C/VVVF/Source/Telemetry.h
+    property bool telemetryActive: false
+    property var spwmModeNames: ["Off", "Async", "Ramp", "Random", "Sync"]
+    property var rotorStateNames: ["Accel", "Coast", "Decel"]
+
+    // Set while the plugin is sending output snapshots, see C/VVVF/Source/Snapshot.h
+    property bool snapshotActive: false
+    property var scopeSamples: []
+    property real scopeCarrierHz: 0
+    property real scopeSampleRate: 25000
+    property var spectrogramColumns: [] // Oldest first, each an array of spectrumBins levels from 0 to 1
+    property int spectrumSize: 128 // FFT length, the first samples of each snapshot
+    property int spectrumBins: spectrumSize / 2
+    property int spectrogramLength: 96 // Columns kept, one per snapshot
+    property real spectrumFloorDb: -60
+
     // Black background for the entire display
     Rectangle {
         anchors.fill: parent
@@ -27,7 +42,7 @@ Item {
     Rectangle {
         id: container
         width: parent.width
-        height: parent.height * 0.70 // Use 60% of the screen height
+        height: parent.height * (snapshotActive ? 0.45 : 0.70) // Make room for the scope while snapshots arrive
         color: "transparent"
         border.color: "white"
         border.width: 2
@@ -130,15 +145,107 @@ Item {
         }
     }
 
+    // Scope trace and rolling spectrogram of the generated output, only while snapshots arrive
+    Rectangle {
+        id: scopePanel
+        visible: snapshotActive
+        width: parent.width
+        height: snapshotActive ? parent.height * 0.25 : 0
+        anchors.top: container.bottom
+        color: "transparent"
+        border.color: "white"
+        border.width: 1
+
+        RowLayout {
+            anchors.fill: parent
+            anchors.margins: 2
+            spacing: 2
+
+            Canvas {
+                id: scopeCanvas
+                Layout.fillWidth: true
+                Layout.fillHeight: true
+
+                onPaint: {
+                    var ctx = getContext("2d")
+                    ctx.reset()
+                    ctx.fillStyle = "black"
+                    ctx.fillRect(0, 0, width, height)
+
+                    ctx.strokeStyle = "#404040"
+                    ctx.lineWidth = 1
+                    ctx.beginPath()
+                    ctx.moveTo(0, height / 2)
+                    ctx.lineTo(width, height / 2)
+                    ctx.stroke()
+
+                    var samples = scopeSamples
+                    if (samples.length > 1) {
+                        ctx.strokeStyle = "#00FF00"
+                        ctx.beginPath()
+                        for (var i = 0; i < samples.length; i++) {
+                            var x = i * width / (samples.length - 1)
+                            var y = height / 2 - samples[i] / 128 * (height / 2 - 2)
+                            if (i === 0) {
+                                ctx.moveTo(x, y)
+                            } else {
+                                ctx.lineTo(x, y)
+                            }
+                        }
+                        ctx.stroke()
+                    }
+
+                    ctx.fillStyle = unitColor
+                    ctx.font = "bold 12px sans-serif"
+                    ctx.fillText((samples.length * 1000 / scopeSampleRate).toFixed(1) + " ms, " +
+                                 scopeCarrierHz.toFixed(0) + " Hz", 4, 14)
+                }
+            }
+
+            Canvas {
+                id: spectrogramCanvas
+                Layout.fillWidth: true
+                Layout.fillHeight: true
+
+                onPaint: {
+                    var ctx = getContext("2d")
+                    ctx.reset()
+                    ctx.fillStyle = "black"
+                    ctx.fillRect(0, 0, width, height)
+
+                    // Newest column on the right, low frequencies at the bottom
+                    var columnWidth = width / spectrogramLength
+                    var binHeight = height / spectrumBins
+                    var first = spectrogramLength - spectrogramColumns.length
+                    for (var c = 0; c < spectrogramColumns.length; c++) {
+                        var column = spectrogramColumns[c]
+                        for (var b = 0; b < column.length; b++) {
+                            if (column[b] <= 0) {
+                                continue
+                            }
+                            ctx.fillStyle = spectrogramColor(column[b])
+                            ctx.fillRect((first + c) * columnWidth, height - (b + 1) * binHeight,
+                                         Math.ceil(columnWidth), Math.ceil(binHeight))
+                        }
+                    }
+
+                    ctx.fillStyle = unitColor
+                    ctx.font = "bold 12px sans-serif"
+                    ctx.fillText((scopeSampleRate / 2000).toFixed(1) + " kHz", 4, 14)
+                }
+            }
+        }
+    }
+
     // Bottom grid layout for additional data
     GridLayout {
         id: bottomGrid
-        anchors.top: container.bottom
+        anchors.top: snapshotActive ? scopePanel.bottom : container.bottom
         anchors.left: parent.left
         anchors.right: parent.right
         anchors.bottom: parent.bottom
         columns: 2
-        rows: 3
+        rows: 4
         columnSpacing: 0 // Remove spacing between columns
         rowSpacing: 0 // Remove spacing between rows
 
@@ -201,10 +308,53 @@ Item {
             Layout.fillWidth: true
             Layout.fillHeight: true
         }
+
+        // Active VVVF speed range and rotor state
+        TitledDecimalDisplay {
+            id: speedRangeDisplay
+            label: "Speed Range"
+            unit: "-"
+            value: "-"
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+        }
+
+        // Carrier frequency and SPWM mode
+        TitledDecimalDisplay {
+            id: carrierDisplay
+            label: "Carrier"
+            unit: "Hz"
+            value: "-"
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+        }
+    }
+
+    // Profile editor on top of the dashboard, see ProfileEditor.qml
+    ProfileEditor {
+        id: profileEditor
+        visible: false
+        anchors.fill: parent
+        commands: mCommands
+        unitColor: mainItem.unitColor
     }
 
+    Button {
+        text: profileEditor.visible ? "Close" : "Edit"
+        anchors.top: parent.top
+        anchors.right: parent.right
+        anchors.margins: 4
+        onClicked: {
+            profileEditor.visible = !profileEditor.visible
+            if (profileEditor.visible) {
+                profileEditor.requestProfile(-1)
+            }
+        }
+    }
+
+    // Telemetry packets set the refresh rate, polling on our own is only the fallback without the plugin
     Timer {
-        running: true
+        running: !telemetryActive
         repeat: true
         interval: 100
 
@@ -214,9 +364,194 @@ Item {
         }
     }
 
+    // Telemetry counts as lost after a second without a packet
+    Timer {
+        id: telemetryWatchdog
+        interval: 1000
+        onTriggered: telemetryActive = false
+    }
+
+    // Snapshots count as lost after a second without one
+    Timer {
+        id: snapshotWatchdog
+        interval: 1000
+        onTriggered: {
+            snapshotActive = false
+            spectrogramColumns = []
+        }
+    }
+
+    // Black, through the unit orange, to white
+    function spectrogramColor(level) {
+        var r = Math.min(255, Math.round(level * 2 * 255))
+        var g = Math.min(255, Math.round(level * level * 255 + level * 103))
+        var b = Math.max(0, Math.round((level - 0.75) * 4 * 255))
+        return "rgb(" + r + "," + g + "," + b + ")"
+    }
+
+    // Mirrors Snapshot_Decode in C/VVVF/Source/Snapshot.c, returns null for a bad packet
+    function decodeSnapshot(dv) {
+        var flags = dv.getUint8(2)
+        var count = dv.getUint8(3)
+        var samples = []
+        var offset = 12
+
+        if ((flags & 0x01) === 0) {
+            if (dv.byteLength < offset + count) {
+                return null
+            }
+            for (var i = 0; i < count; i++) {
+                samples.push(dv.getInt8(offset + i))
+            }
+            return samples
+        }
+
+        var available = dv.byteLength - offset
+        var nibble = 2
+        function getNibble() {
+            var value = dv.getUint8(offset + (nibble >> 1))
+            value = (nibble & 1) === 0 ? value >> 4 : value & 0x0F
+            nibble++
+            return value
+        }
+
+        if (count === 0) {
+            return samples
+        }
+        if (available < 1) {
+            return null
+        }
+        samples.push(dv.getInt8(offset))
+        for (var j = 1; j < count; j++) {
+            if ((nibble >> 1) >= available) {
+                return null
+            }
+            var value = getNibble()
+            if (value === 0x8) {
+                if (((nibble + 1) >> 1) >= available) {
+                    return null
+                }
+                var raw = (getNibble() << 4) | getNibble()
+                samples.push(raw >= 128 ? raw - 256 : raw)
+            } else {
+                var prediction = j < 2 ? samples[j - 1] : 2 * samples[j - 1] - samples[j - 2]
+                samples.push(prediction + (value >= 8 ? value - 16 : value))
+            }
+        }
+        return samples
+    }
+
+    // Levels from 0 (spectrumFloorDb and below) to 1 (full scale) of the first spectrumSize samples, Hann windowed
+    function spectrum(samples) {
+        var n = spectrumSize
+        var re = []
+        var im = []
+        for (var i = 0; i < n; i++) {
+            var sample = i < samples.length ? samples[i] / 128 : 0
+            re.push(sample * (0.5 - 0.5 * Math.cos(2 * Math.PI * i / (n - 1))))
+            im.push(0)
+        }
+
+        // In place radix 2 FFT, bit reversal first
+        for (var k = 1, r = 0; k < n; k++) {
+            var bit = n >> 1
+            for (; r & bit; bit >>= 1) {
+                r ^= bit
+            }
+            r ^= bit
+            if (k < r) {
+                var t = re[k]; re[k] = re[r]; re[r] = t
+            }
+        }
+        for (var size = 2; size <= n; size <<= 1) {
+            var angle = -2 * Math.PI / size
+            for (var start = 0; start < n; start += size) {
+                for (var m = 0; m < size / 2; m++) {
+                    var wr = Math.cos(angle * m)
+                    var wi = Math.sin(angle * m)
+                    var a = start + m
+                    var b = a + size / 2
+                    var xr = re[b] * wr - im[b] * wi
+                    var xi = re[b] * wi + im[b] * wr
+                    re[b] = re[a] - xr
+                    im[b] = im[a] - xi
+                    re[a] += xr
+                    im[a] += xi
+                }
+            }
+        }
+
+        // A full scale sine windowed by Hann peaks at n / 4
+        var levels = []
+        for (var bin = 0; bin < spectrumBins; bin++) {
+            var magnitude = Math.sqrt(re[bin] * re[bin] + im[bin] * im[bin]) / (n / 4)
+            var db = 20 * Math.log(Math.max(magnitude, 1e-6)) / Math.LN10
+            levels.push(Math.max(0, Math.min(1, 1 - db / spectrumFloorDb)))
+        }
+        return levels
+    }
+
     Connections {
         target: mCommands
 
+        function onCustomAppDataReceived(data) {
+            var dv = new DataView(data, 0)
+
+            // Profile editor replies, see C/VVVF/Source/ProfileCodec.h
+            if (profileEditor.handlePacket(dv)) {
+                return
+            }
+
+            // Output snapshot, version 1, see C/VVVF/Source/Snapshot.h
+            if (dv.byteLength >= 12 && dv.getUint8(0) === 0x57 && dv.getUint8(1) === 1) {
+                var samples = decodeSnapshot(dv)
+                if (samples === null) {
+                    return
+                }
+                scopeSamples = samples
+                scopeSampleRate = dv.getUint16(6, true)
+                scopeCarrierHz = dv.getUint16(8, true)
+
+                var columns = spectrogramColumns
+                columns.push(spectrum(samples))
+                if (columns.length > spectrogramLength) {
+                    columns.shift()
+                }
+                spectrogramColumns = columns
+
+                snapshotActive = true
+                snapshotWatchdog.restart()
+                scopeCanvas.requestPaint()
+                spectrogramCanvas.requestPaint()
+                return
+            }
+
+            // Ignore app data from anything other than the VVVF telemetry, version 1 is 16 bytes
+            if (dv.byteLength < 16 || dv.getUint8(0) !== 0x56 || dv.getUint8(1) !== 1) {
+                return
+            }
+
+            var rangeIndex = dv.getInt8(4)
+            var rotorState = dv.getUint8(5)
+            var spwmType = dv.getUint8(6)
+            var enabled = (dv.getUint8(7) & 0x01) !== 0
+            var carrierHz = dv.getUint16(8, true)
+            var underruns = dv.getUint32(12, true)
+
+            speedRangeDisplay.value = rangeIndex < 0 ? "-" : rangeIndex.toString()
+            speedRangeDisplay.unit = rotorStateNames[rotorState] !== undefined ? rotorStateNames[rotorState] : "-"
+            carrierDisplay.value = enabled ? carrierHz.toFixed(0) : "-"
+            carrierDisplay.unit = spwmModeNames[spwmType] !== undefined ? spwmModeNames[spwmType] : "Hz"
+            carrierDisplay.valueColor = underruns > 0 ? "#FF0000" : "white"
+            profileEditor.activeRange = rangeIndex
+
+            // Each packet also refreshes the motor values, so the plugin sets the update rate
+            telemetryActive = true
+            telemetryWatchdog.restart()
+            mCommands.getValues();
+            mCommands.getValuesSetup();
+        }
+
         function onValuesSetupReceived(values, mask) {
             // Setup Imperial/Metric
             var useImperial = VescIf.useImperialUnits()
@@ -244,252 +579,4 @@ Item {
             //efficiencyDisplay.value = efficiency_lpf.toFixed(1);
         }
     }
-
-    // GaugeBar Component
-    Component {
-        id: gaugeBarComponent
-        Item {
-            id: root
-            property string title: "Title"
-            property real value: 0
-            property real minValue: 0
-            property real maxValue: 100
-            property string unit: "unit"
-            property color valueColor: "white"
-            property color unitColor: "#ff6700"
-            property int titleFontSize: 20
-            property int valueFontSize: 28
-            property int unitFontSize: 14
-            property bool bold: true
-            property real tickmarkStepSize: 20.0 // Changed to real for floating-point values
-            property int minorTickmarkCount: 4
-            property int gaugeWidth: 150 // New property to control gauge width
-            property int barWidth: 40 // New property to control the width of the vertical bar
-            property int bottomMargin: 15 // Default bottom margin set to 15
-            property int topMargin: 10 // New property to control the margin at the top of the gauge
-
-            // Calculate the total width from the arrow to the labels
-            property real totalWidth: arrowCanvas.width + gaugeBackground.width + 20 // Arrow + Bar + Label spacing
-
-            ColumnLayout {
-                anchors.fill: parent
-                spacing: 0
-
-                // Title
-                Text {
-                    text: root.title
-                    color: "white"
-                    font.pixelSize: root.titleFontSize
-                    font.bold: root.bold
-                    elide: Text.ElideRight
-                    horizontalAlignment: Text.AlignHCenter
-                    Layout.fillWidth: true
-                    Layout.preferredHeight: 30
-                    Layout.topMargin: root.topMargin // Apply top margin to the title
-                }
-
-                // Gauge
-                Item {
-                    Layout.fillWidth: true
-                    Layout.fillHeight: true
-                    Layout.preferredWidth: root.totalWidth // Set the width of the gauge based on totalWidth
-                    Layout.topMargin: root.topMargin // Apply top margin to the gauge
-                    Layout.alignment: Qt.AlignHCenter // Center the gauge horizontally
-
-                    // Background of the gauge
-                    Rectangle {
-                        id: gaugeBackground
-                        width: root.barWidth
-                        height: parent.height - root.bottomMargin - root.topMargin // Account for top and bottom margins
-                        anchors.horizontalCenter: parent.horizontalCenter
-                        anchors.bottom: parent.bottom
-                        anchors.bottomMargin: root.bottomMargin // Apply bottom margin here
-                        color: "transparent"
-                        border.color: "white"
-                        border.width: 1
-
-                        // Vertical bar representing the gauge value
-                        Rectangle {
-                            anchors.bottom: parent.bottom
-                            width: parent.width
-                            height: (root.value - root.minValue) / (root.maxValue - root.minValue) * parent.height
-                            color: root.valueColor
-                            radius: 3 // Rounded corners for the bar
-                        }
-                    }
-
-                    // Triangular arrow pointing to the value (on the left side of the bar)
-                    Canvas {
-                        id: arrowCanvas
-                        width: 20 // 2x bigger (20 pixels wide)
-                        height: 20
-                        anchors.right: gaugeBackground.left // Position to the left of the bar
-                        anchors.rightMargin: 0 // Move the arrow left so its rightmost tip touches the bar
-                        anchors.verticalCenter: gaugeBackground.bottom
-                        anchors.verticalCenterOffset: -(root.value - root.minValue) / (root.maxValue - root.minValue) * gaugeBackground.height
-
-                        onPaint: {
-                            var ctx = getContext("2d");
-                            ctx.reset();
-                            ctx.beginPath();
-                            ctx.moveTo(width, height / 2); // Start at the right middle
-                            ctx.lineTo(0, 0); // Draw to the top left
-                            ctx.lineTo(0, height); // Draw to the bottom left
-                            ctx.closePath();
-                            ctx.fillStyle = root.valueColor; // Use the same color as the bar
-                            ctx.fill();
-                        }
-                    }
-
-                    // Tick marks (positioned to the right of the bar)
-                    Repeater {
-                        model: Math.floor((root.maxValue - root.minValue) / root.tickmarkStepSize) + 1
-
-                        Rectangle {
-                            width: 10
-                            height: 1
-                            color: "white"
-                            anchors.bottom: gaugeBackground.bottom
-                            anchors.bottomMargin: (index * root.tickmarkStepSize / (root.maxValue - root.minValue)) * gaugeBackground.height
-                            anchors.left: gaugeBackground.right // Align to the right of the bar
-                            anchors.leftMargin: 5 // Space between bar and tick marks
-                        }
-                    }
-
-                    // Minor tick marks (positioned to the right of the bar)
-                    Repeater {
-                        model: Math.floor((root.maxValue - root.minValue) / (root.tickmarkStepSize / root.minorTickmarkCount)) + 1
-
-                        Rectangle {
-                            width: 5
-                            height: 1
-                            color: "white"
-                            anchors.bottom: gaugeBackground.bottom
-                            anchors.bottomMargin: (index * (root.tickmarkStepSize / root.minorTickmarkCount) / (root.maxValue - root.minValue)) * gaugeBackground.height
-                            anchors.left: gaugeBackground.right // Align to the right of the bar
-                            anchors.leftMargin: 5 // Space between bar and minor tick marks
-                        }
-                    }
-
-                    // Labels (positioned to the right of the bar, centered vertically on the tick marks)
-                    Repeater {
-                        model: Math.floor((root.maxValue - root.minValue) / root.tickmarkStepSize) + 1
-
-                        Text {
-                            text: {
-                                var value = root.minValue + index * root.tickmarkStepSize;
-                                // Show decimals only if the value requires it
-                                if (value % 1 !== 0) {
-                                    return value.toFixed(1); // Show 1 decimal place
-                                } else {
-                                    return value.toFixed(0); // Show no decimals
-                                }
-                            }
-                            color: "white"
-                            font.pixelSize: 12
-                            anchors.verticalCenter: gaugeBackground.bottom // Center vertically on the tick mark
-                            anchors.verticalCenterOffset: -(index * root.tickmarkStepSize / (root.maxValue - root.minValue)) * gaugeBackground.height
-                            anchors.left: gaugeBackground.right
-                            anchors.leftMargin: 20 // Space between bar and labels
-                        }
-                    }
-                }
-
-                // Grey horizontal line
-                Rectangle {
-                    Layout.fillWidth: true
-                    Layout.preferredHeight: 2
-                    color: "grey"
-                }
-
-                // Decimal value and unit label
-                ColumnLayout {
-                    Layout.fillWidth: true
-                    Layout.preferredHeight: 60
-                    spacing: 5
-                    Layout.alignment: Qt.AlignHCenter // Center the content
-
-                    Text {
-                        text: {
-                            var formattedValue = root.value.toFixed(1);
-                            if (root.value < 0) {
-                                // Add a negative sign to the left of the value
-                                formattedValue = "-" + Math.abs(root.value).toFixed(1).padStart(4, '0'); // Ensure 4 digits after the negative sign
-                            } else {
-                                formattedValue = formattedValue.padStart(5, '0'); // 000.0 format
-                            }
-                            return formattedValue;
-                        }
-                        color: root.valueColor
-                        font.family: "Monospace"
-                        font.pixelSize: root.valueFontSize
-                        font.bold: root.bold
-                        horizontalAlignment: Text.AlignHCenter
-                    }
-
-                    Text {
-                        text: root.unit
-                        color: root.unitColor
-                        font.pixelSize: root.unitFontSize
-                        font.bold: root.bold
-                        horizontalAlignment: Text.AlignHCenter
-                    }
-                }
-            }
-        }
-    }
-
-    // TitledDecimalDisplay Component
-    Component {
-        id: titledDecimalDisplayComponent
-        Rectangle {
-            id: root
-            property string label: "Label"
-            property string value: "00.0"
-            property string unit: "unit"
-            property color valueColor: "white"
-            property color unitColor: "#ff6700"
-            property int labelFontSize: 16
-            property int valueFontSize: 24
-            property int unitFontSize: 16
-            property bool bold: true
-            border.color: "white"
-            border.width: 1
-            color: "transparent"
-
-            ColumnLayout {
-                anchors.centerIn: parent
-                spacing: 5
-
-                Text {
-                    text: root.label
-                    color: "white"
-                    font.pixelSize: root.labelFontSize
-                    font.bold: root.bold
-                    horizontalAlignment: Text.AlignHCenter
-                }
-
-                RowLayout {
-                    spacing: 5
-                    Layout.alignment: Qt.AlignHCenter
-
-                    Text {
-                        text: root.value
-                        color: root.valueColor
-                        font.pixelSize: root.valueFontSize
-                        font.bold: root.bold
-                        horizontalAlignment: Text.AlignHCenter
-                    }
-
-                    Text {
-                        text: root.unit
-                        color: root.unitColor
-                        font.pixelSize: root.unitFontSize
-                        font.bold: root.bold
-                        horizontalAlignment: Text.AlignHCenter
-                    }
-                }
-            }
-        }
-    }
-}
\ No newline at end of file
+}
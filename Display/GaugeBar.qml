@@ -2,6 +2,11 @@ import QtQuick 2.7
 import QtQuick.Controls 2.0
 import QtQuick.Layouts 1.3
 
+// Vertical bar gauge shared by the dashboards. The scale (frame, ticks and labels) is drawn into
+// one Canvas that is only repainted when the size or the range changes. The bar and the arrow are
+// a second Canvas, repainted when the value has moved by more than repaintThreshold of the range,
+// so a value that jitters by less than a pixel costs no drawing at all. When the range includes 0
+// the bar starts at 0 and is drawn in negativeColor below it.
 Item {
     id: root
     property string title: "Title"
@@ -11,19 +16,57 @@ Item {
     property string unit: "unit"
     property color valueColor: "white"
     property color unitColor: "#ff6700"
+    property color negativeColor: "#6a7aff"
     property int titleFontSize: 20
     property int valueFontSize: 28
     property int unitFontSize: 14
     property bool bold: true
     property real tickmarkStepSize: 20.0 // Changed to real for floating-point values
     property int minorTickmarkCount: 4
-    property int gaugeWidth: 150 // New property to control gauge width
-    property int barWidth: 40 // New property to control the width of the vertical bar
+    property int gaugeWidth: 150 // Unused, the width follows from barWidth
+    property int barWidth: 40 // Width of the vertical bar
     property int bottomMargin: 15 // Default bottom margin set to 15
-    property int topMargin: 10 // New property to control the margin at the top of the gauge
+    property int topMargin: 10 // Margin at the top of the gauge
+    property int leftMargin: 0 // Space left of the arrow
+    property real repaintThreshold: 0.004 // Fraction of the range the value has to move before the bar is repainted
 
-    // Calculate the total width from the arrow to the labels
-    property real totalWidth: arrowCanvas.width + gaugeBackground.width + 20 // Arrow + Bar + Label spacing
+    property int arrowSize: 20
+    property int labelWidth: 36
+    property real totalWidth: leftMargin + arrowSize + barWidth + 20 + labelWidth // Arrow + bar + label spacing
+
+    property real drawnValue: minValue // Value the bar was last painted at
+
+    function span() {
+        return maxValue > minValue ? maxValue - minValue : 1
+    }
+
+    function clampValue(v) {
+        return Math.max(minValue, Math.min(maxValue, v))
+    }
+
+    // Repaint everything after a change of the layout or the range
+    function repaintAll() {
+        drawnValue = clampValue(value)
+        scaleCanvas.requestPaint()
+        barCanvas.requestPaint()
+    }
+
+    Component.onCompleted: repaintAll()
+
+    onValueChanged: {
+        var v = clampValue(value)
+        if (Math.abs(v - drawnValue) >= repaintThreshold * span()) {
+            drawnValue = v
+            barCanvas.requestPaint()
+        }
+    }
+    onMinValueChanged: repaintAll()
+    onMaxValueChanged: repaintAll()
+    onTickmarkStepSizeChanged: scaleCanvas.requestPaint()
+    onMinorTickmarkCountChanged: scaleCanvas.requestPaint()
+    onBarWidthChanged: repaintAll()
+    onValueColorChanged: barCanvas.requestPaint()
+    onNegativeColorChanged: barCanvas.requestPaint()
 
     ColumnLayout {
         anchors.fill: parent
@@ -42,109 +85,87 @@ Item {
             Layout.topMargin: root.topMargin // Apply top margin to the title
         }
 
-        // Gauge
+        // Gauge, both canvases share its coordinates
         Item {
+            id: gaugeArea
             Layout.fillWidth: true
             Layout.fillHeight: true
-            Layout.preferredWidth: root.totalWidth // Set the width of the gauge based on totalWidth
-            Layout.topMargin: root.topMargin // Apply top margin to the gauge
+            Layout.maximumWidth: root.totalWidth
+            Layout.preferredWidth: root.totalWidth
             Layout.alignment: Qt.AlignHCenter // Center the gauge horizontally
 
-            // Background of the gauge
-            Rectangle {
-                id: gaugeBackground
-                width: root.barWidth
-                height: parent.height - root.bottomMargin - root.topMargin // Account for top and bottom margins
-                anchors.horizontalCenter: parent.horizontalCenter
-                anchors.bottom: parent.bottom
-                anchors.bottomMargin: root.bottomMargin // Apply bottom margin here
-                color: "transparent"
-                border.color: "white"
-                border.width: 1
-
-                // Vertical bar representing the gauge value
-                Rectangle {
-                    anchors.bottom: parent.bottom
-                    width: parent.width
-                    height: (root.value - root.minValue) / (root.maxValue - root.minValue) * parent.height
-                    color: root.valueColor
-                    radius: 3 // Rounded corners for the bar
-                }
+            property real barX: root.leftMargin + root.arrowSize
+            property real barTop: root.topMargin
+            property real barHeight: Math.max(1, height - root.topMargin - root.bottomMargin)
+
+            function yAt(v) {
+                return barTop + barHeight * (1 - (v - root.minValue) / root.span())
             }
 
-            // Triangular arrow pointing to the value (on the left side of the bar)
+            onWidthChanged: root.repaintAll()
+            onHeightChanged: root.repaintAll()
+
+            // Frame, tick marks and labels, right of the bar
             Canvas {
-                id: arrowCanvas
-                width: 20 // 2x bigger (20 pixels wide)
-                height: 20
-                anchors.right: gaugeBackground.left // Position to the left of the bar
-                anchors.rightMargin: 0 // Move the arrow left so its rightmost tip touches the bar
-                anchors.verticalCenter: gaugeBackground.bottom
-                anchors.verticalCenterOffset: -(root.value - root.minValue) / (root.maxValue - root.minValue) * gaugeBackground.height
+                id: scaleCanvas
+                anchors.fill: parent
 
                 onPaint: {
-                    var ctx = getContext("2d");
-                    ctx.reset();
-                    ctx.beginPath();
-                    ctx.moveTo(width, height / 2); // Start at the right middle
-                    ctx.lineTo(0, 0); // Draw to the top left
-                    ctx.lineTo(0, height); // Draw to the bottom left
-                    ctx.closePath();
-                    ctx.fillStyle = root.valueColor; // Use the same color as the bar
-                    ctx.fill();
-                }
-            }
-
-            // Tick marks (positioned to the right of the bar)
-            Repeater {
-                model: Math.floor((root.maxValue - root.minValue) / root.tickmarkStepSize) + 1
-
-                Rectangle {
-                    width: 10
-                    height: 1
-                    color: "white"
-                    anchors.bottom: gaugeBackground.bottom
-                    anchors.bottomMargin: (index * root.tickmarkStepSize / (root.maxValue - root.minValue)) * gaugeBackground.height
-                    anchors.left: gaugeBackground.right // Align to the right of the bar
-                    anchors.leftMargin: 5 // Space between bar and tick marks
-                }
-            }
+                    var ctx = getContext("2d")
+                    ctx.reset()
+                    var x = gaugeArea.barX
+                    ctx.strokeStyle = "white"
+                    ctx.lineWidth = 1
+                    ctx.strokeRect(Math.round(x) + 0.5, Math.round(gaugeArea.barTop) + 0.5,
+                                   root.barWidth - 1, Math.round(gaugeArea.barHeight) - 1)
+
+                    if (root.tickmarkStepSize <= 0) {
+                        return
+                    }
+                    ctx.fillStyle = "white"
+                    var right = x + root.barWidth + 5 // Space between bar and tick marks
+                    var minorStep = root.tickmarkStepSize / Math.max(1, root.minorTickmarkCount)
+                    var minorCount = Math.floor(root.span() / minorStep + 1e-6)
+                    for (var i = 0; i <= minorCount; i++) {
+                        ctx.fillRect(right, Math.round(gaugeArea.yAt(root.minValue + i * minorStep)), 5, 1)
+                    }
 
-            // Minor tick marks (positioned to the right of the bar)
-            Repeater {
-                model: Math.floor((root.maxValue - root.minValue) / (root.tickmarkStepSize / root.minorTickmarkCount)) + 1
-
-                Rectangle {
-                    width: 5
-                    height: 1
-                    color: "white"
-                    anchors.bottom: gaugeBackground.bottom
-                    anchors.bottomMargin: (index * (root.tickmarkStepSize / root.minorTickmarkCount) / (root.maxValue - root.minValue)) * gaugeBackground.height
-                    anchors.left: gaugeBackground.right // Align to the right of the bar
-                    anchors.leftMargin: 5 // Space between bar and minor tick marks
+                    ctx.font = "12px sans-serif"
+                    ctx.textBaseline = "middle"
+                    var majorCount = Math.floor(root.span() / root.tickmarkStepSize + 1e-6)
+                    for (var j = 0; j <= majorCount; j++) {
+                        var tick = root.minValue + j * root.tickmarkStepSize
+                        var y = Math.round(gaugeArea.yAt(tick))
+                        ctx.fillRect(right, y, 10, 1)
+                        // Show decimals only if the value requires it
+                        ctx.fillText(Math.abs(tick % 1) > 1e-6 ? tick.toFixed(1) : tick.toFixed(0), x + root.barWidth + 20, y)
+                    }
                 }
             }
 
-            // Labels (positioned to the right of the bar, centered vertically on the tick marks)
-            Repeater {
-                model: Math.floor((root.maxValue - root.minValue) / root.tickmarkStepSize) + 1
+            // Bar from 0 (or the end of the range closest to it) to the value, and the arrow pointing at it
+            Canvas {
+                id: barCanvas
+                anchors.fill: parent
 
-                Text {
-                    text: {
-                        var value = root.minValue + index * root.tickmarkStepSize;
-                        // Show decimals only if the value requires it
-                        if (value % 1 !== 0) {
-                            return value.toFixed(1); // Show 1 decimal place
-                        } else {
-                            return value.toFixed(0); // Show no decimals
-                        }
-                    }
-                    color: "white"
-                    font.pixelSize: 12
-                    anchors.verticalCenter: gaugeBackground.bottom // Center vertically on the tick mark
-                    anchors.verticalCenterOffset: -(index * root.tickmarkStepSize / (root.maxValue - root.minValue)) * gaugeBackground.height
-                    anchors.left: gaugeBackground.right
-                    anchors.leftMargin: 20 // Space between bar and labels
+                onPaint: {
+                    var ctx = getContext("2d")
+                    ctx.reset()
+                    var x = gaugeArea.barX
+                    var base = root.minValue > 0 ? root.minValue : (root.maxValue < 0 ? root.maxValue : 0)
+                    var yBase = gaugeArea.yAt(base)
+                    var yValue = gaugeArea.yAt(root.drawnValue)
+
+                    ctx.fillStyle = root.drawnValue >= base ? root.valueColor : root.negativeColor
+                    ctx.fillRect(x + 1, Math.min(yBase, yValue), root.barWidth - 2, Math.abs(yBase - yValue))
+
+                    ctx.beginPath()
+                    ctx.moveTo(x, yValue) // Tip touches the bar
+                    ctx.lineTo(x - root.arrowSize, yValue - root.arrowSize / 2)
+                    ctx.lineTo(x - root.arrowSize, yValue + root.arrowSize / 2)
+                    ctx.closePath()
+                    ctx.fillStyle = root.valueColor // Use the same color as the bar
+                    ctx.fill()
                 }
             }
         }
@@ -179,6 +200,7 @@ Item {
                 font.pixelSize: root.valueFontSize
                 font.bold: root.bold
                 horizontalAlignment: Text.AlignHCenter
+                Layout.alignment: Qt.AlignHCenter
             }
 
             Text {
@@ -187,7 +209,8 @@ Item {
                 font.pixelSize: root.unitFontSize
                 font.bold: root.bold
                 horizontalAlignment: Text.AlignHCenter
+                Layout.alignment: Qt.AlignHCenter
             }
         }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,362 @@
+import QtQuick 2.7
+import QtQuick.Controls 2.0
+import QtQuick.Layouts 1.3
+
+// Edits the speed ranges of the VVVF plugin's profiles on the device. Load asks the plugin for a
+// profile, Apply sends the edited one back and the plugin switches to it right away, see
+// C/VVVF/Source/ProfileCodec.h for the format. The amplitude curves stay those of the library
+// profile it was loaded from.
+//
+// The dashboard passes every 0x50 app data packet to handlePacket and the speed range index of
+// each telemetry packet to activeRange.
+Rectangle {
+    id: root
+    property var commands: null
+    property color unitColor: "#ff6700"
+    property int activeRange: -1 // From telemetry, highlighted while the edited profile is the active one
+    property bool showsActive: false
+    property int profileIndex: -1
+    property int baseIndex: 0
+    property string profileName: ""
+    property real maxSpeed: 0
+    property real cutoffMargin: 0
+    property var ranges: [] // { min, max, states: [{ type, pulses, start, end } x3] }, accel, coast, decel
+    property int rangeCount: 0 // Repeater model, set after ranges changed
+    property string status: ""
+
+    property var spwmModeNames: ["Off", "Async", "Ramp", "Random", "Sync"]
+    property var rotorStateNames: ["Accel", "Coast", "Decel"]
+    property var resultNames: ["Applied", "Not a valid profile packet", "No such profile", "1 to 16 speed ranges",
+                               "Ranges must end after they start and be in ascending order",
+                               "Carriers must be 1 Hz to half the sample rate, Sync needs pulses"]
+    property int maxRanges: 16
+
+    color: "black"
+    border.color: "white"
+    border.width: 2
+
+    // The plugin answers within a packet round trip, this only catches a missing plugin
+    Timer {
+        id: replyTimeout
+        interval: 1000
+        onTriggered: status = "No reply, is the VVVF plugin running?"
+    }
+
+    function send(buffer) {
+        if (commands === null) {
+            return
+        }
+        commands.sendCustomAppData(buffer)
+        replyTimeout.restart()
+    }
+
+    // index < 0 loads the active profile
+    function requestProfile(index) {
+        var buffer = new ArrayBuffer(4)
+        var dv = new DataView(buffer)
+        dv.setUint8(0, 0x50)
+        dv.setUint8(1, 1)
+        dv.setUint8(2, 0)
+        dv.setUint8(3, index < 0 ? 0xFF : index)
+        status = "Loading..."
+        send(buffer)
+    }
+
+    function speedToI16(speed) {
+        return Math.max(-32768, Math.min(32767, Math.round(speed * 100)))
+    }
+
+    // Mirrors ProfileCodec_Encode in C/VVVF/Source/ProfileCodec.c, with the APPLY command
+    function encodeProfile() {
+        var buffer = new ArrayBuffer(4 + 22 + ranges.length * 22)
+        var dv = new DataView(buffer)
+        dv.setUint8(0, 0x50)
+        dv.setUint8(1, 1)
+        dv.setUint8(2, 2)
+        dv.setUint8(3, 0)
+        for (var i = 0; i < 16; i++) {
+            dv.setUint8(4 + i, i < 15 && i < profileName.length ? profileName.charCodeAt(i) & 0x7F : 0)
+        }
+        dv.setInt16(20, speedToI16(maxSpeed), true)
+        dv.setInt16(22, speedToI16(cutoffMargin), true)
+        dv.setUint8(24, baseIndex)
+        dv.setUint8(25, ranges.length)
+
+        for (var r = 0; r < ranges.length; r++) {
+            var offset = 26 + r * 22
+            dv.setInt16(offset, speedToI16(ranges[r].min), true)
+            dv.setInt16(offset + 2, speedToI16(ranges[r].max), true)
+            for (var s = 0; s < 3; s++) {
+                var state = ranges[r].states[s]
+                var at = offset + 4 + s * 6
+                dv.setUint8(at, state.type)
+                dv.setUint8(at + 1, Math.max(0, Math.min(255, state.pulses)))
+                dv.setUint16(at + 2, Math.max(0, Math.min(65535, state.start)), true)
+                dv.setUint16(at + 4, Math.max(0, Math.min(65535, state.end)), true)
+            }
+        }
+        return buffer
+    }
+
+    // Mirrors ProfileCodec_Decode, returns false for a bad packet
+    function decodeProfile(dv) {
+        if (dv.byteLength < 26) {
+            return false
+        }
+        var count = dv.getUint8(25)
+        if (dv.byteLength !== 26 + count * 22) {
+            return false
+        }
+
+        var name = ""
+        for (var i = 0; i < 15 && dv.getUint8(4 + i) !== 0; i++) {
+            name += String.fromCharCode(dv.getUint8(4 + i))
+        }
+
+        var decoded = []
+        for (var r = 0; r < count; r++) {
+            var offset = 26 + r * 22
+            var range = { min: dv.getInt16(offset, true) / 100, max: dv.getInt16(offset + 2, true) / 100, states: [] }
+            for (var s = 0; s < 3; s++) {
+                var at = offset + 4 + s * 6
+                range.states.push({ type: dv.getUint8(at), pulses: dv.getUint8(at + 1),
+                                    start: dv.getUint16(at + 2, true), end: dv.getUint16(at + 4, true) })
+            }
+            decoded.push(range)
+        }
+
+        profileIndex = dv.getUint8(3)
+        profileName = name
+        maxSpeed = dv.getInt16(20, true) / 100
+        cutoffMargin = dv.getInt16(22, true) / 100
+        baseIndex = dv.getUint8(24)
+        setRanges(decoded)
+        return true
+    }
+
+    function setRanges(newRanges) {
+        ranges = newRanges
+        rangeCount = 0 // Rebuilds every delegate from ranges
+        rangeCount = ranges.length
+    }
+
+    function apply() {
+        if (ranges.length === 0) {
+            status = resultNames[3]
+            return
+        }
+        status = "Applying..."
+        send(encodeProfile())
+    }
+
+    function addRange() {
+        if (ranges.length >= maxRanges) {
+            return
+        }
+        var copy = JSON.parse(JSON.stringify(ranges.length > 0 ? ranges[ranges.length - 1]
+            : { min: -1, max: 0, states: [ { type: 1, pulses: 0, start: 1000, end: 1000 },
+                                           { type: 1, pulses: 0, start: 1000, end: 1000 },
+                                           { type: 1, pulses: 0, start: 1000, end: 1000 } ] }))
+        copy.min = copy.max
+        copy.max = copy.min + 10
+        var newRanges = ranges
+        newRanges.push(copy)
+        setRanges(newRanges)
+    }
+
+    function removeRange(index) {
+        var newRanges = ranges
+        newRanges.splice(index, 1)
+        setRanges(newRanges)
+    }
+
+    // Profile packets from the plugin, returns false when the packet is not one
+    function handlePacket(dv) {
+        if (dv.byteLength < 4 || dv.getUint8(0) !== 0x50) {
+            return false
+        }
+        replyTimeout.stop()
+        if (dv.getUint8(1) !== 1) {
+            status = "Unsupported profile version " + dv.getUint8(1)
+            return true
+        }
+
+        var command = dv.getUint8(2)
+        if (command === 1) {
+            if (decodeProfile(dv)) {
+                showsActive = profileSelector.text === ""
+                status = "Loaded profile " + profileIndex
+            } else {
+                status = resultNames[1]
+            }
+        } else if (command === 3) {
+            var result = dv.getUint8(3)
+            status = resultNames[result] !== undefined ? resultNames[result] : "Error " + result
+            if (result === 0) {
+                showsActive = true
+            }
+        }
+        return true
+    }
+
+    ColumnLayout {
+        anchors.fill: parent
+        anchors.margins: 6
+        spacing: 4
+
+        RowLayout {
+            Layout.fillWidth: true
+
+            TextField {
+                id: profileSelector
+                placeholderText: "active"
+                Layout.preferredWidth: 70
+                inputMethodHints: Qt.ImhDigitsOnly
+            }
+            Button {
+                text: "Load"
+                onClicked: requestProfile(profileSelector.text === "" ? -1 : parseInt(profileSelector.text))
+            }
+            Button {
+                text: "Apply"
+                onClicked: apply()
+            }
+            Button {
+                text: "Add range"
+                enabled: rangeCount < maxRanges
+                onClicked: addRange()
+            }
+        }
+
+        RowLayout {
+            Layout.fillWidth: true
+
+            Text { text: "Name"; color: "white" }
+            TextField {
+                text: profileName
+                maximumLength: 15
+                Layout.fillWidth: true
+                onEditingFinished: profileName = text
+            }
+            Text { text: "Max"; color: "white" }
+            TextField {
+                text: maxSpeed.toFixed(1)
+                Layout.preferredWidth: 60
+                inputMethodHints: Qt.ImhFormattedNumbersOnly
+                onEditingFinished: maxSpeed = parseFloat(text) || 0
+            }
+            Text { text: "km/h"; color: unitColor }
+        }
+
+        Text {
+            text: status
+            color: unitColor
+            font.bold: true
+            Layout.fillWidth: true
+            elide: Text.ElideRight
+        }
+
+        Flickable {
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+            contentHeight: rangeColumn.height
+            clip: true
+
+            Column {
+                id: rangeColumn
+                width: parent.width
+                spacing: 4
+
+                Repeater {
+                    model: rangeCount
+
+                    Rectangle {
+                        property var range: ranges[index]
+                        width: rangeColumn.width
+                        height: rangeLayout.height + 8
+                        color: "transparent"
+                        border.color: showsActive && index === activeRange ? unitColor : "#404040"
+                        border.width: showsActive && index === activeRange ? 3 : 1
+
+                        ColumnLayout {
+                            id: rangeLayout
+                            x: 4
+                            y: 4
+                            width: parent.width - 8
+                            spacing: 2
+
+                            RowLayout {
+                                Text { text: "Range " + index; color: "white"; font.bold: true }
+                                TextField {
+                                    text: range.min.toFixed(2)
+                                    Layout.preferredWidth: 70
+                                    inputMethodHints: Qt.ImhFormattedNumbersOnly
+                                    onEditingFinished: range.min = parseFloat(text) || 0
+                                }
+                                Text { text: "to"; color: "white" }
+                                TextField {
+                                    text: range.max.toFixed(2)
+                                    Layout.preferredWidth: 70
+                                    inputMethodHints: Qt.ImhFormattedNumbersOnly
+                                    onEditingFinished: range.max = parseFloat(text) || 0
+                                }
+                                Text { text: "km/h"; color: unitColor }
+                                Item { Layout.fillWidth: true }
+                                Button {
+                                    text: "Remove"
+                                    onClicked: removeRange(index)
+                                }
+                            }
+
+                            // Acceleration, coasting and deceleration
+                            Repeater {
+                                model: 3
+
+                                RowLayout {
+                                    property var spwm: range.states[index]
+
+                                    Text { text: rotorStateNames[index]; color: "white"; Layout.preferredWidth: 50 }
+                                    ComboBox {
+                                        id: typeBox
+                                        model: spwmModeNames
+                                        currentIndex: spwm.type
+                                        Layout.preferredWidth: 110
+                                        onActivated: spwm.type = currentIndex
+                                    }
+                                    TextField {
+                                        visible: typeBox.currentIndex >= 1 && typeBox.currentIndex <= 3
+                                        text: spwm.start
+                                        placeholderText: "Hz"
+                                        Layout.preferredWidth: 70
+                                        inputMethodHints: Qt.ImhDigitsOnly
+                                        onEditingFinished: spwm.start = parseInt(text) || 0
+                                    }
+                                    TextField {
+                                        visible: typeBox.currentIndex === 2 || typeBox.currentIndex === 3
+                                        text: spwm.end
+                                        placeholderText: "Hz"
+                                        Layout.preferredWidth: 70
+                                        inputMethodHints: Qt.ImhDigitsOnly
+                                        onEditingFinished: spwm.end = parseInt(text) || 0
+                                    }
+                                    TextField {
+                                        visible: typeBox.currentIndex === 4
+                                        text: spwm.pulses
+                                        placeholderText: "pulses"
+                                        Layout.preferredWidth: 70
+                                        inputMethodHints: Qt.ImhDigitsOnly
+                                        onEditingFinished: spwm.pulses = parseInt(text) || 0
+                                    }
+                                    Text {
+                                        text: typeBox.currentIndex === 4 ? "pulses" : typeBox.currentIndex > 0 ? "Hz" : ""
+                                        color: unitColor
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
@@ -1,6 +1,16 @@
 #!/bin/bash
 
 # Script to compile, run, and plot the pulse wave generator
+# Arguments are passed on to pulse_wave_graph, e.g. ./Run.sh -t 60 -f 100 -e 2000 for a one minute sweep
+
+# The index is <name>.json, with the name given by -o as pulse_wave_graph parses it
+name="waveforms"
+while getopts "t:f:e:d:wo:h" opt; do
+    if [ "$opt" = "o" ]; then
+        name="$OPTARG"
+    fi
+done 2> /dev/null
+index="$name.json"
 
 # Step 1: Compile the C program
 echo "Compiling pulse_wave_graph.c..."
@@ -11,14 +21,14 @@ if [ $? -ne 0 ]; then
 fi
 echo "Compilation successful."
 
-# Step 2: Run the C program to generate the CSV file
+# Step 2: Run the C program to generate the sample data and its index
 echo "Generating pulse wave data..."
-./pulse_wave_graph
+./pulse_wave_graph "$@"
 if [ $? -ne 0 ]; then
     echo "Failed to generate pulse wave data. Please check the program."
     exit 1
 fi
-echo "Pulse wave data written to pulse_wave.csv."
+echo "Pulse wave data written, index in $index."
 
 # Step 3: Check if Python and matplotlib are installed
 echo "Checking for Python and matplotlib..."
@@ -27,6 +37,15 @@ if ! command -v python3 &> /dev/null; then
     exit 1
 fi
 
+if ! python3 -c "import numpy" &> /dev/null; then
+    echo "numpy is not installed. Installing numpy..."
+    pip3 install numpy
+    if [ $? -ne 0 ]; then
+        echo "Failed to install numpy. Please install it manually and try again."
+        exit 1
+    fi
+fi
+
 if ! python3 -c "import matplotlib" &> /dev/null; then
     echo "matplotlib is not installed. Installing matplotlib..."
     pip3 install matplotlib
@@ -39,7 +58,7 @@ echo "Python and matplotlib are ready."
 
 # Step 4: Plot the data using Python
 echo "Plotting the pulse wave..."
-python3 plot_pulse_wave.py
+python3 plot_pulse_wave.py "$index"
 if [ $? -ne 0 ]; then
     echo "Failed to plot the data. Please check the Python script."
     exit 1
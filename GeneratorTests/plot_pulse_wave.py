@@ -1,37 +1,78 @@
+import argparse
 import json
+import os
 import matplotlib.pyplot as plt
 import sounddevice as sd
 import numpy as np
 import threading
 import time
 
-# Read the JSON file
-with open("waveforms.json", "r") as file:
+# Most points drawn per waveform, longer windows are reduced to a min/max envelope
+MAX_PLOT_POINTS = 4000
+
+parser = argparse.ArgumentParser(description="Plot and play the output of pulse_wave_graph")
+parser.add_argument("index", nargs="?", default="waveforms.json", help="index written by pulse_wave_graph")
+parser.add_argument("--start", type=float, default=0.0, help="start of the window in seconds")
+parser.add_argument("--length", type=float, default=None, help="length of the window in seconds, default to the end")
+args = parser.parse_args()
+
+# Read the index, the samples themselves are memory mapped so only the window is read
+with open(args.index, "r") as file:
     data = json.load(file)
 
 # Extract metadata
 sample_rate = data["sample_rate"]
 frequency = data["frequency"]
+end_frequency = data.get("end_frequency", frequency)
 duty_cycle = data["duty_cycle"]
+index_dir = os.path.dirname(os.path.abspath(args.index))
+
+def map_waveform(entry):
+    dtype = np.int8 if entry["type"] == "int8" else np.uint8
+    return np.memmap(os.path.join(index_dir, entry["file"]), dtype=dtype, mode="r",
+                     offset=entry["offset"], shape=(entry["count"],))
+
+def to_amplitude(samples):
+    # 8 bit WAV is unsigned with a 128 bias
+    if samples.dtype == np.uint8:
+        return samples.astype(np.int16) - 128
+    return samples.astype(np.int16)
 
-# Prepare waveform data
+# Prepare waveform data, as views on the window
 waveforms = []
 for waveform in data["waveforms"]:
-    time_data = [point["time"] for point in waveform["data"]]
-    amplitude = [point["amplitude"] for point in waveform["data"]]
+    samples = map_waveform(waveform)
+    first = min(int(args.start * sample_rate), len(samples))
+    last = len(samples) if args.length is None else min(first + int(args.length * sample_rate), len(samples))
     waveforms.append({
         "name": waveform["name"],
-        "time": time_data,
-        "amplitude": amplitude
+        "first": first,
+        "samples": samples[first:last]
     })
 
 # Plot all waveforms
 plt.figure(figsize=(10, 6))
 for waveform in waveforms:
-    plt.plot(waveform["time"], waveform["amplitude"], label=waveform["name"])
+    samples = waveform["samples"]
+    if len(samples) <= MAX_PLOT_POINTS:
+        time_data = (waveform["first"] + np.arange(len(samples))) / sample_rate
+        plt.plot(time_data, to_amplitude(samples), label=waveform["name"])
+    else:
+        # Min/max envelope per bucket, so minutes of output still show every transition
+        bucket = -(-len(samples) // MAX_PLOT_POINTS)  # Rounded up, so the whole window fits
+        count = -(-len(samples) // bucket)
+        # The last bucket is padded with its own last sample, which leaves its min and max alone
+        amplitude = np.pad(to_amplitude(samples), (0, count * bucket - len(samples)), mode="edge")
+        buckets = amplitude.reshape(count, bucket)
+        time_data = (waveform["first"] + np.arange(count) * bucket) / sample_rate
+        plt.fill_between(time_data, buckets.min(axis=1), buckets.max(axis=1), step="post", alpha=0.5,
+                         label=waveform["name"])
 
 # Add labels and legend
-plt.title(f"Waveforms (Frequency: {frequency} Hz, Duty Cycle: {duty_cycle * 100}%)")
+if end_frequency != frequency:
+    plt.title(f"Waveforms (Frequency: {frequency} to {end_frequency} Hz, Duty Cycle: {duty_cycle * 100}%)")
+else:
+    plt.title(f"Waveforms (Frequency: {frequency} Hz, Duty Cycle: {duty_cycle * 100}%)")
 plt.xlabel("Time (s)")
 plt.ylabel("Amplitude")
 plt.grid(True)
@@ -50,7 +91,7 @@ def play_waveform_on_repeat(waveform_index, device_id):
     print(f"Playing {waveform['name']} waveform on repeat...")
 
     # Normalize amplitude to the range [-1, 1] for audio playback
-    audio_data = np.array(waveform["amplitude"], dtype=np.float32) / 127.0
+    audio_data = to_amplitude(waveform["samples"]).astype(np.float32) / 127.0
 
     # Play the audio on repeat
     is_playing = True
@@ -1,11 +1,28 @@
+// Renders the test waveforms to disk for plot_pulse_wave.py.
+//
+//   ./pulse_wave_graph [-t seconds] [-f frequency] [-e end_frequency] [-d duty] [-w] [-o name]
+//
+// Samples are streamed to disk in blocks, so any duration works with constant memory. The
+// default output is raw int8 in <name>.bin with every waveform back to back; -w writes one
+// 8 bit WAV per waveform instead (<name>_<waveform>.wav), which any audio tool can open.
+// Either way <name>.json is a small index with the metadata and, per waveform, the file,
+// byte offset, sample count and sample type, so the Python side can memory map the samples
+// instead of parsing them. -e sweeps the frequency linearly over the duration.
+
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <ctype.h>
+#include <unistd.h>
 
 #define SAMPLE_RATE 44100
 #define TWO_PI 6.28318530718f
 #define PULSE_MAX 127
+#define BLOCK_SAMPLES 4096
+#define WAV_HEADER_SIZE 44
+#define MAX_PATH_LENGTH 512
 
 // Function pointer type for waveform generators
 typedef int8_t (*WaveformGenerator)(float phase, float dutyCycle);
@@ -55,12 +72,103 @@ int8_t GenerateTriangle(float phase, float dutyCycle) {
     return (int8_t)(2 * value - PULSE_MAX);
 }
 
-int main() {
-    float frequency = 440.0f; // Frequency in Hz
-    float dutyCycle = 0.03f;  // 3% duty cycle
+typedef struct {
+    char path[MAX_PATH_LENGTH];
+    long offset;      // Byte offset of the first sample
+    long count;
+    const char* type; // "int8" or "uint8" (8 bit WAV, biased by 128)
+} WaveformFile;
+
+static void WriteU16(FILE* file, uint16_t value) {
+    uint8_t bytes[2] = { (uint8_t)value, (uint8_t)(value >> 8) };
+    fwrite(bytes, 1, 2, file);
+}
+
+static void WriteU32(FILE* file, uint32_t value) {
+    uint8_t bytes[4] = { (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24) };
+    fwrite(bytes, 1, 4, file);
+}
+
+// Mono 8 bit PCM header, the sample count is known up front so nothing has to be patched later
+static void WriteWavHeader(FILE* file, uint32_t numSamples) {
+    fwrite("RIFF", 1, 4, file);
+    WriteU32(file, 36 + numSamples + (numSamples & 1)); // Includes the pad byte of an odd data chunk
+    fwrite("WAVEfmt ", 1, 8, file);
+    WriteU32(file, 16);
+    WriteU16(file, 1); // PCM
+    WriteU16(file, 1); // Mono
+    WriteU32(file, SAMPLE_RATE);
+    WriteU32(file, SAMPLE_RATE);
+    WriteU16(file, 1);
+    WriteU16(file, 8);
+    fwrite("data", 1, 4, file);
+    WriteU32(file, numSamples);
+}
+
+// Streams numSamples of one waveform to file, sweeping the frequency from start to end
+static void RenderWaveform(FILE* file, WaveformGenerator generator, long numSamples, float startFrequency,
+                           float endFrequency, float dutyCycle, int wav) {
+    int8_t block[BLOCK_SAMPLES];
     float phase = 0.0f;
-    float phaseIncrement = TWO_PI * frequency / SAMPLE_RATE;
-    int numSamples = SAMPLE_RATE / 10; // Generate 0.1 seconds of data
+
+    for (long done = 0; done < numSamples; ) {
+        int count = numSamples - done < BLOCK_SAMPLES ? (int)(numSamples - done) : BLOCK_SAMPLES;
+        for (int i = 0; i < count; i++) {
+            int8_t sample = generator(phase, dutyCycle);
+            block[i] = wav ? (int8_t)(uint8_t)(sample + 128) : sample;
+
+            // Increment phase at the frequency for this point of the sweep
+            float t = (float)(done + i) / (float)numSamples;
+            float frequency = startFrequency + (endFrequency - startFrequency) * t;
+            phase += TWO_PI * frequency / SAMPLE_RATE;
+            while (phase >= TWO_PI) {
+                phase -= TWO_PI;
+            }
+        }
+        fwrite(block, 1, (size_t)count, file);
+        done += count;
+    }
+}
+
+static void PrintUsage(const char* name) {
+    fprintf(stderr, "Usage: %s [-t seconds] [-f frequency] [-e end_frequency] [-d duty] [-w] [-o name]\n", name);
+}
+
+int main(int argc, char** argv) {
+    float duration = 0.1f;     // Seconds of data per waveform
+    float frequency = 440.0f;  // Frequency in Hz
+    float endFrequency = -1.0f; // Frequency at the end of the sweep, same as the start if not given
+    float dutyCycle = 0.03f;   // 3% duty cycle
+    int wav = 0;
+    const char* name = "waveforms";
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:f:e:d:wo:h")) != -1) {
+        switch (opt) {
+            case 't': duration = (float)atof(optarg); break;
+            case 'f': frequency = (float)atof(optarg); break;
+            case 'e': endFrequency = (float)atof(optarg); break;
+            case 'd': dutyCycle = (float)atof(optarg); break;
+            case 'w': wav = 1; break;
+            case 'o': name = optarg; break;
+            default:
+                PrintUsage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (endFrequency < 0.0f) {
+        endFrequency = frequency;
+    }
+
+    long numSamples = (long)(duration * SAMPLE_RATE);
+    if (numSamples <= 0) {
+        fprintf(stderr, "Duration must be positive.\n");
+        return 1;
+    }
+    if (wav && numSamples > 0x7FFFFFFFL - WAV_HEADER_SIZE) {
+        fprintf(stderr, "Too long for a WAV file, use the raw output.\n");
+        return 1;
+    }
 
     // List of waveform generators to test
     WaveformGenerator generators[] = {
@@ -78,52 +186,91 @@ int main() {
         "Triangle"
     };
     int numWaveforms = sizeof(generators) / sizeof(generators[0]);
+    WaveformFile files[sizeof(generators) / sizeof(generators[0])];
 
-    // Open a file to write the JSON data
-    FILE *file = fopen("waveforms.json", "w");
-    if (!file) {
-        fprintf(stderr, "Error opening file for writing.\n");
-        return 1;
+    // Raw output shares one file, WAV gets one per waveform
+    FILE *file = NULL;
+    char rawPath[MAX_PATH_LENGTH];
+    if (!wav) {
+        snprintf(rawPath, MAX_PATH_LENGTH, "%s.bin", name);
+        file = fopen(rawPath, "wb");
+        if (!file) {
+            fprintf(stderr, "Error opening %s for writing.\n", rawPath);
+            return 1;
+        }
     }
 
-    // Write the JSON header
-    fprintf(file, "{\n");
-    fprintf(file, "  \"sample_rate\": %d,\n", SAMPLE_RATE);
-    fprintf(file, "  \"frequency\": %.1f,\n", frequency);
-    fprintf(file, "  \"duty_cycle\": %.2f,\n", dutyCycle);
-    fprintf(file, "  \"waveforms\": [\n");
-
-    // Generate and write samples for each waveform
     for (int w = 0; w < numWaveforms; w++) {
-        fprintf(file, "    {\n");
-        fprintf(file, "      \"name\": \"%s\",\n", waveformNames[w]);
-        fprintf(file, "      \"data\": [\n");
-
-        phase = 0.0f; // Reset phase for each waveform
-        for (int i = 0; i < numSamples; i++) {
-            int8_t sample = generators[w](phase, dutyCycle);
-            float time = (float)i / SAMPLE_RATE;
-            fprintf(file, "        { \"time\": %.6f, \"amplitude\": %d }%s\n",
-                    time, sample, (i == numSamples - 1) ? "" : ",");
-
-            // Increment phase
-            phase += phaseIncrement;
-            if (phase >= TWO_PI) {
-                phase -= TWO_PI;
+        WaveformFile* entry = &files[w];
+        entry->count = numSamples;
+
+        if (wav) {
+            char lowerName[32];
+            int n = 0;
+            for (; waveformNames[w][n] && n < (int)sizeof(lowerName) - 1; n++) {
+                lowerName[n] = (char)tolower((unsigned char)waveformNames[w][n]);
+            }
+            lowerName[n] = '\0';
+
+            snprintf(entry->path, MAX_PATH_LENGTH, "%s_%s.wav", name, lowerName);
+            file = fopen(entry->path, "wb");
+            if (!file) {
+                fprintf(stderr, "Error opening %s for writing.\n", entry->path);
+                return 1;
             }
+            WriteWavHeader(file, (uint32_t)numSamples);
+            entry->offset = WAV_HEADER_SIZE;
+            entry->type = "uint8";
+        } else {
+            strcpy(entry->path, rawPath);
+            entry->offset = (long)w * numSamples;
+            entry->type = "int8";
         }
 
-        fprintf(file, "      ]\n");
-        fprintf(file, "    }%s\n", (w == numWaveforms - 1) ? "" : ",");
+        RenderWaveform(file, generators[w], numSamples, frequency, endFrequency, dutyCycle, wav);
+
+        if (wav) {
+            // An odd sized data chunk is padded to keep the RIFF chunks aligned
+            if (numSamples & 1) {
+                fputc(128, file);
+            }
+            fclose(file);
+        }
+    }
+    if (!wav) {
+        fclose(file);
     }
 
-    // Write the JSON footer
-    fprintf(file, "  ]\n");
-    fprintf(file, "}\n");
+    // Write the index, file names are relative to it
+    char indexPath[MAX_PATH_LENGTH];
+    snprintf(indexPath, MAX_PATH_LENGTH, "%s.json", name);
+    FILE *index = fopen(indexPath, "w");
+    if (!index) {
+        fprintf(stderr, "Error opening %s for writing.\n", indexPath);
+        return 1;
+    }
 
-    // Close the file
-    fclose(file);
-    printf("Waveform data written to waveforms.json\n");
+    const char* baseStart = strrchr(name, '/');
+    int baseOffset = baseStart ? (int)(baseStart - name) + 1 : 0;
+
+    fprintf(index, "{\n");
+    fprintf(index, "  \"version\": 1,\n");
+    fprintf(index, "  \"sample_rate\": %d,\n", SAMPLE_RATE);
+    fprintf(index, "  \"frequency\": %.1f,\n", (double)frequency);
+    fprintf(index, "  \"end_frequency\": %.1f,\n", (double)endFrequency);
+    fprintf(index, "  \"duty_cycle\": %.2f,\n", (double)dutyCycle);
+    fprintf(index, "  \"duration\": %.6f,\n", (double)numSamples / SAMPLE_RATE);
+    fprintf(index, "  \"waveforms\": [\n");
+    for (int w = 0; w < numWaveforms; w++) {
+        fprintf(index, "    { \"name\": \"%s\", \"file\": \"%s\", \"offset\": %ld, \"count\": %ld, \"type\": \"%s\" }%s\n",
+                waveformNames[w], files[w].path + baseOffset, files[w].offset, files[w].count, files[w].type,
+                (w == numWaveforms - 1) ? "" : ",");
+    }
+    fprintf(index, "  ]\n");
+    fprintf(index, "}\n");
+    fclose(index);
+
+    printf("%d waveforms of %ld samples written, index in %s\n", numWaveforms, numSamples, indexPath);
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,44 +1,51 @@
-
 ;; Compiled C Binary Code
 %COMPILED_C_BINARY
 ;; Load the compiled C code
 (load-native-lib vvvf)
 
-;; define motor current and rpm globally so it shows up in the vesc debugger with the values when polling
-(def motor-current 0)
-(def motor-rpm 0)
-(def speed-kmh 0)
-(def motor-poles (conf-get 'si-motor-poles))
-
-;; Function to update amplitude and command frequency
-(defun update-audio-parameters ()
-  (progn
-    (def motor-current (abs (get-current)))
-    (def motor-rpm (get-rpm))
-    (def speed-kmh (* (get-speed) 3.6)) ; Get speed returns the value in meters/second, so we convert to km/h
-
-    
-    ; (ext-set-amplitude amplitude)
-    (ext-set-motor-current motor-current)
-    (ext-set-motor-hz motor-rpm)
-    (ext-set-motor-poles motor-poles)
-    (ext-set-speed-kmh speed-kmh)
-  )
-
-)
+;; Select the switching pattern profile, either by index or by name (see Profiles.c)
+(ext-set-profile 0)
 
-;; Start the audio loop
-(ext-start-audio-loop)
+;; Push the status packet to the dashboard 10 times per second, 0 turns it off
+(ext-set-telemetry-rate 10)
+
+;; OPTIONAL: send 10 output snapshots per second for the dashboard scope and spectrogram
+; (ext-set-snapshot-rate 10)
 
-;; Debug: Print a message before entering the main loop
-(print "Entering main loop...")
+;; The library reads current, rpm, speed and poles from the motor itself, 50 times per second.
+;; Nothing has to be polled from Lisp.
+(ext-set-update-rate 50)
 
-;; Main loop to update parameters every 20ms
-(loopwhile t {
-  (update-audio-parameters)
+;; OPTIONAL: on a dual motor controller, give each motor the sound of its own speed
+; (ext-set-motor-count 2)
 
-  ;; OPTIONAL FOR DEBUGGING
-  (ext-get-stats)
+;; OPTIONAL: keep the sound further away from the duty cycle limit (default 0.9, 0 turns it off)
+; (ext-set-voltage-limit 0.85)
+
+;; Start the audio loop
+(ext-start-audio-loop)
 
-  (sleep 0.02) ; Sleep for 20ms
-})
\ No newline at end of file
+;; OPTIONAL: react to state changes. The thread sleeps in ext-wait-event until something happens.
+;; Events are (type from to speed-kmh), with the types of EventType in EventLog.h.
+;; Keeps the active speed range in a global so it shows up in the vesc debugger.
+; (def event-speed-range 2) ; EVENT_SPEED_RANGE
+; (def speed-range -1)
+;
+; (defun handle-vvvf-event (event)
+;   (if (= (ix event 0) event-speed-range)
+;     (def speed-range (ix event 2))
+;   )
+; )
+;
+; (spawn (fn ()
+;   (loopwhile (ext-wait-event) {
+;     (var event (ext-next-event))
+;     (loopwhile event {
+;       (handle-vvvf-event event)
+;       (setq event (ext-next-event))
+;     })
+;   })
+; ))
+
+;; OPTIONAL FOR DEBUGGING, the dashboard gets the same status from the telemetry packets
+; (loopwhile t { (ext-print-stats) (sleep 1) })
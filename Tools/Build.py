@@ -1,6 +1,18 @@
 #!/usr/bin/python3
 
 import os
+import argparse
+
+# --pack lz makes the script about half the size, it is unpacked on the VESC before
+# load-native-lib, see C/conv.py for the formats
+parser = argparse.ArgumentParser(description="Build the C code and insert it into the Lisp script")
+parser.add_argument("--pack", choices=["hex", "dec", "lz"], default="hex", help="format of the native lib array")
+parser.add_argument("--time-unpack", action="store_true", help="print the unpack time on the VESC, lz only")
+args = parser.parse_args()
+
+ConvOptions = "-r -m " + args.pack
+if args.time_unpack:
+    ConvOptions += " -t"
 
 # Info Message
 os.system("clear")
@@ -8,7 +20,7 @@ print("-- Starting, note that you need the arm toolchain for linux: apt install
 
 # Build c into lisp
 print(" -- Building C Code --\n")
-assert(os.system("cd ../C/VVVF/ && make -j") == 0)
+assert(os.system("cd ../C/VVVF/ && make -j CONV_OPT=\"" + ConvOptions + "\"") == 0)
 print(" -- Done Building C Code --\n")
 
 # Now, get the binary and insert it into the lisp code to be used